@@ -0,0 +1,138 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/base/Clock.h"
+#include "muduo/base/FileUtil.h"
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MUDUO_HAVE_TSC 1
+#endif
+
+namespace muduo
+{
+namespace detail
+{
+
+Timestamp clockGetTime(clockid_t id)
+{
+  struct timespec ts;
+  ::clock_gettime(id, &ts);
+  return Timestamp(static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond
+                   + ts.tv_nsec / 1000);
+}
+
+#ifdef MUDUO_HAVE_TSC
+struct TscCalibration
+{
+  bool reliable;
+  double ticksPerMicroSecond;
+  int64_t ticksPerSecond;  // re-anchor interval
+};
+
+bool invariantTsc()
+{
+  string cpuinfo;
+  FileUtil::readFile("/proc/cpuinfo", 1024 * 1024, &cpuinfo);
+  //频率不随调频变化，深度睡眠时也不停
+  return cpuinfo.find(" constant_tsc") != string::npos
+      && cpuinfo.find(" nonstop_tsc") != string::npos;
+}
+
+TscCalibration calibrate()
+{
+  TscCalibration c = { false, 0.0, 0 };
+  if (invariantTsc())
+  {
+    Timestamp start = clockGetTime(CLOCK_MONOTONIC);
+    uint64_t startTicks = __rdtsc();
+    struct timespec ts = { 0, 10 * 1000 * 1000 };
+    ::nanosleep(&ts, NULL);
+    Timestamp end = clockGetTime(CLOCK_MONOTONIC);
+    uint64_t endTicks = __rdtsc();
+    int64_t us = end.microSecondsSinceEpoch() - start.microSecondsSinceEpoch();
+    if (us > 0 && endTicks > startTicks)
+    {
+      c.ticksPerMicroSecond = static_cast<double>(endTicks - startTicks) / static_cast<double>(us);
+      c.ticksPerSecond = static_cast<int64_t>(c.ticksPerMicroSecond * Timestamp::kMicroSecondsPerSecond);
+      c.reliable = c.ticksPerSecond > 0;
+    }
+  }
+  return c;
+}
+
+const TscCalibration& tscCalibration()
+{
+  static const TscCalibration calibration = calibrate();  // thread safe since C++11
+  return calibration;
+}
+
+__thread uint64_t t_anchorTicks = 0;
+__thread int64_t t_anchorMicroSeconds = 0;
+__thread int64_t t_lastMicroSeconds = 0;
+#endif  // MUDUO_HAVE_TSC
+
+}  // namespace detail
+}  // namespace muduo
+
+using namespace muduo;
+using namespace muduo::detail;
+
+Timestamp Clock::monotonic()
+{
+  return clockGetTime(CLOCK_MONOTONIC);
+}
+
+Timestamp Clock::monotonicCoarse()
+{
+  return clockGetTime(CLOCK_MONOTONIC_COARSE);
+}
+
+Timestamp Clock::realtimeCoarse()
+{
+  return clockGetTime(CLOCK_REALTIME_COARSE);
+}
+
+Timestamp Clock::toMonotonic(Timestamp wallTime)
+{
+  int64_t delta = wallTime.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+  return Timestamp(monotonic().microSecondsSinceEpoch() + delta);
+}
+
+bool Clock::tscReliable()
+{
+#ifdef MUDUO_HAVE_TSC
+  return tscCalibration().reliable;
+#else
+  return false;
+#endif
+}
+
+Timestamp Clock::tsc()
+{
+#ifdef MUDUO_HAVE_TSC
+  const TscCalibration& c = tscCalibration();
+  if (c.reliable)
+  {
+    uint64_t ticks = __rdtsc();
+    int64_t elapsed = static_cast<int64_t>(ticks - t_anchorTicks);
+    if (t_anchorTicks == 0 || elapsed < 0 || elapsed >= c.ticksPerSecond)
+    {
+      //每秒用CLOCK_MONOTONIC校准一次，误差不会累积
+      t_anchorMicroSeconds = monotonic().microSecondsSinceEpoch();
+      t_anchorTicks = ticks;
+      elapsed = 0;
+    }
+    int64_t us = t_anchorMicroSeconds + static_cast<int64_t>(static_cast<double>(elapsed) / c.ticksPerMicroSecond);
+    if (us < t_lastMicroSeconds)
+    {
+      us = t_lastMicroSeconds;
+    }
+    t_lastMicroSeconds = us;
+    return Timestamp(us);
+  }
+#endif
+  return monotonic();
+}
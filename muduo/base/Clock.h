@@ -0,0 +1,54 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_BASE_CLOCK_H
+#define MUDUO_BASE_CLOCK_H
+
+#include "muduo/base/Timestamp.h"
+
+namespace muduo
+{
+
+///
+/// Clock sources other than Timestamp::now(), all in microseconds.
+///
+/// Timestamp::now() is the wall clock, which may be stepped by NTP or date(1).
+/// Timers and intervals should use monotonic(), whose Timestamp counts
+/// from an unspecified point (usually boot), so it can only be compared
+/// with other monotonic Timestamps, and must not be formatted as a date.
+///
+/// The coarse clocks are several times cheaper, but only updated every
+/// jiffy (1~4ms), good for log lines and idle timeouts.
+/// In callbacks of an EventLoop, EventLoop::pollReturnTime() is a free
+/// approximate wall time.
+///
+namespace Clock
+{
+  /// CLOCK_MONOTONIC
+  Timestamp monotonic();
+
+  /// CLOCK_MONOTONIC_COARSE
+  Timestamp monotonicCoarse();
+
+  /// CLOCK_REALTIME_COARSE, same epoch as Timestamp::now().
+  Timestamp realtimeCoarse();
+
+  /// Converts a wall clock Timestamp to the monotonic clock.
+  Timestamp toMonotonic(Timestamp wallTime);
+
+  ///
+  /// Monotonic clock read from the TSC, calibrated against CLOCK_MONOTONIC
+  /// on first use and re-anchored every second per thread.
+  /// Never goes backwards within a thread, may differ a few microseconds
+  /// between threads.
+  /// Falls back to monotonic() if the TSC is not invariant.
+  ///
+  Timestamp tsc();
+  bool tscReliable();
+}  // namespace Clock
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_CLOCK_H
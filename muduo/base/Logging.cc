@@ -5,6 +5,7 @@
 
 #include "muduo/base/Logging.h"
 
+#include "muduo/base/Clock.h"
 #include "muduo/base/CurrentThread.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/base/TimeZone.h"
@@ -112,13 +113,14 @@ void defaultFlush()
 Logger::OutputFunc g_output = defaultOutput;
 Logger::FlushFunc g_flush = defaultFlush;
 TimeZone g_logTimeZone;
+Logger::ClockFunc g_clock = Clock::realtimeCoarse; //每条日志少一次精确时间的读取
 
 } // namespace sserver
 
 using namespace sserver;
 
 Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile &file, int line)
-    : time_(Timestamp::now()),
+    : time_(g_clock()),
       stream_(),
       level_(level),
       line_(line),
@@ -230,3 +232,8 @@ void Logger::setTimeZone(const TimeZone &tz)
 {
     g_logTimeZone = tz;
 }
+
+void Logger::setClock(ClockFunc clock)
+{
+    g_clock = clock; //要微秒精度时换成Timestamp::now
+}
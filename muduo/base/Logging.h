@@ -79,6 +79,10 @@ public:
   static void setOutput(OutputFunc); //设置输出函数
   static void setFlush(FlushFunc);   //清空缓冲
   static void setTimeZone(const TimeZone &tz);
+  /// Clock of log lines, Clock::realtimeCoarse() by default, cheap but
+  /// with jiffy resolution, Timestamp::now() for microseconds.
+  typedef Timestamp (*ClockFunc)();
+  static void setClock(ClockFunc);
 
 private:
   //Loger类的内部嵌套类
@@ -0,0 +1,43 @@
+#include "muduo/base/Clock.h"
+
+#include <algorithm>
+
+#include <inttypes.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+// ns per call of each clock source, and the largest step backwards
+void bench(const char* name, Timestamp (*clock)())
+{
+  const int kNumber = 10 * 1000 * 1000;
+  Timestamp start(Clock::monotonic());
+  Timestamp last = clock();
+  int64_t reverse = 0;
+  for (int i = 0; i < kNumber; ++i)
+  {
+    Timestamp now = clock();
+    if (now < last)
+    {
+      reverse = std::max(reverse, last.microSecondsSinceEpoch() - now.microSecondsSinceEpoch());
+    }
+    last = now;
+  }
+  double seconds = timeDifference(Clock::monotonic(), start);
+  printf("%-16s %6.1f ns/call, reverse %" PRId64 " us\n", name, seconds * 1e9 / kNumber, reverse);
+}
+
+int main()
+{
+  printf("tsc reliable %d\n", Clock::tscReliable());
+  bench("now", Timestamp::now);
+  bench("monotonic", Clock::monotonic);
+  bench("monotonicCoarse", Clock::monotonicCoarse);
+  bench("realtimeCoarse", Clock::realtimeCoarse);
+  bench("tsc", Clock::tsc);
+
+  // drift of tsc from monotonic
+  Timestamp mono = Clock::monotonic();
+  Timestamp tsc = Clock::tsc();
+  printf("tsc - monotonic %" PRId64 " us\n", tsc.microSecondsSinceEpoch() - mono.microSecondsSinceEpoch());
+}
@@ -13,6 +13,7 @@
 
 #include <functional>
 
+#include "muduo/base/Types.h"
 #include "muduo/net/Channel.h"
 #include "muduo/net/Socket.h"
 
@@ -25,7 +26,7 @@ class EventLoop;
 class InetAddress;
 
 ///
-/// Acceptor of incoming TCP connections.
+/// Acceptor of incoming TCP or Unix domain stream connections.
 /// 用于接受tcp套接字的链接
 /// 一个Channel中有一个套接字，但是这个Channel不拥有套接字，他是不管理套接字的生命周期的！
 /// 他们之间只是绑定，套接字的拥有者是Acceptor和TcpConnection。
@@ -52,6 +53,8 @@ public:
     void listen(); //使得Acceptor类中的acceptSocket_处于监听状态的函数
 
 private:
+    static const int kMaxAcceptsPerRead = 16;
+
     void handleRead();
 
     EventLoop *loop_;       //accept所属的eventloop
@@ -61,6 +64,7 @@ private:
     NewConnectionCallback newConnectionCallback_;
     bool listenning_; //所属的eventloop是否处于监听状态
     int idleFd_;
+    string unixPath_; //Unix域套接字的文件路径，析构时删除
 };
 
 }  // namespace net
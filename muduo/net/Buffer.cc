@@ -26,6 +26,11 @@ const size_t Buffer::kInitialSize;
 //如果有5k个连接，每个连接就分配64k+64k的缓冲区的话，将占用640m
 //而大多数的时候，这些缓冲区的使用率很低
 ssize_t Buffer::readFd(int fd, int *savedErrno)
+{
+    return readFd(fd, savedErrno, NULL);
+}
+
+ssize_t Buffer::readFd(int fd, int *savedErrno, std::vector<int> *fds)
 {
     // saved an ioctl()/FIONREAD call to tell how much to read
     //节省了一次ioctl系统调用（获取有多少可读数据）
@@ -41,7 +46,18 @@ ssize_t Buffer::readFd(int fd, int *savedErrno)
     // when there is enough space in this buffer, don't read into extrabuf.
     // when extrabuf is used, we read 128k-1 bytes at most.
     const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
-    const ssize_t n = sockets::readv(fd, vec, iovcnt);
+    ssize_t n = 0;
+    if (fds == NULL)
+    {
+        n = sockets::readv(fd, vec, iovcnt);
+    }
+    else
+    {
+        int received[16];
+        int nfds = 0;
+        n = sockets::readvWithFds(fd, vec, iovcnt, received, 16, &nfds);
+        fds->insert(fds->end(), received, received + nfds);
+    }
     if (n < 0)
     {
         *savedErrno = errno;
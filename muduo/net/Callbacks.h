@@ -15,6 +15,7 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace muduo
 {
@@ -65,6 +66,12 @@ typedef std::function<void (const TcpConnectionPtr&)> ConnectionCallback;
 typedef std::function<void (const TcpConnectionPtr&)> CloseCallback;
 typedef std::function<void (const TcpConnectionPtr&)> WriteCompleteCallback;
 typedef std::function<void (const TcpConnectionPtr&, size_t)> HighWaterMarkCallback;
+typedef std::function<void (const TcpConnectionPtr&, size_t)> LowWaterMarkCallback;
+// true to pause a producer, false to resume it
+typedef std::function<void (bool)> FlowControlCallback;
+// file descriptors passed over a Unix domain socket, owned by the callback
+typedef std::function<void (const TcpConnectionPtr&,
+                            const std::vector<int>&)> FdsCallback;
 
 // the data has been read to (buf, len)
 typedef std::function<void (const TcpConnectionPtr&,
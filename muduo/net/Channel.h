@@ -6,7 +6,7 @@
 
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
 //
-// This is an internal header file, you should not include this.
+// This is a public header file, it must only include public header files.
 
 #ifndef MUDUO_NET_CHANNEL_H
 #define MUDUO_NET_CHANNEL_H
@@ -93,6 +93,7 @@ public:
     void disableAll() //不关注事件了
     {
         events_ = kNoneEvent;
+        update();
     }
     bool isWriting() const { return events_ & kWriteEvent; }
     bool isReading() const { return events_ & kReadEvent; }
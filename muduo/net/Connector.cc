@@ -26,7 +26,8 @@ Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
       serverAddr_(serverAddr),
       connect_(false),
       state_(kDisconnected),
-      retryDelayMs_(kInitRetryDelayMs)
+      retryDelayMs_(kInitRetryDelayMs),
+      addressIndex_(0)
 {
     LOG_DEBUG << "ctor[" << this << "]";
 }
@@ -77,8 +78,8 @@ void Connector::stopInLoop()
 
 void Connector::connect()
 {
-    int sockfd = sockets::createNonblockingOrDie(); //创建非阻塞套接字
-    int ret = sockets::connect(sockfd, serverAddr_.getSockAddrInet());
+    int sockfd = sockets::createNonblockingOrDie(serverAddr_.family()); //创建非阻塞套接字
+    int ret = sockets::connect(sockfd, serverAddr_.getSockAddr());
     int savedErrno = (ret == 0) ? 0 : errno;
     switch (savedErrno)
     {
@@ -94,6 +95,7 @@ void Connector::connect()
     case EADDRNOTAVAIL:
     case ECONNREFUSED:
     case ENETUNREACH:
+    case ENOENT: // Unix domain socket not created yet
         retry(sockfd); //表示没有连接成功重连
         break;
 
@@ -125,6 +127,14 @@ void Connector::restart()
     startInLoop();
 }
 
+void Connector::setServerAddresses(const std::vector<InetAddress> &addresses)
+{
+    assert(!addresses.empty());
+    addresses_ = addresses;
+    addressIndex_ = 0;
+    serverAddr_ = addresses_[0];
+}
+
 void Connector::connecting(int sockfd)
 {
     setState(kConnecting); //在这里设置状态
@@ -216,8 +226,19 @@ void Connector::retry(int sockfd)
 {
     sockets::close(sockfd);  //重连之前先关闭套接字
     setState(kDisconnected); //设置套接字状态
-    if (connect_)
+    if (connect_ && addressIndex_ + 1 < addresses_.size())
     {
+        serverAddr_ = addresses_[++addressIndex_]; //先试下一个地址，不等待
+        LOG_INFO << "Connector::retry - Try next address " << serverAddr_.toIpPort();
+        loop_->queueInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+    }
+    else if (connect_)
+    {
+        if (!addresses_.empty())
+        {
+            addressIndex_ = 0;
+            serverAddr_ = addresses_[0]; //都失败了，退避之后从头再来
+        }
         LOG_INFO << "Connector::retry - Retry connecting to " << serverAddr_.toIpPort()
                  << " in " << retryDelayMs_ << " milliseconds. ";
         //注册一个定时操作，重连
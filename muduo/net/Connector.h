@@ -16,6 +16,7 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace muduo
 {
@@ -44,6 +45,16 @@ public:
     void stop();    // can be called in any thread
 
     const InetAddress &serverAddress() const { return serverAddr_; }
+    /// Takes effect on the next connect, must be called in loop thread,
+    /// eg. with a freshly resolved address before restart().
+    void setServerAddress(const InetAddress &serverAddr)
+    {
+        serverAddr_ = serverAddr;
+        addresses_.clear();
+    }
+    /// Like setServerAddress(), a failed connect goes on to the next one
+    /// at once, the delay grows only when all of them have failed.
+    void setServerAddresses(const std::vector<InetAddress> &addresses);
 
 private:
     enum States
@@ -73,6 +84,8 @@ private:
     std::unique_ptr<Channel> channel_;            //connector所对应的channel
     NewConnectionCallback newConnectionCallback_; //连接成功回调函数
     int retryDelayMs_;                            //重连延迟时间（单位：毫秒）
+    std::vector<InetAddress> addresses_;          //可以轮流连接的地址，空的话只有serverAddr_
+    size_t addressIndex_;                         //serverAddr_在addresses_中的下标
 };
 
 } // namespace net
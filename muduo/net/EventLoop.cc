@@ -8,6 +8,7 @@
 
 #include "muduo/net/EventLoop.h"
 
+#include "muduo/base/Clock.h"
 #include "muduo/base/Logging.h"
 #include "muduo/base/Mutex.h"
 #include "muduo/net/Channel.h"
@@ -64,7 +65,12 @@ EventLoop *EventLoop::getEventLoopOfCurrentThread()
     return t_loopInThisThread;
 }
 
-EventLoop::EventLoop() //调用构造函数创建对象
+EventLoop::EventLoop()
+    : EventLoop(kDefaultTimerQueue)
+{
+}
+
+EventLoop::EventLoop(TimerQueueType timerQueueType, double timerTick) //调用构造函数创建对象
     : looping_(false),
       quit_(false),
       eventHandling_(false),
@@ -72,7 +78,7 @@ EventLoop::EventLoop() //调用构造函数创建对象
       iteration_(0),
       threadId_(CurrentThread::tid()),
       poller_(Poller::newDefaultPoller(this)), //构造了一个Poller实体对象，是ppoller或者epoller，通过newdefaultpoller函数来判断
-      timerQueue_(new TimerQueue(this)),
+      timerQueue_(TimerQueue::newTimerQueue(this, timerQueueType, timerTick)), //定时器队列的实现，同poller一样可以选择
       wakeupFd_(createEventfd()), //创建一个eventfd
       wakeupChannel_(new Channel(this, wakeupFd_)),
       currentActiveChannel_(NULL)
@@ -119,7 +125,16 @@ void EventLoop::loop() //io线程
     while (!quit_)
     {
         activeChannels_.clear();
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_); //kPolltimems是超时时间，这个超时时间默认给的10s，相当于一直没有时间10s之后返回一次
+        if (timerQueue_->usesTimerfd())
+        {
+            pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_); //kPolltimems是超时时间，这个超时时间默认给的10s，相当于一直没有时间10s之后返回一次
+        }
+        else
+        {
+            //不用timerfd，poll的超时时间就是最早定时器的到期时间，精确到微秒
+            int64_t timeoutUs = timerQueue_->pollTimeout(kPollTimeMs * 1000LL);
+            pollReturnTime_ = poller_->pollMicroSeconds(timeoutUs, &activeChannels_);
+        }
         ++iteration_;
         if (Logger::logLevel() <= Logger::TRACE)
         {
@@ -134,6 +149,7 @@ void EventLoop::loop() //io线程
         }
         currentActiveChannel_ = NULL; //全部处理完
         eventHandling_ = false;
+        timerQueue_->handleExpired(); //不用timerfd时，在这里处理到期的定时器
         doPendingFunctors(); //让io线程除了io操作，也能执行一些任务，可以添加一些计算任务比较小的，来让他们执行,
                              //还有就是主线程accept新连接的的套接字传下来，注册到该eventloop的读事件
     }
@@ -190,21 +206,21 @@ size_t EventLoop::queueSize() const
     return pendingFunctors_.size();
 }
 
-TimerId EventLoop::runAt(const Timestamp &time, TimerCallback cb)
-{                                                           //在某个时间运行定时器任务
-    return timerQueue_->addTimer(std::move(cb), time, 0.0); //把cb添加
+TimerId EventLoop::runAt(const Timestamp &time, TimerCallback cb, double slack)
+{ //在某个时间运行定时器任务，TimerQueue用单调时钟，不受修改系统时间的影响
+    return timerQueue_->addTimer(std::move(cb), Clock::toMonotonic(time), 0.0, slack); //把cb添加
 }
 
-TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+TimerId EventLoop::runAfter(double delay, TimerCallback cb, double slack)
 { //在过多久之后运行定时器任务
-    Timestamp time(addTime(Timestamp::now(), delay));
-    return runAt(time, std::move(cb));
+    Timestamp time(addTime(Clock::monotonic(), delay));
+    return timerQueue_->addTimer(std::move(cb), time, 0.0, slack);
 }
 
-TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+TimerId EventLoop::runEvery(double interval, TimerCallback cb, double slack)
 {                                                        //每过多久就运行一次定时器事件
-    Timestamp time(addTime(Timestamp::now(), interval)); //间隔时间传递进去
-    return timerQueue_->addTimer(std::move(cb), time, interval);
+    Timestamp time(addTime(Clock::monotonic(), interval)); //间隔时间传递进去
+    return timerQueue_->addTimer(std::move(cb), time, interval, slack);
 }
 
 void EventLoop::cancel(TimerId timerId)
@@ -212,6 +228,11 @@ void EventLoop::cancel(TimerId timerId)
     return timerQueue_->cancel(timerId);
 }
 
+void EventLoop::restart(TimerId timerId, const Timestamp &time)
+{
+    timerQueue_->restart(timerId, Clock::toMonotonic(time));
+}
+
 void EventLoop::updateChannel(Channel *channel)
 {
     assert(channel->ownerLoop() == this); //channel是属于本对象的才可以用
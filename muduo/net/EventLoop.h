@@ -53,7 +53,18 @@ class EventLoop : noncopyable //rector模式的封装
 public:
     typedef std::function<void()> Functor;
 
+    /// Implementations of the timer queue, see runAt().
+    enum TimerQueueType
+    {
+        kDefaultTimerQueue, // chosen by MUDUO_USE_TIMING_WHEEL or MUDUO_USE_TIMER_HEAP, otherwise kSetTimerQueue
+        kSetTimerQueue,     // std::set, precise, O(log n) add and cancel
+        kWheelTimerQueue,   // hierarchical timing wheel, O(1) add and cancel, rounded up to tick
+        kHeapTimerQueue,    // indexed 4-ary heap, precise, O(log n) add and cancel without allocation
+    };
+
     EventLoop();
+    /// @c timerTick is the granularity of kWheelTimerQueue in seconds.
+    explicit EventLoop(TimerQueueType timerQueueType, double timerTick = 0.001);
     ~EventLoop(); // force out-line dtor, for scoped_ptr members.
 
     ///
@@ -91,26 +102,37 @@ public:
 
     size_t queueSize() const;
     // timerss
+    //
+    // A timer with @c slack may run up to @c slack seconds late,
+    // so timers whose windows overlap are run by one wakeup,
+    // e.g. idle connection timeouts do not need to be precise.
+    //
     ///
     /// Runs callback at 'time'.
     /// Safe to call from other threads.
     /// 某个时间点执行定时回调
-    TimerId runAt(const Timestamp &time, TimerCallback cb);
+    TimerId runAt(const Timestamp &time, TimerCallback cb, double slack = 0.0);
     ///
     /// Runs callback after @c delay seconds.
     /// Safe to call from other threads.
     /// 某个时间点之后执行定时回调
-    TimerId runAfter(double delay, TimerCallback cb);
+    TimerId runAfter(double delay, TimerCallback cb, double slack = 0.0);
     ///
     /// Runs callback every @c interval seconds.
     /// Safe to call from other threads.
     /// 在每个时间间隔处理某个回调函数
-    TimerId runEvery(double interval, TimerCallback cb);
+    TimerId runEvery(double interval, TimerCallback cb, double slack = 0.0);
     ///
     /// Cancels the timer.
     /// Safe to call from other threads.
     /// 删除某个定时器
     void cancel(TimerId timerId);
+    ///
+    /// Moves the timer to @c time, cheaper than cancel() and runAt().
+    /// Ignored if the timer has fired or been canceled.
+    /// Safe to call from other threads.
+    /// 原地重置某个定时器的到期时间
+    void restart(TimerId timerId, const Timestamp &time);
 
     // internal usage
     void wakeup();                        //唤醒事件通知描述符
@@ -0,0 +1,140 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/Hub.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+///
+/// Subscribers of one loop, only accessed in that loop.
+///
+/// Tasks hold it by shared_ptr, so it outlives the hub if needed.
+///
+class Hub::Shard : noncopyable
+{
+ public:
+  explicit Shard(EventLoop* loop)
+    : loop_(loop)
+  {
+  }
+
+  void subscribe(const string& topic, const TcpConnectionPtr& conn)
+  {
+    loop_->assertInLoopThread();
+    topics_[topic][get_pointer(conn)] = conn;
+  }
+
+  void unsubscribe(const string& topic, const TcpConnectionPtr& conn)
+  {
+    loop_->assertInLoopThread();
+    TopicMap::iterator it = topics_.find(topic);
+    if (it != topics_.end())
+    {
+      it->second.erase(get_pointer(conn));
+      if (it->second.empty())
+      {
+        topics_.erase(it);
+      }
+    }
+  }
+
+  void deliver(const string& topic, const Block& block)
+  {
+    loop_->assertInLoopThread();
+    TopicMap::iterator it = topics_.find(topic);
+    if (it == topics_.end())
+    {
+      return;
+    }
+    Subscribers& subscribers = it->second;
+    for (Subscribers::iterator sub = subscribers.begin(); sub != subscribers.end(); )
+    {
+      TcpConnectionPtr conn = sub->second.lock();
+      if (conn && conn->connected())
+      {
+        conn->send(block);
+        ++sub;
+      }
+      else
+      {
+        sub = subscribers.erase(sub);
+      }
+    }
+    if (subscribers.empty())
+    {
+      topics_.erase(it);
+    }
+  }
+
+ private:
+  // keyed by address, a new connection at the same address replaces the old one
+  typedef std::map<TcpConnection*, std::weak_ptr<TcpConnection>> Subscribers;
+  typedef std::map<string, Subscribers> TopicMap;
+
+  EventLoop* loop_;
+  TopicMap topics_;
+};
+
+Hub::Hub(const string& nameArg)
+  : name_(nameArg)
+{
+}
+
+Hub::~Hub()
+{
+}
+
+void Hub::start(const std::vector<EventLoop*>& loops)
+{
+  assert(shards_.empty());
+  for (EventLoop* loop : loops)
+  {
+    shards_[loop].reset(new Shard(loop));
+  }
+}
+
+Hub::ShardPtr Hub::findShard(EventLoop* loop) const
+{
+  std::map<EventLoop*, ShardPtr>::const_iterator it = shards_.find(loop);
+  return it == shards_.end() ? ShardPtr() : it->second;
+}
+
+void Hub::subscribe(const string& topic, const TcpConnectionPtr& conn)
+{
+  ShardPtr shard = findShard(conn->getLoop());
+  if (shard)
+  {
+    conn->getLoop()->runInLoop(std::bind(&Shard::subscribe, shard, topic, conn));
+  }
+  else
+  {
+    LOG_ERROR << "Hub::subscribe [" << name_ << "] - " << conn->name()
+              << " is not in a loop of the hub";
+  }
+}
+
+void Hub::unsubscribe(const string& topic, const TcpConnectionPtr& conn)
+{
+  ShardPtr shard = findShard(conn->getLoop());
+  if (shard)
+  {
+    conn->getLoop()->runInLoop(std::bind(&Shard::unsubscribe, shard, topic, conn));
+  }
+}
+
+void Hub::publish(const string& topic, const StringPiece& payload)
+{
+  publish(topic, std::make_shared<const string>(payload.data(), payload.size()));
+}
+
+void Hub::publish(const string& topic, const Block& block)
+{
+  for (const auto& item : shards_)
+  {
+    item.first->runInLoop(std::bind(&Shard::deliver, item.second, topic, block));
+  }
+}
@@ -0,0 +1,68 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HUB_H
+#define MUDUO_NET_HUB_H
+
+#include "muduo/net/TcpConnection.h"
+
+#include <map>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Publish/subscribe of messages to many connections.
+///
+/// Subscribers are kept per loop, and only touched in that loop.
+/// publish() copies the payload once into an immutable block and posts
+/// one task to every loop, which sends the block by reference to the
+/// subscribers of the topic, see TcpConnection::send(const std::shared_ptr<const string>&).
+/// Messages published by one thread arrive in order.
+///
+/// Subscribers that have disconnected are dropped at the next publish
+/// of the topic.
+///
+class Hub : noncopyable
+{
+ public:
+  typedef std::shared_ptr<const string> Block;
+
+  explicit Hub(const string& nameArg);
+  ~Hub();  // force out-line dtor, for std::shared_ptr members.
+
+  const string& name() const { return name_; }
+
+  /// The loops of the subscribers, eg. TcpServer::threadPool()->getAllLoops().
+  /// Not thread safe, call only once.
+  void start(const std::vector<EventLoop*>& loops);
+
+  /// Thread safe, @c conn must live in one of the loops passed to start().
+  void subscribe(const string& topic, const TcpConnectionPtr& conn);
+  void unsubscribe(const string& topic, const TcpConnectionPtr& conn);
+
+  /// Thread safe, copies @c payload once for all subscribers.
+  void publish(const string& topic, const StringPiece& payload);
+  /// Thread safe, @c block must not change afterwards.
+  void publish(const string& topic, const Block& block);
+
+ private:
+  class Shard;
+  typedef std::shared_ptr<Shard> ShardPtr;
+
+  ShardPtr findShard(EventLoop* loop) const;
+
+  const string name_;
+  // immutable after start(), so publish() does not lock
+  std::map<EventLoop*, ShardPtr> shards_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_HUB_H
@@ -45,8 +45,9 @@ static const in_addr_t kInaddrLoopback = INADDR_LOOPBACK;
 using namespace muduo;
 using namespace muduo::net;
 
-static_assert(sizeof(InetAddress) == sizeof(struct sockaddr_in6),
-              "InetAddress is same size as sockaddr_in6");
+static_assert(sizeof(InetAddress) >= sizeof(struct sockaddr_un),
+              "InetAddress holds a sockaddr_un");
+static_assert(offsetof(sockaddr_un, sun_family) == 0, "sun_family offset 0");
 static_assert(offsetof(sockaddr_in, sin_family) == 0, "sin_family offset 0");
 static_assert(offsetof(sockaddr_in6, sin6_family) == 0, "sin6_family offset 0");
 static_assert(offsetof(sockaddr_in, sin_port) == 2, "sin_port offset 2");
@@ -88,8 +89,50 @@ InetAddress::InetAddress(StringArg ip, uint16_t port, bool ipv6)
   }
 }
 
+InetAddress::InetAddress(const struct sockaddr_storage& addr)
+{
+  memZero(&addrUn_, sizeof addrUn_);
+  switch (addr.ss_family)
+  {
+  case AF_INET:
+    ::memcpy(&addr_, &addr, sizeof addr_);
+    break;
+  case AF_INET6:
+    ::memcpy(&addr6_, &addr, sizeof addr6_);
+    break;
+  default:
+    // AF_UNIX, sun_path is not NUL terminated if it is full
+    ::memcpy(&addrUn_, &addr, sizeof addrUn_);
+    break;
+  }
+}
+
+InetAddress InetAddress::fromUnixPath(StringArg path)
+{
+  InetAddress result;
+  struct sockaddr_un& addr = result.addrUn_;
+  memZero(&addr, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  size_t len = ::strlen(path.c_str());
+  if (len >= sizeof addr.sun_path)
+  {
+    LOG_ERROR << "InetAddress::fromUnixPath - path too long " << path.c_str();
+    len = sizeof addr.sun_path - 1;
+  }
+  ::memcpy(addr.sun_path, path.c_str(), len);
+  if (addr.sun_path[0] == '@')
+  {
+    addr.sun_path[0] = '\0';  // abstract namespace
+  }
+  return result;
+}
+
 string InetAddress::toIpPort() const
 {
+  if (family() == AF_UNIX)
+  {
+    return "unix:" + toIp();
+  }
   char buf[64] = "";
   sockets::toIpPort(buf, sizeof buf, getSockAddr());
   return buf;
@@ -97,6 +140,15 @@ string InetAddress::toIpPort() const
 
 string InetAddress::toIp() const //只转换ip
 {
+  if (family() == AF_UNIX)
+  {
+    const char* path = addrUn_.sun_path;
+    if (path[0] == '\0' && path[1] != '\0')
+    {
+      return "@" + string(path + 1, ::strnlen(path + 1, sizeof addrUn_.sun_path - 1));
+    }
+    return string(path, ::strnlen(path, sizeof addrUn_.sun_path));
+  }
   char buf[64] = "";
   sockets::toIp(buf, sizeof buf, getSockAddr());
   return buf;
@@ -110,7 +162,7 @@ uint32_t InetAddress::ipNetEndian() const
 
 uint16_t InetAddress::toPort() const
 {
-  return sockets::networkToHost16(portNetEndian());
+  return family() == AF_UNIX ? 0 : sockets::networkToHost16(portNetEndian());
 }
 
 static __thread char t_resolveBuffer[64 * 1024];
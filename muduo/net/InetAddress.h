@@ -15,6 +15,7 @@
 #include "muduo/base/StringPiece.h"
 
 #include <netinet/in.h>
+#include <sys/un.h>
 
 namespace muduo
 {
@@ -26,7 +27,10 @@ const struct sockaddr *sockaddr_cast(const struct sockaddr_in6 *addr);
 }
 
 /// 对于网际地址的封装
-/// Wrapper of sockaddr_in.
+/// Wrapper of sockaddr_in, sockaddr_in6 and sockaddr_un.
+///
+/// Despite the name, it also holds Unix domain socket addresses,
+/// see fromUnixPath(), so TcpServer and TcpClient work over AF_UNIX unchanged.
 ///
 /// This is an POD interface class.
 class InetAddress : public muduo::copyable
@@ -53,17 +57,24 @@ public:
     {
     }
 
+    /// Constructs from the result of accept(), getsockname() or getpeername().
+    explicit InetAddress(const struct sockaddr_storage &addr);
+
+    /// Unix domain socket address, a @c path starting with '@'
+    /// is in the Linux abstract namespace, which leaves no file behind.
+    static InetAddress fromUnixPath(StringArg path);
+
     sa_family_t family() const { return addr_.sin_family; }
-    std::string toIp() const;     //转为ip
-    std::string toIpPort() const; //转为ip端口
-    uint16_t toPort() const;
+    std::string toIp() const;     //转为ip，Unix域套接字返回路径
+    std::string toIpPort() const; //转为ip端口，Unix域套接字返回"unix:路径"
+    uint16_t toPort() const;      //Unix域套接字返回0
 
     // default copy/assignment are Okay
 
     const struct sockaddr *getSockAddr() const { return sockets::sockaddr_cast(&addr6_); }
     void setSockAddrInet6(const struct sockaddr_in6 &addr6) { addr6_ = addr6; }
 
-    uint32_t ipNetEndian() const { return addr_.sin_addr.s_addr; } //返回网络字节序的32位ip
+    uint32_t ipNetEndian() const; //返回网络字节序的32位ip
     uint16_t portNetEndian() const { return addr_.sin_port; }      //返回网络字节序的端口
 
     // resolve hostname to IP address, not changing port or sin_family
@@ -79,6 +90,7 @@ private:
     union {
         struct sockaddr_in addr_;
         struct sockaddr_in6 addr6_;
+        struct sockaddr_un addrUn_;
     };
 };
 
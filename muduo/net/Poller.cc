@@ -20,6 +20,12 @@ Poller::Poller(EventLoop* loop)
 
 Poller::~Poller() = default;
 
+Timestamp Poller::pollMicroSeconds(int64_t timeoutUs, ChannelList* activeChannels)
+{
+  int timeoutMs = timeoutUs < 0 ? -1 : static_cast<int>((timeoutUs + 999) / 1000);
+  return poll(timeoutMs, activeChannels);
+}
+
 bool Poller::hasChannel(Channel* channel) const
 {
   assertInLoopThread();
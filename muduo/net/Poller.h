@@ -40,6 +40,11 @@ class Poller : noncopyable
   /// Must be called in the loop thread.
   virtual Timestamp poll(int timeoutMs, ChannelList* activeChannels) = 0;
 
+  /// Polls with timeout in microseconds, negative for infinite.
+  /// Rounds up to milliseconds by default, never returns before the timeout.
+  /// Must be called in the loop thread.
+  virtual Timestamp pollMicroSeconds(int64_t timeoutUs, ChannelList* activeChannels);
+
   /// Changes the interested I/O events.
   /// Must be called in the loop thread.
   virtual void updateChannel(Channel *channel) = 0; //三个纯虚函数
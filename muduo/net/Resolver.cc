@@ -0,0 +1,617 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/Resolver.h"
+
+#include "muduo/base/Clock.h"
+#include "muduo/base/FileUtil.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/Endian.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <algorithm>
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+const uint16_t kTypeA = 1;
+const uint16_t kTypeSOA = 6;
+const uint16_t kTypeAAAA = 28;
+const uint16_t kTypeOPT = 41;
+const uint16_t kClassIN = 1;
+const uint16_t kUdpPayloadSize = 1232;  // EDNS0, avoids fragmentation
+const int kHeaderSize = 12;
+const int kMaxNameLength = 253;
+const uint32_t kMaxTtlSeconds = 24 * 3600;
+
+enum Rcode
+{
+  kNoError = 0,
+  kNameError = 3,  // NXDOMAIN
+};
+
+uint16_t readUint16(const char* p)
+{
+  uint16_t be16 = 0;
+  ::memcpy(&be16, p, sizeof be16);
+  return sockets::networkToHost16(be16);
+}
+
+uint32_t readUint32(const char* p)
+{
+  uint32_t be32 = 0;
+  ::memcpy(&be32, p, sizeof be32);
+  return sockets::networkToHost32(be32);
+}
+
+void appendUint16(string* message, uint16_t x)
+{
+  message->push_back(static_cast<char>(x >> 8));
+  message->push_back(static_cast<char>(x & 0xFF));
+}
+
+string toLower(StringPiece s)
+{
+  string result(s.data(), s.size());
+  std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+  if (!result.empty() && result.back() == '.')
+  {
+    result.pop_back();  // fully qualified
+  }
+  return result;
+}
+
+// QNAME of @c name, false if it is not a valid hostname
+bool appendName(string* message, const string& name)
+{
+  if (name.empty() || name.size() > kMaxNameLength)
+  {
+    return false;
+  }
+  size_t start = 0;
+  while (start <= name.size())
+  {
+    size_t end = name.find('.', start);
+    if (end == string::npos)
+    {
+      end = name.size();
+    }
+    size_t len = end - start;
+    if (len == 0 || len > 63)
+    {
+      return false;
+    }
+    message->push_back(static_cast<char>(len));
+    message->append(name, start, len);
+    start = end + 1;
+  }
+  message->push_back('\0');
+  return true;
+}
+
+// returns offset after the name, 0 if malformed
+size_t skipName(const char* data, size_t len, size_t pos)
+{
+  while (pos < len)
+  {
+    uint8_t labelLen = static_cast<uint8_t>(data[pos]);
+    if ((labelLen & 0xC0) == 0xC0)
+    {
+      return pos + 2 <= len ? pos + 2 : 0;  // compression pointer ends the name
+    }
+    else if (labelLen == 0)
+    {
+      return pos + 1;
+    }
+    pos += labelLen + 1;
+  }
+  return 0;
+}
+
+bool parseNumeric(const string& hostname, InetAddress* address)
+{
+  struct sockaddr_in6 addr6;
+  memZero(&addr6, sizeof addr6);
+  struct sockaddr_in* addr4 = reinterpret_cast<struct sockaddr_in*>(&addr6);
+  if (::inet_pton(AF_INET, hostname.c_str(), &addr4->sin_addr) == 1)
+  {
+    addr4->sin_family = AF_INET;
+  }
+  else if (::inet_pton(AF_INET6, hostname.c_str(), &addr6.sin6_addr) == 1)
+  {
+    addr6.sin6_family = AF_INET6;
+  }
+  else
+  {
+    return false;
+  }
+  *address = InetAddress(addr6);
+  return true;
+}
+
+// sin_port and sin6_port are both at offset 2
+InetAddress withPort(const InetAddress& address, uint16_t port)
+{
+  struct sockaddr_in6 addr6;
+  memZero(&addr6, sizeof addr6);
+  ::memcpy(&addr6, address.getSockAddr(),
+           address.family() == AF_INET ? sizeof(struct sockaddr_in) : sizeof addr6);
+  addr6.sin6_port = sockets::hostToNetwork16(port);
+  return InetAddress(addr6);
+}
+
+}  // namespace detail
+}  // namespace net
+}  // namespace muduo
+
+using namespace muduo::net::detail;
+
+// resolution of a hostname, waiting for one or two questions
+struct Resolver::Lookup
+{
+  std::vector<std::pair<uint16_t, Callback>> callbacks;  // port and callback
+  std::vector<InetAddress> addresses4;
+  std::vector<InetAddress> addresses6;
+  int outstanding;
+  bool cacheable;
+  uint32_t ttl;
+};
+
+// one DNS message, resent on timeout
+struct Resolver::Question
+{
+  string name;
+  string message;
+  uint16_t type;
+  size_t questionEnd;  // end of the question section in message
+  int retriesLeft;
+  TimerId timer;
+};
+
+Resolver::Resolver(EventLoop* loop, Option option)
+  : Resolver(loop, nameserverOf("/etc/resolv.conf"), option)
+{
+}
+
+Resolver::Resolver(EventLoop* loop, const InetAddress& nameserver, Option option)
+  : loop_(loop),
+    nameserver_(nameserver),
+    option_(option),
+    sockfd_(sockets::createUdpNonblockingOrDie(nameserver.family())),
+    channel_(new Channel(loop, sockfd_)),
+    timeoutSeconds_(1.0),
+    retries_(2)
+{
+  //connect之后只收nameserver发来的报文，用read/write收发
+  if (sockets::connect(sockfd_, nameserver_.getSockAddr()) < 0)
+  {
+    LOG_SYSERR << "Resolver::Resolver - connect " << nameserver_.toIpPort();
+  }
+  loadHosts("/etc/hosts");
+  channel_->setReadCallback(std::bind(&Resolver::handleRead, this));
+  channel_->enableReading();
+  LOG_DEBUG << "Resolver::Resolver - nameserver " << nameserver_.toIpPort();
+}
+
+Resolver::~Resolver()
+{
+  loop_->assertInLoopThread();
+  for (const auto& item : questions_)
+  {
+    loop_->cancel(item.second->timer);
+  }
+  channel_->disableAll();
+  channel_->remove();
+  sockets::close(sockfd_);
+}
+
+InetAddress Resolver::nameserverOf(StringArg resolvConf)
+{
+  string content;
+  FileUtil::readFile(resolvConf, 64 * 1024, &content);
+  size_t pos = 0;
+  while (pos < content.size())
+  {
+    size_t eol = content.find('\n', pos);
+    if (eol == string::npos)
+    {
+      eol = content.size();
+    }
+    char ip[64];
+    if (sscanf(content.c_str() + pos, "nameserver %63s", ip) == 1)
+    {
+      InetAddress address;
+      if (parseNumeric(ip, &address))
+      {
+        return withPort(address, 53);
+      }
+    }
+    pos = eol + 1;
+  }
+  return InetAddress("127.0.0.1", 53);
+}
+
+void Resolver::loadHosts(StringArg filename)
+{
+  string content;
+  FileUtil::readFile(filename, 1024 * 1024, &content);
+  size_t pos = 0;
+  while (pos < content.size())
+  {
+    size_t eol = content.find('\n', pos);
+    if (eol == string::npos)
+    {
+      eol = content.size();
+    }
+    string line(content, pos, eol - pos);
+    pos = eol + 1;
+    size_t comment = line.find('#');
+    if (comment != string::npos)
+    {
+      line.resize(comment);
+    }
+
+    // ip name [aliases...]
+    std::vector<string> fields;
+    size_t start = line.find_first_not_of(" \t\r");
+    while (start != string::npos)
+    {
+      size_t end = line.find_first_of(" \t\r", start);
+      fields.push_back(line.substr(start, end == string::npos ? string::npos : end - start));
+      start = end == string::npos ? end : line.find_first_not_of(" \t\r", end);
+    }
+    InetAddress address;
+    if (fields.size() < 2 || !parseNumeric(fields[0], &address))
+    {
+      continue;
+    }
+    for (size_t i = 1; i < fields.size(); ++i)
+    {
+      hosts_[toLower(fields[i])].push_back(address);
+    }
+  }
+}
+
+bool Resolver::findKnown(const string& name, std::vector<InetAddress>* addresses)
+{
+  InetAddress address;
+  if (parseNumeric(name, &address))
+  {
+    addresses->push_back(address);
+    return true;
+  }
+
+  auto host = hosts_.find(name);
+  if (host != hosts_.end())
+  {
+    for (const InetAddress& addr : host->second)
+    {
+      if ((addr.family() == AF_INET && option_ != kIPv6Only)
+          || (addr.family() == AF_INET6 && option_ != kIPv4Only))
+      {
+        addresses->push_back(addr);
+      }
+    }
+    std::stable_sort(addresses->begin(), addresses->end(),
+                     [](const InetAddress& lhs, const InetAddress& rhs)
+                     { return lhs.family() == AF_INET && rhs.family() != AF_INET; });
+    return true;
+  }
+
+  auto cached = cache_.find(name);
+  if (cached != cache_.end())
+  {
+    if (Clock::monotonicCoarse() < cached->second.expiration)
+    {
+      *addresses = cached->second.addresses;
+      return true;
+    }
+    cache_.erase(cached);
+  }
+  return false;
+}
+
+void Resolver::resolve(StringArg hostname, uint16_t port, Callback cb)
+{
+  loop_->assertInLoopThread();
+  string name(toLower(hostname.c_str()));
+  std::vector<InetAddress> addresses;
+  if (findKnown(name, &addresses))
+  {
+    for (InetAddress& addr : addresses)
+    {
+      addr = withPort(addr, port);
+    }
+    cb(addresses);
+    return;
+  }
+
+  // joins the lookup in flight
+  std::unique_ptr<Lookup>& lookup = lookups_[name];
+  if (lookup)
+  {
+    lookup->callbacks.push_back(std::make_pair(port, std::move(cb)));
+    return;
+  }
+
+  std::vector<uint16_t> types;
+  if (option_ != kIPv6Only)
+  {
+    types.push_back(kTypeA);
+  }
+  if (option_ != kIPv4Only)
+  {
+    types.push_back(kTypeAAAA);
+  }
+
+  std::vector<std::unique_ptr<Question>> questions;
+  for (uint16_t type : types)
+  {
+    std::unique_ptr<Question> question(new Question);
+    string& message = question->message;
+    appendUint16(&message, 0);       // id, filled by sendQuestion()
+    appendUint16(&message, 0x0100);  // RD, recursion desired
+    appendUint16(&message, 1);       // QDCOUNT
+    appendUint16(&message, 0);       // ANCOUNT
+    appendUint16(&message, 0);       // NSCOUNT
+    appendUint16(&message, 1);       // ARCOUNT, the OPT record
+    if (!appendName(&message, name))
+    {
+      LOG_ERROR << "Resolver::resolve - invalid hostname " << hostname.c_str();
+      lookups_.erase(name);
+      cb(std::vector<InetAddress>());
+      return;
+    }
+    appendUint16(&message, type);
+    appendUint16(&message, kClassIN);
+    question->questionEnd = message.size();
+    message.push_back('\0');  // OPT, root name
+    appendUint16(&message, kTypeOPT);
+    appendUint16(&message, kUdpPayloadSize);
+    message.append(6, '\0');  // extended rcode and flags, RDLENGTH
+    question->name = name;
+    question->type = type;
+    question->retriesLeft = retries_;
+    questions.push_back(std::move(question));
+  }
+
+  lookup.reset(new Lookup);
+  lookup->callbacks.push_back(std::make_pair(port, std::move(cb)));
+  lookup->outstanding = static_cast<int>(questions.size());
+  lookup->cacheable = true;
+  lookup->ttl = kMaxTtlSeconds;
+  for (auto& question : questions)
+  {
+    uint16_t id = newQuestionId();
+    question->message[0] = static_cast<char>(id >> 8);
+    question->message[1] = static_cast<char>(id & 0xFF);
+    Question* q = get_pointer(question);
+    questions_[id] = std::move(question);
+    sendQuestion(q);
+  }
+}
+
+uint16_t Resolver::newQuestionId()
+{
+  //随机的id，防止伪造的应答
+  uint16_t id = 0;
+  do
+  {
+    if (::getrandom(&id, sizeof id, 0) != sizeof id)
+    {
+      id = static_cast<uint16_t>(id * 31 + questions_.size() + 1);
+    }
+  } while (questions_.count(id));
+  return id;
+}
+
+void Resolver::sendQuestion(Question* question)
+{
+  ssize_t n = sockets::write(sockfd_, question->message.data(), question->message.size());
+  if (n != static_cast<ssize_t>(question->message.size()))
+  {
+    LOG_SYSERR << "Resolver::sendQuestion - " << question->name;
+  }
+  uint16_t id = readUint16(question->message.data());
+  question->timer = loop_->runAfter(timeoutSeconds_, std::bind(&Resolver::handleTimeout, this, id));
+}
+
+void Resolver::handleRead()
+{
+  loop_->assertInLoopThread();
+  char buf[kUdpPayloadSize];
+  while (true)
+  {
+    ssize_t n = sockets::read(sockfd_, buf, sizeof buf);
+    if (n < 0)
+    {
+      // ECONNREFUSED if the nameserver is down, queries will time out
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      {
+        LOG_SYSERR << "Resolver::handleRead";
+        continue;
+      }
+      break;
+    }
+    handleAnswer(buf, static_cast<size_t>(n));
+  }
+}
+
+void Resolver::handleAnswer(const char* data, size_t len)
+{
+  if (len < kHeaderSize)
+  {
+    return;
+  }
+  uint16_t id = readUint16(data);
+  uint16_t flags = readUint16(data + 2);
+  auto it = questions_.find(id);
+  if (it == questions_.end() || !(flags & 0x8000))
+  {
+    return;  // late answer of a timed out question, or not an answer
+  }
+  Question* question = get_pointer(it->second);
+  const size_t questionEnd = question->questionEnd;
+  if (readUint16(data + 4) != 1 || len < questionEnd
+      || ::strncasecmp(data + kHeaderSize, question->message.data() + kHeaderSize,
+                       questionEnd - kHeaderSize) != 0)
+  {
+    LOG_WARN << "Resolver::handleAnswer - mismatched question of " << question->name;
+    return;
+  }
+
+  const int rcode = flags & 0xF;
+  const int answers = readUint16(data + 6);
+  const int authorities = readUint16(data + 8);
+  std::vector<InetAddress> addresses;
+  uint32_t ttl = kMaxTtlSeconds;
+  uint32_t negativeTtl = 0;
+  size_t pos = questionEnd;
+  for (int i = 0; i < answers + authorities; ++i)
+  {
+    pos = skipName(data, len, pos);
+    if (pos == 0 || pos + 10 > len)
+    {
+      break;
+    }
+    uint16_t type = readUint16(data + pos);
+    uint32_t recordTtl = readUint32(data + pos + 4);
+    uint16_t rdlength = readUint16(data + pos + 8);
+    const char* rdata = data + pos + 10;
+    pos += 10 + rdlength;
+    if (pos > len)
+    {
+      break;
+    }
+    // CNAMEs are followed by the records of the canonical name
+    if (i < answers && type == question->type)
+    {
+      struct sockaddr_in6 addr6;
+      memZero(&addr6, sizeof addr6);
+      if (type == kTypeA && rdlength == 4)
+      {
+        struct sockaddr_in* addr4 = reinterpret_cast<struct sockaddr_in*>(&addr6);
+        addr4->sin_family = AF_INET;
+        ::memcpy(&addr4->sin_addr, rdata, 4);
+      }
+      else if (type == kTypeAAAA && rdlength == 16)
+      {
+        addr6.sin6_family = AF_INET6;
+        ::memcpy(&addr6.sin6_addr, rdata, 16);
+      }
+      else
+      {
+        continue;
+      }
+      addresses.push_back(InetAddress(addr6));
+      ttl = std::min(ttl, recordTtl);
+    }
+    else if (i >= answers && type == kTypeSOA && rdlength >= 20)
+    {
+      // RFC 2308, negative answers are cached for min(TTL, MINIMUM) of SOA
+      negativeTtl = std::min(recordTtl, readUint32(rdata + rdlength - 4));
+    }
+  }
+
+  bool cacheable = true;
+  if (rcode == kNoError || rcode == kNameError)
+  {
+    if (addresses.empty())
+    {
+      ttl = negativeTtl;
+    }
+  }
+  else
+  {
+    LOG_WARN << "Resolver::handleAnswer - " << question->name << " rcode " << rcode;
+    addresses.clear();
+    cacheable = false;
+  }
+
+  loop_->cancel(question->timer);
+  string name(question->name);
+  uint16_t type = question->type;
+  questions_.erase(it);
+
+  Lookup* lookup = get_pointer(lookups_[name]);
+  assert(lookup != NULL);
+  std::vector<InetAddress>& found = type == kTypeA ? lookup->addresses4 : lookup->addresses6;
+  found.insert(found.end(), addresses.begin(), addresses.end());
+  lookup->cacheable = lookup->cacheable && cacheable;
+  lookup->ttl = std::min(lookup->ttl, ttl);
+  finishQuestion(name);
+}
+
+void Resolver::handleTimeout(uint16_t id)
+{
+  auto it = questions_.find(id);
+  if (it == questions_.end())
+  {
+    return;
+  }
+  Question* question = get_pointer(it->second);
+  if (question->retriesLeft > 0)
+  {
+    --question->retriesLeft;
+    LOG_DEBUG << "Resolver::handleTimeout - resend " << question->name;
+    sendQuestion(question);
+    return;
+  }
+
+  LOG_WARN << "Resolver::handleTimeout - " << question->name << " timed out";
+  string name(question->name);
+  questions_.erase(it);
+  Lookup* lookup = get_pointer(lookups_[name]);
+  assert(lookup != NULL);
+  lookup->cacheable = false;
+  finishQuestion(name);
+}
+
+// one question of @c name is done, calls back if it was the last one
+void Resolver::finishQuestion(const string& name)
+{
+  auto it = lookups_.find(name);
+  assert(it != lookups_.end());
+  if (--it->second->outstanding > 0)
+  {
+    return;
+  }
+  std::unique_ptr<Lookup> lookup(std::move(it->second));
+  lookups_.erase(it);
+
+  std::vector<InetAddress> addresses(lookup->addresses4);
+  addresses.insert(addresses.end(), lookup->addresses6.begin(), lookup->addresses6.end());
+  if (lookup->cacheable && lookup->ttl > 0)
+  {
+    CacheEntry& entry = cache_[name];
+    entry.addresses = addresses;
+    entry.expiration = addTime(Clock::monotonicCoarse(), lookup->ttl);
+  }
+
+  // callbacks may call resolve() again
+  for (const auto& item : lookup->callbacks)
+  {
+    std::vector<InetAddress> result;
+    result.reserve(addresses.size());
+    for (const InetAddress& addr : addresses)
+    {
+      result.push_back(withPort(addr, item.first));
+    }
+    item.second(result);
+  }
+}
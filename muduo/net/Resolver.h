@@ -0,0 +1,111 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_RESOLVER_H
+#define MUDUO_NET_RESOLVER_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/Callbacks.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TimerId.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class Channel;
+class EventLoop;
+
+///
+/// Asynchronous DNS resolver of an EventLoop, unlike InetAddress::resolve()
+/// it never blocks the loop.
+///
+/// Queries A and AAAA records over UDP to the nameserver,
+/// answers are cached for their TTL, concurrent lookups of the same name
+/// share one query. Numeric addresses and /etc/hosts are answered directly.
+/// Search domains of resolv.conf are not applied.
+///
+/// Not thread safe, all member functions must be called in the loop thread.
+///
+class Resolver : noncopyable
+{
+ public:
+  /// All addresses, IPv4 first, empty if failed.
+  typedef std::function<void (const std::vector<InetAddress>&)> Callback;
+
+  enum Option
+  {
+    kIPv4AndIPv6,
+    kIPv4Only,
+    kIPv6Only,
+  };
+
+  /// Uses the first nameserver in /etc/resolv.conf.
+  explicit Resolver(EventLoop* loop, Option option = kIPv4AndIPv6);
+  Resolver(EventLoop* loop, const InetAddress& nameserver, Option option = kIPv4AndIPv6);
+  ~Resolver();  // force out-line dtor, for std::unique_ptr members.
+
+  /// Seconds to wait before resending a query, 1 by default.
+  void setTimeout(double seconds) { timeoutSeconds_ = seconds; }
+  /// Times to resend before giving up, 2 by default.
+  void setRetries(int retries) { retries_ = retries; }
+
+  ///
+  /// Resolves @c hostname, returned addresses have port @c port.
+  /// @c cb is called before resolve() returns if the answer is known.
+  ///
+  void resolve(StringArg hostname, uint16_t port, Callback cb);
+
+  /// Number of cached names, including negative answers.
+  size_t cacheSize() const { return cache_.size(); }
+  void clearCache() { cache_.clear(); }
+
+  /// Parses the first "nameserver" line of @c resolvConf,
+  /// 127.0.0.1:53 if there is none.
+  static InetAddress nameserverOf(StringArg resolvConf);
+
+ private:
+  struct Lookup;
+  struct Question;
+  struct CacheEntry
+  {
+    std::vector<InetAddress> addresses;  // port 0
+    Timestamp expiration;
+  };
+
+  void loadHosts(StringArg filename);
+  bool findKnown(const string& name, std::vector<InetAddress>* addresses);
+  void sendQuestion(Question* question);
+  void handleRead();
+  void handleAnswer(const char* data, size_t len);
+  void handleTimeout(uint16_t id);
+  void finishQuestion(const string& name);
+  uint16_t newQuestionId();
+
+  EventLoop* loop_;
+  const InetAddress nameserver_;
+  const Option option_;
+  const int sockfd_;
+  std::unique_ptr<Channel> channel_;
+  double timeoutSeconds_;
+  int retries_;
+  std::map<string, std::vector<InetAddress>> hosts_;
+  std::map<string, CacheEntry> cache_;
+  std::map<string, std::unique_ptr<Lookup>> lookups_;      // by hostname
+  std::map<uint16_t, std::unique_ptr<Question>> questions_;  // by DNS id
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_RESOLVER_H
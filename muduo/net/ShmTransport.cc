@@ -0,0 +1,329 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/ShmTransport.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+// Positions only grow, a position modulo the ring size is the offset.
+struct ShmRing
+{
+  alignas(64) std::atomic<uint64_t> head;  // consumed, by the consumer
+  std::atomic<uint32_t> consumerWaiting;   // set before it sleeps
+  alignas(64) std::atomic<uint64_t> tail;  // produced, by the producer
+  std::atomic<uint32_t> producerWaiting;   // set when the ring is full
+};
+
+struct ShmRegion
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t ringSize;
+  ShmRing rings[2];  // [0] from the creator, [1] to the creator
+  // data of rings[0] and rings[1] at kDataOffset
+};
+
+}  // namespace detail
+}  // namespace net
+}  // namespace muduo
+
+using namespace muduo;
+using namespace muduo::net;
+using namespace muduo::net::detail;
+
+namespace
+{
+
+const uint32_t kMagic = 0x6d73686d;  // "mshm"
+const uint32_t kVersion = 1;
+const size_t kDataOffset = 4096;
+const size_t kMinRingSize = 4096;
+
+static_assert(sizeof(ShmRegion) <= kDataOffset, "ShmRegion fits in a page");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "atomics in shared memory must be lock free");
+
+void closeAll(const std::vector<int>& fds)
+{
+  for (int fd : fds)
+  {
+    if (fd >= 0)
+    {
+      sockets::close(fd);
+    }
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<ShmTransport> ShmTransport::create(EventLoop* loop, size_t ringSize)
+{
+  size_t size = kMinRingSize;
+  while (size < ringSize)
+  {
+    size <<= 1;
+  }
+  const size_t mapSize = kDataOffset + 2 * size;
+
+  std::vector<int> fds;
+  fds.push_back(::memfd_create("muduo-shm", MFD_CLOEXEC));
+  fds.push_back(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+  fds.push_back(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+  if (std::find(fds.begin(), fds.end(), -1) != fds.end()
+      || ::ftruncate(fds[0], static_cast<off_t>(mapSize)) < 0)
+  {
+    LOG_SYSERR << "ShmTransport::create";
+    closeAll(fds);
+    return std::unique_ptr<ShmTransport>();
+  }
+  void* addr = ::mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+  if (addr == MAP_FAILED)
+  {
+    LOG_SYSERR << "ShmTransport::create - mmap " << mapSize;
+    closeAll(fds);
+    return std::unique_ptr<ShmTransport>();
+  }
+
+  // a new memfd is zero filled, so are the positions
+  ShmRegion* region = static_cast<ShmRegion*>(addr);
+  region->magic = kMagic;
+  region->version = kVersion;
+  region->ringSize = size;
+  region->rings[0].consumerWaiting.store(1);
+  region->rings[1].consumerWaiting.store(1);
+  return std::unique_ptr<ShmTransport>(
+      new ShmTransport(loop, fds[0], fds[1], fds[2], region, mapSize, true));
+}
+
+std::unique_ptr<ShmTransport> ShmTransport::attach(EventLoop* loop, const std::vector<int>& fds)
+{
+  struct stat st;
+  if (fds.size() != 3 || ::fstat(fds[0], &st) < 0
+      || static_cast<size_t>(st.st_size) < kDataOffset + 2 * kMinRingSize)
+  {
+    LOG_ERROR << "ShmTransport::attach - not a shared memory offer";
+    closeAll(fds);
+    return std::unique_ptr<ShmTransport>();
+  }
+  const size_t mapSize = static_cast<size_t>(st.st_size);
+  void* addr = ::mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+  if (addr == MAP_FAILED)
+  {
+    LOG_SYSERR << "ShmTransport::attach - mmap " << mapSize;
+    closeAll(fds);
+    return std::unique_ptr<ShmTransport>();
+  }
+
+  ShmRegion* region = static_cast<ShmRegion*>(addr);
+  const uint64_t size = region->ringSize;
+  if (region->magic != kMagic || region->version != kVersion
+      || size < kMinRingSize || (size & (size - 1)) != 0
+      || kDataOffset + 2 * size != mapSize)
+  {
+    LOG_ERROR << "ShmTransport::attach - bad region header";
+    ::munmap(addr, mapSize);
+    closeAll(fds);
+    return std::unique_ptr<ShmTransport>();
+  }
+  // the doorbells are swapped on this end
+  return std::unique_ptr<ShmTransport>(
+      new ShmTransport(loop, fds[0], fds[2], fds[1], region, mapSize, false));
+}
+
+ShmTransport::ShmTransport(EventLoop* loop, int memfd, int doorbell, int peerDoorbell,
+                           ShmRegion* region, size_t mapSize, bool creator)
+  : loop_(loop),
+    memfd_(memfd),
+    doorbell_(doorbell),
+    peerDoorbell_(peerDoorbell),
+    region_(region),
+    mapSize_(mapSize),
+    ringSize_(region->ringSize),
+    tx_(&region->rings[creator ? 0 : 1]),
+    rx_(&region->rings[creator ? 1 : 0]),
+    txData_(reinterpret_cast<char*>(region) + kDataOffset + (creator ? 0 : ringSize_)),
+    rxData_(reinterpret_cast<char*>(region) + kDataOffset + (creator ? ringSize_ : 0)),
+    channel_(new Channel(loop, doorbell)),
+    started_(false),
+    notifyPending_(false)
+{
+  channel_->setReadCallback(
+      std::bind(&ShmTransport::handleDoorbell, this, std::placeholders::_1));
+}
+
+ShmTransport::~ShmTransport()
+{
+  assert(!started_);
+  ::munmap(region_, mapSize_);
+  sockets::close(memfd_);
+  sockets::close(doorbell_);
+  sockets::close(peerDoorbell_);
+}
+
+std::vector<int> ShmTransport::peerFds() const
+{
+  std::vector<int> fds;
+  fds.push_back(memfd_);
+  fds.push_back(doorbell_);
+  fds.push_back(peerDoorbell_);
+  return fds;
+}
+
+void ShmTransport::start(const EventCallback& cb, const std::shared_ptr<void>& owner)
+{
+  loop_->assertInLoopThread();
+  assert(!started_);
+  started_ = true;
+  eventCallback_ = cb;
+  channel_->tie(owner);
+  channel_->enableReading();
+}
+
+void ShmTransport::stop()
+{
+  loop_->assertInLoopThread();
+  if (started_)
+  {
+    started_ = false;
+    channel_->disableAll();
+    channel_->remove();
+  }
+}
+
+size_t ShmTransport::write(const void* data, size_t len)
+{
+  const uint64_t tail = tx_->tail.load(std::memory_order_relaxed);
+  const uint64_t head = tx_->head.load(std::memory_order_acquire);
+  const size_t n = std::min(len, ringSize_ - static_cast<size_t>(tail - head));
+  if (n == 0)
+  {
+    return 0;
+  }
+  const size_t offset = static_cast<size_t>(tail) & (ringSize_ - 1);
+  const size_t first = std::min(n, ringSize_ - offset);
+  ::memcpy(txData_ + offset, data, first);
+  ::memcpy(txData_, static_cast<const char*>(data) + first, n - first);
+  tx_->tail.store(tail + n, std::memory_order_release);
+  notifyPending_ = true;
+  return n;
+}
+
+void ShmTransport::notify()
+{
+  if (notifyPending_)
+  {
+    notifyPending_ = false;
+    // pairs with the fence in read(), either the consumer sees the new tail
+    // before it sleeps, or we see it is going to sleep and ring it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (tx_->consumerWaiting.load(std::memory_order_relaxed)
+        && tx_->consumerWaiting.exchange(0))
+    {
+      ring(peerDoorbell_);
+    }
+  }
+}
+
+size_t ShmTransport::read(Buffer* buf)
+{
+  size_t total = 0;
+  uint64_t head = rx_->head.load(std::memory_order_relaxed);
+  rx_->consumerWaiting.store(0, std::memory_order_relaxed);
+  for (;;)
+  {
+    uint64_t tail = rx_->tail.load(std::memory_order_acquire);
+    if (tail == head)
+    {
+      rx_->consumerWaiting.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      tail = rx_->tail.load(std::memory_order_acquire);
+      if (tail == head)
+      {
+        break;
+      }
+      rx_->consumerWaiting.store(0, std::memory_order_relaxed);
+    }
+    if (total >= ringSize_)
+    {
+      // a ring's worth at a time, give other channels of the loop a turn
+      ring(doorbell_);
+      break;
+    }
+
+    const size_t n = static_cast<size_t>(tail - head);
+    if (n > ringSize_)
+    {
+      LOG_ERROR << "ShmTransport::read - corrupted ring, " << n << " bytes";
+      break;
+    }
+    const size_t offset = static_cast<size_t>(head) & (ringSize_ - 1);
+    const size_t first = std::min(n, ringSize_ - offset);
+    buf->ensureWritableBytes(n);
+    ::memcpy(buf->beginWrite(), rxData_ + offset, first);
+    ::memcpy(buf->beginWrite() + first, rxData_, n - first);
+    buf->hasWritten(n);
+    total += n;
+    head = tail;
+    rx_->head.store(head, std::memory_order_release);
+  }
+
+  // pairs with the fence in waitForSpace()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (total > 0 && rx_->producerWaiting.load(std::memory_order_relaxed)
+      && rx_->producerWaiting.exchange(0))
+  {
+    ring(peerDoorbell_);
+  }
+  return total;
+}
+
+bool ShmTransport::waitForSpace()
+{
+  tx_->producerWaiting.store(1, std::memory_order_relaxed);
+  // pairs with the fence in read()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const uint64_t head = tx_->head.load(std::memory_order_acquire);
+  const uint64_t tail = tx_->tail.load(std::memory_order_relaxed);
+  return tail - head < ringSize_;
+}
+
+void ShmTransport::handleDoorbell(Timestamp receiveTime)
+{
+  uint64_t count = 0;
+  ssize_t n = ::read(doorbell_, &count, sizeof count);
+  if (n != sizeof count && errno != EAGAIN)
+  {
+    LOG_SYSERR << "ShmTransport::handleDoorbell";
+  }
+  eventCallback_(receiveTime);
+}
+
+void ShmTransport::ring(int doorbell)
+{
+  uint64_t one = 1;
+  ssize_t n = ::write(doorbell, &one, sizeof one);
+  if (n != sizeof one)
+  {
+    LOG_SYSERR << "ShmTransport::ring";
+  }
+}
@@ -0,0 +1,101 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_SHMTRANSPORT_H
+#define MUDUO_NET_SHMTRANSPORT_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Timestamp.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class Buffer;
+class Channel;
+class EventLoop;
+
+namespace detail
+{
+struct ShmRegion;
+struct ShmRing;
+}
+
+///
+/// Byte stream between two processes of one host, through two
+/// single-producer single-consumer rings in shared memory, one per
+/// direction, and an eventfd doorbell for each end.
+///
+/// The creating end passes peerFds() to the other end over a Unix domain
+/// socket, which calls attach(). A doorbell is rung only when the other end
+/// may be asleep: it has drained its ring, or it waits for space. Writes
+/// are published at once, notify() rings if needed, so the writes of one
+/// loop iteration share a wakeup. A busy stream goes without system calls.
+///
+/// Not thread safe, used in the loop thread of its TcpConnection.
+///
+class ShmTransport : noncopyable
+{
+ public:
+  typedef std::function<void (Timestamp)> EventCallback;
+
+  /// Creates rings of @c ringSize bytes, rounded up to a power of 2.
+  /// Returns NULL on failure.
+  static std::unique_ptr<ShmTransport> create(EventLoop* loop, size_t ringSize);
+  /// The other end, takes ownership of @c fds, which came from peerFds().
+  /// Returns NULL on failure.
+  static std::unique_ptr<ShmTransport> attach(EventLoop* loop, const std::vector<int>& fds);
+  ~ShmTransport();
+
+  /// The memfd and the two doorbells, to be passed to the other end.
+  std::vector<int> peerFds() const;
+  size_t ringSize() const { return ringSize_; }
+
+  /// Calls @c cb when the doorbell rings: data or space has arrived.
+  void start(const EventCallback& cb, const std::shared_ptr<void>& owner);
+  void stop();
+
+  /// Copies as much of @c data as fits, returns the bytes written.
+  size_t write(const void* data, size_t len);
+  /// Wakes up the other end if it sleeps since earlier write()s.
+  void notify();
+  /// Appends all available bytes to @c buf, returns the count.
+  size_t read(Buffer* buf);
+  /// Asks the other end to ring when it frees space of a full ring.
+  /// Returns true if there is space already, write() again then.
+  bool waitForSpace();
+
+ private:
+  ShmTransport(EventLoop* loop, int memfd, int doorbell, int peerDoorbell,
+               detail::ShmRegion* region, size_t mapSize, bool creator);
+  void handleDoorbell(Timestamp receiveTime);
+  void ring(int doorbell);
+
+  EventLoop* loop_;
+  const int memfd_;
+  const int doorbell_;
+  const int peerDoorbell_;
+  detail::ShmRegion* region_;
+  const size_t mapSize_;
+  const size_t ringSize_;
+  detail::ShmRing* tx_;
+  detail::ShmRing* rx_;
+  char* txData_;
+  char* rxData_;
+  std::unique_ptr<Channel> channel_;
+  EventCallback eventCallback_;
+  bool started_;
+  bool notifyPending_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_SHMTRANSPORT_H
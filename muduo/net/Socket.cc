@@ -69,12 +69,12 @@ void Socket::listen()
 
 int Socket::accept(InetAddress *peeraddr) //使得上层应用更好使用
 {
-    struct sockaddr_in addr;
+    struct sockaddr_storage addr;
     bzero(&addr, sizeof addr);
     int connfd = sockets::accept(sockfd_, &addr); //在这里封装了accept
     if (connfd >= 0)
     {
-        peeraddr->setSockAddrInet(addr);
+        *peeraddr = InetAddress(addr); //Unix域套接字的对端通常没有名字
     }
     return connfd;
 }
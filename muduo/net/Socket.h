@@ -6,7 +6,7 @@
 
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
 //
-// This is an internal header file, you should not include this.
+// This is a public header file, it must only include public header files.
 
 #ifndef MUDUO_NET_SOCKET_H
 #define MUDUO_NET_SOCKET_H
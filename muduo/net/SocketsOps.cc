@@ -12,11 +12,16 @@
 #include "muduo/base/Types.h"
 #include "muduo/net/Endian.h"
 
+#include <algorithm>
+
 #include <errno.h>
 #include <fcntl.h>
+#include <stddef.h>  // offsetof
 #include <stdio.h>  // snprintf
+#include <sys/sendfile.h>
 #include <sys/socket.h>
-#include <sys/uio.h>  // readv
+#include <sys/uio.h>  // readv, writev
+#include <sys/un.h>
 #include <unistd.h>
 
 using namespace muduo;
@@ -27,6 +32,8 @@ namespace
 
 typedef struct sockaddr SA;
 
+const int kMaxFdsPerMessage = 253;  // SCM_MAX_FD
+
 
 #if VALGRIND || defined (NO_ACCEPT4)
 void setNonBlockAndCloseOnExec(int sockfd)
@@ -76,9 +83,10 @@ const struct sockaddr_in6* sockets::sockaddr_in6_cast(const struct sockaddr* add
 
 int sockets::createNonblockingOrDie(sa_family_t family) //创建非阻塞套接字，创建失败就终止
 {
+  const int protocol = family == AF_UNIX ? 0 : IPPROTO_TCP;
      //linux 2.6.27以上的内核支持sock_nonblock和sock_cloexec的检测，就不需要上面的set函数了
 #if VALGRIND
-  int sockfd = ::socket(family, SOCK_STREAM, IPPROTO_TCP);
+  int sockfd = ::socket(family, SOCK_STREAM, protocol);
   if (sockfd < 0)
   {
     LOG_SYSFATAL << "sockets::createNonblockingOrDie";
@@ -86,7 +94,7 @@ int sockets::createNonblockingOrDie(sa_family_t family) //创建非阻塞套接
 
   setNonBlockAndCloseOnExec(sockfd);
 #else
-  int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+  int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
   if (sockfd < 0)
   {
     LOG_SYSFATAL << "sockets::createNonblockingOrDie";
@@ -95,9 +103,19 @@ int sockets::createNonblockingOrDie(sa_family_t family) //创建非阻塞套接
   return sockfd;
 }
 
+int sockets::createUdpNonblockingOrDie(sa_family_t family)
+{
+  int sockfd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+  if (sockfd < 0)
+  {
+    LOG_SYSFATAL << "sockets::createUdpNonblockingOrDie";
+  }
+  return sockfd;
+}
+
 void sockets::bindOrDie(int sockfd, const struct sockaddr* addr)
 {
-  int ret = ::bind(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+  int ret = ::bind(sockfd, addr, sockaddrLength(addr));
   if (ret < 0)
   {
     LOG_SYSFATAL << "sockets::bindOrDie";
@@ -113,15 +131,18 @@ void sockets::listenOrDie(int sockfd)
   }
 }
 
-int sockets::accept(int sockfd, struct sockaddr_in *addr)
+int sockets::accept(int sockfd, struct sockaddr_storage *addr)
 {
     socklen_t addrlen = static_cast<socklen_t>(sizeof *addr);
-    int connfd = ::accept4(sockfd, sockaddr_cast(addr), //新的系统调用，这个已连接的套接字已经是非阻塞的了
+    int connfd = ::accept4(sockfd, reinterpret_cast<struct sockaddr *>(addr), //新的系统调用，这个已连接的套接字已经是非阻塞的了
                            &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd < 0)
     {
         int savedErrno = errno;         //先保存错误代码
-        LOG_SYSERR << "Socket::accept"; //因为这里登记了一个错误，所以调用前先保存起来errno
+        if (savedErrno != EAGAIN)       // the backlog is drained, not an error
+        {
+            LOG_SYSERR << "Socket::accept"; //因为这里登记了一个错误，所以调用前先保存起来errno
+        }
         switch (savedErrno)
         {
         case EAGAIN:
@@ -154,7 +175,7 @@ int sockets::accept(int sockfd, struct sockaddr_in *addr)
 
 int sockets::connect(int sockfd, const struct sockaddr* addr)
 {
-  return ::connect(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+  return ::connect(sockfd, addr, sockaddrLength(addr));
 }
 
 ssize_t sockets::read(int sockfd, void *buf, size_t count)
@@ -169,7 +190,85 @@ ssize_t sockets::readv(int sockfd, const struct iovec *iov, int iovcnt)
 
 ssize_t sockets::write(int sockfd, const void *buf, size_t count)
 {
-    return ::write(sockfd, buf, count); //writev没封装
+    return ::write(sockfd, buf, count);
+}
+
+ssize_t sockets::sendfile(int sockfd, int fd, off_t *offset, size_t count)
+{
+    return ::sendfile(sockfd, fd, offset, count);
+}
+
+ssize_t sockets::writev(int sockfd, const struct iovec *iov, int iovcnt)
+{
+    return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t sockets::writeWithFds(int sockfd, const void *buf, size_t count,
+                              const int *fds, int nfds)
+{
+  assert(count > 0);
+  assert(0 < nfds && nfds <= kMaxFdsPerMessage);
+  char control[CMSG_SPACE(kMaxFdsPerMessage * sizeof(int))];
+  memZero(control, sizeof control);
+  struct iovec vec;
+  vec.iov_base = const_cast<void*>(buf);
+  vec.iov_len = count;
+  struct msghdr msg;
+  memZero(&msg, sizeof msg);
+  msg.msg_iov = &vec;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+  ::memcpy(CMSG_DATA(cmsg), fds, nfds * sizeof(int));
+  return ::sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+}
+
+ssize_t sockets::readvWithFds(int sockfd, const struct iovec *iov, int iovcnt,
+                              int *fds, int maxFds, int *nfds)
+{
+  char control[CMSG_SPACE(kMaxFdsPerMessage * sizeof(int))];
+  struct msghdr msg;
+  memZero(&msg, sizeof msg);
+  msg.msg_iov = const_cast<struct iovec*>(iov);
+  msg.msg_iovlen = iovcnt;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof control;
+  ssize_t n = ::recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC);
+  *nfds = 0;
+  if (n < 0)
+  {
+    return n;
+  }
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+  {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+      const int count = static_cast<int>((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+      const char* data = reinterpret_cast<const char*>(CMSG_DATA(cmsg));
+      for (int i = 0; i < count; ++i)
+      {
+        int fd = -1;
+        ::memcpy(&fd, data + i * sizeof(int), sizeof fd);
+        if (*nfds < maxFds)
+        {
+          fds[(*nfds)++] = fd;
+        }
+        else
+        {
+          ::close(fd);
+        }
+      }
+    }
+  }
+  if (msg.msg_flags & MSG_CTRUNC)
+  {
+    LOG_ERROR << "sockets::readvWithFds - file descriptors truncated";
+  }
+  return n;
 }
 
 void sockets::close(int sockfd)
@@ -189,33 +288,65 @@ void sockets::shutdownWrite(int sockfd)
     }
 }
 //将地址转换为ip和端口的形式
-void sockets::toIpPort(char *buf, size_t size,
-                       const struct sockaddr_in &addr)
+void sockets::toIpPort(char* buf, size_t size,
+                       const struct sockaddr* addr)
 {
-    assert(size >= INET_ADDRSTRLEN); //宏，网际地址的长度，提供的缓冲区大小一定要大于网际地址的长度
-    ::inet_ntop(AF_INET, &addr.sin_addr, buf, static_cast<socklen_t>(size));
+  if (addr->sa_family == AF_INET6)
+  {
+    buf[0] = '[';
+    toIp(buf + 1, size - 1, addr);
     size_t end = ::strlen(buf);
-    uint16_t port = sockets::networkToHost16(addr.sin_port); //将网络字节序的端口转换为主机字节序的端口
+    const struct sockaddr_in6* addr6 = sockaddr_in6_cast(addr);
+    uint16_t port = sockets::networkToHost16(addr6->sin6_port);
     assert(size > end);
-    snprintf(buf + end, size - end, ":%u", port); //将地址端口结构化
+    snprintf(buf + end, size - end, "]:%u", port);
+    return;
+  }
+  toIp(buf, size, addr);
+  size_t end = ::strlen(buf);
+  const struct sockaddr_in* addr4 = sockaddr_in_cast(addr);
+  uint16_t port = sockets::networkToHost16(addr4->sin_port); //将网络字节序的端口转换为主机字节序的端口
+  assert(size > end);
+  snprintf(buf + end, size - end, ":%u", port); //将地址端口结构化
 }
 
-void sockets::toIp(char *buf, size_t size,
-                   const struct sockaddr_in &addr)
+void sockets::toIp(char* buf, size_t size,
+                   const struct sockaddr* addr)
 {
+  if (addr->sa_family == AF_INET)
+  {
     assert(size >= INET_ADDRSTRLEN); //宏，网际地址的长度，提供的缓冲区大小一定要大于网际地址的长度
-    ::inet_ntop(AF_INET, &addr.sin_addr, buf, static_cast<socklen_t>(size));
+    const struct sockaddr_in* addr4 = sockaddr_in_cast(addr);
+    ::inet_ntop(AF_INET, &addr4->sin_addr, buf, static_cast<socklen_t>(size));
+  }
+  else if (addr->sa_family == AF_INET6)
+  {
+    assert(size >= INET6_ADDRSTRLEN);
+    const struct sockaddr_in6* addr6 = sockaddr_in6_cast(addr);
+    ::inet_ntop(AF_INET6, &addr6->sin6_addr, buf, static_cast<socklen_t>(size));
+  }
 }
 
-void sockets::fromIpPort(const char *ip, uint16_t port, //从ip和端口，变成一个addr
-                         struct sockaddr_in *addr)
+void sockets::fromIpPort(const char* ip, uint16_t port, //从ip和端口，变成一个addr
+                         struct sockaddr_in* addr)
 {
-    addr->sin_family = AF_INET;
-    addr->sin_port = hostToNetwork16(port);
-    if (::inet_pton(AF_INET, ip, &addr->sin_addr) <= 0) //从主机变成网际
-    {
-        LOG_SYSERR << "sockets::fromIpPort";
-    }
+  addr->sin_family = AF_INET;
+  addr->sin_port = hostToNetwork16(port);
+  if (::inet_pton(AF_INET, ip, &addr->sin_addr) <= 0) //从主机变成网际
+  {
+    LOG_SYSERR << "sockets::fromIpPort";
+  }
+}
+
+void sockets::fromIpPort(const char* ip, uint16_t port,
+                         struct sockaddr_in6* addr)
+{
+  addr->sin6_family = AF_INET6;
+  addr->sin6_port = hostToNetwork16(port);
+  if (::inet_pton(AF_INET6, ip, &addr->sin6_addr) <= 0)
+  {
+    LOG_SYSERR << "sockets::fromIpPort";
+  }
 }
 
 int sockets::getSocketError(int sockfd) //返回socket错误
@@ -233,24 +364,45 @@ int sockets::getSocketError(int sockfd) //返回socket错误
     }
 }
 
-struct sockaddr_in sockets::getLocalAddr(int sockfd) //对于每个以连接套接字，都会有个本机地址和对等方的地址
+socklen_t sockets::sockaddrLength(const struct sockaddr* addr)
+{
+  switch (addr->sa_family)
+  {
+  case AF_INET:
+    return static_cast<socklen_t>(sizeof(struct sockaddr_in));
+  case AF_UNIX:
+  {
+    // abstract names start with '\0', and are not NUL terminated on the wire
+    const struct sockaddr_un* un = reinterpret_cast<const struct sockaddr_un*>(addr);
+    const size_t maxLen = sizeof un->sun_path;
+    size_t len = un->sun_path[0] == '\0'
+        ? 1 + ::strnlen(un->sun_path + 1, maxLen - 1)
+        : std::min(::strnlen(un->sun_path, maxLen) + 1, maxLen);
+    return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + len);
+  }
+  default:
+    return static_cast<socklen_t>(sizeof(struct sockaddr_in6));
+  }
+}
+
+struct sockaddr_storage sockets::getLocalAddr(int sockfd) //对于每个以连接套接字，都会有个本机地址和对等方的地址
 {
-    struct sockaddr_in localaddr;
+    struct sockaddr_storage localaddr;
     bzero(&localaddr, sizeof localaddr);
     socklen_t addrlen = static_cast<socklen_t>(sizeof localaddr);
-    if (::getsockname(sockfd, sockaddr_cast(&localaddr), &addrlen) < 0) //获取本机地址
+    if (::getsockname(sockfd, reinterpret_cast<struct sockaddr *>(&localaddr), &addrlen) < 0) //获取本机地址
     {
         LOG_SYSERR << "sockets::getLocalAddr";
     }
     return localaddr;
 }
 
-struct sockaddr_in sockets::getPeerAddr(int sockfd)
+struct sockaddr_storage sockets::getPeerAddr(int sockfd)
 {
-    struct sockaddr_in peeraddr;
+    struct sockaddr_storage peeraddr;
     bzero(&peeraddr, sizeof peeraddr);
     socklen_t addrlen = static_cast<socklen_t>(sizeof peeraddr);
-    if (::getpeername(sockfd, sockaddr_cast(&peeraddr), &addrlen) < 0) //获取对方地址
+    if (::getpeername(sockfd, reinterpret_cast<struct sockaddr *>(&peeraddr), &addrlen) < 0) //获取对方地址
     {
         LOG_SYSERR << "sockets::getPeerAddr";
     }
@@ -259,21 +411,23 @@ struct sockaddr_in sockets::getPeerAddr(int sockfd)
 
 bool sockets::isSelfConnect(int sockfd)
 {
-  struct sockaddr_in6 localaddr = getLocalAddr(sockfd);
-  struct sockaddr_in6 peeraddr = getPeerAddr(sockfd);
-  if (localaddr.sin6_family == AF_INET)
+  struct sockaddr_storage localaddr = getLocalAddr(sockfd);
+  struct sockaddr_storage peeraddr = getPeerAddr(sockfd);
+  if (localaddr.ss_family == AF_INET)
   {
     const struct sockaddr_in* laddr4 = reinterpret_cast<struct sockaddr_in*>(&localaddr);
     const struct sockaddr_in* raddr4 = reinterpret_cast<struct sockaddr_in*>(&peeraddr);
     return laddr4->sin_port == raddr4->sin_port
         && laddr4->sin_addr.s_addr == raddr4->sin_addr.s_addr;
   }
-  else if (localaddr.sin6_family == AF_INET6)
+  else if (localaddr.ss_family == AF_INET6)
   {
-    return localaddr.sin6_port == peeraddr.sin6_port
-        && memcmp(&localaddr.sin6_addr, &peeraddr.sin6_addr, sizeof localaddr.sin6_addr) == 0;
+    const struct sockaddr_in6* laddr6 = reinterpret_cast<struct sockaddr_in6*>(&localaddr);
+    const struct sockaddr_in6* raddr6 = reinterpret_cast<struct sockaddr_in6*>(&peeraddr);
+    return laddr6->sin6_port == raddr6->sin6_port
+        && memcmp(&laddr6->sin6_addr, &raddr6->sin6_addr, sizeof laddr6->sin6_addr) == 0;
   }
-  else
+  else  // AF_UNIX never connects to itself
   {
     return false;
   }
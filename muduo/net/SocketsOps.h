@@ -12,6 +12,7 @@
 #define MUDUO_NET_SOCKETSOPS_H
 
 #include <arpa/inet.h>
+#include <sys/socket.h>
 
 namespace muduo
 {
@@ -23,15 +24,29 @@ namespace sockets
 ///
 /// Creates a non-blocking socket file descriptor,
 /// abort if any error.
-int createNonblockingOrDie(); //创建一个非阻塞的套接字
+int createNonblockingOrDie(sa_family_t family); //创建一个非阻塞的流套接字，TCP或Unix域
+/// Same as above, but SOCK_DGRAM.
+int createUdpNonblockingOrDie(sa_family_t family);
 
-int connect(int sockfd, const struct sockaddr_in &addr);    //链接
-void bindOrDie(int sockfd, const struct sockaddr_in &addr); //绑定
-void listenOrDie(int sockfd);                               //监听
-int  accept(int sockfd, struct sockaddr_in6* addr);
+int connect(int sockfd, const struct sockaddr* addr);    //链接
+void bindOrDie(int sockfd, const struct sockaddr* addr); //绑定
+void listenOrDie(int sockfd);                            //监听
+int  accept(int sockfd, struct sockaddr_storage* addr);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
+ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+/// sendfile(2), @c count bytes of @c fd from @c *offset, which is advanced.
+ssize_t sendfile(int sockfd, int fd, off_t *offset, size_t count);
+
+/// Unix domain sockets only, sends @c nfds file descriptors (SCM_RIGHTS)
+/// along with the first byte of @c buf, which must not be empty.
+ssize_t writeWithFds(int sockfd, const void *buf, size_t count,
+                     const int *fds, int nfds);
+/// readv() which also receives file descriptors (SCM_RIGHTS), close-on-exec.
+/// At most @c maxFds are kept in @c fds, @c *nfds is set to the number received.
+ssize_t readvWithFds(int sockfd, const struct iovec *iov, int iovcnt,
+                     int *fds, int maxFds, int *nfds);
 void close(int sockfd);
 void shutdownWrite(int sockfd);
 
@@ -53,8 +68,11 @@ struct sockaddr* sockaddr_cast(struct sockaddr_in6* addr);
 const struct sockaddr_in* sockaddr_in_cast(const struct sockaddr* addr);
 const struct sockaddr_in6* sockaddr_in6_cast(const struct sockaddr* addr);
 
-struct sockaddr_in6 getLocalAddr(int sockfd);
-struct sockaddr_in6 getPeerAddr(int sockfd);
+/// Length of @c addr for bind() and connect(), by its family.
+socklen_t sockaddrLength(const struct sockaddr* addr);
+
+struct sockaddr_storage getLocalAddr(int sockfd);
+struct sockaddr_storage getPeerAddr(int sockfd);
 bool isSelfConnect(int sockfd);
 
 }  // namespace sockets
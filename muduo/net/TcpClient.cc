@@ -12,24 +12,23 @@
 #include "muduo/base/Logging.h"
 #include "muduo/net/Connector.h"
 #include "muduo/net/EventLoop.h"
+#include "muduo/net/Resolver.h"
 #include "muduo/net/SocketsOps.h"
 
+#include <algorithm>
+
 #include <stdio.h>  // snprintf
 
 using namespace muduo;
 using namespace muduo::net;
 
+const int TcpClient::kMaxResolveDelayMs;
+
 // TcpClient::TcpClient(EventLoop* loop)
 //   : loop_(loop)
 // {
 // }
 
-// TcpClient::TcpClient(EventLoop* loop, const string& host, uint16_t port)
-//   : loop_(CHECK_NOTNULL(loop)),
-//     serverAddr_(host, port)
-// {
-// }
-
 namespace muduo
 {
 namespace net
@@ -59,11 +58,15 @@ TcpClient::TcpClient(EventLoop* loop,
                      const string& nameArg)
   : loop_(CHECK_NOTNULL(loop)),
     connector_(new Connector(loop, serverAddr)),
+    resolver_(NULL),
+    port_(serverAddr.toPort()),
+    resolveDelayMs_(kInitResolveDelayMs),
     name_(nameArg),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
     retry_(false),
     connect_(true),
+    sharedMemory_(false),
     nextConnId_(1)
 {
     connector_->setNewConnectionCallback(                                   //设置连接成功回调函数
@@ -73,6 +76,33 @@ TcpClient::TcpClient(EventLoop* loop,
            << "] - connector " << get_pointer(connector_);
 }
 
+TcpClient::TcpClient(EventLoop* loop,
+                     Resolver* resolver,
+                     const string& host,
+                     uint16_t port,
+                     const string& nameArg)
+  : loop_(CHECK_NOTNULL(loop)),
+    connector_(new Connector(loop, InetAddress(port))),  //地址在解析完成后设置
+    resolver_(CHECK_NOTNULL(resolver)),
+    host_(host),
+    port_(port),
+    resolveDelayMs_(kInitResolveDelayMs),
+    guard_(std::make_shared<int>(0)),
+    name_(nameArg),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    retry_(false),
+    connect_(true),
+    sharedMemory_(false),
+    nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(
+        std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+  LOG_INFO << "TcpClient::TcpClient[" << name_
+           << "] - connector " << get_pointer(connector_)
+           << " host " << host_;
+}
+
 TcpClient::~TcpClient()
 {
     LOG_INFO << "TcpClient::~TcpClient[" << name_
@@ -110,11 +140,68 @@ TcpClient::~TcpClient()
 void TcpClient::connect()
 {
     // FIXME: check state
+    connect_ = true;
+    if (resolver_)
+    {
+        //先在loop线程中解析，解析完成后再发起连接
+        std::weak_ptr<int> guard(guard_);
+        loop_->runInLoop([this, guard] {
+            if (guard.lock())
+            {
+                resolveAndConnect();
+            }
+        });
+        return;
+    }
     LOG_INFO << "TcpClient::connect[" << name_ << "] - connecting to "
              << connector_->serverAddress().toIpPort();
-    connect_ = true;
     connector_->start(); //发起连接
 }
+
+void TcpClient::resolveAndConnect()
+{
+    loop_->assertInLoopThread();
+    if (!connect_)
+    {
+        return; //重试的定时器到期前调用了stop()或disconnect()
+    }
+    LOG_INFO << "TcpClient::connect[" << name_ << "] - resolving " << host_;
+    std::weak_ptr<int> guard(guard_); //resolver比TcpClient活得久
+    resolver_->resolve(host_, port_, [this, guard](const std::vector<InetAddress> &addresses) {
+        if (guard.lock())
+        {
+            onResolved(addresses);
+        }
+    });
+}
+
+void TcpClient::onResolved(const std::vector<InetAddress>& addresses)
+{
+    loop_->assertInLoopThread();
+    if (!connect_)
+    {
+        return; //解析期间调用了stop()或disconnect()
+    }
+    if (addresses.empty())
+    {
+        LOG_ERROR << "TcpClient::connect[" << name_ << "] - cannot resolve " << host_
+                  << ", retry in " << resolveDelayMs_ << " milliseconds";
+        std::weak_ptr<int> guard(guard_);
+        loop_->runAfter(resolveDelayMs_ / 1000.0, [this, guard] {
+            if (guard.lock())
+            {
+                resolveAndConnect();
+            }
+        });
+        resolveDelayMs_ = std::min(resolveDelayMs_ * 2, kMaxResolveDelayMs); //和Connector一样退避
+        return;
+    }
+    resolveDelayMs_ = kInitResolveDelayMs;
+    connector_->setServerAddresses(addresses); //连不上时轮流试其他地址
+    LOG_INFO << "TcpClient::connect[" << name_ << "] - connecting to "
+             << addresses.front().toIpPort();
+    connector_->restart(); //首次连接和重连都从断开状态开始
+}
 //用于连接已建立的情况下，关闭连接
 void TcpClient::disconnect()
 {
@@ -139,7 +226,7 @@ void TcpClient::newConnection(int sockfd)
 {
     loop_->assertInLoopThread();
     InetAddress peerAddr(sockets::getPeerAddr(sockfd));
-    char buf[32];
+    char buf[128];  // Unix domain socket paths are up to 108 bytes
     snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
     ++nextConnId_;
     string connName = name_ + buf;
@@ -158,6 +245,10 @@ void TcpClient::newConnection(int sockfd)
     conn->setWriteCompleteCallback(writeCompleteCallback_);
     conn->setCloseCallback(
         std::bind(&TcpClient::removeConnection, this, std::placeholders::_1)); // FIXME: unsafe
+    if (sharedMemory_)
+    {
+        conn->acceptSharedMemory();
+    }
     {
         MutexLockGuard lock(mutex_);
         connection_ = conn; //保存tcpconnection
@@ -182,6 +273,13 @@ void TcpClient::removeConnection(const TcpConnectionPtr &conn)
         LOG_INFO << "TcpClient::connect[" << name_ << "] - Reconnecting to "
                  << connector_->serverAddress().toIpPort();
         //这里的重连是值连接建立成功之后被断开的重连
-        connector_->restart();
+        if (resolver_)
+        {
+            resolveAndConnect(); //重新解析，地址可能已经改变
+        }
+        else
+        {
+            connector_->restart();
+        }
     }
 }
@@ -20,16 +20,25 @@ namespace net
 {
 
 class Connector;
+class Resolver;
 typedef std::shared_ptr<Connector> ConnectorPtr;
 
 class TcpClient : noncopyable
 {
 public:
     // TcpClient(EventLoop* loop);
-    // TcpClient(EventLoop* loop, const string& host, uint16_t port);
     TcpClient(EventLoop *loop,
               const InetAddress &serverAddr,
               const string &nameArg);
+    /// Resolves @c host with @c resolver on every connect and reconnect,
+    /// so a changed DNS record is picked up. All the addresses are tried
+    /// in turn, a failed resolution is retried with a growing delay.
+    /// @c resolver must belong to @c loop and outlive this client.
+    TcpClient(EventLoop *loop,
+              Resolver *resolver,
+              const string &host,
+              uint16_t port,
+              const string &nameArg);
     ~TcpClient(); // force out-line dtor, for std::unique_ptr members.
 
     void connect();
@@ -45,6 +54,10 @@ public:
     EventLoop *getLoop() const { return loop_; }
     bool retry() const { return retry_; }
     void enableRetry() { retry_ = true; }
+    /// Over a Unix domain socket, takes the shared memory rings of a
+    /// TcpServer with setSharedMemoryRingSize(). Sends are held back
+    /// until they arrive. Call before connect().
+    void enableSharedMemory() { sharedMemory_ = true; }
 
     const string &name() const
     {
@@ -77,15 +90,27 @@ private:
     void newConnection(int sockfd);
     /// Not thread safe, but in loop
     void removeConnection(const TcpConnectionPtr &conn);
+    /// Not thread safe, but in loop
+    void resolveAndConnect();
+    void onResolved(const std::vector<InetAddress> &addresses);
+
+    static const int kMaxResolveDelayMs = 30 * 1000;
+    static const int kInitResolveDelayMs = 500;
 
     EventLoop *loop_;
     ConnectorPtr connector_;                      // avoid revealing Connector用于发起主动连接
+    Resolver *resolver_;                          //为NULL时直接连接serverAddr
+    const string host_;                           //要解析的主机名
+    const uint16_t port_;
+    int resolveDelayMs_;                          //解析失败后重试的延迟，in loop
+    std::shared_ptr<int> guard_;                  //解析回调和定时器用weak_ptr判断TcpClient是否还在
     const string name_;                           //名称
     ConnectionCallback connectionCallback_;       //连接建立的回调函数
     MessageCallback messageCallback_;             //消息到来的回调函数
     WriteCompleteCallback writeCompleteCallback_; //数据发送完毕回调函数
     bool retry_;                                  // atomic重连，是指连接建立之后又意外断开的时候是否重连
     bool connect_;                                // atomic连接
+    bool sharedMemory_;                           //是否接收服务端的共享内存
     // always in loop thread
     int nextConnId_; //name_+nextconnid_用于标识一个连接
     mutable MutexLock mutex_;
@@ -0,0 +1,552 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/TcpClientPool.h"
+
+#include "muduo/base/Clock.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/WeakCallback.h"
+#include "muduo/net/Connector.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <algorithm>
+#include <deque>
+
+#include <stdio.h>  // snprintf
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace net
+{
+typedef std::shared_ptr<Connector> ConnectorPtr;
+
+namespace detail
+{
+
+// holds the connector till Connector::stopInLoop() has run
+void keepConnector(const ConnectorPtr&)
+{
+}
+
+}  // namespace detail
+}  // namespace net
+}  // namespace muduo
+
+///
+/// Connections of one loop, only accessed in that loop.
+///
+/// Timers and callbacks hold it by weak_ptr,
+/// so it can go away before them when the pool is destroyed.
+///
+class TcpClientPool::Bucket : noncopyable,
+                              public std::enable_shared_from_this<Bucket>
+{
+ public:
+  Bucket(const TcpClientPool& pool, EventLoop* loop, int index);
+
+  EventLoop* getLoop() const { return loop_; }
+
+  void start();
+  void stop();
+  void acquire(AcquireCallback cb);
+  void release(const TcpConnectionPtr& conn);
+
+ private:
+  enum SlotState { kConnecting, kBackoff, kIdle, kLeased };
+  static const int kMaxRetryDelayMs = 30 * 1000;
+  static const int kInitRetryDelayMs = 500;
+
+  // a connector and its connection
+  struct Slot
+  {
+    ConnectorPtr connector;
+    TcpConnectionPtr connection;
+    SlotState state;
+    bool warm;        // kept connected, otherwise closed when idle too long
+    bool evicted;     // closed for idle, reconnects without backoff
+    bool served;      // released at least once, so the upstream is healthy
+    int retryDelayMs; // 0 if the last connection was healthy
+    Timestamp connectedTime;
+    Timestamp idleSince;
+  };
+
+  struct Waiter
+  {
+    Timestamp deadline;
+    AcquireCallback callback;
+  };
+
+  static void onNewConnection(const std::weak_ptr<Bucket>& weak, Connector* connector, int sockfd);
+  static void onClose(const std::weak_ptr<Bucket>& weak, const TcpConnectionPtr& conn);
+  static void onReconnect(const std::weak_ptr<Bucket>& weak, Connector* connector);
+
+  void addSlot(bool warm);
+  Slot* findSlot(const Connector* connector) const;
+  Slot* findSlot(const TcpConnection* conn) const;
+  void newConnection(Connector* connector, int sockfd);
+  void removeConnection(const TcpConnectionPtr& conn);
+  void reconnect(Connector* connector);
+  void handOut(Slot* slot);
+  void expireWaiters();
+  void check();
+
+  EventLoop* loop_;
+  const InetAddress serverAddr_;
+  const string name_;
+  const ConnectionCallback connectionCallback_;
+  const MessageCallback messageCallback_;
+  const WriteCompleteCallback writeCompleteCallback_;
+  const HealthCheckCallback healthCheckCallback_;
+  const int connectionsPerLoop_;
+  const int maxConnectionsPerLoop_;
+  const double maxIdleSeconds_;
+  const double acquireTimeoutSeconds_;
+  const double healthCheckSeconds_;
+  bool stopped_;
+  int nextConnId_;
+  std::vector<std::unique_ptr<Slot>> slots_;
+  std::deque<Waiter> waiters_;
+};
+
+const int TcpClientPool::Bucket::kMaxRetryDelayMs;
+const int TcpClientPool::Bucket::kInitRetryDelayMs;
+
+TcpClientPool::Bucket::Bucket(const TcpClientPool& pool, EventLoop* loop, int index)
+  : loop_(loop),
+    serverAddr_(pool.serverAddr_),
+    name_(pool.name_ + "#" + std::to_string(index)),
+    connectionCallback_(pool.connectionCallback_),
+    messageCallback_(pool.messageCallback_),
+    writeCompleteCallback_(pool.writeCompleteCallback_),
+    healthCheckCallback_(pool.healthCheckCallback_),
+    connectionsPerLoop_(pool.connectionsPerLoop_),
+    maxConnectionsPerLoop_(std::max(pool.maxConnectionsPerLoop_, pool.connectionsPerLoop_)),
+    maxIdleSeconds_(pool.maxIdleSeconds_),
+    acquireTimeoutSeconds_(pool.acquireTimeoutSeconds_),
+    healthCheckSeconds_(pool.healthCheckSeconds_),
+    stopped_(false),
+    nextConnId_(1)
+{
+}
+
+void TcpClientPool::Bucket::start()
+{
+  loop_->assertInLoopThread();
+  for (int i = 0; i < connectionsPerLoop_; ++i)
+  {
+    addSlot(true);
+  }
+
+  double interval = healthCheckCallback_ ? healthCheckSeconds_ : 0.0;
+  if (maxIdleSeconds_ > 0.0 && (interval <= 0.0 || maxIdleSeconds_ / 2 < interval))
+  {
+    interval = maxIdleSeconds_ / 2;
+  }
+  if (interval > 0.0)
+  {
+    //维护定时器不需要精确
+    loop_->runEvery(interval, makeWeakCallback(shared_from_this(), &Bucket::check), interval / 10);
+  }
+}
+
+void TcpClientPool::Bucket::stop()
+{
+  loop_->assertInLoopThread();
+  stopped_ = true;
+  std::deque<Waiter> waiters;
+  waiters.swap(waiters_);
+  for (const Waiter& waiter : waiters)
+  {
+    waiter.callback(TcpConnectionPtr());
+  }
+
+  // like ~TcpServer(), the loop may quit right after this
+  std::vector<std::unique_ptr<Slot>> slots;
+  slots.swap(slots_);
+  for (const auto& slot : slots)
+  {
+    slot->connector->stop();
+    loop_->queueInLoop(std::bind(&detail::keepConnector, slot->connector));
+    if (slot->connection)
+    {
+      slot->connection->connectDestroyed();
+    }
+  }
+}
+
+void TcpClientPool::Bucket::acquire(AcquireCallback cb)
+{
+  loop_->assertInLoopThread();
+  if (stopped_)
+  {
+    cb(TcpConnectionPtr());
+    return;
+  }
+
+  // the most recently used one, so the others can be evicted when idle too long
+  Slot* found = NULL;
+  int pending = 0;
+  for (const auto& slot : slots_)
+  {
+    if (slot->state == kIdle && slot->connection->connected()
+        && (!found || found->idleSince < slot->idleSince))
+    {
+      found = get_pointer(slot);
+    }
+    else if (slot->state == kConnecting || slot->state == kBackoff)
+    {
+      ++pending;
+    }
+  }
+  if (found)
+  {
+    found->state = kLeased;
+    cb(found->connection);
+    return;
+  }
+
+  if (pending <= static_cast<int>(waiters_.size())
+      && static_cast<int>(slots_.size()) < maxConnectionsPerLoop_)
+  {
+    addSlot(false);
+  }
+  Waiter waiter = { addTime(Clock::monotonic(), acquireTimeoutSeconds_), std::move(cb) };
+  waiters_.push_back(std::move(waiter));
+  loop_->runAfter(acquireTimeoutSeconds_, makeWeakCallback(shared_from_this(), &Bucket::expireWaiters));
+}
+
+void TcpClientPool::Bucket::release(const TcpConnectionPtr& conn)
+{
+  loop_->assertInLoopThread();
+  if (!conn->connected())
+  {
+    // closed while leased, removeConnection() has freed or will reconnect its slot
+    LOG_DEBUG << "TcpClientPool::release [" << name_ << "] - connection "
+              << conn->name() << " is closed";
+    return;
+  }
+  Slot* slot = findSlot(get_pointer(conn));
+  if (slot == NULL || slot->state != kLeased)
+  {
+    LOG_ERROR << "TcpClientPool::release [" << name_ << "] - connection "
+              << conn->name() << " is not leased";
+    return;
+  }
+  slot->served = true;
+  handOut(slot);
+}
+
+void TcpClientPool::Bucket::onNewConnection(const std::weak_ptr<Bucket>& weak,
+                                            Connector* connector,
+                                            int sockfd)
+{
+  BucketPtr bucket(weak.lock());
+  if (bucket)
+  {
+    bucket->newConnection(connector, sockfd);
+  }
+  else
+  {
+    sockets::close(sockfd);
+  }
+}
+
+void TcpClientPool::Bucket::onClose(const std::weak_ptr<Bucket>& weak,
+                                    const TcpConnectionPtr& conn)
+{
+  BucketPtr bucket(weak.lock());
+  if (bucket)
+  {
+    bucket->removeConnection(conn);
+  }
+  else
+  {
+    conn->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+  }
+}
+
+void TcpClientPool::Bucket::onReconnect(const std::weak_ptr<Bucket>& weak, Connector* connector)
+{
+  BucketPtr bucket(weak.lock());
+  if (bucket)
+  {
+    bucket->reconnect(connector);
+  }
+}
+
+void TcpClientPool::Bucket::addSlot(bool warm)
+{
+  std::unique_ptr<Slot> slot(new Slot);
+  slot->connector.reset(new Connector(loop_, serverAddr_));
+  slot->connector->setNewConnectionCallback(
+      std::bind(&Bucket::onNewConnection, std::weak_ptr<Bucket>(shared_from_this()),
+                get_pointer(slot->connector), std::placeholders::_1));
+  slot->state = kConnecting;
+  slot->warm = warm;
+  slot->evicted = false;
+  slot->served = false;
+  slot->retryDelayMs = 0;
+  slot->connector->start();
+  slots_.push_back(std::move(slot));
+}
+
+TcpClientPool::Bucket::Slot* TcpClientPool::Bucket::findSlot(const Connector* connector) const
+{
+  for (const auto& slot : slots_)
+  {
+    if (get_pointer(slot->connector) == connector)
+    {
+      return get_pointer(slot);
+    }
+  }
+  return NULL;
+}
+
+TcpClientPool::Bucket::Slot* TcpClientPool::Bucket::findSlot(const TcpConnection* conn) const
+{
+  for (const auto& slot : slots_)
+  {
+    if (get_pointer(slot->connection) == conn)
+    {
+      return get_pointer(slot);
+    }
+  }
+  return NULL;
+}
+
+void TcpClientPool::Bucket::newConnection(Connector* connector, int sockfd)
+{
+  loop_->assertInLoopThread();
+  Slot* slot = findSlot(connector);
+  if (slot == NULL || stopped_)
+  {
+    sockets::close(sockfd);
+    return;
+  }
+  InetAddress peerAddr(sockets::getPeerAddr(sockfd));
+  char buf[128];  // Unix domain socket paths are up to 108 bytes
+  snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
+  ++nextConnId_;
+  string connName = name_ + buf;
+
+  InetAddress localAddr(sockets::getLocalAddr(sockfd));
+  TcpConnectionPtr conn(new TcpConnection(loop_,
+                                          connName,
+                                          sockfd,
+                                          localAddr,
+                                          peerAddr));
+  conn->setConnectionCallback(connectionCallback_);
+  conn->setMessageCallback(messageCallback_);
+  conn->setWriteCompleteCallback(writeCompleteCallback_);
+  conn->setCloseCallback(
+      std::bind(&Bucket::onClose, std::weak_ptr<Bucket>(shared_from_this()), std::placeholders::_1));
+  slot->connection = conn;
+  slot->connectedTime = Clock::monotonicCoarse();
+  conn->connectEstablished();
+  if (slot->connection == conn && conn->connected())
+  {
+    handOut(slot);
+  }
+}
+
+void TcpClientPool::Bucket::removeConnection(const TcpConnectionPtr& conn)
+{
+  loop_->assertInLoopThread();
+  loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+  Slot* slot = findSlot(get_pointer(conn));
+  if (slot == NULL)
+  {
+    return;
+  }
+  slot->connection.reset();
+
+  if (stopped_ || !slot->warm)
+  {
+    for (auto it = slots_.begin(); it != slots_.end(); ++it)
+    {
+      if (get_pointer(*it) == slot)
+      {
+        slots_.erase(it);
+        break;
+      }
+    }
+    return;
+  }
+
+  //连接用过，或者存活的时间超过了下一次的重连延迟，就认为是健康的，立即重连；否则退避
+  double lived = timeDifference(Clock::monotonicCoarse(), slot->connectedTime);
+  int nextDelayMs = slot->retryDelayMs == 0 ? kInitRetryDelayMs
+                                            : std::min(slot->retryDelayMs * 2, kMaxRetryDelayMs);
+  if (slot->evicted || slot->served || lived * 1000 >= nextDelayMs)
+  {
+    slot->retryDelayMs = 0;
+  }
+  else
+  {
+    slot->retryDelayMs = nextDelayMs;
+  }
+  slot->evicted = false;
+  slot->served = false;
+
+  if (slot->retryDelayMs == 0)
+  {
+    slot->state = kConnecting;
+    slot->connector->restart();
+  }
+  else
+  {
+    LOG_INFO << "TcpClientPool::removeConnection [" << name_ << "] - Reconnecting to "
+             << serverAddr_.toIpPort() << " in " << slot->retryDelayMs << " milliseconds";
+    slot->state = kBackoff;
+    loop_->runAfter(slot->retryDelayMs / 1000.0,
+                    std::bind(&Bucket::onReconnect, std::weak_ptr<Bucket>(shared_from_this()),
+                              get_pointer(slot->connector)));
+  }
+}
+
+void TcpClientPool::Bucket::reconnect(Connector* connector)
+{
+  loop_->assertInLoopThread();
+  Slot* slot = findSlot(connector);
+  if (slot && !stopped_ && slot->state == kBackoff)
+  {
+    slot->state = kConnecting;
+    slot->connector->restart();
+  }
+}
+
+void TcpClientPool::Bucket::handOut(Slot* slot)
+{
+  if (waiters_.empty())
+  {
+    slot->state = kIdle;
+    slot->idleSince = Clock::monotonicCoarse();
+  }
+  else
+  {
+    AcquireCallback cb(std::move(waiters_.front().callback));
+    waiters_.pop_front();
+    slot->state = kLeased;
+    cb(slot->connection);
+  }
+}
+
+void TcpClientPool::Bucket::expireWaiters()
+{
+  Timestamp now(Clock::monotonic());
+  while (!waiters_.empty() && !(now < waiters_.front().deadline))
+  {
+    AcquireCallback cb(std::move(waiters_.front().callback));
+    waiters_.pop_front();
+    LOG_WARN << "TcpClientPool::acquire [" << name_ << "] - timeout";
+    cb(TcpConnectionPtr());
+  }
+}
+
+void TcpClientPool::Bucket::check()
+{
+  loop_->assertInLoopThread();
+  Timestamp now(Clock::monotonicCoarse());
+  std::vector<TcpConnectionPtr> evicted;
+  std::vector<TcpConnectionPtr> idle;
+  for (const auto& slot : slots_)
+  {
+    if (slot->state != kIdle || !slot->connection->connected())
+    {
+      continue;
+    }
+    if (maxIdleSeconds_ > 0.0 && timeDifference(now, slot->idleSince) > maxIdleSeconds_)
+    {
+      slot->evicted = true;
+      evicted.push_back(slot->connection);
+    }
+    else
+    {
+      idle.push_back(slot->connection);
+    }
+  }
+  // callbacks may close connections and remove slots
+  for (const TcpConnectionPtr& conn : evicted)
+  {
+    LOG_DEBUG << "TcpClientPool::check [" << name_ << "] - evict " << conn->name();
+    conn->forceClose();
+  }
+  if (healthCheckCallback_)
+  {
+    for (const TcpConnectionPtr& conn : idle)
+    {
+      if (conn->connected())
+      {
+        healthCheckCallback_(conn);
+      }
+    }
+  }
+}
+
+TcpClientPool::TcpClientPool(const InetAddress& serverAddr,
+                             const string& nameArg)
+  : serverAddr_(serverAddr),
+    name_(nameArg),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    connectionsPerLoop_(1),
+    maxConnectionsPerLoop_(1),
+    maxIdleSeconds_(0.0),
+    acquireTimeoutSeconds_(3.0),
+    healthCheckSeconds_(0.0)
+{
+}
+
+TcpClientPool::~TcpClientPool()
+{
+  LOG_TRACE << "TcpClientPool::~TcpClientPool [" << name_ << "] destructing";
+  for (const auto& item : buckets_)
+  {
+    item.first->runInLoop(std::bind(&Bucket::stop, item.second));
+  }
+}
+
+void TcpClientPool::start(const std::vector<EventLoop*>& loops)
+{
+  assert(buckets_.empty());
+  LOG_INFO << "TcpClientPool::start [" << name_ << "] - connecting to "
+           << serverAddr_.toIpPort() << " from " << loops.size() << " loops";
+  int index = 0;
+  for (EventLoop* loop : loops)
+  {
+    BucketPtr bucket(new Bucket(*this, loop, index++));
+    buckets_[loop] = bucket;
+    loop->runInLoop(std::bind(&Bucket::start, bucket));
+  }
+}
+
+TcpClientPool::Bucket* TcpClientPool::findBucket(EventLoop* loop) const
+{
+  std::map<EventLoop*, BucketPtr>::const_iterator it = buckets_.find(loop);
+  return it == buckets_.end() ? NULL : get_pointer(it->second);
+}
+
+void TcpClientPool::acquire(AcquireCallback cb)
+{
+  Bucket* bucket = findBucket(EventLoop::getEventLoopOfCurrentThread());
+  if (bucket)
+  {
+    bucket->acquire(std::move(cb));
+  }
+  else
+  {
+    LOG_ERROR << "TcpClientPool::acquire [" << name_ << "] - not in a loop of the pool";
+    cb(TcpConnectionPtr());
+  }
+}
+
+void TcpClientPool::release(const TcpConnectionPtr& conn)
+{
+  Bucket* bucket = findBucket(conn->getLoop());
+  assert(bucket != NULL);
+  bucket->release(conn);
+}
@@ -0,0 +1,117 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_TCPCLIENTPOOL_H
+#define MUDUO_NET_TCPCLIENTPOOL_H
+
+#include "muduo/net/TcpConnection.h"
+
+#include <map>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Pool of connections to one upstream, with warm connections on every loop.
+///
+/// acquire() hands out an idle connection living on the caller's loop,
+/// so a proxy reads from upstream and writes to downstream in one thread,
+/// without runInLoop() and copying the message across threads.
+/// Each connection is leased to one caller until release().
+///
+/// Every loop keeps connectionsPerLoop() connections, reconnects them with
+/// exponential backoff, and opens at most maxConnectionsPerLoop() in total
+/// when all are leased. Idle connections older than maxIdle() are closed,
+/// the warm ones are replaced by fresh connections.
+///
+class TcpClientPool : noncopyable
+{
+ public:
+  /// Called in the caller's loop, with null connection if failed.
+  typedef std::function<void (const TcpConnectionPtr&)> AcquireCallback;
+  /// Called for every idle connection periodically,
+  /// which may send a probe, or close the connection if it is broken.
+  typedef std::function<void (const TcpConnectionPtr&)> HealthCheckCallback;
+
+  TcpClientPool(const InetAddress& serverAddr,
+                const string& nameArg);
+  ~TcpClientPool();  // force out-line dtor, for std::shared_ptr members.
+
+  const string& name() const { return name_; }
+  const InetAddress& serverAddress() const { return serverAddr_; }
+
+  /// Not thread safe, call before start().
+  void setConnectionsPerLoop(int n) { connectionsPerLoop_ = n; }
+  int connectionsPerLoop() const { return connectionsPerLoop_; }
+  void setMaxConnectionsPerLoop(int n) { maxConnectionsPerLoop_ = n; }
+  int maxConnectionsPerLoop() const { return maxConnectionsPerLoop_; }
+  /// 0 means idle connections are never closed.
+  void setMaxIdle(double seconds) { maxIdleSeconds_ = seconds; }
+  double maxIdle() const { return maxIdleSeconds_; }
+  /// acquire() fails if no connection is available within @c seconds.
+  void setAcquireTimeout(double seconds) { acquireTimeoutSeconds_ = seconds; }
+  void setHealthCheck(HealthCheckCallback cb, double intervalSeconds)
+  {
+    healthCheckCallback_ = std::move(cb);
+    healthCheckSeconds_ = intervalSeconds;
+  }
+
+  /// Set connection callback.
+  /// Not thread safe.
+  void setConnectionCallback(ConnectionCallback cb)
+  { connectionCallback_ = std::move(cb); }
+
+  /// Set message callback.
+  /// Not thread safe.
+  void setMessageCallback(MessageCallback cb)
+  { messageCallback_ = std::move(cb); }
+
+  /// Set write complete callback.
+  /// Not thread safe.
+  void setWriteCompleteCallback(WriteCompleteCallback cb)
+  { writeCompleteCallback_ = std::move(cb); }
+
+  /// Starts connecting in every loop, eg. TcpServer::threadPool()->getAllLoops().
+  /// Not thread safe, call only once.
+  void start(const std::vector<EventLoop*>& loops);
+
+  /// Gets an idle connection of the current loop.
+  /// Must be called in one of the loops passed to start().
+  void acquire(AcquireCallback cb);
+
+  /// Gives back a connection got from acquire(),
+  /// close it instead if the protocol state is broken.
+  /// One closed meanwhile is fine to give back.
+  /// Must be called in the loop of @c conn.
+  void release(const TcpConnectionPtr& conn);
+
+ private:
+  class Bucket;
+  typedef std::shared_ptr<Bucket> BucketPtr;
+
+  Bucket* findBucket(EventLoop* loop) const;
+
+  const InetAddress serverAddr_;
+  const string name_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+  WriteCompleteCallback writeCompleteCallback_;
+  HealthCheckCallback healthCheckCallback_;
+  int connectionsPerLoop_;
+  int maxConnectionsPerLoop_;
+  double maxIdleSeconds_;
+  double acquireTimeoutSeconds_;
+  double healthCheckSeconds_;
+  // immutable after start(), so acquire() does not lock
+  std::map<EventLoop*, BucketPtr> buckets_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TCPCLIENTPOOL_H
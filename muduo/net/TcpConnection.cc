@@ -12,14 +12,126 @@
 #include "muduo/base/WeakCallback.h"
 #include "muduo/net/Channel.h"
 #include "muduo/net/EventLoop.h"
+#include "muduo/net/ShmTransport.h"
 #include "muduo/net/Socket.h"
 #include "muduo/net/SocketsOps.h"
 
+#include <algorithm>
+
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+// sent by the server end with the fds of ShmTransport
+const char kShmOffer[8] = { 'M', 'U', 'D', 'U', 'O', 'S', 'H', 'M' };
+// sent instead when the server cannot create the rings,
+// or by the client end when it cannot attach them
+const char kShmDecline[8] = { 'M', 'U', 'D', 'U', 'O', 'N', 'O', 'S' };
+// sent by the client end once it has attached the rings
+const char kShmAck[8] = { 'M', 'U', 'D', 'U', 'O', 'A', 'C', 'K' };
+
+bool startsWith(const Buffer &buf, const char (&marker)[8])
+{
+    return buf.readableBytes() >= sizeof marker && ::memcmp(buf.peek(), marker, sizeof marker) == 0;
+}
+
+// a marker may come in two reads
+bool startsWithPartOf(const Buffer &buf, const char (&marker)[8])
+{
+    return buf.readableBytes() < sizeof marker && ::memcmp(buf.peek(), marker, buf.readableBytes()) == 0;
+}
+
+void writeMarker(int sockfd, const char (&marker)[8], const string &name)
+{
+    //对端还在等这个标记，之前没有别的输出
+    if (sockets::write(sockfd, marker, sizeof marker) != sizeof marker)
+    {
+        LOG_SYSERR << "TcpConnection::writeMarker [" << name << "]";
+    }
+}
+
+const int kSplicePipeSize = 256 * 1024;  // F_SETPIPE_SZ, 64KiB by default
+
+void closeFds(const std::vector<int>& fds)
+{
+    for (int fd : fds)
+    {
+        sockets::close(fd);
+    }
+}
+
+// returns false if the file ends early
+bool readFile(int fd, off_t offset, size_t count, Buffer* buf)
+{
+    buf->ensureWritableBytes(count);
+    while (count > 0)
+    {
+        ssize_t n = ::pread(fd, buf->beginWrite(), count, offset);
+        if (n <= 0)
+        {
+            LOG_SYSERR << "readFile " << fd;
+            return false;
+        }
+        buf->hasWritten(n);
+        offset += n;
+        count -= n;
+    }
+    return true;
+}
+
+// what a connection starts with, always shared, so never changed
+const std::shared_ptr<TcpConnection::CallbackSet> &emptyCallbacks()
+{
+    static std::shared_ptr<TcpConnection::CallbackSet> callbacks(new TcpConnection::CallbackSet);
+    return callbacks;
+}
+
+}  // namespace
+
+const double TcpConnection::kShmOfferTimeout = 1.0;
+
+struct TcpConnection::SplicePipe : noncopyable
+{
+    SplicePipe()
+        : pending(0),
+          eof(false)
+    {
+        fds[0] = fds[1] = -1;
+    }
+
+    ~SplicePipe()
+    {
+        if (fds[0] >= 0)
+        {
+            sockets::close(fds[0]);
+            sockets::close(fds[1]);
+        }
+    }
+
+    bool open()
+    {
+        if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+        {
+            LOG_SYSERR << "TcpConnection::SplicePipe::open";
+            return false;
+        }
+        ::fcntl(fds[1], F_SETPIPE_SZ, kSplicePipeSize); // best effort
+        return true;
+    }
+
+    int fds[2];
+    size_t pending; // bytes in the pipe
+    bool eof;       // the source has closed
+    Buffer behind;  // sent while pending > 0, goes after the pipe
+};
+
 void muduo::net::defaultConnectionCallback(const TcpConnectionPtr &conn)
 {
     //默认的连接到来函数，如果自己设置，是在tcpserver设置
@@ -41,51 +153,91 @@ TcpConnection::TcpConnection(EventLoop *loop,
                              int sockfd,
                              const InetAddress &localAddr,
                              const InetAddress &peerAddr)
+    : TcpConnection(loop, nameArg, sockfd, peerAddr)
+{
+    std::call_once(localAddrOnce_, [&] { localAddr_ = localAddr; });
+    socket_.setKeepAlive(true);
+}
+
+TcpConnection::TcpConnection(EventLoop *loop,
+                             const string &nameArg,
+                             int sockfd,
+                             const InetAddress &peerAddr)
     : loop_(CHECK_NOTNULL(loop)),
       name_(nameArg),
       state_(kConnecting),
       reading_(true),
-      socket_(new Socket(sockfd)),
-      channel_(new Channel(loop, sockfd)),
-      localAddr_(localAddr),
+      socket_(sockfd),
+      channel_(loop, sockfd),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024)
+      callbacks_(emptyCallbacks()),
+      highWaterMark_(64 * 1024 * 1024),
+      lowWaterMark_(0),
+      aboveHighWater_(false),
+      nextFlowSourceId_(0),
+      readPauses_(0),
+      inputBuffer_(0), //第一次读写时才分配
+      outputBuffer_(0),
+      outputBlockOffset_(0),
+      outputBlockBytes_(0),
+      shmRingSize_(0),
+      shmPending_(false),
+      shmLate_(false),
+      shmNotifyQueued_(false),
+      splicing_(false)
 { //在这些函数中调用了从用户层传递给TcpServer并且渗透到TcpConnection中的messageCallback_ writeCompleteCallback_函数
+    // lambdas capturing only this fit in std::function, std::bind would allocate
     //通道可读时间到来的时候，回到tcpconnection::handleread，-1是时间发生时间
-    channel_->setReadCallback(
-        std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
+    channel_.setReadCallback(
+        [this](Timestamp receiveTime) { handleRead(receiveTime); });
     //通道可写事件到来的时候，回调tcpconnection::handlewrite
-    channel_->setWriteCallback(
-        std::bind(&TcpConnection::handleWrite, this));
+    channel_.setWriteCallback([this] { handleWrite(); });
     //连接关闭，回调tcpconnection::handleclose
-    channel_->setCloseCallback(
-        std::bind(&TcpConnection::handleClose, this));
+    channel_.setCloseCallback([this] { handleClose(); });
     //发生错误，回调tcpconnection::handleerror
-    channel_->setErrorCallback(
-        std::bind(&TcpConnection::handleError, this));
+    channel_.setErrorCallback([this] { handleError(); });
     LOG_DEBUG << "TcpConnection::ctor[" << name_ << "] at " << this
               << " fd=" << sockfd;
-    socket_->setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection()
 {
     LOG_DEBUG << "TcpConnection::dtor[" << name_ << "] at " << this
-              << " fd=" << channel_->fd()
+              << " fd=" << channel_.fd()
               << " state=" << stateToString();
     assert(state_ == kDisconnected);
+    for (const auto &item : outputFds_)
+    {
+        closeFds(item.second);
+    }
+}
+
+const InetAddress &TcpConnection::localAddress() const
+{
+    std::call_once(localAddrOnce_, [this]
+                   { localAddr_ = InetAddress(sockets::getLocalAddr(socket_.fd())); });
+    return localAddr_;
+}
+
+TcpConnection::CallbackSet *TcpConnection::mutableCallbacks()
+{
+    if (callbacks_.use_count() > 1)
+    {
+        callbacks_.reset(new CallbackSet(*callbacks_)); //写时复制，其他连接不受影响
+    }
+    return get_pointer(callbacks_);
 }
 
 bool TcpConnection::getTcpInfo(struct tcp_info *tcpi) const
 {
-    return socket_->getTcpInfo(tcpi);
+    return socket_.getTcpInfo(tcpi);
 }
 
 string TcpConnection::getTcpInfoString() const
 {
     char buf[1024];
     buf[0] = '\0';
-    socket_->getTcpInfoString(buf, sizeof buf);
+    socket_.getTcpInfoString(buf, sizeof buf);
     return buf;
 }
 
@@ -154,6 +306,23 @@ void TcpConnection::send(Buffer *buf)
     }
 }
 
+//线程安全的，可以跨线程调用，不复制block
+void TcpConnection::send(const std::shared_ptr<const string> &block)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendBlockInLoop(block);
+        }
+        else
+        {
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendBlockInLoop, this, block));
+        }
+    }
+}
+
 //线程安全的，可以跨线程调用
 void TcpConnection::send(Buffer &&buf)
 {
@@ -191,18 +360,51 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
         LOG_WARN << "disconnected, give up writing";
         return;
     }
+    if (shmPending_)
+    {
+        // held back until the rings of the server arrive
+        outputBuffer_.append(static_cast<const char *>(data), len);
+        return;
+    }
+    if (spliceInput_ && spliceInput_->pending > 0)
+    {
+        // after the spliced bytes, drainSpliceInput() moves it to outputBuffer_
+        size_t oldLen = outputBytes() + spliceInput_->behind.readableBytes();
+        checkHighWaterMark(oldLen, oldLen + len);
+        spliceInput_->behind.append(static_cast<const char *>(data), len);
+        return;
+    }
+    if (!outputBlocks_.empty())
+    {
+        // after the blocks, as a block of its own
+        sendBlockInLoop(std::make_shared<const string>(static_cast<const char *>(data), len));
+        return;
+    }
+    if (shm_)
+    {
+        if (outputBuffer_.readableBytes() == 0)
+        {
+            nwrote = shm_->write(data, len);
+            remaining = len - nwrote;
+            queueShmNotify();
+            if (remaining == 0 && callbacks_->writeCompleteCallback)
+            {
+                loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
+            }
+        }
+    }
     // if no thing in output queue, try writing directly
     //通道没有关注可写时间不亲个发送缓冲区没有数据，直接write
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) //没有关注可写事件，且outputbuffer缓冲区没有数据
+    else if (!channel_.isWriting() && outputBuffer_.readableBytes() == 0) //没有关注可写事件，且outputbuffer缓冲区没有数据
     {
-        nwrote = sockets::write(channel_->fd(), data, len); //可以直接write
+        nwrote = sockets::write(channel_.fd(), data, len); //可以直接write
         if (nwrote >= 0)
         {
             remaining = len - nwrote;
             //写完了，回调writecompletecallback
-            if (remaining == 0 && writeCompleteCallback_) //如果等于0，说明都发送完毕，都拷贝到了内核缓冲区
+            if (remaining == 0 && callbacks_->writeCompleteCallback) //如果等于0，说明都发送完毕，都拷贝到了内核缓冲区
             {
-                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this())); //回调writeCompareCallback
+                loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this())); //回调writeCompareCallback
             }
         }
         else // nwrote < 0，出错了
@@ -225,15 +427,267 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     {
         size_t oldLen = outputBuffer_.readableBytes(); //oldlen是目前outputbuffer中的数据量
         //如果超过highwatermark_（高水位标），回调highwatermarkcallback
-        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_) //highwatermark肯定要小于oldlen长度
+        checkHighWaterMark(oldLen, oldLen + remaining);
+        outputBuffer_.append(static_cast<const char *>(data) + nwrote, remaining); //然后后面还有(data) + nwrote的数据没发送，就把他添加到outputbuffer中
+        if (shm_)
+        {
+            if (shm_->waitForSpace()) // the peer rings when it has read
+            {
+                flushShm();
+            }
+        }
+        else if (!channel_.isWriting())                                                //outputbuffer中有数据了，如果现在还没有关注pollout事件，则现在关注这个pollout事件
         {
-            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining)); //回调highwatermarkcallback，回调中可能把这个连接断开
+            channel_.enableWriting(); //关注这个pollout事件,当对等方的接受了数据，tcp的滑动窗口滑动了，这时候内核的发送缓冲区有位置了，pullout事件被触发，会回调tcpconnection::handlewrite
         }
-        outputBuffer_.append(static_cast<const char *>(data) + nwrote, remaining); //然后后面还有(data) + nwrote的数据没发送，就把他添加到outputbuffer中
-        if (!channel_->isWriting())                                                //outputbuffer中有数据了，如果现在还没有关注pollout事件，则现在关注这个pollout事件
+    }
+}
+
+void TcpConnection::sendBlockInLoop(const std::shared_ptr<const string> &block)
+{
+    loop_->assertInLoopThread();
+    if (shm_ || shmPending_ || spliceInput_)
+    {
+        sendInLoop(block->data(), block->size()); //这些路径只有outputBuffer_
+        return;
+    }
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+    size_t nwrote = 0;
+    bool faultError = false;
+    if (!channel_.isWriting() && outputBytes() == 0)
+    {
+        ssize_t n = sockets::write(channel_.fd(), block->data(), block->size());
+        if (n >= 0)
+        {
+            nwrote = n;
+            if (nwrote == block->size() && callbacks_->writeCompleteCallback)
+            {
+                loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
+            }
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            LOG_SYSERR << "TcpConnection::sendBlockInLoop";
+            if (errno == EPIPE || errno == ECONNRESET)
+            {
+                faultError = true;
+            }
+        }
+    }
+
+    size_t remaining = block->size() - nwrote;
+    if (!faultError && remaining > 0)
+    {
+        size_t oldLen = outputBytes();
+        checkHighWaterMark(oldLen, oldLen + remaining);
+        if (outputBlocks_.empty())
+        {
+            outputBlockOffset_ = nwrote;
+        }
+        outputBlocks_.push_back(OutputBlock{block, nullptr, -1, 0, 0});
+        outputBlockBytes_ += remaining;
+        if (!channel_.isWriting())
+        {
+            channel_.enableWriting();
+        }
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t count,
+                             const std::shared_ptr<const void> &owner)
+{
+    loop_->assertInLoopThread();
+    if (shm_ || shmPending_ || spliceInput_)
+    {
+        Buffer buf(0);
+        if (readFile(fd, offset, count, &buf)) //这些路径只有outputBuffer_
+        {
+            sendInLoop(buf.peek(), buf.readableBytes());
+        }
+        return;
+    }
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+    size_t nwrote = 0;
+    bool faultError = false;
+    if (!channel_.isWriting() && outputBytes() == 0)
+    {
+        off_t sent = offset;
+        ssize_t n = sockets::sendfile(channel_.fd(), fd, &sent, count);
+        if (n >= 0)
+        {
+            nwrote = n;
+            if (nwrote == count && callbacks_->writeCompleteCallback)
+            {
+                loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
+            }
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            LOG_SYSERR << "TcpConnection::sendFile";
+            if (errno == EPIPE || errno == ECONNRESET)
+            {
+                faultError = true;
+            }
+        }
+    }
+
+    size_t remaining = count - nwrote;
+    if (!faultError && remaining > 0)
+    {
+        size_t oldLen = outputBytes();
+        checkHighWaterMark(oldLen, oldLen + remaining);
+        outputBlocks_.push_back(OutputBlock{nullptr, owner, fd,
+                                            static_cast<off_t>(offset + nwrote), remaining});
+        outputBlockBytes_ += remaining;
+        if (!channel_.isWriting())
+        {
+            channel_.enableWriting();
+        }
+    }
+}
+
+ssize_t TcpConnection::writeBlocks()
+{
+    OutputBlock &front = outputBlocks_.front();
+    if (front.fd >= 0)
+    {
+        ssize_t n = sockets::sendfile(channel_.fd(), front.fd, &front.offset, front.size);
+        if (n > 0)
+        {
+            outputBlockBytes_ -= n;
+            front.size -= n;
+            if (front.size == 0)
+            {
+                outputBlocks_.erase(outputBlocks_.begin()); //最后一个引用时关闭文件
+            }
+        }
+        else if (n == 0)
+        {
+            LOG_ERROR << "TcpConnection::writeBlocks [" << name_ << "] - file ends early";
+            forceCloseInLoop(); //已经许诺的字节发不出来了
+        }
+        return n;
+    }
+
+    const int kMaxBlocksPerWrite = 64;
+    struct iovec vec[kMaxBlocksPerWrite];
+    int count = 0;
+    size_t offset = outputBlockOffset_;
+    for (const auto &block : outputBlocks_)
+    {
+        if (count == kMaxBlocksPerWrite || block.fd >= 0)
+        {
+            break; //文件留给下一次sendfile
+        }
+        vec[count].iov_base = const_cast<char *>(block.data->data()) + offset;
+        vec[count].iov_len = block.data->size() - offset;
+        offset = 0;
+        ++count;
+    }
+    ssize_t n = sockets::writev(channel_.fd(), vec, count);
+    if (n > 0)
+    {
+        outputBlockBytes_ -= n;
+        size_t left = n;
+        size_t sent = 0; // whole blocks
+        while (left > 0)
+        {
+            size_t unsent = outputBlocks_[sent].data->size() - outputBlockOffset_;
+            if (left < unsent)
+            {
+                outputBlockOffset_ += left;
+                break;
+            }
+            left -= unsent;
+            outputBlockOffset_ = 0;
+            ++sent;
+        }
+        outputBlocks_.erase(outputBlocks_.begin(), outputBlocks_.begin() + sent); //最后一个引用时释放
+    }
+    return n;
+}
+
+// copies the blocks into outputBuffer_
+void TcpConnection::flattenBlocks()
+{
+    for (const auto &block : outputBlocks_)
+    {
+        if (block.fd >= 0)
+        {
+            readFile(block.fd, block.offset, block.size, &outputBuffer_);
+        }
+        else
+        {
+            outputBuffer_.append(block.data->data() + outputBlockOffset_,
+                                 block.data->size() - outputBlockOffset_);
+            outputBlockOffset_ = 0;
+        }
+    }
+    outputBlocks_.clear();
+    outputBlockBytes_ = 0;
+}
+
+void TcpConnection::sendFds(const StringPiece &message, const std::vector<int> &fds)
+{
+    loop_->assertInLoopThread();
+    assert(message.size() > 0);
+    if (shm_ || shmPending_ || spliceInput_)
+    {
+        LOG_ERROR << "TcpConnection::sendFds [" << name_ << "] - not over shared memory or to a splice sink";
+        return;
+    }
+    if (state_ != kConnected)
+    {
+        LOG_WARN << "disconnected, give up sending fds";
+        return;
+    }
+    std::vector<int> dups;
+    for (int fd : fds)
+    {
+        int dup = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dup < 0)
         {
-            channel_->enableWriting(); //关注这个pollout事件,当对等方的接受了数据，tcp的滑动窗口滑动了，这时候内核的发送缓冲区有位置了，pullout事件被触发，会回调tcpconnection::handlewrite
+            LOG_SYSERR << "TcpConnection::sendFds - dup " << fd;
+            closeFds(dups);
+            return;
         }
+        dups.push_back(dup);
+    }
+    flattenBlocks(); //outputFds_的偏移只针对outputBuffer_
+
+    if (!channel_.isWriting() && outputBuffer_.readableBytes() == 0)
+    {
+        ssize_t nwrote = sockets::writeWithFds(channel_.fd(), message.data(), message.size(),
+                                               dups.data(), static_cast<int>(dups.size()));
+        if (nwrote > 0)
+        {
+            closeFds(dups); //已经在对端了
+            sendInLoop(message.data() + nwrote, message.size() - nwrote);
+            return;
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            LOG_SYSERR << "TcpConnection::sendFds";
+            closeFds(dups);
+            return;
+        }
+    }
+    //排在outputBuffer_中已有数据之后，由handleWrite发送
+    size_t oldLen = outputBuffer_.readableBytes();
+    checkHighWaterMark(oldLen, oldLen + message.size());
+    outputFds_.push_back(std::make_pair(oldLen, std::move(dups)));
+    outputBuffer_.append(message.data(), message.size());
+    if (!channel_.isWriting())
+    {
+        channel_.enableWriting();
     }
 }
 
@@ -254,10 +708,10 @@ void TcpConnection::shutdown()
 void TcpConnection::shutdownInLoop()
 {
     loop_->assertInLoopThread(); //断言在io线程调用
-    if (!channel_->isWriting())  //如果不在处于pollout状态
+    if (!channel_.isWriting() && outputBytes() == 0)  //如果不在处于pollout状态，并且没有数据等待写入共享内存
     {
         // we are not writing
-        socket_->shutdownWrite(); //关闭写的一端，否则不能关闭
+        socket_.shutdownWrite(); //关闭写的一端，否则不能关闭
         //当数据发完之后，服务端还要在判断一下现在状态是否处于kdisconnecting状态
         //如果处于这个状态，服务端主动断开和客户端的连接
         //这就意味着 客户端 read返回为0 close(conn);
@@ -278,10 +732,10 @@ void TcpConnection::shutdownInLoop()
 // void TcpConnection::shutdownAndForceCloseInLoop(double seconds)
 // {
 //   loop_->assertInLoopThread();
-//   if (!channel_->isWriting())
+//   if (!channel_.isWriting())
 //   {
 //     // we are not writing
-//     socket_->shutdownWrite();
+//     socket_.shutdownWrite();
 //   }
 //   loop_->runAfter(
 //       seconds,
@@ -340,7 +794,7 @@ const char *TcpConnection::stateToString() const
 
 void TcpConnection::setTcpNoDelay(bool on)
 {
-    socket_->setTcpNoDelay(on);
+    socket_.setTcpNoDelay(on);
 }
 
 void TcpConnection::startRead()
@@ -351,9 +805,12 @@ void TcpConnection::startRead()
 void TcpConnection::startReadInLoop()
 {
     loop_->assertInLoopThread();
-    if (!reading_ || !channel_->isReading())
+    if (!reading_ || !channel_.isReading())
     {
-        channel_->enableReading();
+        if (readPauses_ == 0) //否则等到sink低于低水位标
+        {
+            channel_.enableReading();
+        }
         reading_ = true;
     }
 }
@@ -366,9 +823,9 @@ void TcpConnection::stopRead()
 void TcpConnection::stopReadInLoop()
 {
     loop_->assertInLoopThread();
-    if (reading_ || channel_->isReading())
+    if (reading_ || channel_.isReading())
     {
-        channel_->disableReading();
+        channel_.disableReading();
         reading_ = false;
     }
 }
@@ -378,10 +835,22 @@ void TcpConnection::connectEstablished()
     loop_->assertInLoopThread();
     assert(state_ == kConnecting);
     setState(kConnected);
-    channel_->tie(shared_from_this());
-    channel_->enableReading(); //tcpconnection所对应的通道加入到poller关注
+    channel_.tie(shared_from_this());
+    channel_.enableReading(); //tcpconnection所对应的通道加入到poller关注
+    if (peerAddr_.family() == AF_UNIX && shmRingSize_ > 0)
+    {
+        offerShm(); //在用户发送任何数据之前
+    }
+    else if (peerAddr_.family() != AF_UNIX)
+    {
+        shmPending_ = false;
+    }
+    else if (shmPending_)
+    {
+        waitForShmOffer(); //不用共享内存的服务端什么也不发
+    }
 
-    connectionCallback_(shared_from_this());
+    callbacks_->connectionCallback(shared_from_this());
 }
 
 void TcpConnection::connectDestroyed()
@@ -390,24 +859,69 @@ void TcpConnection::connectDestroyed()
     if (state_ == kConnected)
     {
         setState(kDisconnected);
-        channel_->disableAll();
+        channel_.disableAll();
+        releaseFlowSources();
+        releaseFlowSinks();
+        releaseSpliceSource();
 
-        connectionCallback_(shared_from_this());
+        callbacks_->connectionCallback(shared_from_this());
+    }
+    channel_.remove();
+    if (shm_)
+    {
+        shm_->stop();
     }
-    channel_->remove();
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
     loop_->assertInLoopThread();
+    if (splicing_)
+    {
+        handleSpliceRead();
+        return;
+    }
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno); //当消息到来时读这个通道
+    ssize_t n = 0;
+    std::vector<int> fds;
+    if (callbacks_->fdsCallback || shmPending_ || shmLate_)
+    {
+        n = inputBuffer_.readFd(channel_.fd(), &savedErrno, &fds);
+    }
+    else
+    {
+        n = inputBuffer_.readFd(channel_.fd(), &savedErrno); //当消息到来时读这个通道
+    }
     if (n > 0)
     {
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        if ((shmPending_ || shmLate_) && !(shmOffered_ ? takeShmAnswer() : attachShm(&fds)))
+        {
+            return; //标记还没收全
+        }
+        if (!fds.empty())
+        {
+            if (callbacks_->fdsCallback)
+            {
+                callbacks_->fdsCallback(shared_from_this(), fds);
+            }
+            else
+            {
+                closeFds(fds);
+            }
+        }
+        if (inputBuffer_.readableBytes() > 0)
+        {
+            callbacks_->messageCallback(shared_from_this(), &inputBuffer_, receiveTime);
+        }
+        inputBuffer_.releaseIfEmpty(Buffer::kInitialSize); //空闲连接不占大块内存
     }
     else if (n == 0)
     {
+        // what the peer wrote before closing
+        if (shm_ && shm_->read(&inputBuffer_) > 0)
+        {
+            callbacks_->messageCallback(shared_from_this(), &inputBuffer_, receiveTime);
+        }
         handleClose();
     }
     else
@@ -421,27 +935,74 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 void TcpConnection::handleWrite() //pollout事件触发了
 {
     loop_->assertInLoopThread();
-    if (channel_->isWriting()) //如果关注了pollout事件
+    if (channel_.isWriting()) //如果关注了pollout事件
     {
-        ssize_t n = sockets::write(channel_->fd(), //这时就把outputbuffer中的写入
-                                   outputBuffer_.peek(),
-                                   outputBuffer_.readableBytes());
-        if (n > 0) //不一定能写完，写了n个字节
+        if (spliceInput_ && outputBuffer_.readableBytes() == 0)
         {
-            outputBuffer_.retrieve(n);              //缓冲区下标的移动，因为这时已经写了n个字节了
-            if (outputBuffer_.readableBytes() == 0) //==0说明发送缓冲区已清空
-            {
-                channel_->disableWriting(); //停止关注pollout事件，以免出现busy_loop
-                if (writeCompleteCallback_) //回调writecomplatecallback
-                {
-                    //应用层发送缓冲区被清空，就回调writecomplatecallback
-                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-                }
-                if (state_ == kDisconnecting) //发送缓冲区已清空并且连接状态是kdisconnecting,要关闭连接(在shutdown函数哪里，如果要关闭连接，关闭前必须把数据都发送到对端)
-                {
-                    shutdownInLoop(); //关闭连接
-                }
-            }
+            drainSpliceInput(); //等待的是管道中的数据
+            return;
+        }
+        ssize_t n = 0;
+        size_t len = outputBuffer_.readableBytes();
+        if (len == 0 && !outputBlocks_.empty())
+        {
+            n = writeBlocks(); //outputBuffer_已写完，再写block
+        }
+        else if (!outputFds_.empty() && outputFds_.front().first == 0)
+        {
+            //fds随这段数据的第一个字节发送，一次只发一组
+            if (outputFds_.size() > 1)
+            {
+                len = std::min(len, outputFds_[1].first);
+            }
+            std::vector<int> &fds = outputFds_.front().second;
+            n = sockets::writeWithFds(channel_.fd(), outputBuffer_.peek(), len,
+                                      fds.data(), static_cast<int>(fds.size()));
+            if (n > 0)
+            {
+                closeFds(fds);
+                outputFds_.erase(outputFds_.begin());
+            }
+        }
+        else
+        {
+            if (!outputFds_.empty())
+            {
+                len = std::min(len, outputFds_.front().first);
+            }
+            n = sockets::write(channel_.fd(), //这时就把outputbuffer中的写入
+                               outputBuffer_.peek(),
+                               len);
+        }
+        if (n > 0) //不一定能写完，写了n个字节
+        {
+            if (len > 0)
+            {
+                outputBuffer_.retrieve(n);              //缓冲区下标的移动，因为这时已经写了n个字节了
+                for (auto &item : outputFds_)
+                {
+                    item.first -= n;
+                }
+            }
+            if (outputBytes() == 0) //==0说明发送缓冲区已清空
+            {
+                channel_.disableWriting(); //停止关注pollout事件，以免出现busy_loop
+                outputBuffer_.releaseIfEmpty(Buffer::kInitialSize);
+                if (callbacks_->writeCompleteCallback) //回调writecomplatecallback
+                {
+                    //应用层发送缓冲区被清空，就回调writecomplatecallback
+                    loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
+                }
+                if (spliceInput_)
+                {
+                    drainSpliceInput(); //管道中的数据排在outputBuffer_之后
+                }
+                else if (state_ == kDisconnecting) //发送缓冲区已清空并且连接状态是kdisconnecting,要关闭连接(在shutdown函数哪里，如果要关闭连接，关闭前必须把数据都发送到对端)
+                {
+                    shutdownInLoop(); //关闭连接
+                }
+            }
+            checkLowWaterMark(); //最后调用，恢复的producer可能会立刻send
         }
         else
         {
@@ -450,7 +1011,7 @@ void TcpConnection::handleWrite() //pollout事件触发了
     }
     else
     {
-        LOG_TRACE << "Connection fd = " << channel_->fd()
+        LOG_TRACE << "Connection fd = " << channel_.fd()
                   << " is down, no more writing";
     }
 }
@@ -458,21 +1019,541 @@ void TcpConnection::handleWrite() //pollout事件触发了
 void TcpConnection::handleClose()
 {
     loop_->assertInLoopThread();
-    LOG_TRACE << "fd = " << channel_->fd() << " state = " << stateToString();
+    LOG_TRACE << "fd = " << channel_.fd() << " state = " << stateToString();
     assert(state_ == kConnected || state_ == kDisconnecting);
     // we don't close fd, leave it to dtor, so we can find leaks easily.
     setState(kDisconnected);
-    channel_->disableAll();
+    channel_.disableAll();
+    if (shm_)
+    {
+        shm_->stop();
+    }
+    releaseFlowSources();
+    releaseFlowSinks();
+    releaseSpliceSource();
 
     TcpConnectionPtr guardThis(shared_from_this());
-    connectionCallback_(guardThis); //这一行可以不调用，这里调用的是用户的回调函数onconnection函数，处理三个半事件的函数，里面判断是连接还是断开
+    callbacks_->connectionCallback(guardThis); //这一行可以不调用，这里调用的是用户的回调函数onconnection函数，处理三个半事件的函数，里面判断是连接还是断开
     // must be the last line
-    closeCallback_(guardThis); //调用tcpserverremoveconnection
+    callbacks_->closeCallback(guardThis); //调用tcpserverremoveconnection
 }
 
 void TcpConnection::handleError()
 {
-    int err = sockets::getSocketError(channel_->fd());
+    int err = sockets::getSocketError(channel_.fd());
     LOG_ERROR << "TcpConnection::handleError [" << name_
               << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
+
+void TcpConnection::handleShm(Timestamp receiveTime)
+{
+    loop_->assertInLoopThread();
+    if (shm_->read(&inputBuffer_) > 0)
+    {
+        callbacks_->messageCallback(shared_from_this(), &inputBuffer_, receiveTime);
+    }
+    if (state_ != kDisconnected && outputBuffer_.readableBytes() > 0)
+    {
+        flushShm();
+    }
+}
+
+void TcpConnection::offerShm()
+{
+    std::unique_ptr<ShmTransport> shm(ShmTransport::create(loop_, shmRingSize_));
+    if (!shm)
+    {
+        // stay on the socket, and say so, the client waits for an answer
+        writeMarker(channel_.fd(), kShmDecline, name_);
+        return;
+    }
+    std::vector<int> fds = shm->peerFds();
+    ssize_t n = sockets::writeWithFds(channel_.fd(), kShmOffer, sizeof kShmOffer,
+                                      fds.data(), static_cast<int>(fds.size()));
+    if (n != sizeof kShmOffer)
+    {
+        LOG_SYSERR << "TcpConnection::offerShm [" << name_ << "]";
+        return;
+    }
+    //客户端说用了才切换，在那之前的输出留着
+    shmOffered_ = std::move(shm);
+    shmPending_ = true;
+}
+
+// the client end, returns false while the marker of the server is incomplete
+bool TcpConnection::attachShm(std::vector<int> *fds)
+{
+    if (fds->empty() && (startsWithPartOf(inputBuffer_, kShmOffer) ||
+                         startsWithPartOf(inputBuffer_, kShmDecline)))
+    {
+        return false;
+    }
+    if (shmLate_)
+    {
+        // we have sent on the socket, the server has seen it and stays there too
+        shmLate_ = false;
+        if (startsWith(inputBuffer_, kShmOffer) || startsWith(inputBuffer_, kShmDecline))
+        {
+            if (startsWith(inputBuffer_, kShmOffer))
+            {
+                closeFds(*fds);
+                fds->clear();
+            }
+            inputBuffer_.retrieve(sizeof kShmOffer);
+            LOG_WARN << "TcpConnection::attachShm [" << name_
+                     << "] - the answer of the peer came late, stay on the socket";
+        }
+        return true;
+    }
+    if (fds->size() == 3 && startsWith(inputBuffer_, kShmOffer))
+    {
+        inputBuffer_.retrieve(sizeof kShmOffer);
+        shm_ = ShmTransport::attach(loop_, *fds);
+        fds->clear();
+        if (shm_)
+        {
+            writeMarker(channel_.fd(), kShmAck, name_);
+            shm_->start(std::bind(&TcpConnection::handleShm, this, std::placeholders::_1),
+                        shared_from_this());
+        }
+        else
+        {
+            LOG_WARN << "TcpConnection::attachShm [" << name_
+                     << "] - cannot attach the shared memory, stay on the socket";
+            writeMarker(channel_.fd(), kShmDecline, name_);
+        }
+    }
+    else if (startsWith(inputBuffer_, kShmDecline))
+    {
+        inputBuffer_.retrieve(sizeof kShmDecline);
+        LOG_WARN << "TcpConnection::attachShm [" << name_
+                 << "] - the peer has no shared memory, stay on the socket";
+    }
+    else
+    {
+        LOG_WARN << "TcpConnection::attachShm [" << name_
+                 << "] - no shared memory from the peer, stay on the socket";
+    }
+    endShmPending();
+    return true;
+}
+
+// the server end, returns false while the answer of the client is incomplete
+bool TcpConnection::takeShmAnswer()
+{
+    if (startsWithPartOf(inputBuffer_, kShmAck) || startsWithPartOf(inputBuffer_, kShmDecline))
+    {
+        return false;
+    }
+    std::unique_ptr<ShmTransport> shm(std::move(shmOffered_));
+    if (startsWith(inputBuffer_, kShmAck))
+    {
+        inputBuffer_.retrieve(sizeof kShmAck);
+        shm_ = std::move(shm);
+        shm_->start(std::bind(&TcpConnection::handleShm, this, std::placeholders::_1),
+                    shared_from_this());
+    }
+    else if (startsWith(inputBuffer_, kShmDecline))
+    {
+        inputBuffer_.retrieve(sizeof kShmDecline);
+        LOG_WARN << "TcpConnection::takeShmAnswer [" << name_
+                 << "] - the peer cannot attach the shared memory, stay on the socket";
+    }
+    else
+    {
+        // the client gave up waiting for our offer, its data is on the socket
+        LOG_WARN << "TcpConnection::takeShmAnswer [" << name_
+                 << "] - no answer from the peer, stay on the socket";
+    }
+    endShmPending();
+    return true;
+}
+
+// the client end, gives up only when it has something to send
+void TcpConnection::waitForShmOffer()
+{
+    std::weak_ptr<TcpConnection> weak(shared_from_this());
+    loop_->runAfter(kShmOfferTimeout, [weak]
+        {
+            TcpConnectionPtr conn = weak.lock();
+            if (!conn || !conn->shmPending_ || conn->state_ == kDisconnected)
+            {
+                return;
+            }
+            if (conn->outputBuffer_.readableBytes() == 0)
+            {
+                conn->waitForShmOffer(); //没有要发的，慢的服务端的提议还能用上
+                return;
+            }
+            LOG_WARN << "TcpConnection::waitForShmOffer [" << conn->name_
+                     << "] - no offer from the peer, stay on the socket";
+            conn->shmLate_ = true; //提议可能还在路上，会在服务端的数据之前到
+            conn->endShmPending();
+        });
+}
+
+// sends what was held back while waiting for the peer
+void TcpConnection::endShmPending()
+{
+    shmPending_ = false;
+    if (outputBuffer_.readableBytes() > 0)
+    {
+        if (shm_)
+        {
+            flushShm();
+        }
+        else
+        {
+            channel_.enableWriting();
+        }
+    }
+}
+
+void TcpConnection::flushShm()
+{
+    while (outputBuffer_.readableBytes() > 0)
+    {
+        size_t n = shm_->write(outputBuffer_.peek(), outputBuffer_.readableBytes());
+        outputBuffer_.retrieve(n);
+        queueShmNotify();
+        if (outputBuffer_.readableBytes() > 0 && !shm_->waitForSpace())
+        {
+            checkLowWaterMark();
+            return; // the peer rings when it has read
+        }
+    }
+    checkLowWaterMark();
+    if (callbacks_->writeCompleteCallback)
+    {
+        loop_->queueInLoop(std::bind(callbacks_->writeCompleteCallback, shared_from_this()));
+    }
+    if (state_ == kDisconnecting)
+    {
+        shutdownInLoop();
+    }
+}
+
+void TcpConnection::queueShmNotify()
+{
+    if (!shmNotifyQueued_)
+    {
+        shmNotifyQueued_ = true;
+        loop_->queueInLoop(std::bind(&TcpConnection::notifyShm, shared_from_this()));
+    }
+}
+
+void TcpConnection::notifyShm()
+{
+    shmNotifyQueued_ = false;
+    if (shm_)
+    {
+        shm_->notify();
+    }
+}
+
+void TcpConnection::spliceTo(const TcpConnectionPtr &sink)
+{
+    loop_->assertInLoopThread();
+    assert(sink->getLoop() == loop_);
+    if (shm_ || shmPending_ || sink->shm_ || sink->shmPending_)
+    {
+        LOG_ERROR << "TcpConnection::spliceTo [" << name_ << "] - not over shared memory";
+        return;
+    }
+    if (!sink->spliceInput_)
+    {
+        std::unique_ptr<SplicePipe> pipe(new SplicePipe);
+        if (!pipe->open())
+        {
+            return;
+        }
+        sink->spliceInput_ = std::move(pipe);
+    }
+    sink->flattenBlocks(); //drainSpliceInput()只等outputBuffer_
+    sink->spliceSource_ = shared_from_this();
+    spliceSink_ = sink;
+    splicing_ = true;
+    if (inputBuffer_.readableBytes() > 0)
+    {
+        sink->send(&inputBuffer_);
+    }
+}
+
+void TcpConnection::handleSpliceRead()
+{
+    TcpConnectionPtr sink = spliceSink_.lock();
+    if (!sink || sink->state_ != kConnected)
+    {
+        // nowhere to go, drop what comes until the peer closes
+        int savedErrno = 0;
+        ssize_t n = inputBuffer_.readFd(channel_.fd(), &savedErrno);
+        inputBuffer_.retrieveAll();
+        if (n == 0)
+        {
+            handleClose();
+        }
+        return;
+    }
+
+    SplicePipe &pipe = *sink->spliceInput_;
+    if (pipe.behind.readableBytes() > 0)
+    {
+        channel_.disableReading(); // the sink sent something after the pipe, wait for it
+        return;
+    }
+    ssize_t n = ::splice(channel_.fd(), NULL, pipe.fds[1], NULL, kSplicePipeSize,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n > 0)
+    {
+        pipe.pending += n;
+        sink->drainSpliceInput();
+    }
+    else if (n == 0)
+    {
+        pipe.eof = true;
+        sink->drainSpliceInput();
+        handleClose();
+        return;
+    }
+    else if (errno != EAGAIN)
+    {
+        LOG_SYSERR << "TcpConnection::handleSpliceRead";
+        handleError();
+    }
+    if (pipe.pending > 0)
+    {
+        channel_.disableReading(); // the sink is full, resumeRead() when drained
+    }
+}
+
+void TcpConnection::drainSpliceInput()
+{
+    if (outputBuffer_.readableBytes() > 0)
+    {
+        return; // bytes sent before spliceTo() go first, handleWrite() comes back
+    }
+    SplicePipe &pipe = *spliceInput_;
+    while (pipe.pending > 0)
+    {
+        ssize_t n = ::splice(pipe.fds[0], NULL, channel_.fd(), NULL, pipe.pending,
+                             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0)
+        {
+            pipe.pending -= n;
+        }
+        else if (errno == EAGAIN)
+        {
+            break;
+        }
+        else
+        {
+            LOG_SYSERR << "TcpConnection::drainSpliceInput [" << name_ << "]";
+            forceClose(); // the source stops sending to us
+            return;
+        }
+    }
+
+    if (pipe.pending > 0)
+    {
+        if (!channel_.isWriting())
+        {
+            channel_.enableWriting();
+        }
+        return;
+    }
+    if (pipe.behind.readableBytes() > 0)
+    {
+        outputBuffer_.swap(pipe.behind); // outputBuffer_ is empty, what comes next goes after it
+        if (!channel_.isWriting())
+        {
+            channel_.enableWriting();
+        }
+    }
+    else if (channel_.isWriting())
+    {
+        channel_.disableWriting();
+    }
+    TcpConnectionPtr source = spliceSource_.lock();
+    if (source)
+    {
+        source->resumeRead();
+    }
+    if (pipe.eof && state_ == kConnected)
+    {
+        setState(kDisconnecting);
+    }
+    if (state_ == kDisconnecting)
+    {
+        shutdownInLoop();
+    }
+}
+
+void TcpConnection::releaseSpliceSource()
+{
+    TcpConnectionPtr source = spliceSource_.lock();
+    if (source)
+    {
+        source->resumeRead(); //不然source停在背压中永远不读，它会丢弃读到的数据直到对端关闭
+    }
+}
+
+void TcpConnection::resumeRead()
+{
+    if (reading_ && readPauses_ == 0 && state_ != kDisconnected && !channel_.isReading())
+    {
+        channel_.enableReading();
+    }
+}
+
+int TcpConnection::linkFlowFrom(const TcpConnectionPtr &source)
+{
+    std::weak_ptr<TcpConnection> weakSource(source);
+    int id = linkFlowFrom([weakSource](bool pause) {
+        TcpConnectionPtr conn = weakSource.lock();
+        if (conn)
+        {
+            conn->getLoop()->runInLoop(
+                std::bind(&TcpConnection::pauseReadInLoop, conn, pause));
+        }
+    });
+    if (id > 0)
+    {
+        //source关闭时来解除，不然长连接的sink会攒下一堆已关闭的source
+        std::weak_ptr<TcpConnection> weakSink(shared_from_this());
+        source->getLoop()->runInLoop(
+            std::bind(&TcpConnection::addFlowSink, source, weakSink, id));
+    }
+    return id;
+}
+
+int TcpConnection::linkFlowFrom(const FlowControlCallback &cb)
+{
+    loop_->assertInLoopThread();
+    if (state_ == kDisconnected)
+    {
+        return 0;
+    }
+    int id = ++nextFlowSourceId_;
+    flowSources_.push_back(FlowSource{id, cb});
+    if (aboveHighWater_)
+    {
+        cb(true);
+    }
+    return id;
+}
+
+void TcpConnection::unlinkFlowFrom(int id)
+{
+    loop_->assertInLoopThread();
+    for (auto it = flowSources_.begin(); it != flowSources_.end(); ++it)
+    {
+        if (it->id == id)
+        {
+            FlowControlCallback cb(std::move(it->cb));
+            flowSources_.erase(it);
+            if (aboveHighWater_)
+            {
+                cb(false); //不然source永远停止读
+            }
+            return;
+        }
+    }
+}
+
+// in the loop of the source, @c id is ours in @c sink
+void TcpConnection::addFlowSink(const std::weak_ptr<TcpConnection> &sink, int id)
+{
+    loop_->assertInLoopThread();
+    if (state_ == kDisconnected)
+    {
+        flowSinks_.push_back(std::make_pair(sink, id));
+        releaseFlowSinks(); //已经关闭了，立即解除
+        return;
+    }
+    flowSinks_.erase(std::remove_if(flowSinks_.begin(), flowSinks_.end(),
+                                    [](const std::pair<std::weak_ptr<TcpConnection>, int> &item)
+                                    { return item.first.expired(); }),
+                     flowSinks_.end()); //关闭了的sink
+    flowSinks_.push_back(std::make_pair(sink, id));
+}
+
+void TcpConnection::releaseFlowSinks()
+{
+    for (const auto &item : flowSinks_)
+    {
+        TcpConnectionPtr sink = item.first.lock();
+        if (sink)
+        {
+            sink->getLoop()->runInLoop(
+                std::bind(&TcpConnection::unlinkFlowFrom, sink, item.second));
+        }
+    }
+    flowSinks_.clear();
+}
+
+// outputBuffer_ grows from oldLen to newLen
+void TcpConnection::checkHighWaterMark(size_t oldLen, size_t newLen)
+{
+    if (newLen >= highWaterMark_ && oldLen < highWaterMark_) //highwatermark肯定要小于oldlen长度
+    {
+        if (callbacks_->highWaterMarkCallback)
+        {
+            loop_->queueInLoop(std::bind(callbacks_->highWaterMarkCallback, shared_from_this(), newLen)); //回调中可能把这个连接断开
+        }
+        if (!aboveHighWater_)
+        {
+            aboveHighWater_ = true;
+            // at once, so that a producer sending in a loop sees it
+            for (size_t i = 0; i < flowSources_.size(); ++i)
+            {
+                flowSources_[i].cb(true);
+            }
+        }
+    }
+}
+
+void TcpConnection::checkLowWaterMark()
+{
+    size_t len = outputBytes();
+    if (aboveHighWater_ && len <= lowWaterMark_)
+    {
+        aboveHighWater_ = false;
+        if (callbacks_->lowWaterMarkCallback)
+        {
+            loop_->queueInLoop(std::bind(callbacks_->lowWaterMarkCallback, shared_from_this(), len));
+        }
+        for (size_t i = 0; i < flowSources_.size(); ++i)
+        {
+            flowSources_[i].cb(false);
+        }
+    }
+}
+
+void TcpConnection::releaseFlowSources()
+{
+    if (aboveHighWater_)
+    {
+        aboveHighWater_ = false;
+        for (size_t i = 0; i < flowSources_.size(); ++i)
+        {
+            flowSources_[i].cb(false); //不然source永远停止读
+        }
+    }
+    flowSources_.clear();
+}
+
+void TcpConnection::pauseReadInLoop(bool pause)
+{
+    loop_->assertInLoopThread();
+    if (pause)
+    {
+        if (readPauses_++ == 0 && channel_.isReading())
+        {
+            channel_.disableReading();
+        }
+    }
+    else if (readPauses_ > 0 && --readPauses_ == 0)
+    {
+        resumeRead();
+    }
+}
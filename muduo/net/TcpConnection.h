@@ -16,9 +16,13 @@
 #include "muduo/base/Types.h"
 #include "muduo/net/Callbacks.h"
 #include "muduo/net/Buffer.h"
+#include "muduo/net/Channel.h"
 #include "muduo/net/InetAddress.h"
+#include "muduo/net/Socket.h"
 
 #include <memory>
+#include <mutex>
+#include <sys/types.h>
 
 #include <boost/any.hpp>
 
@@ -30,9 +34,8 @@ namespace muduo
 namespace net
 {
 
-class Channel;
 class EventLoop;
-class Socket;
+class ShmTransport;
 
 ///
 /// TCP connection, for both client and server usage.
@@ -48,6 +51,27 @@ class TcpConnection : noncopyable,
                       public std::enable_shared_from_this<TcpConnection>
 {
 public:
+    /// Callbacks of a connection. TcpServer shares one set among all its
+    /// connections, a connection copies it when one is set on it alone.
+    struct CallbackSet
+    {
+        ConnectionCallback connectionCallback;
+        MessageCallback messageCallback;
+        WriteCompleteCallback writeCompleteCallback; //数据发送完毕的回调函数，即所以的用户数据都已拷贝到内核缓冲区时
+        //回调该函数，outputbuffer_被清空也会回调该函数，可以理解为低水位标回调函数。        大流量才需要这个回调函数
+        //大流量
+        //不断生成数据，然后用发送conn—>send();
+        //如果对等方接受不及时，受到通告窗口的控制，内核发送缓冲区不足，这个时候，就会将用户数据添加到应用层
+        //发送缓冲区(output buffer);可能会承包output buffer。
+        //解决方法就是，调整发送频率。
+        //关注writecomplecallback。这样当所有用户数据拷贝到内核缓冲区，上层的应用程序得到writecomplete的通知，这个时候我们在发送数据。
+        //可以保证所有的用户数据都发送完，writecomplatecallback回调，然后继续发送
+        HighWaterMarkCallback highWaterMarkCallback; //高水位标回调函数，在这个回调函数中就可以断开连接，避免内存不断增大导致撑爆
+        LowWaterMarkCallback lowWaterMarkCallback;
+        FdsCallback fdsCallback;
+        CloseCallback closeCallback;
+    };
+
     /// Constructs a TcpConnection with a connected sockfd
     ///
     /// User should not create this object.
@@ -56,11 +80,19 @@ public:
                   int sockfd,
                   const InetAddress &localAddr,
                   const InetAddress &peerAddr);
+    /// Constructs a TcpConnection with an accepted sockfd, which has the
+    /// socket options of the listening socket already.
+    /// The local address is looked up on the first localAddress().
+    TcpConnection(EventLoop *loop,
+                  const string &name,
+                  int sockfd,
+                  const InetAddress &peerAddr);
     ~TcpConnection();
 
     EventLoop *getLoop() const { return loop_; }
     const string &name() const { return name_; }
-    const InetAddress &localAddress() const { return localAddr_; }
+    /// Thread safe, for an accepted connection the first call does getsockname(2).
+    const InetAddress &localAddress() const;
     const InetAddress &peerAddress() const { return peerAddr_; }
     bool connected() const { return state_ == kConnected; }
     bool disconnected() const { return state_ == kDisconnected; }
@@ -73,6 +105,35 @@ public:
     void send(const StringPiece &message);
     // void send(Buffer&& message); // C++11
     void send(Buffer *message); // this one will swap data
+    /// Sends an immutable @c block by reference, eg. one message to many
+    /// connections, see Hub. What the socket does not take at once waits
+    /// in the output queue by reference, it is not copied.
+    void send(const std::shared_ptr<const string> &block);
+    /// Sends @c count bytes of @c fd from @c offset with sendfile(2), in
+    /// order with other sends, without copying them to user space.
+    /// @c owner keeps @c fd open until then, eg. an entry of a cache of
+    /// open files. @c owner may be NULL if the caller keeps @c fd open.
+    /// Over shared memory or splice the range is read into the output
+    /// buffer instead.
+    /// Must be called in the loop thread.
+    void sendFile(int fd, off_t offset, size_t count,
+                  const std::shared_ptr<const void> &owner);
+    /// Unix domain sockets only, passes @c fds to the peer (SCM_RIGHTS)
+    /// with the first byte of @c message, in order with other sends.
+    /// The fds are dup()ed, the caller still owns @c fds.
+    /// Not available over shared memory or on the sink of spliceTo().
+    /// Must be called in the loop thread.
+    void sendFds(const StringPiece &message, const std::vector<int> &fds);
+    /// Relays what this connection reads to @c sink with splice(2), through
+    /// a pipe, without copying to user space, the message callback is not
+    /// called any more. Bytes already in inputBuffer() go first.
+    /// Reading pauses while the sink can not take more. When this side
+    /// closes, the sink is shut down once the pipe is drained. When the
+    /// sink closes, this side drops what it reads until its peer closes.
+    /// What is send() to the sink goes after the bytes already spliced.
+    /// Call it on both connections to relay both ways.
+    /// Plain sockets of the same loop only, must be called in the loop thread.
+    void spliceTo(const TcpConnectionPtr &sink);
     void shutdown();            // NOT thread safe, no simultaneous calling
     // void shutdownAndForceCloseAfter(double seconds); // NOT thread safe, no simultaneous calling
     void forceClose();
@@ -82,6 +143,8 @@ public:
     void startRead();
     void stopRead();
     bool isReading() const { return reading_; }; // NOT thread safe, may race with start/stopReadInLoop
+    /// True once data goes through shared memory rings instead of the socket.
+    bool sharedMemory() const { return shm_ != NULL; }
 
     void setContext(const std::any &context) //把一个未知类型赋值
     {
@@ -100,25 +163,54 @@ public:
 
     void setConnectionCallback(const ConnectionCallback &cb)
     {
-        connectionCallback_ = cb;
+        mutableCallbacks()->connectionCallback = cb;
     }
 
     void setMessageCallback(const MessageCallback &cb)
     {
-        messageCallback_ = cb;
+        mutableCallbacks()->messageCallback = cb;
     }
 
     void setWriteCompleteCallback(const WriteCompleteCallback &cb)
     {
-        writeCompleteCallback_ = cb;
+        mutableCallbacks()->writeCompleteCallback = cb;
     }
 
     void setHighWaterMarkCallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
     {
-        highWaterMarkCallback_ = cb;
+        mutableCallbacks()->highWaterMarkCallback = cb;
         highWaterMark_ = highWaterMark;
     }
 
+    /// Called once the output buffer drains to @c lowWaterMark,
+    /// after it has reached the high water mark.
+    void setLowWaterMarkCallback(const LowWaterMarkCallback &cb, size_t lowWaterMark)
+    {
+        mutableCallbacks()->lowWaterMarkCallback = cb;
+        lowWaterMark_ = lowWaterMark;
+    }
+
+    /// Stops reading @c source while the output buffer of this connection
+    /// is above the high water mark, until it drains to the low water mark.
+    /// @c source may belong to another loop, it is unlinked when it closes.
+    /// Returns an id for unlinkFlowFrom(), 0 if this connection is closed.
+    /// Must be called in the loop thread.
+    int linkFlowFrom(const TcpConnectionPtr &source);
+    /// Same for other producers, @c cb is called in the loop thread with true
+    /// to pause, false to resume, and false when this connection closes paused.
+    int linkFlowFrom(const FlowControlCallback &cb);
+    /// Forgets the source linked as @c id, resuming it if paused.
+    /// Must be called in the loop thread.
+    void unlinkFlowFrom(int id);
+
+    /// Receives fds passed by sendFds() of the peer, called before
+    /// the message callback of the bytes they came with.
+    /// Without it, passed fds are closed by the kernel.
+    void setFdsCallback(const FdsCallback &cb)
+    {
+        mutableCallbacks()->fdsCallback = cb;
+    }
+
     /// Advanced interface
     Buffer *inputBuffer()
     {
@@ -133,9 +225,35 @@ public:
     /// Internal use only.
     void setCloseCallback(const CloseCallback &cb)
     {
-        closeCallback_ = cb;
+        mutableCallbacks()->closeCallback = cb;
     }
 
+    /// Internal use only, replaces all callbacks with a shared set.
+    void setCallbacks(const std::shared_ptr<CallbackSet> &callbacks)
+    {
+        callbacks_ = callbacks;
+    }
+
+    /// Internal use only, see TcpServer::setSharedMemoryRingSize().
+    /// Call before connectEstablished(), over a Unix domain socket the
+    /// server end creates the rings and passes them to the client end,
+    /// or tells it that it cannot. The client end answers whether it
+    /// attached them, both ends hold back their output until then.
+    /// A client end with output to send waits kShmOfferTimeout seconds
+    /// at most, then stays on the socket, the server end sees its data
+    /// instead of an answer and does the same.
+    void offerSharedMemory(size_t ringSize)
+    {
+        shmRingSize_ = ringSize;
+    }
+
+    void acceptSharedMemory()
+    {
+        shmPending_ = true;
+    }
+
+    static const double kShmOfferTimeout;
+
     // called when TcpServer accepts a new connection
     void connectEstablished(); // should be called only once
     // called when TcpServer has removed me from its map
@@ -153,12 +271,37 @@ private:
     void handleWrite();
     void handleClose();
     void handleError();
+    void handleShm(Timestamp receiveTime);
+    void offerShm();
+    bool attachShm(std::vector<int> *fds);
+    bool takeShmAnswer();
+    void waitForShmOffer();
+    void endShmPending();
+    void flushShm();
+    void queueShmNotify();
+    void notifyShm();
+    struct SplicePipe;
+    void handleSpliceRead();
+    void drainSpliceInput();
+    void resumeRead();
+    void releaseSpliceSource();
+    void checkHighWaterMark(size_t oldLen, size_t newLen);
+    void checkLowWaterMark();
+    void releaseFlowSources();
+    void addFlowSink(const std::weak_ptr<TcpConnection> &sink, int id);
+    void releaseFlowSinks();
+    void pauseReadInLoop(bool pause);
     // void sendInLoop(string&& message);
     void sendInLoop(const StringPiece &message);
     void sendInLoop(const void *message, size_t len);
+    void sendBlockInLoop(const std::shared_ptr<const string> &block);
+    ssize_t writeBlocks();
+    void flattenBlocks();
+    size_t outputBytes() const { return outputBuffer_.readableBytes() + outputBlockBytes_; }
     void shutdownInLoop();
     // void shutdownAndForceCloseInLoop(double seconds);
     void forceCloseInLoop();
+    CallbackSet *mutableCallbacks();
     void setState(StateE s) { state_ = s; }
     const char *stateToString() const;
     void startReadInLoop();
@@ -167,29 +310,54 @@ private:
     EventLoop *loop_;        //所属eventloop
     const std::string name_; //连接名
     StateE state_;           // FIXME: use atomic variable
-    // we don't expose those classes to client.
-    std::unique_ptr<Socket> socket_;
-    std::unique_ptr<Channel> channel_;
-    const InetAddress localAddr_;
+    Socket socket_;   // inline, no allocation per connection
+    Channel channel_;
+    mutable InetAddress localAddr_; //本地地址，accept来的连接第一次用到时才getsockname
+    mutable std::once_flag localAddrOnce_; //别的线程也可能第一次用到
     const InetAddress peerAddr_;
-    ConnectionCallback connectionCallback_;       //从tcpserver中的setconnect..back来的
-    MessageCallback messageCallback_;             //从tcpserver中的setconnect..back里来的
-    WriteCompleteCallback writeCompleteCallback_; //数据发送完毕的回调函数，即所以的用户数据都已拷贝到内核缓冲区时
-    //回调该函数，outputbuffer_被清空也会回调该函数，可以理解为低水位标回调函数。        大流量才需要这个回调函数
-    //大流量
-    //不断生成数据，然后用发送conn—>send();
-    //如果对等方接受不及时，受到通告窗口的控制，内核发送缓冲区不足，这个时候，就会将用户数据添加到应用层
-    //发送缓冲区(output buffer);可能会承包output buffer。
-    //解决方法就是，调整发送频率。
-    //关注writecomplecallback。这样当所有用户数据拷贝到内核缓冲区，上层的应用程序得到writecomplete的通知，这个时候我们在发送数据。
-    //可以保证所有的用户数据都发送完，writecomplatecallback回调，然后继续发送
-    HighWaterMarkCallback highWaterMarkCallback_; //高水位标回调函数，在这个回调函数中就可以断开连接，避免内存不断增大导致撑爆
-    CloseCallback closeCallback_;
+    std::shared_ptr<CallbackSet> callbacks_; //从tcpserver中的setconnect..back来的，所有连接共用一份
+    // fds waiting in outputBuffer_, with the offset of the byte they go with
+    std::vector<std::pair<size_t, std::vector<int>>> outputFds_; // a deque allocates when empty
     size_t highWaterMark_; //高水位标
+    size_t lowWaterMark_;  //低水位标
+    bool aboveHighWater_;  // since the high water mark, until the low one
+    // internal
+    struct FlowSource
+    {
+        int id;
+        FlowControlCallback cb;
+    };
+    std::vector<FlowSource> flowSources_; // paused while aboveHighWater_
+    int nextFlowSourceId_;
+    // the connections we are a flow source of, with our ids there
+    std::vector<std::pair<std::weak_ptr<TcpConnection>, int>> flowSinks_;
+    int readPauses_;       // by the connections we are a flow source of
     Buffer inputBuffer_;   //应用层的接收缓冲区
     Buffer outputBuffer_;  // FIXME: use list<Buffer> as output buffer.应用层的发送缓冲区，当outputbuffer高到一定程度，回调highwatermarkcallback_函数
+    // a block by reference, or a range of a file for sendfile(2)
+    struct OutputBlock
+    {
+        std::shared_ptr<const string> data;
+        std::shared_ptr<const void> file; // keeps fd open, may be NULL
+        int fd;                           // -1 for a data block
+        off_t offset; // unsent range of the file
+        size_t size;
+    };
+    std::vector<OutputBlock> outputBlocks_; // after outputBuffer_, by reference
+    size_t outputBlockOffset_; // sent bytes of the first data block
+    size_t outputBlockBytes_;  // unsent bytes of all blocks
     std::any context_;     //提供一个接口绑定一个未知类型的上下文对象，我们不清楚上层的网络程序会绑定一个什么对象，提供这样的接口，帮助应用程序
     bool reading_;
+    std::unique_ptr<ShmTransport> shm_; // data path once shared memory is set up
+    size_t shmRingSize_;                // > 0 if we offer shared memory
+    bool shmPending_;                   // waiting for the offer, or the answer, of the peer
+    bool shmLate_;                      // gave up waiting, an offer may still head the input
+    std::unique_ptr<ShmTransport> shmOffered_; // the server end, until the peer answers
+    bool shmNotifyQueued_;              // writes of this loop iteration share a wakeup
+    bool splicing_;                              // reads go to spliceSink_
+    std::weak_ptr<TcpConnection> spliceSink_;
+    std::weak_ptr<TcpConnection> spliceSource_;  // whose reads come through spliceInput_
+    std::unique_ptr<SplicePipe> spliceInput_;
     //可变类型的解决方案有两种
     //void* 这种方法不是类型安全的
     //boost::any,好处是可以将任意类型安全存取
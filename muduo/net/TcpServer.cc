@@ -9,16 +9,108 @@
 #include "muduo/net/TcpServer.h"
 
 #include "muduo/base/Logging.h"
+#include "muduo/base/Mutex.h"
 #include "muduo/net/Acceptor.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThreadPool.h"
 #include "muduo/net/SocketsOps.h"
 
-#include <stdio.h>  // snprintf
+#include <vector>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+const size_t kMaxPooledConnections = 1024; // per io loop
+}
+
+/// Memory of closed connections of one io loop, reused by the new ones.
+/// A block holds a TcpConnection with its shared_ptr control block, see
+/// std::allocate_shared().  Blocks are taken in the acceptor loop and
+/// given back in the io loop, or wherever the last TcpConnectionPtr goes.
+class TcpServer::ConnectionPool : noncopyable
+{
+ public:
+  template <typename T>
+  struct Allocator
+  {
+    typedef T value_type;
+
+    explicit Allocator(const ConnectionPoolPtr& poolArg)
+      : pool(poolArg)
+    {
+    }
+
+    template <typename U>
+    Allocator(const Allocator<U>& other)
+      : pool(other.pool)
+    {
+    }
+
+    T* allocate(size_t n) { return static_cast<T*>(pool->allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { pool->deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const Allocator<U>& rhs) const { return pool == rhs.pool; }
+    template <typename U>
+    bool operator!=(const Allocator<U>& rhs) const { return pool != rhs.pool; }
+
+    ConnectionPoolPtr pool; // a block keeps its pool
+  };
+
+  explicit ConnectionPool(size_t maxBlocks)
+    : maxBlocks_(maxBlocks),
+      blockSize_(0)
+  {
+  }
+
+  ~ConnectionPool()
+  {
+    for (void* block : blocks_)
+    {
+      ::operator delete(block);
+    }
+  }
+
+  void* allocate(size_t size)
+  {
+    {
+      MutexLockGuard lock(mutex_);
+      if (size == blockSize_ && !blocks_.empty())
+      {
+        void* block = blocks_.back();
+        blocks_.pop_back();
+        return block;
+      }
+    }
+    return ::operator new(size);
+  }
+
+  void deallocate(void* block, size_t size)
+  {
+    {
+      MutexLockGuard lock(mutex_);
+      if (blockSize_ == 0)
+      {
+        blockSize_ = size;
+      }
+      if (size == blockSize_ && blocks_.size() < maxBlocks_)
+      {
+        blocks_.push_back(block);
+        return;
+      }
+    }
+    ::operator delete(block);
+  }
+
+ private:
+  const size_t maxBlocks_;
+  MutexLock mutex_;
+  size_t blockSize_;          // GUARDED_BY(mutex_)
+  std::vector<void*> blocks_; // GUARDED_BY(mutex_)
+};
+
 TcpServer::TcpServer(EventLoop* loop,
                      const InetAddress& listenAddr,
                      const string& nameArg,
@@ -26,10 +118,12 @@ TcpServer::TcpServer(EventLoop* loop,
   : loop_(CHECK_NOTNULL(loop)),
     ipPort_(listenAddr.toIpPort()),
     name_(nameArg),
+    connNamePrefix_(name_ + ":" + ipPort_ + "#"),
     acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
     threadPool_(new EventLoopThreadPool(loop, name_)),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
+    shmRingSize_(0),
     nextConnId_(1)
 {
     //accepter::handleread函数中会调用tcpserver::newconnection
@@ -78,29 +172,37 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
     loop_->assertInLoopThread(); //断言在io线程
     //按照轮叫的方式选择一个eventloop，将这个新的连接交付给这个EventLoop
     EventLoop *ioLoop = threadPool_->getNextLoop(); //选出来了那个io线程
-    char buf[32];                                   //缓冲区
-    snprintf(buf, sizeof buf, ":%s#%d", hostport_.c_str(), nextConnId_);
+    string connName = connNamePrefix_ + std::to_string(nextConnId_); //表示当前连接的名称
     ++nextConnId_;
-    string connName = name_ + buf; //表示当前连接的名称
 
-    LOG_INFO << "TcpServer::newConnection [" << name_
-             << "] - new connection [" << connName
-             << "] from " << peerAddr.toIpPort();
-    InetAddress localAddr(sockets::getLocalAddr(sockfd));
+    LOG_DEBUG << "TcpServer::newConnection [" << name_
+              << "] - new connection [" << connName
+              << "] from " << peerAddr.toIpPort();
     // FIXME poll with zero timeout to double confirm the new connection
-    // FIXME use make_shared if necessary
-    //创建了一个Tcpconnection对象
-    TcpConnectionPtr conn(new TcpConnection(ioLoop, //所属的loop
-                                            connName,
-                                            sockfd,
-                                            localAddr,
-                                            peerAddr));
+    ConnectionPoolPtr& pool = connectionPools_[ioLoop];
+    if (!pool)
+    {
+        pool = std::make_shared<ConnectionPool>(kMaxPooledConnections);
+    }
+    //创建了一个Tcpconnection对象，用的是ioLoop上回收的内存，本地地址用到时才取
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(
+        ConnectionPool::Allocator<TcpConnection>(pool),
+        ioLoop, //所属的loop
+        connName,
+        sockfd,
+        peerAddr);
     connections_[connName] = conn;
-    conn->setConnectionCallback(connectionCallback_); //设置回调函数
-    conn->setMessageCallback(messageCallback_);
-    conn->setWriteCompleteCallback(writeCompleteCallback_);
-    conn->setCloseCallback(
-        std::bind(&TcpServer::removeConnection, this, std::placeholders::_1)); // FIXME: unsafe
+    if (!connectionCallbacks_) //所有连接共用一份回调函数，setXXXCallback后重新生成
+    {
+        connectionCallbacks_ = std::make_shared<TcpConnection::CallbackSet>();
+        connectionCallbacks_->connectionCallback = connectionCallback_;
+        connectionCallbacks_->messageCallback = messageCallback_;
+        connectionCallbacks_->writeCompleteCallback = writeCompleteCallback_;
+        connectionCallbacks_->closeCallback =
+            std::bind(&TcpServer::removeConnection, this, std::placeholders::_1); // FIXME: unsafe
+    }
+    conn->setCallbacks(connectionCallbacks_); //设置回调函数
+    conn->offerSharedMemory(shmRingSize_);
     ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));    //转到ioloop所属的线程调用他进行连接
 }
 
@@ -114,8 +216,8 @@ void TcpServer::removeConnection(const TcpConnectionPtr& conn)
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
 {
   loop_->assertInLoopThread();
-  LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
-           << "] - connection " << conn->name();
+  LOG_DEBUG << "TcpServer::removeConnectionInLoop [" << name_
+            << "] - connection " << conn->name();
   size_t n = connections_.erase(conn->name());
   (void)n;
   assert(n == 1);
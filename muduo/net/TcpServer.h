@@ -66,6 +66,15 @@ class TcpServer : noncopyable
     {
         threadInitCallback_ = cb;
     }
+    /// Connections of a Unix domain socket server carry data through two
+    /// rings of @c bytes each in shared memory, the socket only tells
+    /// when the peer is gone. Clients must TcpClient::enableSharedMemory().
+    /// 0 means off, this is the default value.
+    /// Must be called before @c start
+    void setSharedMemoryRingSize(size_t bytes)
+    {
+        shmRingSize_ = bytes;
+    }
     /// valid after calling start()
     std::shared_ptr<EventLoopThreadPool> threadPool()
     {
@@ -86,6 +95,7 @@ class TcpServer : noncopyable
     void setConnectionCallback(const ConnectionCallback &cb)
     {
         connectionCallback_ = cb;
+        connectionCallbacks_.reset();
     }
 
    /// Set message callback.
@@ -94,6 +104,7 @@ class TcpServer : noncopyable
     void setMessageCallback(const MessageCallback &cb)
     {
         messageCallback_ = cb;
+        connectionCallbacks_.reset();
     }
 
     /// Set write complete callback.
@@ -101,6 +112,7 @@ class TcpServer : noncopyable
     void setWriteCompleteCallback(const WriteCompleteCallback &cb)
     {
         writeCompleteCallback_ = cb;
+        connectionCallbacks_.reset();
     }
     /***************************************************************/
 private:
@@ -112,20 +124,27 @@ private:
     void removeConnectionInLoop(const TcpConnectionPtr &conn);
 
     typedef std::map<string, TcpConnectionPtr> ConnectionMap; //连接列表是一个map容器key是链接名称，value保存的变量就是TcpConnection的指针
+    class ConnectionPool;
+    typedef std::shared_ptr<ConnectionPool> ConnectionPoolPtr;
 
     EventLoop *loop_;                    // the acceptor loop
-    const string hostport_;              //服务端口
+    const string ipPort_;                //服务端口
     const string name_;                  //服务名
+    const string connNamePrefix_;        // name_:ipPort_#, followed by the id
     std::unique_ptr<Acceptor> acceptor_; // avoid revealing Acceptor，Acceptor负责了一个socketfd,这个socketfd就是一个监听套接字。类是属于内部类
     std::shared_ptr<EventLoopThreadPool> threadPool_;
     ConnectionCallback connectionCallback_;
     MessageCallback messageCallback_;
     WriteCompleteCallback writeCompleteCallback_; //数据发送完毕，会调用此函数，tcpconnection中的回调函数在这里调用
     ThreadInitCallback threadInitCallback_;       //io线程池中的线程在进入事件循环前，会调用此函数
+    // shared by the new connections, built again after the callbacks change
+    std::shared_ptr<TcpConnection::CallbackSet> connectionCallbacks_;
+    size_t shmRingSize_;                          //共享内存环形缓冲区的大小，0表示不使用
     AtomicInt32 started_;                         //是否启动
     // always in loop thread
     int nextConnId_;            //下一个链接id
     ConnectionMap connections_; //连接列表,保留着在这个服务器上的所有连接
+    std::map<EventLoop *, ConnectionPoolPtr> connectionPools_; //每个io loop回收的连接内存
 };
 
 
@@ -8,6 +8,8 @@
 
 #include "muduo/net/Timer.h"
 
+#include <assert.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -17,10 +19,31 @@ void Timer::restart(Timestamp now) //重启
 {
     if (repeat_)
     {                                          //重新计算下一个超时时刻
-        expiration_ = addTime(now, interval_); //是一个全局函数
+        set_expiration(addTime(now, interval_)); //是一个全局函数
     }
     else
     {
         expiration_ = Timestamp::invalid();
+        deadline_ = Timestamp::invalid();
     }
 }
+
+void Timer::reuse(TimerCallback cb, Timestamp when, double interval, double slack)
+{
+    assert(sequence() == 0);
+    callback_ = std::move(cb);
+    interval_ = interval;
+    slack_ = slack;
+    set_expiration(when);
+    repeat_ = interval > 0.0;
+    sequence_.store(s_numCreated_.incrementAndGet(), std::memory_order_relaxed);
+    index_ = -1;
+    bucket_ = -1;
+}
+
+void Timer::release()
+{
+    assert(index_ == -1);
+    callback_ = TimerCallback(); //释放回调中绑定的对象
+    sequence_.store(0, std::memory_order_relaxed);
+}
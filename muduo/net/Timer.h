@@ -15,6 +15,8 @@
 #include "muduo/base/Timestamp.h"
 #include "muduo/net/Callbacks.h"
 
+#include <atomic>
+
 namespace muduo
 {
 namespace net
@@ -26,12 +28,17 @@ namespace net
 class Timer : noncopyable //对定时操作的高层次抽象
 {
 public:
-    Timer(TimerCallback cb, Timestamp when, double interval)
+    Timer(TimerCallback cb, Timestamp when, double interval, double slack)
         : callback_(std::move(cb)),
           expiration_(when),
           interval_(interval), //构造函数
+          slack_(slack),
+          deadline_(addTime(when, slack)),
           repeat_(interval > 0.0),
-          sequence_(s_numCreated_.incrementAndGet()) //先加后获取，原子操作，如果有多个计时器同时生成，也不会出问题
+          cancelled_(false),
+          sequence_(s_numCreated_.incrementAndGet()), //先加后获取，原子操作，如果有多个计时器同时生成，也不会出问题
+          index_(-1),
+          bucket_(-1)
     {
     }
 
@@ -40,20 +47,58 @@ public:
         callback_();
     }
 
+    /// Earliest time to run, the timer may run till deadline().
     Timestamp expiration() const { return expiration_; }
+    /// expiration() + slack, timers are queued by deadline so that
+    /// the ones whose windows overlap share one wakeup.
+    Timestamp deadline() const { return deadline_; }
     bool repeat() const { return repeat_; }
-    int64_t sequence() const { return sequence_; }
+    int64_t sequence() const { return sequence_.load(std::memory_order_relaxed); }
 
     void restart(Timestamp now);
+    void set_expiration(Timestamp when)
+    {
+        expiration_ = when;
+        deadline_ = addTime(when, slack_);
+        cancelled_ = false; //重新排期就是又要它了
+    }
+    /// Stops repeating, a running timer is recycled instead of restarted,
+    /// one due later in the same batch of expired timers does not run.
+    void cancel()
+    {
+        repeat_ = false;
+        cancelled_ = true;
+    }
+    bool cancelled() const { return cancelled_; }
+
+    // for TimerQueue pool, a recycled Timer gets a new sequence,
+    // so stale TimerIds no longer match it.
+    void reuse(TimerCallback cb, Timestamp when, double interval, double slack);
+    void release();
+
+    // for TimerQueue implementations, like Channel::index() for Poller
+    // index() is -1 if not queued
+    int index() const { return index_; }
+    void set_index(int idx) { index_ = idx; }
+    int bucket() const { return bucket_; }
+    void set_bucket(int bucket) { bucket_ = bucket; }
 
     static int64_t numCreated() { return s_numCreated_.get(); }
 
 private:
-    const TimerCallback callback_; //定时器回调函数
+    TimerCallback callback_;       //定时器回调函数
     Timestamp expiration_;         //下一次超时时刻
-    const double interval_;        //超时时间间隔，如果为一次行定时器，该值为0
-    const bool repeat_;            //时候重复
-    const int64_t sequence_;       //定时器序号
+    double interval_;              //超时时间间隔，如果为一次行定时器，该值为0
+    double slack_;                 //允许推迟的时间，单位秒
+    Timestamp deadline_;           //最晚的超时时刻
+    bool repeat_;                  //时候重复
+    bool cancelled_;               //到期后在回调前被取消了
+    // generation of this Timer object, 0 if it is in the free list.
+    // atomic since TimerIds are checked in loop thread while
+    // other threads may take it from the pool.
+    std::atomic<int64_t> sequence_; //定时器序号
+    int index_;                    //在TimerQueue容器中的位置
+    int bucket_;                   //时间轮中的槽位
 
     static AtomicInt64 s_numCreated_; //定时器计数，当前已经创建的定时器数量
 };
@@ -12,11 +12,15 @@
 
 #include "muduo/net/TimerQueue.h"
 
+#include "muduo/base/Clock.h"
 #include "muduo/base/Logging.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/Timer.h"
 #include "muduo/net/TimerId.h"
 
+#include <algorithm>
+
+#include <stdlib.h>
 #include <sys/timerfd.h>
 #include <unistd.h>
 
@@ -29,6 +33,10 @@ namespace detail
 
 int createTimerfd()
 {
+    if (::getenv("MUDUO_NO_TIMERFD"))
+    {
+        return -1; // timers are driven by poll timeout
+    }
   int timerfd = ::timerfd_create(CLOCK_MONOTONIC,
                                  TFD_NONBLOCK | TFD_CLOEXEC);
   if (timerfd < 0)
@@ -38,19 +46,14 @@ int createTimerfd()
   return timerfd;
 }
 
-//计算超时时刻和当前时间的时间差
-struct timespec howMuchTimeFromNow(Timestamp when) //将when转换成timespec
+//Timestamp是单调时钟，和timerfd的CLOCK_MONOTONIC一致，直接设置绝对时间，不用再读一次当前时间
+struct timespec toTimespec(Timestamp when) //将when转换成timespec
 {
-    int64_t microseconds = when.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
-    if (microseconds < 100) //精确最小到100，小于100当做100
-    {
-        microseconds = 100;
-    }
     struct timespec ts;
     ts.tv_sec = static_cast<time_t>( //秒
-                                     microseconds / Timestamp::kMicroSecondsPerSecond);
+                                     when.microSecondsSinceEpoch() / Timestamp::kMicroSecondsPerSecond);
     ts.tv_nsec = static_cast<long>( //纳秒
-                                    (microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+                                    (when.microSecondsSinceEpoch() % Timestamp::kMicroSecondsPerSecond) * 1000);
     return ts;
 }
 //清除定时器，避免一直触发
@@ -72,8 +75,8 @@ void resetTimerfd(int timerfd, Timestamp expiration)
     struct itimerspec oldValue;
     bzero(&newValue, sizeof newValue);
     bzero(&oldValue, sizeof oldValue);
-    newValue.it_value = howMuchTimeFromNow(expiration);
-    int ret = ::timerfd_settime(timerfd, 0, &newValue, &oldValue);
+    newValue.it_value = toTimespec(expiration); //已经过去的时刻会立即触发
+    int ret = ::timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &newValue, &oldValue);
     if (ret)
     {
         LOG_SYSERR << "timerfd_settime()";
@@ -82,45 +85,48 @@ void resetTimerfd(int timerfd, Timestamp expiration)
 
 } // namespace detail
 } // namespace net
-} // namespace sserver
+} // namespace muduo
 
-using namespace sserver;
-using namespace sserver::net;
-using namespace sserver::net::detail;
+using namespace muduo;
+using namespace muduo::net;
+using namespace muduo::net::detail;
 
 TimerQueue::TimerQueue(EventLoop *loop)
     : loop_(loop),
     timerfd_(createTimerfd()),
-    timerfdChannel_(loop, timerfd_),
-    timers_(),
-    callingExpiredTimers_(false)
+    timerfdChannel_(loop, timerfd_)
 {
-    timerfdChannel_.setReadCallback( //当定时器通道可读时间产生的时候，会回调handleread成员函数
-                                     std::bind(&TimerQueue::handleRead, this));
-    // we are always reading the timerfd, we disarm it with timerfd_settime.
-    timerfdChannel_.enableReading(); //这个通道会加到poller来关注，一旦这个通道的可读时间产生就会回调
+    if (usesTimerfd())
+    {
+        timerfdChannel_.setReadCallback( //当定时器通道可读时间产生的时候，会回调handleread成员函数
+                                         std::bind(&TimerQueue::handleRead, this));
+        // we are always reading the timerfd, we disarm it with timerfd_settime.
+        timerfdChannel_.enableReading(); //这个通道会加到poller来关注，一旦这个通道的可读时间产生就会回调
+    }
 }
 
 TimerQueue::~TimerQueue()
 {
-    timerfdChannel_.disableAll();
-    timerfdChannel_.remove();
-    ::close(timerfd_);
-    // do not remove channel, since we're in EventLoop::dtor();
-    for (const Entry &timer : timers_)
+    if (usesTimerfd())
     {
-        delete timer.second;
+        timerfdChannel_.disableAll();
+        timerfdChannel_.remove();
+        ::close(timerfd_);
     }
+    // do not remove channel, since we're in EventLoop::dtor();
+    // queued and free Timers are all deleted with timers_
 }
 
 TimerId TimerQueue::addTimer(TimerCallback cb, //cb定时器的回调函数，可以跨线程调用
                              Timestamp when,   //超时时间
-                             double interval)  //间隔时间
+                             double interval,  //间隔时间
+                             double slack)     //允许推迟的时间
 {
-    Timer *timer = new Timer(std::move(cb), when, interval); //interval如果不为0，说明他是一个重复的定时任务，每过interval就在执行一次，会调cb
-    loop_->runInLoop(                                        //跨线程调用实现函数
-                                                             std::bind(&TimerQueue::addTimerInLoop, this, timer));
-    return TimerId(timer, timer->sequence());
+    Timer *timer = newTimer(std::move(cb), when, interval, slack); //interval如果不为0，说明他是一个重复的定时任务，每过interval就在执行一次，会调cb
+    int64_t sequence = timer->sequence(); //addTimerInLoop之后timer可能已经被回收
+    loop_->runInLoop(                     //跨线程调用实现函数
+                     std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return TimerId(timer, sequence);
 }
 
 void TimerQueue::cancel(TimerId timerId)
@@ -129,150 +135,212 @@ void TimerQueue::cancel(TimerId timerId)
                      std::bind(&TimerQueue::cancelInLoop, this, timerId));
 }
 
+void TimerQueue::restart(TimerId timerId, Timestamp when)
+{
+    loop_->runInLoop(
+                     std::bind(&TimerQueue::restartInLoop, this, timerId, when));
+}
+
+void TimerQueue::reschedule(Timer *timer, Timestamp when)
+{
+    remove(timer);
+    timer->set_expiration(when);
+    insert(timer);
+}
+
 void TimerQueue::addTimerInLoop(Timer *timer) //不会跨线程调用，不需要对临界资源进行保护
 {
     loop_->assertInLoopThread();
+    if (timer->index() >= 0)
+    {
+        // already queued by restart() before this functor ran
+        return;
+    }
     //插入一个定时器，有可能会使最早到期的定时器发生改变
     bool earliestChanged = insert(timer); //插入一个定时器可能会比原有的定时器还早，这样earliestchanged会为true
 
     if (earliestChanged) //true
     {
         //重置定时器的超时时刻(timerfd_settime)
-        resetTimerfd(timerfd_, timer->expiration()); //定时器fd和定时时间
+        resetTimer(nextExpiration()); //定时器fd和定时时间
+    }
+}
+
+Timer *TimerQueue::findTimer(TimerId timerId) const
+{
+    //Timer对象不会被delete，只要序号(代数)一致就是同一个定时器
+    Timer *timer = timerId.timer_;
+    if (timer && timerId.sequence_ != 0 && timer->sequence() == timerId.sequence_)
+    {
+        return timer;
     }
+    return NULL; //已经到期或者取消，已被回收
 }
 
 void TimerQueue::cancelInLoop(TimerId timerId) //不会跨线程调用，不需要对临界资源进行保护
 {
     loop_->assertInLoopThread(); //断言在该线程中
-    assert(timers_.size() == activeTimers_.size());
-    ActiveTimer timer(timerId.timer_, timerId.sequence_);
     //查找该定时器
-    ActiveTimerSet::iterator it = activeTimers_.find(timer);
-    if (it != activeTimers_.end())
+    Timer *timer = findTimer(timerId);
+    if (!timer)
+    {
+        return;
+    }
+    if (timer->index() >= 0)
     {
-        size_t n = timers_.erase(Entry(it->first->expiration(), it->first));
-        assert(n == 1);
-        (void)n;
-        delete it->first; // FIXME: no delete please，如果用可unique_ptr就不需要手动删除了
-        activeTimers_.erase(it);
+        remove(timer);
+        releaseTimer(timer);
     }
-    else if (callingExpiredTimers_) //如果不在列表中
+    else
     {
-        //已经到期，并且正在调用回调函数的定时器
-        cancelingTimers_.insert(timer); //插入到cancelingTimers，因为有的定时器多次执行，加入到cancelingTimers_中会使虽然过期的他也能被取消
+        //已经到期的定时器，不再重复，还没轮到的也不再运行，reset()会回收它
+        timer->cancel();
+    }
+}
+
+void TimerQueue::restartInLoop(TimerId timerId, Timestamp when)
+{
+    loop_->assertInLoopThread();
+    Timer *timer = findTimer(timerId);
+    if (!timer)
+    {
+        return;
+    }
+    Timestamp earliest = nextExpiration();
+    if (timer->index() >= 0)
+    {
+        reschedule(timer, when); //原地移动，不用重新分配
+    }
+    else
+    {
+        //正在回调中重启自己，reset()看到它已在队列中就不再处理
+        timer->set_expiration(when);
+        insert(timer);
+    }
+    if (!earliest.valid() || nextExpiration() < earliest)
+    {
+        resetTimer(nextExpiration());
     }
-    assert(timers_.size() == activeTimers_.size());
 }
 
 void TimerQueue::handleRead() //实际上只关注最早的定时器
 {
     loop_->assertInLoopThread();
-    Timestamp now(Timestamp::now());
+    Timestamp now(Clock::monotonic());
     readTimerfd(timerfd_, now); //清除该事件，避免一直触发
+    runExpired(now);
+}
 
-    //获取该时刻之前所有的定时器列表(即超时定时器列表)
-    std::vector<Entry> expired = getExpired(now); //这个时刻可能好几个定时器超时了，都得处理
-
-    callingExpiredTimers_ = true; //处于处理到期定时器时间
-    cancelingTimers_.clear();
-    // safe to callback outside critical section
+int64_t TimerQueue::pollTimeout(int64_t maxTimeoutUs) const
+{
+    loop_->assertInLoopThread();
+    Timestamp nextExpire = nextExpiration();
+    if (usesTimerfd() || !nextExpire.valid())
+    {
+        return maxTimeoutUs;
+    }
+    int64_t timeoutUs = nextExpire.microSecondsSinceEpoch() - Clock::monotonic().microSecondsSinceEpoch();
+    return std::max<int64_t>(0, std::min(timeoutUs, maxTimeoutUs));
+}
 
-    for (const Entry &it : expired)
+void TimerQueue::handleExpired()
+{
+    loop_->assertInLoopThread();
+    Timestamp nextExpire = nextExpiration();
+    if (usesTimerfd() || !nextExpire.valid())
     {
-        //这里的回调定时器处理函数
-        it.second->run();
+        return;
+    }
+    Timestamp now(Clock::monotonic());
+    if (!(now < nextExpire))
+    {
+        runExpired(now);
     }
-    callingExpiredTimers_ = false;
-    //不是一次性定时器，需要重启
-    reset(expired, now);
 }
-//这里不需要拷贝构造，构造器会进行rvo优化
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
+
+void TimerQueue::runExpired(Timestamp now)
 {
-    assert(timers_.size() == activeTimers_.size());
-    std::vector<Entry> expired;
-    Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
-    //返回第一个未到期的Timer的迭代器,二分
-    TimerList::iterator end = timers_.lower_bound(sentry);
-    assert(end == timers_.end() || now < end->first); //断言找到了
-    //将到期的定时器插入expired中
-    std::copy(timers_.begin(), end, back_inserter(expired));
-    //从timers_中移除到期的定时器
-    timers_.erase(timers_.begin(), end);
-
-    //从activeTimers_中移除到期的定时器
-    for (const Entry &it : expired)
+    //获取该时刻之前所有的定时器列表(即超时定时器列表)
+    expired_.clear();
+    getExpired(now, &expired_); //这个时刻可能好几个定时器超时了，都得处理
+    expiredSequences_.clear();
+    for (Timer *timer : expired_)
     {
-        ActiveTimer timer(it.second, it.second->sequence());
-        size_t n = activeTimers_.erase(timer);
-        assert(n == 1);
-        (void)n;
+        expiredSequences_.push_back(ActiveTimer(timer, timer->sequence()));
     }
 
-    assert(timers_.size() == activeTimers_.size());
-    return expired; //到期的定时器被返回
+    // safe to callback outside critical section
+    for (const ActiveTimer &it : expiredSequences_)
+    {
+        //同一批里先到的回调可能取消或重启了后面的，已到期的定时器只是标记为取消
+        Timer *timer = it.first;
+        if (timer->sequence() == it.second && !timer->cancelled() && timer->index() < 0)
+        {
+            timer->run(); //这里的回调定时器处理函数
+        }
+    }
+    //不是一次性定时器，需要重启
+    reset(now);
 }
 
-void TimerQueue::reset(const std::vector<Entry> &expired, Timestamp now)
+void TimerQueue::reset(Timestamp now)
 { //执行重复执行定时器的函数
-    Timestamp nextExpire;
-
-    for (const Entry &it : expired)
+    for (const ActiveTimer &it : expiredSequences_)
     {
-        ActiveTimer timer(it.second, it.second->sequence());
+        Timer *timer = it.first;
+        if (timer->sequence() != it.second || timer->index() >= 0)
+        {
+            // recycled by cancel(), or restarted in callback
+            continue;
+        }
         //如果是重复的定时器，并且是未取消的定时器，则重启该定时器
-        if (it.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end())
+        if (timer->repeat())
         { //如果没有被取消，而且是重复的定时器，就重启
-            it.second->restart(now);
-            insert(it.second);
+            timer->restart(now);
+            insert(timer);
         }
         else
         {
-            // 一次性定时器或者已被取消的定时器是不能重置，因此删除该定时器
-            // FIXME move to a free list
-            delete it.second; // FIXME: no delete please
+            // 一次性定时器或者已被取消的定时器是不能重置，因此放回空闲列表
+            releaseTimer(timer);
         }
     }
     //获取最早到期的定时器超时时间
-    if (!timers_.empty())
-    {
-        nextExpire = timers_.begin()->second->expiration();
-    }
+    Timestamp nextExpire = nextExpiration();
 
     if (nextExpire.valid())
     {
-        resetTimerfd(timerfd_, nextExpire);
+        resetTimer(nextExpire);
     }
 }
 
-bool TimerQueue::insert(Timer *timer)
+Timer *TimerQueue::newTimer(TimerCallback cb, Timestamp when, double interval, double slack)
 {
-    loop_->assertInLoopThread();
-    assert(timers_.size() == activeTimers_.size()); //之前说过timers_和activeTimers_存的东西是一样的
-    //最早到器的时间是否改变
-    bool earliestChanged = false;
-    Timestamp when = timer->expiration();     //timer的到期时间取出来
-    TimerList::iterator it = timers_.begin(); //第一个定时器，也就是时间最早的定时器
-
-    //如果timers_为空或者when小于timers_中的最早到期时间
-    if (it == timers_.end() || when < it->first)
-    {
-        earliestChanged = true; //需要更新变量
-    }
+    MutexLockGuard lock(mutex_);
+    if (freeTimers_.empty())
     {
-        //插入到timers_中，按到期时间排序
-        std::pair<TimerList::iterator, bool> result = timers_.insert(Entry(when, timer));
-        assert(result.second);
-        (void)result;
+        timers_.emplace_back(new Timer(std::move(cb), when, interval, slack));
+        return timers_.back().get();
     }
+    Timer *timer = freeTimers_.back();
+    freeTimers_.pop_back();
+    timer->reuse(std::move(cb), when, interval, slack);
+    return timer;
+}
+
+void TimerQueue::releaseTimer(Timer *timer)
+{
+    loop_->assertInLoopThread();
+    timer->release(); //清空回调，序号置0，旧的TimerId从此失效
+    MutexLockGuard lock(mutex_);
+    freeTimers_.push_back(timer);
+}
+
+void TimerQueue::resetTimer(Timestamp expiration)
+{
+    if (usesTimerfd())
     {
-        //插入到activeTimers_中，按定时器对象地址大小排序
-        std::pair<ActiveTimerSet::iterator, bool> result = activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
-        assert(result.second);
-        (void)result;
+        resetTimerfd(timerfd_, expiration);
     }
-
-    assert(timers_.size() == activeTimers_.size());
-    return earliestChanged; //最早到期时间是否改变
+    //否则EventLoop::loop()下一次poll会按最早的到期时间计算超时
 }
@@ -11,44 +11,51 @@
 #ifndef MUDUO_NET_TIMERQUEUE_H
 #define MUDUO_NET_TIMERQUEUE_H
 
-#include <set>
+#include <memory>
 #include <vector>
 
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/net/Callbacks.h"
 #include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TimerId.h"
 
 namespace muduo
 {
 namespace net
 {
 
-class EventLoop;
 class Timer;
-class TimerId;
 
 ///
 /// A best efforts timer queue.
 /// No guarantee that the callback will be on time.
 ///
+/// Base class of timer containers, like Poller for IO multiplexing.
+/// It owns the timerfd and runs expired timers, the derived classes
+/// only decide how queued timers are organized.
+/// All Timestamps here are of Clock::monotonic().
+///
 class TimerQueue : noncopyable//相当于一个定时器的管理类， 内部维护了一个列表，定时器列表，实际上他只关注最早的定时器
 {
    //timerqueue数据结构的选择，能快速的根据当前时间找到已到期的定时器，也要高效的添加和删除timer
-  //因为可以使用二插搜索树，用map或者set
+   //默认用set(二叉搜索树)，大量粗粒度超时（如空闲连接）可以用时间轮
 public:
   explicit TimerQueue(EventLoop *loop); //一个TimerQueue属于一个eventloop对象，而eventloop对象在一个io线程中创建的
-  ~TimerQueue();
+  virtual ~TimerQueue();
 
   ///
   /// Schedules the callback to be run at given time,
   /// repeats if @c interval > 0.0.
+  /// It may be run up to @c slack seconds later, together with other timers.
   ///
   /// Must be thread safe. Usually be called from other threads.
   /// 一定是线程安全的，可以跨线程调用。通常情况下被其他线程跨线程调用
   TimerId addTimer(TimerCallback cb, //添加一个定时器，返回一个外部类Timeid，供外部使用
                    Timestamp when,   //外部可以调用取消一个定时器
-                   double interval);
+                   double interval,
+                   double slack);
   //在实际使用时，不会直接调用addtimer而是会调用eventloop中的
   //runat 在某个时刻运行定时器
   //runafter 过一段时间运行定时器
@@ -56,39 +63,87 @@ public:
   //cancel 取消定时器
   void cancel(TimerId timerId); //取消一个定时器
 
+  ///
+  /// Moves the timer to @c when in place, cheaper than cancel() and addTimer().
+  /// A repeating timer keeps its interval after it fires.
+  ///
+  /// Must be thread safe. Usually be called from other threads.
+  void restart(TimerId timerId, Timestamp when);
+
+  ///
+  /// Without timerfd (MUDUO_NO_TIMERFD is set), EventLoop::loop() polls with
+  /// pollTimeout() and calls handleExpired() after poll returns,
+  /// saving timerfd_settime() and the read of timerfd for every expiration.
+  ///
+  bool usesTimerfd() const { return timerfd_ >= 0; }
+
+  /// Microseconds till the earliest expiration, at most @c maxTimeoutUs.
+  int64_t pollTimeout(int64_t maxTimeoutUs) const;
+
+  /// Runs expired timers if not using timerfd.
+  void handleExpired();
+
+  /// Creates the timer queue of @c type,
+  /// EventLoop::kDefaultTimerQueue is chosen by environment variables,
+  /// see EventLoop::TimerQueueType.
+  /// @c tick is the granularity of kWheelTimerQueue in seconds.
+  static TimerQueue *newTimerQueue(EventLoop *loop,
+                                   EventLoop::TimerQueueType type,
+                                   double tick);
+
+protected:
+  typedef std::vector<Timer *> TimerList;
+
+  //以下虚函数只在所属的i/o线程中调用
+
+  /// Queues @c timer by its deadline() and sets its index(),
+  /// returns true if the earliest expiration changed.
+  virtual bool insert(Timer *timer) = 0;
+
+  /// Unlinks a queued timer and sets its index() to -1.
+  virtual void remove(Timer *timer) = 0;
+
+  /// Moves a queued timer to @c when, remove() and insert() by default.
+  virtual void reschedule(Timer *timer, Timestamp when);
+
+  /// Moves out timers expired at @c now, at least those whose deadline() passed.
+  virtual void getExpired(Timestamp now, TimerList *expired) = 0;
+
+  /// Time the timerfd should be armed to, invalid if nothing is queued.
+  virtual Timestamp nextExpiration() const = 0;
+
+  EventLoop *loop_; //所属的eventloop
+
 private:
-  // FIXME: use unique_ptr<Timer> instead of raw pointers.
-  // unique无法得到同一个对象的两个unique_ptr指针
-  // 但可以进项移动构造和移动赋值操作，即所有权可以移动到另一个对象（而非拷贝构造）
-  typedef std::pair<Timestamp, Timer *> Entry; //按照时间戳排序
-  typedef std::set<Entry> TimerList;           //使用set不用map
   typedef std::pair<Timer *, int64_t> ActiveTimer;
-  typedef std::set<ActiveTimer> ActiveTimerSet; //和第二行保存的是同样的东西
 
   //以下成员函数只可能在所属的i/o线程中调用，因而不必加锁，因为其他线程不会跨线程调用
   //锁竞争户导致服务器的性能大大降低，所以要尽量减少锁的使用
   void addTimerInLoop(Timer *timer);
   void cancelInLoop(TimerId timerId);
+  void restartInLoop(TimerId timerId, Timestamp when);
+  Timer *findTimer(TimerId timerId) const;
   // called when timerfd alarms
   void handleRead(); //回调函数
-  // move out all expired timers
-  std::vector<Entry> getExpired(Timestamp now);                 //返回超时的定时器列表，同一时间可能很多定时器返回
-  void reset(const std::vector<Entry> &expired, Timestamp now); //对超时的定时器进行重置，因为超时的定时器可能是重复的，对定时器进行重置
+  void runExpired(Timestamp now);
+  void reset(Timestamp now); //对超时的定时器进行重置，因为超时的定时器可能是重复的，对定时器进行重置
 
-  bool insert(Timer *timer); //插入定时器
+  // per loop pool of Timer objects, which are never deleted before ~TimerQueue(),
+  // so a TimerId can always be checked by the sequence of its Timer.
+  Timer *newTimer(TimerCallback cb, Timestamp when, double interval, double slack); // thread safe
+  void releaseTimer(Timer *timer);
+  void resetTimer(Timestamp expiration);
 
-  EventLoop *loop_; //所属的eventloop
-  const int timerfd_;
+  const int timerfd_;      // -1 if not using timerfd
   Channel timerfdChannel_; //定时器通道，在定时器事件到来后会回调handleread函数
-  // Timer list sorted by expiration
-  TimerList timers_; //timers_是按到期时间排序的
-
-  // for cancel()
-  //timers_与activeTimers_保存的是相同的数据
-  //timers_是按照到期时间排序的，activeTimers_是按照对象地址排序的
-  ActiveTimerSet activeTimers_;    //按照对象地址排序
-  bool callingExpiredTimers_;      /* 是否正在处于调用处理超时定时器的atomic */
-  ActiveTimerSet cancelingTimers_; //保护被取消的定时器
+
+  // scratch variables
+  TimerList expired_;
+  std::vector<ActiveTimer> expiredSequences_; //到期时的序号，回调中可能被取消并回收
+
+  MutexLock mutex_;
+  std::vector<std::unique_ptr<Timer>> timers_ GUARDED_BY(mutex_); //所有分配过的Timer
+  TimerList freeTimers_ GUARDED_BY(mutex_);
 };
 
 }  // namespace net
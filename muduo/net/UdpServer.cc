@@ -0,0 +1,83 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/UdpServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+void destroyUdpSocket(UdpSocket* socket)
+{
+  delete socket;
+}
+
+}  // namespace detail
+}  // namespace net
+}  // namespace muduo
+
+UdpServer::UdpServer(EventLoop* loop,
+                     const InetAddress& listenAddr,
+                     const string& nameArg)
+  : loop_(CHECK_NOTNULL(loop)),
+    listenAddr_(listenAddr),
+    name_(nameArg),
+    threadPool_(new EventLoopThreadPool(loop, name_))
+{
+}
+
+UdpServer::~UdpServer()
+{
+  loop_->assertInLoopThread();
+  LOG_TRACE << "UdpServer::~UdpServer [" << name_ << "] destructing";
+
+  //socket的channel要在它自己的loop线程中移除
+  for (auto& socket : sockets_)
+  {
+    EventLoop* ioLoop = socket->getLoop();
+    ioLoop->runInLoop(std::bind(&detail::destroyUdpSocket, socket.release()));
+  }
+}
+
+void UdpServer::setThreadNum(int numThreads)
+{
+  assert(0 <= numThreads);
+  threadPool_->setThreadNum(numThreads);
+}
+
+void UdpServer::start()
+{
+  if (started_.getAndSet(1) == 0)
+  {
+    loop_->assertInLoopThread();
+    threadPool_->start(threadInitCallback_);
+
+    std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+    UdpSocket::Option option = loops.size() > 1 ? UdpSocket::kReusePort : UdpSocket::kNoReusePort;
+    for (EventLoop* ioLoop : loops)
+    {
+      // the first socket picks the port if it is 0, the rest share it
+      std::unique_ptr<UdpSocket> socket(new UdpSocket(ioLoop, listenAddr_, option));
+      listenAddr_ = socket->localAddress();
+      socket->setDatagramCallback(datagramCallback_);
+      if (socketInitCallback_)
+      {
+        socketInitCallback_(socket.get());
+      }
+      ioLoop->runInLoop(std::bind(&UdpSocket::start, socket.get()));
+      sockets_.push_back(std::move(socket));
+    }
+    LOG_INFO << "UdpServer::start [" << name_ << "] - " << listenAddr_.toIpPort()
+             << " with " << sockets_.size() << " sockets";
+  }
+}
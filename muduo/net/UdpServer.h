@@ -0,0 +1,86 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_UDPSERVER_H
+#define MUDUO_NET_UDPSERVER_H
+
+#include "muduo/base/Atomic.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/UdpSocket.h"
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class EventLoopThreadPool;
+
+///
+/// UDP server, supports single-threaded and thread-pool models.
+///
+/// With N threads, every I/O loop gets its own UdpSocket bound to the same
+/// address with SO_REUSEPORT, the kernel spreads peers across them by hash,
+/// so datagrams of one peer always arrive at the same loop.
+///
+class UdpServer : noncopyable
+{
+ public:
+  typedef std::function<void(EventLoop*)> ThreadInitCallback;
+  /// Called for each socket before it starts, in the thread of start(),
+  /// eg. to setBatchSize() or enableGro().
+  typedef std::function<void(UdpSocket*)> SocketInitCallback;
+
+  UdpServer(EventLoop* loop,
+            const InetAddress& listenAddr,
+            const string& nameArg);
+  ~UdpServer();  // force out-line dtor, for std::unique_ptr members.
+
+  const string& name() const { return name_; }
+  EventLoop* getLoop() const { return loop_; }
+  /// With the actual port, valid after calling start().
+  const InetAddress& listenAddress() const { return listenAddr_; }
+
+  /// Set the number of threads for handling datagrams.
+  ///
+  /// - 0 means one socket in loop's thread, this is the default value.
+  /// - N means N threads, each has a socket of the same port.
+  /// Must be called before @c start
+  void setThreadNum(int numThreads);
+  void setThreadInitCallback(const ThreadInitCallback& cb)
+  { threadInitCallback_ = cb; }
+  void setSocketInitCallback(const SocketInitCallback& cb)
+  { socketInitCallback_ = cb; }
+
+  /// Set datagram callback, called in the loop of the socket.
+  /// Not thread safe.
+  void setDatagramCallback(const UdpSocket::DatagramCallback& cb)
+  { datagramCallback_ = cb; }
+
+  /// Starts the server, it's harmless to call it multiple times.
+  /// Must be called in loop's thread.
+  void start();
+
+  /// Sockets of all loops, valid after calling start().
+  const std::vector<std::unique_ptr<UdpSocket>>& sockets() const { return sockets_; }
+
+ private:
+  EventLoop* loop_;  // the base loop
+  InetAddress listenAddr_;
+  const string name_;
+  std::shared_ptr<EventLoopThreadPool> threadPool_;
+  UdpSocket::DatagramCallback datagramCallback_;
+  ThreadInitCallback threadInitCallback_;
+  SocketInitCallback socketInitCallback_;
+  AtomicInt32 started_;
+  std::vector<std::unique_ptr<UdpSocket>> sockets_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_UDPSERVER_H
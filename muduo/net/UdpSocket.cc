@@ -0,0 +1,411 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/UdpSocket.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/Socket.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const size_t kMaxGroBufferSize = 65535;
+const size_t kMaxGsoSegments = 64;       // UDP_MAX_SEGMENTS of Linux 4.18
+const size_t kMaxGsoBytes = 65000;       // below the 64KiB limit of an IP packet
+const size_t kMaxQueuedBytes = 4 * 1024 * 1024;
+const int kMaxReadRounds = 8;            // then let other channels run
+
+}  // namespace
+
+// preallocated arguments of recvmmsg/sendmmsg
+struct UdpSocket::Batch
+{
+  Batch(int n, size_t datagramSize, size_t controlSizeArg)
+    : buffer(n * datagramSize),
+      messages(n),
+      iovecs(n),
+      peers(n),
+      control(n * controlSizeArg),
+      controlSize(controlSizeArg)
+  {
+    memZero(messages.data(), messages.size() * sizeof(struct mmsghdr));
+    for (int i = 0; i < n; ++i)
+    {
+      struct msghdr& hdr = messages[i].msg_hdr;
+      iovecs[i].iov_base = datagramSize > 0 ? &buffer[i * datagramSize] : NULL;
+      iovecs[i].iov_len = datagramSize;
+      hdr.msg_name = &peers[i];
+      hdr.msg_iov = &iovecs[i];
+      hdr.msg_iovlen = 1;
+    }
+  }
+
+  std::vector<char> buffer;
+  std::vector<struct mmsghdr> messages;
+  std::vector<struct iovec> iovecs;
+  std::vector<struct sockaddr_in6> peers;
+  std::vector<char> control;  // cmsg of UDP_GRO or UDP_SEGMENT
+  const size_t controlSize;
+};
+
+UdpSocket::UdpSocket(EventLoop* loop, const InetAddress& localAddr, Option option)
+  : loop_(CHECK_NOTNULL(loop)),
+    socket_(new Socket(sockets::createUdpNonblockingOrDie(localAddr.family()))),
+    channel_(new Channel(loop, socket_->fd())),
+    localAddr_(localAddr),
+    batchSize_(64),
+    maxDatagramSize_(2048),
+    started_(false),
+    gro_(false),
+    gsoFailed_(false),
+    inCallbacks_(false),
+    receivedDatagrams_(0),
+    sentDatagrams_(0),
+    droppedDatagrams_(0)
+{
+  //每个loop一个socket，由内核按四元组哈希分发报文
+  socket_->setReusePort(option == kReusePort);
+  socket_->bindAddress(localAddr);
+  localAddr_ = InetAddress(sockets::getLocalAddr(socket_->fd()));
+  channel_->setReadCallback(
+      std::bind(&UdpSocket::handleRead, this, std::placeholders::_1));
+  channel_->setWriteCallback(
+      std::bind(&UdpSocket::handleWrite, this));
+}
+
+UdpSocket::~UdpSocket()
+{
+  if (started_)
+  {
+    loop_->assertInLoopThread();
+    channel_->disableAll();
+    channel_->remove();
+  }
+  if (!sendQueue_.empty())
+  {
+    LOG_WARN << "UdpSocket::~UdpSocket - " << localAddr_.toIpPort()
+             << " drops " << sendQueue_.size() << " queued datagrams";
+  }
+}
+
+int UdpSocket::fd() const
+{
+  return socket_->fd();
+}
+
+void UdpSocket::setReceiveBufferSize(int bytes)
+{
+  if (::setsockopt(fd(), SOL_SOCKET, SO_RCVBUF, &bytes, sizeof bytes) < 0)
+  {
+    LOG_SYSERR << "UdpSocket::setReceiveBufferSize";
+  }
+}
+
+void UdpSocket::setSendBufferSize(int bytes)
+{
+  if (::setsockopt(fd(), SOL_SOCKET, SO_SNDBUF, &bytes, sizeof bytes) < 0)
+  {
+    LOG_SYSERR << "UdpSocket::setSendBufferSize";
+  }
+}
+
+bool UdpSocket::enableGro()
+{
+  assert(!started_);
+  int on = 1;
+  if (::setsockopt(fd(), SOL_UDP, UDP_GRO, &on, sizeof on) < 0)
+  {
+    LOG_SYSERR << "UdpSocket::enableGro";
+    return false;
+  }
+  gro_ = true;
+  maxDatagramSize_ = std::max(maxDatagramSize_, kMaxGroBufferSize);
+  return true;
+}
+
+void UdpSocket::start()
+{
+  loop_->assertInLoopThread();
+  assert(!started_);
+  assert(batchSize_ > 0);
+  started_ = true;
+  recvBatch_.reset(new Batch(batchSize_, maxDatagramSize_, gro_ ? CMSG_SPACE(sizeof(int)) : 0));
+  channel_->enableReading();
+}
+
+void UdpSocket::sendTo(const InetAddress& peer, const void* data, size_t len)
+{
+  if (loop_->isInLoopThread())
+  {
+    enqueue(peer, data, len, 0);
+  }
+  else
+  {
+    loop_->runInLoop(
+        std::bind(&UdpSocket::sendInLoop, this,  // FIXME: unsafe
+                  peer, string(static_cast<const char*>(data), len)));
+  }
+}
+
+void UdpSocket::sendInLoop(const InetAddress& peer, const string& message)
+{
+  enqueue(peer, message.data(), message.size(), 0);
+}
+
+void UdpSocket::sendSegments(const InetAddress& peer, const void* data, size_t len,
+                             size_t segmentSize)
+{
+  loop_->assertInLoopThread();
+  assert(segmentSize > 0 && segmentSize <= 0xFFFF);
+  const char* p = static_cast<const char*>(data);
+  if (gsoFailed_)
+  {
+    for (size_t offset = 0; offset < len; offset += segmentSize)
+    {
+      enqueue(peer, p + offset, std::min(segmentSize, len - offset), 0);
+    }
+    return;
+  }
+
+  const size_t segmentsPerSend = std::max<size_t>(1, std::min(kMaxGsoSegments, kMaxGsoBytes / segmentSize));
+  const size_t bytesPerSend = segmentsPerSend * segmentSize;
+  for (size_t offset = 0; offset < len; offset += bytesPerSend)
+  {
+    size_t n = std::min(bytesPerSend, len - offset);
+    enqueue(peer, p + offset, n, n > segmentSize ? static_cast<uint16_t>(segmentSize) : 0);
+  }
+}
+
+void UdpSocket::enqueue(const InetAddress& peer, const void* data, size_t len,
+                        uint16_t segmentSize)
+{
+  loop_->assertInLoopThread();
+  if (sendQueueData_.size() + len > kMaxQueuedBytes)
+  {
+    ++droppedDatagrams_;
+    return;
+  }
+  Pending pending = { peer, sendQueueData_.size(), len, segmentSize };
+  sendQueueData_.append(static_cast<const char*>(data), len);
+  sendQueue_.push_back(pending);
+  //在回调中发送的报文攒到一批结束再一起发送
+  if (!channel_->isWriting()
+      && (!inCallbacks_ || sendQueue_.size() >= static_cast<size_t>(batchSize_)))
+  {
+    flush();
+  }
+}
+
+void UdpSocket::flush()
+{
+  loop_->assertInLoopThread();
+  if (!sendBatch_)
+  {
+    sendBatch_.reset(new Batch(batchSize_, 0, CMSG_SPACE(sizeof(uint16_t))));
+  }
+  Batch& batch = *sendBatch_;
+  while (!sendQueue_.empty())
+  {
+    const int n = static_cast<int>(std::min(sendQueue_.size(), static_cast<size_t>(batchSize_)));
+    for (int i = 0; i < n; ++i)
+    {
+      const Pending& pending = sendQueue_[i];
+      struct msghdr& hdr = batch.messages[i].msg_hdr;
+      batch.iovecs[i].iov_base = &sendQueueData_[pending.offset];
+      batch.iovecs[i].iov_len = pending.len;
+      hdr.msg_name = const_cast<struct sockaddr*>(pending.peer.getSockAddr());
+      hdr.msg_namelen = sockets::sockaddrLength(pending.peer.getSockAddr());
+      if (pending.segmentSize > 0)
+      {
+        hdr.msg_control = &batch.control[i * batch.controlSize];
+        hdr.msg_controllen = batch.controlSize;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        ::memcpy(CMSG_DATA(cmsg), &pending.segmentSize, sizeof(uint16_t));
+      }
+      else
+      {
+        hdr.msg_control = NULL;
+        hdr.msg_controllen = 0;
+      }
+    }
+
+    int sent = ::sendmmsg(fd(), batch.messages.data(), n, 0);
+    if (sent > 0)
+    {
+      for (int i = 0; i < sent; ++i)
+      {
+        const Pending& pending = sendQueue_[i];
+        sentDatagrams_ += pending.segmentSize > 0
+            ? (pending.len + pending.segmentSize - 1) / pending.segmentSize
+            : 1;
+      }
+      sendQueue_.erase(sendQueue_.begin(), sendQueue_.begin() + sent);
+    }
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+    {
+      //发送缓冲区满了，等可写时再发
+      if (!channel_->isWriting())
+      {
+        channel_->enableWriting();
+      }
+      return;
+    }
+    else if (errno == EINTR)
+    {
+      continue;
+    }
+    else if (sendQueue_.front().segmentSize > 0 && (errno == EIO || errno == EINVAL))
+    {
+      // no checksum offload on the route, or kernel without UDP_SEGMENT
+      LOG_WARN << "UdpSocket::flush - UDP GSO unavailable, sending plain datagrams";
+      gsoFailed_ = true;
+      splitSegments();
+    }
+    else
+    {
+      // EMSGSIZE, ENETUNREACH, etc. drops this datagram only
+      LOG_SYSERR << "UdpSocket::flush - to " << sendQueue_.front().peer.toIpPort();
+      ++droppedDatagrams_;
+      sendQueue_.pop_front();
+    }
+  }
+
+  sendQueueData_.clear();
+  if (channel_->isWriting())
+  {
+    channel_->disableWriting();
+  }
+}
+
+void UdpSocket::splitSegments()
+{
+  Pending gso = sendQueue_.front();
+  sendQueue_.pop_front();
+  std::vector<Pending> segments;
+  for (size_t offset = 0; offset < gso.len; offset += gso.segmentSize)
+  {
+    Pending segment = { gso.peer, gso.offset + offset,
+                        std::min<size_t>(gso.segmentSize, gso.len - offset), 0 };
+    segments.push_back(segment);
+  }
+  sendQueue_.insert(sendQueue_.begin(), segments.begin(), segments.end());
+}
+
+void UdpSocket::handleWrite()
+{
+  loop_->assertInLoopThread();
+  flush();
+}
+
+void UdpSocket::handleRead(Timestamp receiveTime)
+{
+  loop_->assertInLoopThread();
+  Batch& batch = *recvBatch_;
+  for (int round = 0; round < kMaxReadRounds; ++round)
+  {
+    for (int i = 0; i < batchSize_; ++i)
+    {
+      struct msghdr& hdr = batch.messages[i].msg_hdr;
+      hdr.msg_namelen = sizeof(struct sockaddr_in6);
+      hdr.msg_control = batch.controlSize > 0 ? &batch.control[i * batch.controlSize] : NULL;
+      hdr.msg_controllen = batch.controlSize;
+      hdr.msg_flags = 0;
+    }
+
+    int n = ::recvmmsg(fd(), batch.messages.data(), batchSize_, MSG_DONTWAIT, NULL);
+    if (n < 0)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      {
+        LOG_SYSERR << "UdpSocket::handleRead";
+      }
+      break;
+    }
+
+    inCallbacks_ = true;
+    for (int i = 0; i < n; ++i)
+    {
+      struct msghdr& hdr = batch.messages[i].msg_hdr;
+      if (hdr.msg_flags & MSG_TRUNC)
+      {
+        ++droppedDatagrams_;
+        continue;
+      }
+      size_t segmentSize = 0;
+      if (gro_)
+      {
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+        {
+          if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+          {
+            int gsoSize = 0;
+            ::memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof gsoSize);
+            segmentSize = gsoSize;
+          }
+        }
+      }
+      deliver(static_cast<const char*>(batch.iovecs[i].iov_base), batch.messages[i].msg_len,
+              InetAddress(batch.peers[i]), segmentSize, receiveTime);
+    }
+    inCallbacks_ = false;
+    if (!sendQueue_.empty() && !channel_->isWriting())
+    {
+      flush();
+    }
+
+    if (n < batchSize_)
+    {
+      break;
+    }
+  }
+}
+
+void UdpSocket::deliver(const char* data, size_t len, const InetAddress& peer,
+                        size_t segmentSize, Timestamp receiveTime)
+{
+  if (segmentSize == 0)
+  {
+    segmentSize = len;
+  }
+  //GRO合并的缓冲区按原来的报文大小拆开
+  for (size_t offset = 0; offset < len; offset += segmentSize)
+  {
+    ++receivedDatagrams_;
+    if (datagramCallback_)
+    {
+      datagramCallback_(this, peer, data + offset, std::min(segmentSize, len - offset), receiveTime);
+    }
+  }
+  if (len == 0)
+  {
+    ++receivedDatagrams_;  // empty datagram
+    if (datagramCallback_)
+    {
+      datagramCallback_(this, peer, data, 0, receiveTime);
+    }
+  }
+}
@@ -0,0 +1,145 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_UDPSOCKET_H
+#define MUDUO_NET_UDPSOCKET_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/InetAddress.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+
+namespace muduo
+{
+namespace net
+{
+
+class Channel;
+class EventLoop;
+class Socket;
+
+///
+/// Non-blocking UDP socket of an EventLoop, batching system calls.
+///
+/// Datagrams are received with recvmmsg(2) into preallocated slots,
+/// up to batchSize() per call. Datagrams sent in the datagram callbacks
+/// of one batch are queued and sent together with sendmmsg(2);
+/// sendTo() from elsewhere sends at once, unless earlier datagrams are
+/// still waiting for the socket to become writable.
+///
+/// With enableGro(), the kernel coalesces a flow into large buffers,
+/// the callback still gets every datagram. sendSegments() sends a large
+/// buffer as equal-sized datagrams with one UDP GSO send.
+///
+/// sendTo() is thread safe, other member functions must be called
+/// in the loop thread, or before start().
+///
+class UdpSocket : noncopyable
+{
+ public:
+  typedef std::function<void (UdpSocket*,
+                              const InetAddress& peer,
+                              const char* data,
+                              size_t len,
+                              Timestamp receiveTime)> DatagramCallback;
+
+  enum Option
+  {
+    kNoReusePort,
+    kReusePort,
+  };
+
+  /// Binds to @c localAddr, port 0 picks an ephemeral port.
+  UdpSocket(EventLoop* loop, const InetAddress& localAddr, Option option = kNoReusePort);
+  ~UdpSocket();  // force out-line dtor, for std::unique_ptr members.
+
+  EventLoop* getLoop() const { return loop_; }
+  int fd() const;
+  /// With the actual port.
+  const InetAddress& localAddress() const { return localAddr_; }
+
+  /// Datagrams per recvmmsg/sendmmsg, 64 by default. Call before start().
+  void setBatchSize(int n) { batchSize_ = n; }
+  int batchSize() const { return batchSize_; }
+  /// Larger datagrams are dropped, 2048 by default. Call before start().
+  void setMaxDatagramSize(size_t n) { maxDatagramSize_ = n; }
+  /// SO_RCVBUF, bursts beyond it are dropped by the kernel.
+  void setReceiveBufferSize(int bytes);
+  void setSendBufferSize(int bytes);
+  /// Returns false if the kernel does not support UDP_GRO (Linux 5.0).
+  /// Slots grow to 64KiB for coalesced buffers. Call before start().
+  bool enableGro();
+
+  void setDatagramCallback(DatagramCallback cb)
+  { datagramCallback_ = std::move(cb); }
+
+  /// Starts receiving, not thread safe, call only once.
+  void start();
+
+  void sendTo(const InetAddress& peer, const void* data, size_t len);
+  void sendTo(const InetAddress& peer, const StringPiece& message)
+  { sendTo(peer, message.data(), message.size()); }
+
+  ///
+  /// Sends @c data as datagrams of @c segmentSize bytes, the last one
+  /// may be shorter. Uses UDP_SEGMENT (Linux 4.18) when supported,
+  /// one send per 64 segments, falls back to plain datagrams otherwise.
+  /// Must be called in the loop thread.
+  ///
+  void sendSegments(const InetAddress& peer, const void* data, size_t len,
+                    size_t segmentSize);
+
+  int64_t receivedDatagrams() const { return receivedDatagrams_; }
+  int64_t sentDatagrams() const { return sentDatagrams_; }
+  /// Truncated, or not sent because the send queue was full or sendmmsg failed.
+  int64_t droppedDatagrams() const { return droppedDatagrams_; }
+
+ private:
+  struct Batch;
+  struct Pending
+  {
+    InetAddress peer;
+    size_t offset;  // in sendQueueData_
+    size_t len;
+    uint16_t segmentSize;  // 0 if not GSO
+  };
+
+  void sendInLoop(const InetAddress& peer, const string& message);
+  void enqueue(const InetAddress& peer, const void* data, size_t len, uint16_t segmentSize);
+  void flush();
+  void splitSegments();
+  void handleRead(Timestamp receiveTime);
+  void handleWrite();
+  void deliver(const char* data, size_t len, const InetAddress& peer,
+               size_t segmentSize, Timestamp receiveTime);
+
+  EventLoop* loop_;
+  std::unique_ptr<Socket> socket_;
+  std::unique_ptr<Channel> channel_;
+  InetAddress localAddr_;
+  DatagramCallback datagramCallback_;
+  int batchSize_;
+  size_t maxDatagramSize_;
+  bool started_;
+  bool gro_;
+  bool gsoFailed_;
+  bool inCallbacks_;  // sends are flushed after the callbacks of a batch
+  std::unique_ptr<Batch> recvBatch_;
+  std::unique_ptr<Batch> sendBatch_;
+  std::deque<Pending> sendQueue_;
+  string sendQueueData_;
+  int64_t receivedDatagrams_;
+  int64_t sentDatagrams_;
+  int64_t droppedDatagrams_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_UDPSOCKET_H
@@ -45,13 +45,16 @@ class ZlibInputStream : noncopyable
 class ZlibOutputStream : noncopyable
 {
  public:
-  explicit ZlibOutputStream(Buffer* output)
+  // windowBits is MAX_WBITS + 16 for gzip instead of zlib format
+  explicit ZlibOutputStream(Buffer* output,
+                            int level = Z_DEFAULT_COMPRESSION,
+                            int windowBits = MAX_WBITS)
     : output_(output),
       zerror_(Z_OK),
       bufferSize_(1024)
   {
     memZero(&zstream_, sizeof zstream_);
-    zerror_ = deflateInit(&zstream_, Z_DEFAULT_COMPRESSION);
+    zerror_ = deflateInit2(&zstream_, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
   }
 
   ~ZlibOutputStream()
@@ -106,6 +109,18 @@ class ZlibOutputStream : noncopyable
   }
 
   bool finish()
+  {
+    bool ok = end();
+    if (zstream_.state != Z_NULL && deflateEnd(&zstream_) != Z_OK)
+    {
+      ok = false;
+    }
+    zerror_ = Z_STREAM_END;
+    return ok;
+  }
+
+  // Like finish(), but keeps the deflate state for reset().
+  bool end()
   {
     if (zerror_ != Z_OK)
       return false;
@@ -114,10 +129,18 @@ class ZlibOutputStream : noncopyable
     {
       zerror_ = compress(Z_FINISH);
     }
-    zerror_ = deflateEnd(&zstream_);
-    bool ok = zerror_ == Z_OK;
-    zerror_ = Z_STREAM_END;
-    return ok;
+    return zerror_ == Z_STREAM_END;
+  }
+
+  // Starts a new stream after end(), much cheaper than a new
+  // ZlibOutputStream, deflateInit() allocates about 256KiB.
+  bool reset()
+  {
+    if (zstream_.state == Z_NULL)
+      return false;
+
+    zerror_ = deflateReset(&zstream_);
+    return zerror_ == Z_OK;
   }
 
  private:
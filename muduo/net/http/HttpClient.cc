@@ -0,0 +1,455 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/http/HttpClient.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/http/HttpContext.h"
+#include "muduo/net/http/HttpRequest.h"
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include <stdio.h>   // snprintf
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+struct HttpClient::Call
+{
+    Request req;
+    ResponseCallback cb;
+    BodyCallback bodyCb;
+    bool retried; //已经重发过一次
+
+    bool idempotent() const
+    {
+        return req.method == "GET" || req.method == "HEAD";
+    }
+};
+
+struct HttpClient::Connection : noncopyable
+{
+    Connection(Host *h, size_t maxBodySize)
+        : host(h),
+          context(HttpContext::kParseResponse),
+          parsing(false),
+          closing(false)
+    {
+        context.setMaxBodySize(maxBodySize);
+    }
+
+    Host *host;                       //移出host之后为NULL，回调不再处理
+    std::unique_ptr<TcpClient> client;
+    TcpConnectionPtr conn;            //连上之后才有
+    HttpContext context;              //解析inflight.front()的应答
+    std::deque<std::shared_ptr<Call>> inflight; //已发出的请求，按顺序等应答
+    bool parsing;                     //正在解析，回调里发的请求不能用它
+    bool closing;                     //不再发新的请求
+};
+
+struct HttpClient::Host
+{
+    explicit Host(const InetAddress &addr)
+        : address(addr)
+    {
+    }
+
+    InetAddress address;
+    std::vector<ConnectionPtr> connections;
+    std::deque<std::shared_ptr<Call>> queue; //等待空闲连接的请求
+};
+
+namespace
+{
+
+const string kNoBody;
+
+// "Name: value\r\n" lines, case-insensitive
+bool hasHeader(const string &headers, const char *field)
+{
+    const size_t len = ::strlen(field);
+    for (size_t line = 0; line < headers.size(); )
+    {
+        if (::strncasecmp(headers.data() + line, field, len) == 0 &&
+            line + len < headers.size() && headers[line + len] == ':')
+        {
+            return true;
+        }
+        const size_t crlf = headers.find("\r\n", line);
+        line = crlf == string::npos ? headers.size() : crlf + 2;
+    }
+    return false;
+}
+
+// case-insensitive, the value is not NUL terminated
+bool containsToken(const StringPiece &value, const char *token)
+{
+    const int len = static_cast<int>(::strlen(token));
+    for (int i = 0; i + len <= value.size(); ++i)
+    {
+        if (::strncasecmp(value.data() + i, token, len) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void fail(const std::shared_ptr<HttpClient::Call> &call)
+{
+    call->cb(HttpClient::Response(NULL));
+}
+
+} // namespace
+
+int HttpClient::Response::statusCode() const
+{
+    return context_ ? context_->statusCode() : 0;
+}
+
+StringPiece HttpClient::Response::statusMessage() const
+{
+    return context_ ? StringPiece(context_->statusMessage()) : StringPiece();
+}
+
+StringPiece HttpClient::Response::header(const StringPiece &field) const
+{
+    return context_ ? context_->request().header(field) : StringPiece();
+}
+
+const string &HttpClient::Response::body() const
+{
+    return context_ ? context_->request().body() : kNoBody;
+}
+
+HttpClient::HttpClient(EventLoop *loop, const string &name)
+    : loop_(CHECK_NOTNULL(loop)),
+      name_(name),
+      maxConnectionsPerHost_(kDefaultMaxConnectionsPerHost),
+      pipelineDepth_(1),
+      connectTimeout_(3.0),
+      maxBodySize_(kDefaultMaxBodySize),
+      nextConnId_(1)
+{
+}
+
+HttpClient::~HttpClient()
+{
+    for (const auto &host : hosts_)
+    {
+        for (const ConnectionPtr &connection : host.second->connections)
+        {
+            connection->host = NULL;
+            connection->conn.reset(); //TcpClient析构时会强制关闭它
+        }
+    }
+}
+
+void HttpClient::request(const InetAddress &server, const Request &req,
+                         const ResponseCallback &cb, const BodyCallback &bodyCb)
+{
+    std::shared_ptr<Call> call(new Call);
+    call->req = req;
+    call->cb = cb;
+    call->bodyCb = bodyCb;
+    call->retried = false;
+    loop_->runInLoop(std::bind(&HttpClient::requestInLoop, this, server, call));
+}
+
+void HttpClient::requestInLoop(const InetAddress &server, const std::shared_ptr<Call> &call)
+{
+    loop_->assertInLoopThread();
+    std::unique_ptr<Host> &host = hosts_[server.toIpPort()];
+    if (!host)
+    {
+        host.reset(new Host(server));
+    }
+    host->queue.push_back(call);
+    dispatch(get_pointer(host));
+}
+
+// an idle connection first, then a new one, then pipelining
+void HttpClient::dispatch(Host *host)
+{
+    while (!host->queue.empty())
+    {
+        const std::shared_ptr<Call> call = host->queue.front();
+        ConnectionPtr best;
+        int connecting = 0;
+        for (const ConnectionPtr &connection : host->connections)
+        {
+            if (connection->closing || connection->parsing)
+            {
+                continue; //等它关闭，或者解析完再说
+            }
+            else if (!connection->conn)
+            {
+                ++connecting;
+            }
+            else if (connection->inflight.empty())
+            {
+                best = connection;
+                break;
+            }
+            else if (call->idempotent() && connection->inflight.back()->idempotent() &&
+                     static_cast<int>(connection->inflight.size()) < pipelineDepth_ &&
+                     (!best || connection->inflight.size() < best->inflight.size()))
+            {
+                best = connection;
+            }
+        }
+
+        const bool full = static_cast<int>(host->connections.size()) >= maxConnectionsPerHost_;
+        if (best && (best->inflight.empty() || full))
+        {
+            host->queue.pop_front();
+            send(best, call);
+        }
+        else if (!full && connecting < static_cast<int>(host->queue.size()))
+        {
+            newConnection(host);
+        }
+        else
+        {
+            break; //等连接空闲或连上
+        }
+    }
+}
+
+void HttpClient::send(const ConnectionPtr &connection, const std::shared_ptr<Call> &call)
+{
+    const Request &req = call->req;
+    Buffer buf;
+    buf.append(req.method);
+    buf.append(" ");
+    buf.append(req.path);
+    buf.append(" HTTP/1.1\r\n");
+    if (!hasHeader(req.headers, "Host"))
+    {
+        buf.append("Host: ");
+        buf.append(connection->host->address.toIpPort());
+        buf.append("\r\n");
+    }
+    buf.append(req.headers);
+    if (!req.body.empty())
+    {
+        char contentLength[64];
+        snprintf(contentLength, sizeof contentLength, "Content-Length: %zu\r\n", req.body.size());
+        buf.append(contentLength);
+    }
+    buf.append("\r\n");
+    buf.append(req.body);
+
+    connection->inflight.push_back(call);
+    if (connection->inflight.size() == 1)
+    {
+        prepare(get_pointer(connection));
+    }
+    connection->conn->send(&buf);
+}
+
+void HttpClient::newConnection(Host *host)
+{
+    ConnectionPtr connection(new Connection(host, maxBodySize_));
+    char buf[64];
+    snprintf(buf, sizeof buf, "-%s#%d", host->address.toIpPort().c_str(), nextConnId_);
+    ++nextConnId_;
+    connection->client.reset(new TcpClient(loop_, host->address, name_ + buf));
+    std::weak_ptr<Connection> weak(connection);
+    connection->client->setConnectionCallback(
+        std::bind(&HttpClient::onConnection, this, weak, _1));
+    connection->client->setMessageCallback(
+        std::bind(&HttpClient::onMessage, this, weak, _2, _3));
+    host->connections.push_back(connection);
+    connection->client->connect();
+    //Connector连不上会一直重试，由这个定时器来放弃
+    loop_->runAfter(connectTimeout_, std::bind(&HttpClient::onConnectTimeout, this, weak));
+}
+
+void HttpClient::onConnection(const std::weak_ptr<Connection> &weak, const TcpConnectionPtr &conn)
+{
+    ConnectionPtr connection = weak.lock();
+    if (!connection || !connection->host)
+    {
+        return;
+    }
+    Host *host = connection->host;
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+        connection->conn = conn;
+        dispatch(host);
+        return;
+    }
+
+    connection->closing = true;
+    connection->conn.reset();
+    if (connection->context.finishOnClose() && !connection->inflight.empty())
+    {
+        respond(get_pointer(connection)); //实体到连接关闭为止
+    }
+    const bool started = connection->context.started();
+    remove(connection);
+
+    //一个字节应答都没收到的幂等请求重发一次，其余的失败
+    std::deque<std::shared_ptr<Call>> inflight;
+    inflight.swap(connection->inflight);
+    std::vector<std::shared_ptr<Call>> failed;
+    for (size_t i = inflight.size(); i > 0; --i)
+    {
+        const std::shared_ptr<Call> &call = inflight[i - 1];
+        if (call->idempotent() && !call->retried && !(i == 1 && started))
+        {
+            call->retried = true;
+            host->queue.push_front(call);
+        }
+        else
+        {
+            failed.push_back(call);
+        }
+    }
+    std::reverse(failed.begin(), failed.end());
+    for (const std::shared_ptr<Call> &call : failed)
+    {
+        fail(call);
+    }
+    dispatch(host);
+}
+
+void HttpClient::onMessage(const std::weak_ptr<Connection> &weak, Buffer *buf, Timestamp receiveTime)
+{
+    ConnectionPtr connection = weak.lock();
+    if (!connection || !connection->host || connection->closing)
+    {
+        buf->retrieveAll();
+        return;
+    }
+    HttpContext &context = connection->context;
+    connection->parsing = true; //回调里的request()不会重置context
+    while (buf->readableBytes() > 0 && !connection->closing)
+    {
+        if (connection->inflight.empty())
+        {
+            LOG_ERROR << "HttpClient::onMessage[" << name_ << "] - unexpected data from "
+                      << connection->host->address.toIpPort();
+            connection->closing = true;
+            connection->conn->forceClose();
+        }
+        else if (!context.parseResponse(buf, receiveTime))
+        {
+            LOG_ERROR << "HttpClient::onMessage[" << name_ << "] - "
+                      << (context.bodyTooLarge() ? "body too large" : "bad response")
+                      << " from " << connection->host->address.toIpPort();
+            std::shared_ptr<Call> call = connection->inflight.front();
+            connection->inflight.pop_front();
+            connection->closing = true;
+            connection->conn->forceClose();
+            fail(call);
+        }
+        else if (!context.gotAll())
+        {
+            break;
+        }
+        else if (context.interim())
+        {
+            prepare(get_pointer(connection)); //跳过"100 Continue"
+        }
+        else
+        {
+            const StringPiece value = context.request().header("Connection");
+            if (containsToken(value, "close") ||
+                (context.request().getVersion() == HttpRequest::kHttp10 &&
+                 !containsToken(value, "keep-alive")))
+            {
+                connection->closing = true; //之后流水线上的请求在关闭时重发
+                connection->conn->shutdown();
+            }
+            respond(get_pointer(connection));
+        }
+    }
+    connection->parsing = false;
+    if (connection->closing)
+    {
+        buf->retrieveAll();
+    }
+    else if (connection->host)
+    {
+        dispatch(connection->host);
+    }
+}
+
+void HttpClient::onConnectTimeout(const std::weak_ptr<Connection> &weak)
+{
+    ConnectionPtr connection = weak.lock();
+    if (!connection || !connection->host || connection->conn)
+    {
+        return;
+    }
+    Host *host = connection->host;
+    LOG_ERROR << "HttpClient::onConnectTimeout[" << name_ << "] - "
+              << host->address.toIpPort();
+    connection->client->stop();
+    remove(connection);
+    if (host->connections.empty())
+    {
+        std::deque<std::shared_ptr<Call>> queue;
+        queue.swap(host->queue);
+        for (const std::shared_ptr<Call> &call : queue)
+        {
+            fail(call);
+        }
+    }
+}
+
+// gets the context ready for the answer to inflight.front()
+void HttpClient::prepare(Connection *connection)
+{
+    HttpContext &context = connection->context;
+    context.reset();
+    context.setBodyCallback(HttpContext::BodyCallback());
+    if (!connection->inflight.empty())
+    {
+        const Call &call = *connection->inflight.front();
+        if (call.req.method == "HEAD")
+        {
+            context.setNoBody();
+        }
+        if (call.bodyCb)
+        {
+            context.setBodyCallback([connection](const HttpRequest &, const StringPiece &piece)
+                {
+                    connection->inflight.front()->bodyCb(Response(&connection->context), piece);
+                });
+        }
+    }
+}
+
+void HttpClient::respond(Connection *connection)
+{
+    std::shared_ptr<Call> call = connection->inflight.front();
+    connection->inflight.pop_front();
+    call->cb(Response(&connection->context));
+    prepare(connection);
+}
+
+// in a callback of its TcpClient, which is destroyed later
+void HttpClient::remove(const ConnectionPtr &connection)
+{
+    Host *host = connection->host;
+    connection->host = NULL;
+    host->connections.erase(
+        std::find(host->connections.begin(), host->connections.end(), connection));
+    loop_->queueInLoop([connection] {});
+}
@@ -0,0 +1,163 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPCLIENT_H
+#define MUDUO_NET_HTTP_HTTPCLIENT_H
+
+#include "muduo/base/StringPiece.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/TcpConnection.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+class HttpContext;
+
+/// An asynchronous HTTP/1.1 client, the callbacks run in the loop.
+///
+/// Connections are kept alive and reused per server, up to
+/// setMaxConnectionsPerHost(), requests beyond that wait for one to be
+/// free. GET and HEAD may be pipelined on a busy connection, see
+/// setPipelineDepth(). Responses are parsed by HttpContext in its
+/// kParseResponse mode, the body is kept or streamed to a BodyCallback.
+///
+/// If a connection closes before any byte of an answer, GET and HEAD are
+/// sent again once, the server may have timed a kept-alive connection out.
+/// Requests still in flight when the HttpClient is destroyed are dropped
+/// without their callbacks.
+class HttpClient : noncopyable
+{ //http客户端，按服务器复用长连接
+public:
+    /// Valid only during the callback.
+    class Response
+    {
+    public:
+        explicit Response(const HttpContext *context)
+            : context_(context)
+        {
+        }
+
+        /// 0 if the request failed, no connection or it closed early.
+        int statusCode() const;
+        StringPiece statusMessage() const;
+        /// data() is NULL if there is no such header.
+        StringPiece header(const StringPiece &field) const;
+        /// Empty if it was streamed to a BodyCallback.
+        const string &body() const;
+
+    private:
+        const HttpContext *context_; //失败时为NULL
+    };
+
+    struct Request
+    {
+        explicit Request(const string &methodArg = "GET", const string &pathArg = "/")
+            : method(methodArg),
+              path(pathArg)
+        {
+        }
+
+        string method;
+        string path;    //带query
+        string headers; //"Name: value\r\n"，每行一个
+        string body;    //非空时加上Content-Length
+    };
+
+    typedef std::function<void(const Response &)> ResponseCallback;
+    /// A piece of the body, straight from the input buffer, valid only
+    /// during the call. The ResponseCallback follows the last piece.
+    typedef std::function<void(const Response &, const StringPiece &)> BodyCallback;
+
+    static const int kDefaultMaxConnectionsPerHost = 4;
+    static const size_t kDefaultMaxBodySize = 64 * 1024 * 1024;
+
+    HttpClient(EventLoop *loop, const string &name);
+    ~HttpClient(); // force out-line dtor, for std::unique_ptr members.
+
+    EventLoop *getLoop() const { return loop_; }
+
+    /// Not thread safe, set before the first request.
+    void setMaxConnectionsPerHost(int n)
+    {
+        maxConnectionsPerHost_ = n;
+    }
+
+    /// Requests in flight on one connection, 1 (no pipelining) by default.
+    /// Not thread safe, set before the first request.
+    void setPipelineDepth(int n)
+    {
+        pipelineDepth_ = n;
+    }
+
+    /// Requests waiting for a connection that is not up by then fail,
+    /// 3 seconds by default. Not thread safe, set before the first request.
+    void setConnectTimeout(double seconds)
+    {
+        connectTimeout_ = seconds;
+    }
+
+    /// Larger bodies fail the request. Not thread safe, set before the
+    /// first request.
+    void setMaxBodySize(size_t bytes)
+    {
+        maxBodySize_ = bytes;
+    }
+
+    /// Thread safe, cb is called in the loop thread, never from inside
+    /// request() itself.
+    void request(const InetAddress &server, const Request &req,
+                 const ResponseCallback &cb,
+                 const BodyCallback &bodyCb = BodyCallback());
+
+    void get(const InetAddress &server, const string &path, const ResponseCallback &cb)
+    {
+        request(server, Request("GET", path), cb);
+    }
+
+    // internal
+    struct Call;
+    struct Connection;
+    struct Host;
+
+private:
+    typedef std::shared_ptr<Connection> ConnectionPtr;
+
+    void requestInLoop(const InetAddress &server, const std::shared_ptr<Call> &call);
+    void dispatch(Host *host);
+    void send(const ConnectionPtr &connection, const std::shared_ptr<Call> &call);
+    void newConnection(Host *host);
+    void onConnection(const std::weak_ptr<Connection> &weak, const TcpConnectionPtr &conn);
+    void onMessage(const std::weak_ptr<Connection> &weak, Buffer *buf, Timestamp receiveTime);
+    void onConnectTimeout(const std::weak_ptr<Connection> &weak);
+    void prepare(Connection *connection);
+    void respond(Connection *connection);
+    void remove(const ConnectionPtr &connection);
+
+    EventLoop *loop_;
+    const string name_;
+    int maxConnectionsPerHost_;
+    int pipelineDepth_;
+    double connectTimeout_;
+    size_t maxBodySize_;
+    int nextConnId_;
+    std::map<string, std::unique_ptr<Host>> hosts_; //按ip:port
+};
+
+} // namespace net
+} // namespace muduo
+
+#endif // MUDUO_NET_HTTP_HTTPCLIENT_H
@@ -0,0 +1,333 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/http/HttpCompressor.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/base/ThreadLocalSingleton.h"
+#include "muduo/net/ZlibStream.h"
+#include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponse.h"
+
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// The deflate states of a thread, created on first use and reset after
+// each body, since deflateInit() is what costs.
+struct Deflaters
+{
+    Deflaters()
+    {
+        levels[0] = levels[1] = Z_DEFAULT_COMPRESSION;
+    }
+
+    ZlibOutputStream *stream(HttpCompressor::Encoding encoding, int level)
+    {
+        int i = encoding == HttpCompressor::kGzip ? 0 : 1;
+        if (!streams[i] || levels[i] != level)
+        {
+            streams[i].reset(new ZlibOutputStream(&output, level,
+                                                  i == 0 ? MAX_WBITS + 16 : MAX_WBITS));
+            levels[i] = level;
+        }
+        return streams[i].get();
+    }
+
+    Buffer output;                                 //压缩后的实体
+    std::unique_ptr<ZlibOutputStream> streams[2];  //gzip和deflate
+    int levels[2];
+};
+
+// "0", "0.5", "1.000", in thousandths
+int parseQuality(StringPiece s)
+{
+    if (s.empty() || (s[0] != '0' && s[0] != '1'))
+    {
+        return 0;
+    }
+    int q = (s[0] - '0') * 1000;
+    int scale = 100;
+    for (int i = 2; i < s.size() && i < 5 && s[1] == '.'; ++i)
+    {
+        if (s[i] < '0' || s[i] > '9')
+        {
+            break;
+        }
+        q += (s[i] - '0') * scale;
+        scale /= 10;
+    }
+    return q > 1000 ? 1000 : q;
+}
+
+StringPiece trim(StringPiece s)
+{
+    while (!s.empty() && (s[0] == ' ' || s[0] == '\t'))
+    {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s[s.size() - 1] == ' ' || s[s.size() - 1] == '\t'))
+    {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+bool equalsIgnoreCase(const StringPiece &s, const char *token)
+{
+    return static_cast<size_t>(s.size()) == ::strlen(token) &&
+           ::strncasecmp(s.data(), token, s.size()) == 0;
+}
+
+// "Vary: Cookie" becomes "Vary: Cookie, Accept-Encoding"
+void addVary(HttpResponse *resp)
+{
+    const StringPiece vary = resp->header("Vary");
+    const char *p = vary.data();
+    const char *end = p + vary.size();
+    while (p < end)
+    {
+        const char *comma = static_cast<const char *>(::memchr(p, ',', end - p));
+        const char *itemEnd = comma ? comma : end;
+        const StringPiece item = trim(StringPiece(p, static_cast<int>(itemEnd - p)));
+        if (item == "*" || equalsIgnoreCase(item, "Accept-Encoding"))
+        {
+            return; //已经包含了
+        }
+        p = itemEnd + 1;
+    }
+    resp->addHeader("Vary", vary.empty() ? string("Accept-Encoding")
+                                         : vary.as_string() + ", Accept-Encoding");
+}
+
+const size_t kEntryOverhead = 64; //链表和哈希表的节点，大约
+
+// the source is not counted, its owner keeps it
+size_t entryBytes(const std::shared_ptr<const string> &compressed)
+{
+    return kEntryOverhead + (compressed ? compressed->size() : 0);
+}
+
+} // namespace
+
+HttpCompressor::HttpCompressor()
+    : minSize_(kDefaultMinSize),
+      level_(Z_DEFAULT_COMPRESSION),
+      cacheBytes_(kDefaultCacheBytes),
+      bytes_(0)
+{
+    contentTypes_.push_back("text/");
+    contentTypes_.push_back("application/json");
+    contentTypes_.push_back("application/javascript");
+    contentTypes_.push_back("application/xml");
+    contentTypes_.push_back("image/svg+xml");
+}
+
+HttpCompressor::~HttpCompressor() = default;
+
+// "gzip, deflate;q=0.5, *;q=0", gzip wins a tie
+HttpCompressor::Encoding HttpCompressor::negotiate(const HttpRequest &req)
+{
+    const StringPiece accept = req.header("Accept-Encoding");
+    int gzip = -1; //-1表示没有提到
+    int deflate = -1;
+    int any = -1;
+    const char *p = accept.data();
+    const char *end = p + accept.size();
+    while (p < end)
+    {
+        const char *comma = static_cast<const char *>(::memchr(p, ',', end - p));
+        const char *itemEnd = comma ? comma : end;
+        StringPiece item(p, static_cast<int>(itemEnd - p));
+        int quality = 1000;
+        const char *semicolon = static_cast<const char *>(::memchr(p, ';', itemEnd - p));
+        if (semicolon)
+        {
+            item = StringPiece(p, static_cast<int>(semicolon - p));
+            StringPiece param = trim(StringPiece(semicolon + 1, static_cast<int>(itemEnd - semicolon - 1)));
+            if (param.starts_with("q=") || param.starts_with("Q="))
+            {
+                param.remove_prefix(2);
+                quality = parseQuality(param);
+            }
+        }
+        item = trim(item);
+        if (equalsIgnoreCase(item, "gzip") || equalsIgnoreCase(item, "x-gzip"))
+        {
+            gzip = quality;
+        }
+        else if (equalsIgnoreCase(item, "deflate"))
+        {
+            deflate = quality;
+        }
+        else if (item == "*")
+        {
+            any = quality;
+        }
+        p = itemEnd + 1;
+    }
+    if (gzip < 0)
+    {
+        gzip = any;
+    }
+    if (deflate < 0)
+    {
+        deflate = any;
+    }
+    if (gzip > 0 && gzip >= deflate)
+    {
+        return kGzip;
+    }
+    return deflate > 0 ? kDeflate : kIdentity;
+}
+
+bool HttpCompressor::compressible(const HttpResponse &resp) const
+{
+    HttpResponse::HttpStatusCode code = resp.statusCode();
+    if (code == HttpResponse::k204NoContent || code == HttpResponse::k206PartialContent ||
+        code == HttpResponse::k304NotModified)
+    {
+        return false;
+    }
+    if (resp.hasBodyByReference() && !resp.bodyBlock())
+    {
+        return false; //sendfile的文件不压缩
+    }
+    if (resp.bodySize() < minSize_ || resp.header("Content-Encoding").data())
+    {
+        return false;
+    }
+    const StringPiece type = resp.header("Content-Type");
+    for (const string &prefix : contentTypes_)
+    {
+        if (static_cast<size_t>(type.size()) >= prefix.size() &&
+            ::strncasecmp(type.data(), prefix.data(), prefix.size()) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HttpCompressor::compress(Encoding encoding, HttpResponse *resp) const
+{
+    if (!compressible(*resp))
+    {
+        return false;
+    }
+    addVary(resp); //不管压没压，缓存都要按编码区分
+    if (encoding == kIdentity)
+    {
+        return false;
+    }
+
+    const Block block = resp->bodyBlock();
+    // blocks are aligned, the low bits are free for the encoding
+    const uintptr_t key = reinterpret_cast<uintptr_t>(block.get()) | encoding;
+    const bool caching = block && cacheBytes_ > 0;
+    Block compressed;
+    if (caching && cached(key, block, &compressed) && !compressed)
+    {
+        return false; //上次压缩了也没有更小
+    }
+    if (!compressed)
+    {
+        Deflaters &deflaters = ThreadLocalSingleton<Deflaters>::instance();
+        ZlibOutputStream *stream = deflaters.stream(encoding, level_);
+        Buffer &output = deflaters.output;
+        const StringPiece body = resp->body();
+        bool ok = stream->write(body) && stream->end();
+        if (!ok)
+        {
+            LOG_ERROR << "HttpCompressor::compress " << stream->zlibErrorCode();
+        }
+        if (!stream->reset())
+        {
+            deflaters.streams[encoding == kGzip ? 0 : 1].reset();
+        }
+        if (!ok || output.readableBytes() >= static_cast<size_t>(body.size()))
+        {
+            output.retrieveAll();
+            if (ok && caching)
+            {
+                cache(key, block, Block()); //压缩了也不会更小，只记下这一点
+            }
+            return false;
+        }
+        if (caching)
+        {
+            compressed.reset(new string(output.peek(), output.readableBytes()));
+            cache(key, block, compressed);
+        }
+        else
+        {
+            resp->setBody(output.peek(), output.readableBytes()); //复用实体原来的内存
+        }
+        output.retrieveAll();
+    }
+    if (compressed)
+    {
+        resp->setBody(compressed);
+    }
+
+    resp->addHeader("Content-Encoding", encoding == kGzip ? "gzip" : "deflate");
+    const StringPiece etag = resp->header("ETag");
+    if (etag.data() && !etag.starts_with("W/"))
+    {
+        resp->addHeader("ETag", "W/" + etag.as_string()); //字节不同了，只能是弱ETag
+    }
+    return true;
+}
+
+bool HttpCompressor::cached(uintptr_t key, const Block &source, Block *compressed) const
+{
+    MutexLockGuard lock(mutex_);
+    std::unordered_map<uintptr_t, LruList::iterator>::iterator it = blocks_.find(key);
+    if (it == blocks_.end())
+    {
+        return false;
+    }
+    if (it->second->second.source.lock() != source)
+    {
+        eraseLocked(it); //原来的实体已经没了，地址被重用
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    *compressed = it->second->second.compressed;
+    return true;
+}
+
+void HttpCompressor::cache(uintptr_t key, const Block &source, const Block &compressed) const
+{
+    MutexLockGuard lock(mutex_);
+    std::unordered_map<uintptr_t, LruList::iterator>::iterator it = blocks_.find(key);
+    if (it != blocks_.end())
+    {
+        eraseLocked(it); //别的线程也压缩了一份
+    }
+    lru_.push_front(std::make_pair(key, Entry{source, compressed, !compressed}));
+    blocks_[key] = lru_.begin();
+    bytes_ += entryBytes(compressed);
+    while (bytes_ > cacheBytes_ && !lru_.empty())
+    {
+        eraseLocked(blocks_.find(lru_.back().first));
+    }
+}
+
+void HttpCompressor::eraseLocked(std::unordered_map<uintptr_t, LruList::iterator>::iterator it) const
+{
+    bytes_ -= entryBytes(it->second->second.compressed);
+    lru_.erase(it->second);
+    blocks_.erase(it);
+}
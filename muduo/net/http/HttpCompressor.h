@@ -0,0 +1,119 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPCOMPRESSOR_H
+#define MUDUO_NET_HTTP_HTTPCOMPRESSOR_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/base/StringPiece.h"
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpRequest;
+class HttpResponse;
+
+/// Compresses response bodies with gzip or deflate, for
+/// HttpServer::setCompressor().
+///
+/// Bodies in memory of at least setMinSize() bytes, whose Content-Type
+/// starts with one of setContentTypes(), are compressed when the
+/// Accept-Encoding of the request allows. Each thread keeps its deflate
+/// states and reuses them with deflateReset(). Bodies sent by reference
+/// are likely sent again, their compressed forms are kept in an LRU cache,
+/// so is the fact that one does not get smaller.
+///
+/// Thread safe once set up.
+class HttpCompressor : noncopyable
+{ //应答实体的压缩
+public:
+    enum Encoding
+    {
+        kIdentity,
+        kGzip,
+        kDeflate,
+    };
+
+    static const size_t kDefaultMinSize = 1024;
+    static const size_t kDefaultCacheBytes = 16 * 1024 * 1024;
+
+    /// Text, JSON, JavaScript, XML and SVG, at the default level.
+    HttpCompressor();
+    ~HttpCompressor();
+
+    /// Smaller bodies are not worth it, they fit in one packet anyway.
+    void setMinSize(size_t bytes)
+    {
+        minSize_ = bytes;
+    }
+
+    /// Prefixes of the Content-Type, eg. "text/" or "application/json".
+    void setContentTypes(const std::vector<string> &prefixes)
+    {
+        contentTypes_ = prefixes;
+    }
+
+    /// 1 to 9, see deflateInit().
+    void setLevel(int level)
+    {
+        level_ = level;
+    }
+
+    /// Bytes of compressed bodyBlock()s kept, 0 for none.
+    void setCacheBytes(size_t bytes)
+    {
+        cacheBytes_ = bytes;
+    }
+
+    /// The encoding to use for the answer to @c req.
+    static Encoding negotiate(const HttpRequest &req);
+
+    /// Compresses the body of @c resp in place, if the policy says so.
+    /// Returns true if it did.
+    bool compress(Encoding encoding, HttpResponse *resp) const;
+
+private:
+    typedef std::shared_ptr<const string> Block;
+    struct Entry
+    {
+        std::weak_ptr<const string> source; //地址可能被重用，用它确认还是原来的实体
+        Block compressed;                   //incompressible时为空
+        bool incompressible;                //压缩了也不会更小
+    };
+    typedef std::list<std::pair<uintptr_t, Entry>> LruList;
+
+    bool compressible(const HttpResponse &resp) const;
+    /// false if not cached, else *compressed is NULL for an incompressible block.
+    bool cached(uintptr_t key, const Block &source, Block *compressed) const;
+    /// @c compressed is NULL for an incompressible block.
+    void cache(uintptr_t key, const Block &source, const Block &compressed) const;
+    void eraseLocked(std::unordered_map<uintptr_t, LruList::iterator>::iterator it) const;
+
+    size_t minSize_;
+    std::vector<string> contentTypes_;
+    int level_;
+    size_t cacheBytes_;
+    mutable MutexLock mutex_;
+    mutable LruList lru_ GUARDED_BY(mutex_);
+    mutable std::unordered_map<uintptr_t, LruList::iterator> blocks_ GUARDED_BY(mutex_);
+    mutable size_t bytes_ GUARDED_BY(mutex_);
+};
+
+} // namespace net
+} // namespace muduo
+
+#endif // MUDUO_NET_HTTP_HTTPCOMPRESSOR_H
@@ -10,6 +10,10 @@
 #include "muduo/net/Buffer.h"
 #include "muduo/net/http/HttpContext.h"
 
+#include <algorithm>
+#include <string.h>
+#include <strings.h>
+
 using namespace muduo;
 using namespace muduo::net;
 //http服务器类的封装
@@ -56,24 +60,219 @@ bool HttpContext::processRequestLine(const char* begin, const char* end)
   return succeed;
 }
 
+// "HTTP/1.1 200 OK", the reason phrase may be empty
+bool HttpContext::processStatusLine(const char* begin, const char* end)
+{
+  if (end - begin < 12 || !std::equal(begin, begin + 7, "HTTP/1.") || begin[8] != ' ')
+  {
+    return false;
+  }
+  if (begin[7] == '1')
+  {
+    request_.setVersion(HttpRequest::kHttp11);
+  }
+  else if (begin[7] == '0')
+  {
+    request_.setVersion(HttpRequest::kHttp10);
+  }
+  else
+  {
+    return false;
+  }
+  int code = 0;
+  for (const char* p = begin + 9; p < begin + 12; ++p)
+  {
+    if (*p < '0' || *p > '9')
+    {
+      return false;
+    }
+    code = code * 10 + (*p - '0');
+  }
+  if (end - begin > 12 && begin[12] != ' ')
+  {
+    return false;
+  }
+  statusCode_ = code;
+  statusMessage_.assign(end - begin > 12 ? begin + 13 : end, end);
+  return true;
+}
+
+namespace
+{
+
+// case-insensitive, the value is not NUL terminated
+bool containsToken(const StringPiece& value, const char* token)
+{
+  const int len = static_cast<int>(::strlen(token));
+  for (int i = 0; i + len <= value.size(); ++i)
+  {
+    if (::strncasecmp(value.data() + i, token, len) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* findColon(const char* begin, const char* end)
+{
+  const void* colon = ::memchr(begin, ':', end - begin); // memchr is vectorized
+  return colon ? static_cast<const char*>(colon) : end;
+}
+
+int hexDigit(char c)
+{
+  int digit = -1;
+  if (c >= '0' && c <= '9')
+  {
+    digit = c - '0';
+  }
+  else if (c >= 'a' && c <= 'f')
+  {
+    digit = c - 'a' + 10;
+  }
+  else if (c >= 'A' && c <= 'F')
+  {
+    digit = c - 'A' + 10;
+  }
+  return digit;
+}
+
+// *value = *value * base + digit, false if that is above limit
+bool appendDigit(size_t* value, size_t base, size_t digit, size_t limit)
+{
+  if (*value > limit / base)
+  {
+    return false;
+  }
+  *value *= base;
+  if (digit > limit - *value)
+  {
+    return false;
+  }
+  *value += digit;
+  return true;
+}
+
+}  // namespace
+
+// decides how the body is framed, see RFC 7230 section 3.3.3
+bool HttpContext::processHeadersEnd()
+{
+  if (mode_ == kParseResponse &&
+      (noBody_ || interim() || statusCode_ == 204 || statusCode_ == 304))
+  {
+    state_ = kGotAll; //这些应答没有实体，不管Content-Length
+    return true;
+  }
+  const StringPiece transferEncoding = request_.header("Transfer-Encoding");
+  const StringPiece contentLength = request_.header("Content-Length");
+  if (transferEncoding.data())
+  {
+    if (!containsToken(transferEncoding, "chunked"))
+    {
+      return false;
+    }
+    state_ = kExpectChunkSize;
+  }
+  else if (contentLength.data())
+  {
+    if (contentLength.empty())
+    {
+      return false;
+    }
+    size_t length = 0;
+    for (char c : contentLength)
+    {
+      if (c < '0' || c > '9')
+      {
+        return false;
+      }
+      if (!appendDigit(&length, 10, c - '0', maxBodySize_))
+      {
+        bodyTooLarge_ = true;
+        return false;
+      }
+    }
+    bodyRemaining_ = length;
+    state_ = length > 0 ? kExpectBody : kGotAll;
+  }
+  else if (mode_ == kParseResponse)
+  {
+    state_ = kExpectBodyUntilClose;
+  }
+  else
+  {
+    state_ = kGotAll; //没有实体
+  }
+
+  expectContinue_ = mode_ == kParseRequest && state_ != kGotAll && containsToken(request_.header("Expect"), "100-continue");
+  return true;
+}
+
+// chunk-size [ chunk-ext ], in hex
+bool HttpContext::processChunkSize(const char* begin, const char* end)
+{
+  const char* semicolon = std::find(begin, end, ';');
+  size_t size = 0;
+  const char* p = begin;
+  for (; p < semicolon && hexDigit(*p) >= 0; ++p)
+  {
+    if (!appendDigit(&size, 16, hexDigit(*p), maxBodySize_ - bodySize_))
+    {
+      bodyTooLarge_ = true;
+      return false;
+    }
+  }
+  while (p < semicolon && (*p == ' ' || *p == '\t'))
+  {
+    ++p;
+  }
+  if (p == begin || p != semicolon)
+  {
+    return false;
+  }
+  bodyRemaining_ = size;
+  state_ = size > 0 ? kExpectChunkData : kExpectTrailers;
+  return true;
+}
+
+// hands out what is in buf, without copying it if there is a BodyCallback
+void HttpContext::consumeBody(Buffer* buf)
+{
+  size_t n = std::min(buf->readableBytes(), bodyRemaining_);
+  if (bodyCallback_)
+  {
+    bodyCallback_(request_, StringPiece(buf->peek(), static_cast<int>(n)));
+  }
+  else
+  {
+    request_.appendBody(buf->peek(), buf->peek() + n);
+  }
+  buf->retrieve(n);
+  bodyRemaining_ -= n;
+  bodySize_ += n;
+}
+
 // return false if any error
 bool HttpContext::parseRequest(Buffer* buf, Timestamp receiveTime)
 {
   bool ok = true;
   bool hasMore = true;
-  while (hasMore) //相当与一个状态机
+  while (ok && hasMore) //相当与一个状态机
   {
     if (state_ == kExpectRequestLine)//处于解析请求行状态
     {
       const char* crlf = buf->findCRLF();//这些数据都保存到缓冲区当中，在缓冲区寻找\r\n，头部每一行都有一个\r\n
       if (crlf)
       {
-        ok = processRequestLine(buf->peek(), crlf);//解析请求行
+        ok = mode_ == kParseRequest ? processRequestLine(buf->peek(), crlf)//解析请求行
+                                    : processStatusLine(buf->peek(), crlf);
         if (ok)
         {
-context->request().setReceiveTime(receiveTime); //设置请求时间
-                    buf->retrieveUntil(crlf + 2);                   //将请求行从buf中取回，包括\r\n，所以要+2
-                    context->receiveRequestLine();                  //httpcontext将状态改为kexpectheaders
+          request_.setReceiveTime(receiveTime); //设置请求时间
+          buf->retrieveUntil(crlf + 2);         //将请求行从buf中取回，包括\r\n，所以要+2
+          state_ = kExpectHeaders;              //httpcontext将状态改为kexpectheaders
         }
         else
         {
@@ -90,7 +289,7 @@ context->request().setReceiveTime(receiveTime); //设置请求时间
       const char* crlf = buf->findCRLF();
       if (crlf)
       {
-        const char* colon = std::find(buf->peek(), crlf, ':');//查找冒号所在位置
+        const char* colon = findColon(buf->peek(), crlf);//查找冒号所在位置
         if (colon != crlf)
         {
           request_.addHeader(buf->peek(), colon, crlf);
@@ -98,9 +297,7 @@ context->request().setReceiveTime(receiveTime); //设置请求时间
         else
         {
           // empty line, end of header
-          // FIXME:
-          state_ = kGotAll;//httpcontext将状态改为kgotall
-          hasMore = false;
+          ok = processHeadersEnd(); //根据Content-Length或chunked决定接下来的状态
         }
         buf->retrieveUntil(crlf + 2);//将header从buf中取回，包括\r\n
       }
@@ -109,10 +306,98 @@ context->request().setReceiveTime(receiveTime); //设置请求时间
         hasMore = false;
       }
     }
-    else if (state_ == kExpectBody) //当前还暂时不支持带body，需要补充
+    else if (state_ == kExpectBody || state_ == kExpectChunkData) //实体，不必等到全部收到
+    {
+      if (buf->readableBytes() > 0)
+      {
+        consumeBody(buf);
+        if (bodyRemaining_ == 0)
+        {
+          state_ = state_ == kExpectBody ? kGotAll : kExpectChunkEnd;
+        }
+      }
+      else
+      {
+        hasMore = false;
+      }
+    }
+    else if (state_ == kExpectBodyUntilClose)
+    {
+      if (buf->readableBytes() > maxBodySize_ - bodySize_)
+      {
+        bodyTooLarge_ = true;
+        ok = false;
+      }
+      else if (buf->readableBytes() > 0)
+      {
+        bodyRemaining_ = buf->readableBytes();
+        consumeBody(buf);
+      }
+      hasMore = false;
+    }
+    else if (state_ == kExpectChunkSize || state_ == kExpectChunkEnd)
+    {
+      const char* crlf = buf->findCRLF();
+      if (crlf)
+      {
+        if (state_ == kExpectChunkSize)
+        {
+          ok = processChunkSize(buf->peek(), crlf);
+        }
+        else
+        {
+          ok = crlf == buf->peek(); //块数据之后紧跟着\r\n
+          state_ = kExpectChunkSize;
+        }
+        buf->retrieveUntil(crlf + 2);
+      }
+      else
+      {
+        hasMore = false;
+      }
+    }
+    else if (state_ == kExpectTrailers)
+    {
+      const char* crlf = buf->findCRLF();
+      if (crlf)
+      {
+        const char* colon = findColon(buf->peek(), crlf);
+        if (colon != crlf)
+        {
+          request_.addHeader(buf->peek(), colon, crlf);
+        }
+        else
+        {
+          state_ = kGotAll;
+        }
+        buf->retrieveUntil(crlf + 2);
+      }
+      else
+      {
+        hasMore = false;
+      }
+    }
+    else // kGotAll, the rest is the next request
     {
-      // FIXME:
+      hasMore = false;
     }
   }
   return ok;
 }
+
+void HttpContext::sendReady(const TcpConnectionPtr& conn)
+{
+  while (!pending_.empty() && pending_.front()->ready)
+  {
+    PendingPtr pending;
+    pending.swap(pending_.front());
+    pending_.pop_front();
+    conn->send(&pending->output);
+    pending->response.sendBody(conn);
+    if (pending->close)
+    {
+      pending_.clear(); //之后的请求不再应答
+      conn->shutdown();
+    }
+  }
+}
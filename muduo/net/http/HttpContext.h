@@ -12,15 +12,56 @@
 #define MUDUO_NET_HTTP_HTTPCONTEXT_H
 
 #include "muduo/base/copyable.h"
+#include "muduo/base/StringPiece.h"
 
+#include "muduo/net/Buffer.h"
+#include "muduo/net/TcpConnection.h"
+#include "muduo/net/http/HttpCompressor.h"
 #include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponder.h"
+#include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/http/HttpResponseCache.h"
+
+#include <deque>
+#include <functional>
 
 namespace muduo
 {
 namespace net
 {
 
-class Buffer;
+/// One answer of a connection, waits in HttpContext until it and
+/// all before it are done.
+struct HttpResponder::Pending : noncopyable
+{
+    Pending(const TcpConnectionPtr &connection, bool closeConnection)
+        : conn(connection),
+          response(closeConnection),
+          close(closeConnection),
+          ready(false),
+          encoding(HttpCompressor::kIdentity)
+    {
+    }
+
+    /// Abandons cacheKey if done() was never called.
+    ~Pending();
+
+    /// Serializes response into output, in the thread calling done().
+    void finish();
+
+    /// A cache hit, the block of @c entry goes by reference.
+    void setEntry(const HttpResponseCache::EntryPtr &entry, Timestamp date);
+
+    std::weak_ptr<TcpConnection> conn;
+    HttpResponse response;                //用户填的应答
+    Buffer output;                        //序列化好的应答，按引用发送的实体除外
+    bool close;                           //发送后关闭连接
+    bool ready;                           //只在io线程中读写
+    std::shared_ptr<const HttpCompressor> compressor;
+    HttpCompressor::Encoding encoding;    //按请求协商好的
+    std::shared_ptr<HttpResponseCache> cache; //应答要填进缓存
+    string cacheKey;
+};
 
 class HttpContext : public muduo::copyable
 { //http协议解析类的封装
@@ -29,12 +70,41 @@ public:
     {
         kExpectRequestLine, //正处于解析请求行的状态
         kExpectHeaders,     //正处于解析头部状态
-        kExpectBody,        //正处于解析实体状态
+        kExpectBody,        //正处于解析实体状态，Content-Length
+        kExpectChunkSize,   //chunked编码，正处于解析块大小的状态
+        kExpectChunkData,   //正处于解析块数据的状态
+        kExpectChunkEnd,    //块数据之后的\r\n
+        kExpectTrailers,    //最后一块之后的trailer
+        kExpectBodyUntilClose, //应答没有长度，实体到连接关闭为止
         kGotAll,            //全部解析完毕
     };
 
-    HttpContext()
-        : state_(kExpectRequestLine)
+    /// kParseResponse parses the answers of HttpClient, request() holds
+    /// their headers and body.
+    enum Mode
+    {
+        kParseRequest,
+        kParseResponse,
+    };
+
+    /// Pieces of the body, pointing into the input buffer, valid only
+    /// during the call.
+    typedef std::function<void(const HttpRequest &,
+                               const StringPiece &)> BodyCallback;
+    typedef std::shared_ptr<HttpResponder::Pending> PendingPtr;
+
+    static const size_t kDefaultMaxBodySize = 1024 * 1024;
+
+    explicit HttpContext(Mode mode = kParseRequest)
+        : mode_(mode),
+          state_(kExpectRequestLine),
+          maxBodySize_(kDefaultMaxBodySize),
+          bodyRemaining_(0),
+          bodySize_(0),
+          bodyTooLarge_(false),
+          expectContinue_(false),
+          statusCode_(0),
+          noBody_(false)
     {
     }
 
@@ -43,18 +113,113 @@ public:
     // return false if any error
     bool parseRequest(Buffer *buf, Timestamp receiveTime);
 
+    /// The same state machine, for kParseResponse.
+    bool parseResponse(Buffer *buf, Timestamp receiveTime)
+    {
+        return parseRequest(buf, receiveTime);
+    }
+
+    /// The answer to HEAD has headers only, whatever Content-Length says.
+    /// Set before parsing each such response, reset() clears it.
+    void setNoBody()
+    {
+        noBody_ = true;
+    }
+
+    /// Ends a body framed by the connection close, returns false if the
+    /// response was cut short instead.
+    bool finishOnClose()
+    {
+        if (state_ == kExpectBodyUntilClose)
+        {
+            state_ = kGotAll;
+            return true;
+        }
+        return false;
+    }
+
+    /// Bodies longer than this are errors, with bodyTooLarge().
+    void setMaxBodySize(size_t bytes)
+    {
+        maxBodySize_ = bytes;
+    }
+
+    /// Without it, the body is kept in request().body().
+    void setBodyCallback(const BodyCallback &cb)
+    {
+        bodyCallback_ = cb;
+    }
+
+    bool bodyTooLarge() const
+    {
+        return bodyTooLarge_;
+    }
+
+    /// The client waits for "100 Continue" before it sends the body.
+    bool expectContinue() const
+    {
+        return expectContinue_;
+    }
+
+    void continueSent()
+    {
+        expectContinue_ = false;
+    }
+
     bool gotAll() const
     {
         return state_ == kGotAll;
     }
+
+    /// Some bytes of the current message have been parsed.
+    bool started() const
+    {
+        return state_ != kExpectRequestLine;
+    }
+
+    /// "100 Continue" and the like, to be skipped, in kParseResponse.
+    bool interim() const
+    {
+        return statusCode_ >= 100 && statusCode_ < 200;
+    }
+
+    int statusCode() const
+    {
+        return statusCode_;
+    }
+
+    const string &statusMessage() const
+    {
+        return statusMessage_;
+    }
     //重置httpcontext状态
     void reset()
     {
         state_ = kExpectRequestLine; //重置为初始状态
-        HttpRequest dummy;
-        request_.swap(dummy); //将当前对象置空
+        bodyRemaining_ = 0;
+        bodySize_ = 0;
+        bodyTooLarge_ = false;
+        expectContinue_ = false;
+        statusCode_ = 0;
+        statusMessage_.clear();
+        noBody_ = false;
+        request_.reset(); //将当前对象置空，内存留给下一个请求
     }
 
+    /// Answers which wait for an earlier one, see HttpResponder.
+    bool hasPending() const
+    {
+        return !pending_.empty();
+    }
+
+    void addPending(const PendingPtr &pending)
+    {
+        pending_.push_back(pending);
+    }
+
+    /// Sends the answers at the front which are done, in the loop of conn.
+    void sendReady(const TcpConnectionPtr &conn);
+
     const HttpRequest &request() const
     {
         return request_;
@@ -67,9 +232,24 @@ public:
 
 private:
     bool processRequestLine(const char *begin, const char *end);
+    bool processStatusLine(const char *begin, const char *end);
+    bool processHeadersEnd();
+    bool processChunkSize(const char *begin, const char *end);
+    void consumeBody(Buffer *buf);
 
+    Mode mode_;
     HttpRequestParseState state_; //请求解析状态
     HttpRequest request_;         //http请求
+    size_t maxBodySize_;
+    BodyCallback bodyCallback_;   //流式接收实体，不保存整个实体
+    size_t bodyRemaining_;        //Content-Length或当前块还剩多少字节
+    size_t bodySize_;             //已经收到的实体字节数
+    bool bodyTooLarge_;
+    bool expectContinue_;
+    int statusCode_;              //kParseResponse的状态行
+    string statusMessage_;
+    bool noBody_;                 //HEAD的应答
+    std::deque<PendingPtr> pending_; //按请求顺序排队的应答，reset()不清空
 };
 
 } // namespace net
@@ -0,0 +1,406 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/http/HttpFileHandler.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponse.h"
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// An open file, shared by the cache and the responses still sending it.
+struct HttpFileHandler::File : noncopyable
+{
+    explicit File(int fileFd)
+        : fd(fileFd),
+          dev(0),
+          ino(0),
+          size(0),
+          mtime(0),
+          contentType(NULL),
+          checked(0)
+    {
+    }
+
+    ~File()
+    {
+        ::close(fd);
+    }
+
+    bool sameAs(const struct stat &st) const
+    {
+        return st.st_dev == dev && st.st_ino == ino &&
+               st.st_size == size && st.st_mtime == mtime;
+    }
+
+    const int fd;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    string etag;                                 //"\"mtime-size\""，和nginx一样
+    string lastModified;                         //"Sun, 06 Nov 1994 08:49:37 GMT"
+    const char *contentType;
+    std::shared_ptr<const string> content;       //小文件的内容
+    mutable std::atomic<int64_t> checked;        //上次stat的时间，秒
+};
+
+namespace
+{
+
+const char *contentTypeOf(const string &path)
+{
+    static const struct
+    {
+        const char *extension;
+        const char *type;
+    } kTypes[] = {
+        {".html", "text/html; charset=utf-8"},
+        {".htm", "text/html; charset=utf-8"},
+        {".css", "text/css"},
+        {".js", "application/javascript"},
+        {".json", "application/json"},
+        {".txt", "text/plain; charset=utf-8"},
+        {".xml", "application/xml"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".jpeg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".svg", "image/svg+xml"},
+        {".ico", "image/x-icon"},
+        {".webp", "image/webp"},
+        {".woff", "font/woff"},
+        {".woff2", "font/woff2"},
+        {".wasm", "application/wasm"},
+        {".pdf", "application/pdf"},
+    };
+    size_t dot = path.rfind('.');
+    if (dot != string::npos && path.find('/', dot) == string::npos)
+    {
+        for (const auto &t : kTypes)
+        {
+            if (::strcasecmp(path.c_str() + dot, t.extension) == 0)
+            {
+                return t.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+// no "..", no NUL, relative to the root
+bool safePath(const StringPiece &path)
+{
+    if (::memchr(path.data(), '\0', path.size()))
+    {
+        return false;
+    }
+    const char *p = path.data();
+    const char *end = p + path.size();
+    while (p < end)
+    {
+        const char *slash = static_cast<const char *>(::memchr(p, '/', end - p));
+        const char *segmentEnd = slash ? slash : end;
+        if (segmentEnd - p == 2 && p[0] == '.' && p[1] == '.')
+        {
+            return false;
+        }
+        p = segmentEnd + 1;
+    }
+    return true;
+}
+
+// "bytes=0-99", "bytes=100-", "bytes=-100", one range only,
+// returns false to ignore the header
+bool parseRange(const StringPiece &range, off_t size, off_t *first, off_t *last, bool *satisfiable)
+{
+    if (!range.starts_with("bytes=") || ::memchr(range.data(), ',', range.size()))
+    {
+        return false;
+    }
+    string spec(range.data() + 6, range.size() - 6);
+    const char *p = spec.c_str();
+    char *end = NULL;
+    *satisfiable = true;
+    if (*p == '-')
+    {
+        errno = 0;
+        long long suffix = ::strtoll(p + 1, &end, 10);
+        if (end == p + 1 || *end != '\0' || errno != 0 || suffix < 0)
+        {
+            return false;
+        }
+        *first = suffix < size ? size - suffix : 0;
+        *last = size - 1;
+        *satisfiable = suffix > 0 && size > 0;
+        return true;
+    }
+    errno = 0;
+    long long from = ::strtoll(p, &end, 10);
+    if (end == p || *end != '-' || errno != 0 || from < 0)
+    {
+        return false;
+    }
+    p = end + 1;
+    long long to = size - 1;
+    if (*p != '\0')
+    {
+        to = ::strtoll(p, &end, 10);
+        if (*end != '\0' || errno != 0 || to < from)
+        {
+            return false;
+        }
+    }
+    *first = from;
+    *last = to < size ? to : size - 1;
+    *satisfiable = from < size;
+    return true;
+}
+
+// If-None-Match: "a", "b" or *
+bool etagMatches(const StringPiece &ifNoneMatch, const string &etag)
+{
+    if (ifNoneMatch == "*")
+    {
+        return true;
+    }
+    const char *p = ifNoneMatch.data();
+    const char *end = p + ifNoneMatch.size();
+    while (p < end)
+    {
+        const char *comma = static_cast<const char *>(::memchr(p, ',', end - p));
+        const char *tagEnd = comma ? comma : end;
+        while (p < tagEnd && *p == ' ')
+        {
+            ++p;
+        }
+        if (p + 2 < tagEnd && p[0] == 'W' && p[1] == '/')
+        {
+            p += 2; //弱比较就够了
+        }
+        const char *q = tagEnd;
+        while (q > p && q[-1] == ' ')
+        {
+            --q;
+        }
+        if (StringPiece(p, static_cast<int>(q - p)) == etag)
+        {
+            return true;
+        }
+        p = tagEnd + 1;
+    }
+    return false;
+}
+
+string httpDate(time_t t)
+{
+    struct tm tm;
+    ::gmtime_r(&t, &tm);
+    char buf[64];
+    size_t len = ::strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return string(buf, len);
+}
+
+} // namespace
+
+HttpFileHandler::HttpFileHandler(const string &root, size_t maxOpenFiles)
+    : root_(root.empty() || root[root.size() - 1] != '/' ? root + "/" : root),
+      maxOpenFiles_(maxOpenFiles > 0 ? maxOpenFiles : 1),
+      memoryCacheSize_(0)
+{
+}
+
+HttpFileHandler::~HttpFileHandler() = default;
+
+HttpFileHandler::FilePtr HttpFileHandler::open(const string &path, Timestamp now)
+{
+    const int64_t seconds = now.secondsSinceEpoch();
+    FilePtr file;
+    {
+        MutexLockGuard lock(mutex_);
+        std::unordered_map<string, LruList::iterator>::iterator it = files_.find(path);
+        if (it != files_.end())
+        {
+            lru_.splice(lru_.begin(), lru_, it->second); //移到最前面
+            file = it->second->second;
+        }
+    }
+    if (file && file->checked.load(std::memory_order_relaxed) == seconds)
+    {
+        return file; //这一秒已经stat过了
+    }
+
+    const string fullPath = root_ + path;
+    struct stat st;
+    if (::stat(fullPath.c_str(), &st) == 0 && file && file->sameAs(st))
+    {
+        file->checked.store(seconds, std::memory_order_relaxed);
+        return file;
+    }
+
+    FilePtr opened;
+    int fd = ::open(fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+        std::shared_ptr<File> f(new File(fd));
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            f->dev = st.st_dev;
+            f->ino = st.st_ino;
+            f->size = st.st_size;
+            f->mtime = st.st_mtime;
+            char etag[64];
+            snprintf(etag, sizeof etag, "\"%lx-%llx\"",
+                     static_cast<unsigned long>(st.st_mtime),
+                     static_cast<unsigned long long>(st.st_size));
+            f->etag = etag;
+            f->lastModified = httpDate(st.st_mtime);
+            f->contentType = contentTypeOf(path);
+            f->checked.store(seconds, std::memory_order_relaxed);
+            if (static_cast<size_t>(st.st_size) <= memoryCacheSize_)
+            {
+                std::shared_ptr<string> content(new string(st.st_size, '\0'));
+                if (::pread(fd, &(*content)[0], content->size(), 0) == st.st_size)
+                {
+                    f->content = content;
+                }
+            }
+            opened = f;
+        }
+    }
+
+    MutexLockGuard lock(mutex_);
+    std::unordered_map<string, LruList::iterator>::iterator it = files_.find(path);
+    if (it != files_.end())
+    {
+        if (opened)
+        {
+            it->second->second = opened; //文件换过了
+        }
+        else
+        {
+            lru_.erase(it->second); //文件没了
+            files_.erase(it);
+        }
+    }
+    else if (opened)
+    {
+        lru_.push_front(std::make_pair(path, opened));
+        files_[path] = lru_.begin();
+        while (lru_.size() > maxOpenFiles_)
+        {
+            files_.erase(lru_.back().first); //还在发送的文件，等发完才关闭
+            lru_.pop_back();
+        }
+    }
+    return opened;
+}
+
+void HttpFileHandler::onRequest(const HttpRequest &req, HttpResponse *resp)
+{
+    serve(req, req.path(), resp);
+}
+
+void HttpFileHandler::serve(const HttpRequest &req, const StringPiece &path, HttpResponse *resp)
+{
+    if (req.method() != HttpRequest::kGet)
+    {
+        resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
+        resp->addHeader("Allow", "GET");
+        return;
+    }
+    StringPiece relative(path);
+    while (relative.starts_with("/"))
+    {
+        relative.remove_prefix(1);
+    }
+    if (!safePath(relative))
+    {
+        resp->setStatusCode(HttpResponse::k403Forbidden);
+        return;
+    }
+    string name = relative.as_string();
+    if (name.empty() || name[name.size() - 1] == '/')
+    {
+        name += "index.html";
+    }
+    Timestamp now = req.receiveTime().valid() ? req.receiveTime() : Timestamp::now();
+    FilePtr file = open(name, now);
+    if (!file)
+    {
+        resp->setStatusCode(HttpResponse::k404NotFound);
+        return;
+    }
+
+    resp->addHeader("ETag", file->etag);
+    resp->addHeader("Last-Modified", file->lastModified);
+    const StringPiece ifNoneMatch = req.header("If-None-Match");
+    if (ifNoneMatch.data() ? etagMatches(ifNoneMatch, file->etag)
+                           : req.header("If-Modified-Since") == file->lastModified)
+    {
+        resp->setStatusCode(HttpResponse::k304NotModified);
+        return;
+    }
+
+    resp->setContentType(file->contentType);
+    resp->addHeader("Accept-Ranges", "bytes");
+    off_t first = 0;
+    off_t last = file->size - 1;
+    bool satisfiable = true;
+    const StringPiece range = req.header("Range");
+    const StringPiece ifRange = req.header("If-Range");
+    if (range.data() && (!ifRange.data() || ifRange == file->etag) &&
+        parseRange(range, file->size, &first, &last, &satisfiable))
+    {
+        char contentRange[96];
+        if (!satisfiable)
+        {
+            snprintf(contentRange, sizeof contentRange, "bytes */%lld",
+                     static_cast<long long>(file->size));
+            resp->setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+            resp->addHeader("Content-Range", contentRange);
+            return;
+        }
+        snprintf(contentRange, sizeof contentRange, "bytes %lld-%lld/%lld",
+                 static_cast<long long>(first), static_cast<long long>(last),
+                 static_cast<long long>(file->size));
+        resp->setStatusCode(HttpResponse::k206PartialContent);
+        resp->addHeader("Content-Range", contentRange);
+    }
+    else
+    {
+        resp->setStatusCode(HttpResponse::k200Ok);
+    }
+
+    size_t count = static_cast<size_t>(last - first + 1);
+    if (file->content && count == file->content->size())
+    {
+        resp->setBody(file->content);
+    }
+    else if (file->content)
+    {
+        resp->setBody(file->content->substr(first, count));
+    }
+    else
+    {
+        resp->setBodyFile(file->fd, first, count, file);
+    }
+}
@@ -0,0 +1,82 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPFILEHANDLER_H
+#define MUDUO_NET_HTTP_HTTPFILEHANDLER_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Timestamp.h"
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpRequest;
+class HttpResponse;
+
+/// Serves the files under a directory, for GET requests.
+///
+/// Keeps an LRU cache of open files with their stat(2), checked again at
+/// most once a second, so "304 Not Modified" for If-None-Match or
+/// If-Modified-Since takes no system call. Bodies go out with sendfile(2)
+/// after the head, files up to setMemoryCacheSize() are kept in memory and
+/// sent by reference instead. One "Range: bytes=" range is answered with
+/// "206 Partial Content".
+///
+/// Thread safe, one handler can serve all the io threads of an HttpServer.
+class HttpFileHandler : noncopyable
+{ //静态文件
+public:
+    static const size_t kDefaultMaxOpenFiles = 1024;
+
+    explicit HttpFileHandler(const string &root,
+                             size_t maxOpenFiles = kDefaultMaxOpenFiles);
+    ~HttpFileHandler();
+
+    /// Files up to @c bytes are read once and kept with the open file,
+    /// 0 by default, ie. always sendfile(2).
+    void setMemoryCacheSize(size_t bytes)
+    {
+        memoryCacheSize_ = bytes;
+    }
+
+    /// For HttpServer::setHttpCallback(), serves req.path().
+    void onRequest(const HttpRequest &req, HttpResponse *resp);
+
+    /// @c path under the root, eg. the "*file" parameter of an HttpRouter
+    /// route. A path ending with '/' means its "index.html".
+    void serve(const HttpRequest &req, const StringPiece &path, HttpResponse *resp);
+
+    struct File; // internal
+
+private:
+    typedef std::shared_ptr<const File> FilePtr;
+    typedef std::list<std::pair<string, FilePtr>> LruList;
+
+    FilePtr open(const string &path, Timestamp now);
+
+    const string root_;
+    const size_t maxOpenFiles_;
+    size_t memoryCacheSize_;
+    MutexLock mutex_;
+    LruList lru_ GUARDED_BY(mutex_);   //最近用过的在前面
+    std::unordered_map<string, LruList::iterator> files_ GUARDED_BY(mutex_);
+};
+
+} // namespace net
+} // namespace muduo
+
+#endif // MUDUO_NET_HTTP_HTTPFILEHANDLER_H
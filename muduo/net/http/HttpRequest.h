@@ -12,18 +12,26 @@
 #define MUDUO_NET_HTTP_HTTPREQUEST_H
 
 #include "muduo/base/copyable.h"
+#include "muduo/base/StringPiece.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/base/Types.h"
 
 #include <map>
+#include <memory>
+#include <vector>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+#include <strings.h>
 
 namespace muduo
 {//http请求类封装
 namespace net
 {
 
+/// Headers are kept in one string, indexed by a flat vector, and the
+/// memory is reused by the next request on the connection, see reset().
+/// Parsing a request allocates nothing once the connection is warm.
 class HttpRequest : public muduo::copyable
 {
  public:
@@ -53,7 +61,7 @@ class HttpRequest : public muduo::copyable
   bool setMethod(const char* start, const char* end)
   {
     assert(method_ == kInvalid);
-    string m(start, end);//根据这个字符串来判断
+    StringPiece m(start, static_cast<int>(end - start));//根据这个字符串来判断，不必构造string
     if (m == "GET")
     {
       method_ = kGet;
@@ -134,36 +142,86 @@ class HttpRequest : public muduo::copyable
 
     void addHeader(const char *start, const char *colon, const char *end)
     {                                    //添加一个头部信息
-        string field(start, colon); //header域
-        ++colon;
+        const char *value = colon + 1;
         //去除左空格
-        while (colon < end && isspace(*colon)) //header值
+        while (value < end && isspace(*value)) //header值
         {
-            ++colon;
+            ++value;
         }
-        string value(colon, end);
         //去除右空格
-        while (!value.empty() && isspace(value[value.size() - 1]))
+        while (end > value && isspace(end[-1]))
         {
-            value.resize(value.size() - 1);
+            --end;
         }
-        headers_[field] = value; //将value的值保存到headers
+        HeaderIndex index;
+        index.field = static_cast<uint32_t>(fields_.size());
+        index.fieldLen = static_cast<uint32_t>(colon - start);
+        fields_.append(start, colon); //header域
+        index.value = static_cast<uint32_t>(fields_.size());
+        index.valueLen = static_cast<uint32_t>(end - value);
+        fields_.append(value, end);
+        headerIndex_.push_back(index);
+        headerMap_.reset();
     }
 
+  /// Field names are case-insensitive, the last one wins.
+  /// Points into the request, data() is NULL if there is no such header.
+  StringPiece header(const StringPiece& field) const
+  {
+    for (size_t i = headerIndex_.size(); i > 0; --i)
+    {
+      const HeaderIndex& index = headerIndex_[i - 1];
+      if (index.fieldLen == static_cast<uint32_t>(field.size()) &&
+          ::strncasecmp(fields_.data() + index.field, field.data(), index.fieldLen) == 0)
+      {
+        return StringPiece(fields_.data() + index.value, static_cast<int>(index.valueLen));
+      }
+    }
+    return StringPiece();
+  }
+
+  size_t headerCount() const
+  { return headerIndex_.size(); }
+
+  StringPiece headerField(size_t i) const
+  {
+    const HeaderIndex& index = headerIndex_[i];
+    return StringPiece(fields_.data() + index.field, static_cast<int>(index.fieldLen));
+  }
+
+  StringPiece headerValue(size_t i) const
+  {
+    const HeaderIndex& index = headerIndex_[i];
+    return StringPiece(fields_.data() + index.value, static_cast<int>(index.valueLen));
+  }
 
   string getHeader(const string& field) const//根据头域返回值
   {
-    string result;
-    std::map<string, string>::const_iterator it = headers_.find(field);
-    if (it != headers_.end())
+    return header(field).as_string();
+  }
+
+  /// Builds a map on the first call, prefer header() and headerField().
+  const std::map<string, string>& headers() const
+  {
+    if (!headerMap_)
     {
-      result = it->second;
+      headerMap_.reset(new std::map<string, string>);
+      for (size_t i = 0; i < headerIndex_.size(); ++i)
+      {
+        (*headerMap_)[headerField(i).as_string()] = headerValue(i).as_string();
+      }
     }
-    return result;
+    return *headerMap_;
   }
 
-  const std::map<string, string>& headers() const
-  { return headers_; }
+  void appendBody(const char* start, const char* end)
+  {
+    body_.append(start, end);
+  }
+
+  // empty if HttpServer::setHttpBodyCallback() is used
+  const string& body() const
+  { return body_; }
 
   void swap(HttpRequest& that)//交换数据成员
   {
@@ -172,16 +230,50 @@ class HttpRequest : public muduo::copyable
     path_.swap(that.path_);
     query_.swap(that.query_);
     receiveTime_.swap(that.receiveTime_);
-    headers_.swap(that.headers_);
+    fields_.swap(that.fields_);
+    headerIndex_.swap(that.headerIndex_);
+    headerMap_.swap(that.headerMap_);
+    body_.swap(that.body_);
+  }
+
+  /// Forgets the request, but keeps the memory for the next one.
+  void reset()
+  {
+    method_ = kInvalid;
+    version_ = kUnknown;
+    path_.clear();
+    query_.clear();
+    receiveTime_ = Timestamp();
+    fields_.clear();
+    headerIndex_.clear();
+    headerMap_.reset();
+    if (body_.capacity() > kMaxKeptBody)
+    {
+      string().swap(body_); //大的实体不保留
+    }
+    body_.clear();
   }
 
  private:
+    struct HeaderIndex
+    {
+      uint32_t field;    // offset in fields_
+      uint32_t fieldLen;
+      uint32_t value;
+      uint32_t valueLen;
+    };
+
+    static const size_t kMaxKeptBody = 64 * 1024;
+
     Method method_;    //请求方法
     Version version_;  //协议版本1.0/1.1
     string path_; //请求路径
     string query_;
     Timestamp receiveTime_;                      //请求时间
-    std::map<string, string> headers_; //header列表
+    string fields_;                          //所有header域和值，一个接一个
+    std::vector<HeaderIndex> headerIndex_;   //header列表，按到达的顺序
+    mutable std::shared_ptr<std::map<string, string>> headerMap_; // for headers()
+    string body_;                      //实体，不超过HttpContext的maxBodySize
 };
 
 }  // namespace net
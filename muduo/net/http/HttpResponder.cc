@@ -0,0 +1,75 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/http/HttpResponder.h"
+
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/http/HttpContext.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+HttpResponder::Pending::~Pending()
+{
+    if (cache)
+    {
+        cache->abandon(cacheKey); //等着这个应答的请求自己渲染
+    }
+}
+
+void HttpResponder::Pending::finish()
+{
+    close = response.closeConnection();
+    if (compressor)
+    {
+        compressor->compress(encoding, &response);
+    }
+    if (cache)
+    {
+        cache->fill(cacheKey, response);
+        cache.reset();
+    }
+    if (response.hasBodyByReference())
+    {
+        response.appendHeadToBuffer(&output);
+    }
+    else
+    {
+        response.appendToBuffer(&output);
+    }
+}
+
+void HttpResponder::Pending::setEntry(const HttpResponseCache::EntryPtr &entry, Timestamp date)
+{
+    output.append(entry->statusLine);
+    HttpResponse::appendConnectionHead(&output, close, date);
+    response.setBody(entry->rest); //sendReady()按引用发送
+}
+
+HttpResponse *HttpResponder::response() const
+{
+    return &pending_->response;
+}
+
+void HttpResponder::done() const
+{
+    TcpConnectionPtr conn = pending_->conn.lock();
+    if (!conn)
+    {
+        return; //连接已经断开
+    }
+    pending_->finish(); //在调用者的线程中序列化
+    std::shared_ptr<Pending> pending = pending_;
+    // queued even in the loop thread, after what onMessage() sends
+    conn->getLoop()->queueInLoop([conn, pending]
+        {
+            pending->ready = true;
+            std::any_cast<HttpContext>(conn->getMutableContext())->sendReady(conn);
+        });
+}
@@ -0,0 +1,53 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPRESPONDER_H
+#define MUDUO_NET_HTTP_HTTPRESPONDER_H
+
+#include "muduo/base/copyable.h"
+
+#include <memory>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpResponse;
+
+/// The answer to one request of HttpServer::setAsyncHttpCallback().
+/// Fill in response(), then call done() once, from any thread, eg. from
+/// a ThreadPool task. The server sends it in its io loop, after the
+/// answers to the earlier requests on the same connection.
+/// If the connection is gone by then, done() does nothing.
+class HttpResponder : public muduo::copyable
+{ //异步处理http请求时，交给用户的应答句柄
+public:
+    struct Pending; // internal
+
+    explicit HttpResponder(const std::shared_ptr<Pending> &pending)
+        : pending_(pending)
+    {
+    }
+
+    // default copy-ctor, dtor and assignment are fine
+
+    HttpResponse *response() const;
+
+    void done() const; //应答已填好，交给io线程发送
+
+private:
+    std::shared_ptr<Pending> pending_;
+};
+
+} // namespace net
+} // namespace muduo
+
+#endif // MUDUO_NET_HTTP_HTTPRESPONDER_H
@@ -8,21 +8,184 @@
 //
 
 #include "muduo/net/http/HttpResponse.h"
+#include "muduo/base/Logging.h"
 #include "muduo/net/Buffer.h"
+#include "muduo/net/TcpConnection.h"
 
-#include <stdio.h>
+#include <algorithm>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
-void HttpResponse::appendToBuffer(Buffer *output) const
+namespace
+{
+
+// "HTTP/1.1 200 OK\r\n", empty if not precomputed
+StringPiece statusLine(HttpResponse::HttpStatusCode code)
+{
+    switch (code)
+    {
+    case HttpResponse::k200Ok:
+        return "HTTP/1.1 200 OK\r\n";
+    case HttpResponse::k204NoContent:
+        return "HTTP/1.1 204 No Content\r\n";
+    case HttpResponse::k206PartialContent:
+        return "HTTP/1.1 206 Partial Content\r\n";
+    case HttpResponse::k301MovedPermanently:
+        return "HTTP/1.1 301 Moved Permanently\r\n";
+    case HttpResponse::k302Found:
+        return "HTTP/1.1 302 Found\r\n";
+    case HttpResponse::k304NotModified:
+        return "HTTP/1.1 304 Not Modified\r\n";
+    case HttpResponse::k400BadRequest:
+        return "HTTP/1.1 400 Bad Request\r\n";
+    case HttpResponse::k403Forbidden:
+        return "HTTP/1.1 403 Forbidden\r\n";
+    case HttpResponse::k404NotFound:
+        return "HTTP/1.1 404 Not Found\r\n";
+    case HttpResponse::k405MethodNotAllowed:
+        return "HTTP/1.1 405 Method Not Allowed\r\n";
+    case HttpResponse::k413PayloadTooLarge:
+        return "HTTP/1.1 413 Payload Too Large\r\n";
+    case HttpResponse::k416RangeNotSatisfiable:
+        return "HTTP/1.1 416 Range Not Satisfiable\r\n";
+    case HttpResponse::k500InternalServerError:
+        return "HTTP/1.1 500 Internal Server Error\r\n";
+    case HttpResponse::k503ServiceUnavailable:
+        return "HTTP/1.1 503 Service Unavailable\r\n";
+    default:
+        return StringPiece();
+    }
+}
+
+// returns the length, buf has room for 20 digits
+size_t formatUnsigned(char *buf, uint64_t value)
+{
+    char *p = buf;
+    do
+    {
+        *p++ = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    std::reverse(buf, p);
+    return p - buf;
+}
+
+// "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n", one per second per thread
+struct DateLine
+{
+    int64_t seconds;
+    char line[64];
+    size_t len;
+};
+
+__thread DateLine t_date = {-1, {0}, 0};
+
+void appendDate(Buffer *output, Timestamp when)
+{
+    int64_t seconds = when.secondsSinceEpoch();
+    if (seconds != t_date.seconds)
+    {
+        time_t t = static_cast<time_t>(seconds);
+        struct tm tm;
+        ::gmtime_r(&t, &tm);
+        t_date.len = ::strftime(t_date.line, sizeof t_date.line,
+                                "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        t_date.seconds = seconds;
+    }
+    output->append(t_date.line, t_date.len);
+}
+
+} // namespace
+
+void HttpResponse::reset(bool close)
+{
+    statusCode_ = kUnknown;
+    statusMessage_.clear();
+    closeConnection_ = close;
+    headers_.clear();
+    date_ = Timestamp();
+    body_.clear();
+    if (body_.capacity() > kMaxKeptBody)
+    {
+        string().swap(body_); //大的实体不保留
+    }
+    bodyBlock_.reset();
+    bodyFile_.reset();
+    bodyFd_ = -1;
+}
+
+// a few headers only, look for "key:" at the start of each line
+size_t HttpResponse::findHeader(const StringPiece &key) const
+{
+    size_t line = 0;
+    while (line < headers_.size())
+    {
+        size_t next = headers_.find('\n', line) + 1;
+        if (next - line > static_cast<size_t>(key.size()) &&
+            headers_[line + key.size()] == ':' &&
+            ::strncasecmp(headers_.data() + line, key.data(), key.size()) == 0)
+        {
+            return line;
+        }
+        line = next;
+    }
+    return string::npos;
+}
+
+StringPiece HttpResponse::header(const StringPiece &key) const
+{
+    size_t line = findHeader(key);
+    if (line == string::npos)
+    {
+        return StringPiece();
+    }
+    size_t value = line + key.size() + 2; //"key: value\r\n"
+    return StringPiece(headers_.data() + value,
+                       static_cast<int>(headers_.find('\r', value) - value));
+}
+
+void HttpResponse::addHeader(const StringPiece &key, const StringPiece &value)
+{
+    size_t line = findHeader(key);
+    if (line != string::npos)
+    {
+        headers_.erase(line, headers_.find('\n', line) + 1 - line);
+    }
+    headers_.append(key.data(), key.size());
+    headers_.append(": ");
+    headers_.append(value.data(), value.size());
+    headers_.append("\r\n");
+}
+
+void HttpResponse::appendStatusLine(Buffer *output) const
+{
+    StringPiece line = statusLine(statusCode_); //添加响应头，常见的状态行是预先生成的
+    if (line.size() > 0 &&
+        (statusMessage_.empty() ||
+         StringPiece(statusMessage_) == StringPiece(line.data() + 13, line.size() - 15)))
+    {
+        output->append(line.data(), line.size());
+    }
+    else
+    {
+        char buf[32];
+        output->append("HTTP/1.1 ");
+        output->append(buf, formatUnsigned(buf, statusCode_));
+        output->append(" ");
+        output->append(statusMessage_);
+        output->append("\r\n");
+    }
+}
+
+void HttpResponse::appendHeadToBuffer(Buffer *output) const
 {
     //http响应类的封装
-    char buf[32]; //添加响应头
-    snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
-    output->append(buf);
-    output->append(statusMessage_);
-    output->append("\r\n");
+    appendStatusLine(output);
 
     if (closeConnection_)
     {
@@ -30,21 +193,97 @@ void HttpResponse::appendToBuffer(Buffer *output) const
         //短连接不需要告诉包的长度，因为他处理完直接就断开了，所以不存在粘包问题
         output->append("Connection: close\r\n");
     }
+    else if (statusCode_ == k204NoContent || statusCode_ == k304NotModified)
+    {
+        output->append("Connection: Keep-Alive\r\n"); //没有body，也不能有Content-Length
+    }
     else
     {
-        snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size()); //如果是长连接才需要这一行头部信息，来说明包的实体长度
-        output->append(buf);
-        output->append("Connection: Keep-Alive\r\n"); //长连接的标志
+        char buf[32];
+        output->append("Content-Length: "); //如果是长连接才需要这一行头部信息，来说明包的实体长度
+        output->append(buf, formatUnsigned(buf, bodySize()));
+        output->append("\r\nConnection: Keep-Alive\r\n"); //长连接的标志
+    }
+    if (date_.valid())
+    {
+        appendDate(output, date_);
     }
     //header列表
-    for (const auto &header : headers_)
+    output->append(headers_);
+
+    output->append("\r\n"); //header与body之间的空行
+}
+
+void HttpResponse::appendToBuffer(Buffer *output) const
+{
+    appendHeadToBuffer(output);
+    if (bodyBlock_)
+    {
+        output->append(*bodyBlock_);
+    }
+    else if (bodyFd_ >= 0)
+    {
+        // a copy after all, sendBody() does not copy
+        output->ensureWritableBytes(bodyFileSize_);
+        off_t offset = bodyFileOffset_;
+        size_t count = bodyFileSize_;
+        while (count > 0)
+        {
+            ssize_t n = ::pread(bodyFd_, output->beginWrite(), count, offset);
+            if (n <= 0)
+            {
+                LOG_SYSERR << "HttpResponse::appendToBuffer";
+                break;
+            }
+            output->hasWritten(n);
+            offset += n;
+            count -= n;
+        }
+    }
+    else
+    {
+        output->append(body_);
+    }
+}
+
+void HttpResponse::appendSharedPart(Buffer *output) const
+{
+    if (statusCode_ != k204NoContent && statusCode_ != k304NotModified)
     {
-        output->append(header.first);
-        output->append(": ");
-        output->append(header.second);
+        char buf[32];
+        output->append("Content-Length: "); //连接关闭时也带上，同一份字节给所有应答
+        output->append(buf, formatUnsigned(buf, bodySize()));
         output->append("\r\n");
     }
+    output->append(headers_);
+    output->append("\r\n");
+    if (bodyBlock_)
+    {
+        output->append(*bodyBlock_);
+    }
+    else
+    {
+        output->append(body_);
+    }
+}
+
+void HttpResponse::appendConnectionHead(Buffer *output, bool close, Timestamp date)
+{
+    output->append(close ? "Connection: close\r\n" : "Connection: Keep-Alive\r\n");
+    if (date.valid())
+    {
+        appendDate(output, date);
+    }
+}
 
-    output->append("\r\n"); //header与body之间的空行
-    output->append(body_);
+void HttpResponse::sendBody(const TcpConnectionPtr &conn) const
+{
+    if (bodyBlock_)
+    {
+        conn->send(bodyBlock_);
+    }
+    else if (bodyFd_ >= 0)
+    {
+        conn->sendFile(bodyFd_, bodyFileOffset_, bodyFileSize_, bodyFile_);
+    }
 }
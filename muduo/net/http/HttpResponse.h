@@ -12,9 +12,13 @@
 #define MUDUO_NET_HTTP_HTTPRESPONSE_H
 
 #include "muduo/base/copyable.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Timestamp.h"
 #include "muduo/base/Types.h"
+#include "muduo/net/Callbacks.h"
 
-#include <map>
+#include <memory>
+#include <sys/types.h>
 
 namespace muduo
 {
@@ -22,6 +26,10 @@ namespace net
 {
 
 class Buffer;
+
+/// Headers are kept as the lines they are sent as, and the status lines
+/// of the codes below are precomputed, so serializing allocates nothing.
+/// HttpServer reuses one response per thread.
 class HttpResponse : public muduo::copyable
 { //http响应类的封装
 public:
@@ -29,25 +37,42 @@ public:
     {
         kUnknown,                   //还有很多没实现
         k200Ok = 200,               //成功
+        k204NoContent = 204,
+        k206PartialContent = 206,
         k301MovedPermanently = 301, //错误重定向，请求的页面永久转移到另一个地址
+        k302Found = 302,
+        k304NotModified = 304,
         k400BadRequest = 400,       //错误的请求，语法格式有问题，服务器无法处理此请求
+        k403Forbidden = 403,
         k404NotFound = 404,         //请求的网页不存在
+        k405MethodNotAllowed = 405,
+        k413PayloadTooLarge = 413,
+        k416RangeNotSatisfiable = 416,
+        k500InternalServerError = 500,
+        k503ServiceUnavailable = 503,
     };
 
     explicit HttpResponse(bool close)
         : statusCode_(kUnknown),
-          closeConnection_(close)
+          closeConnection_(close),
+          bodyFd_(-1),
+          bodyFileOffset_(0),
+          bodyFileSize_(0)
     {
     }
 
+    /// Forgets the response, but keeps the memory for the next one.
+    void reset(bool close);
+
     void setStatusCode(HttpStatusCode code)
     {
         statusCode_ = code;
     }
 
-    void setStatusMessage(const string &message)
+    /// Optional for the codes above.
+    void setStatusMessage(const StringPiece &message)
     {
-        statusMessage_ = message;
+        statusMessage_.assign(message.data(), message.size());
     }
 
     void setCloseConnection(bool on)
@@ -60,31 +85,129 @@ public:
         return closeConnection_;
     }
     //设置文档媒体类型
-    void setContentType(const string &contentType)
+    void setContentType(const StringPiece &contentType)
     {
         addHeader("Content-Type", contentType);
     }
 
-    // FIXME: replace string with StringPiece
-    void addHeader(const string &key, const string &value)
+    /// Replaces an earlier header of the same field.
+    void addHeader(const StringPiece &key, const StringPiece &value);
+
+    /// data() is NULL if there is no such header.
+    StringPiece header(const StringPiece &key) const;
+
+    /// Adds "Date:", formatted once a second per thread.
+    void setDate(Timestamp when)
     {
-        headers_[key] = value;
+        date_ = when;
     }
 
     void setBody(const string &body)
     {
         body_ = body;
+        bodyBlock_.reset();
+        bodyFile_.reset();
+        bodyFd_ = -1;
+    }
+
+    void setBody(string &&body)
+    {
+        body_ = std::move(body);
+        bodyBlock_.reset();
+        bodyFile_.reset();
+        bodyFd_ = -1;
+    }
+
+    /// Copies, keeping the memory of the previous body.
+    void setBody(const char *data, size_t len)
+    {
+        body_.assign(data, len);
+        bodyBlock_.reset();
+        bodyFile_.reset();
+        bodyFd_ = -1;
+    }
+
+    /// Sent by reference, see TcpConnection::send(const std::shared_ptr<const string>&).
+    void setBody(const std::shared_ptr<const string> &body)
+    {
+        body_.clear();
+        bodyBlock_ = body;
+        bodyFile_.reset();
+        bodyFd_ = -1;
+    }
+
+    /// Sent with sendfile(2), see TcpConnection::sendFile().
+    /// @c owner may be NULL if the caller keeps @c fd open.
+    void setBodyFile(int fd, off_t offset, size_t count,
+                     const std::shared_ptr<const void> &owner)
+    {
+        body_.clear();
+        bodyBlock_.reset();
+        bodyFile_ = owner;
+        bodyFd_ = fd;
+        bodyFileOffset_ = offset;
+        bodyFileSize_ = count;
+    }
+
+    const std::shared_ptr<const string> &bodyBlock() const
+    {
+        return bodyBlock_;
+    }
+
+    /// A bodyBlock() or a file, sent with sendBody().
+    bool hasBodyByReference() const
+    {
+        return bodyBlock_ || bodyFd_ >= 0;
     }
 
     void appendToBuffer(Buffer *output) const; //将httpresponse添加到buffer
+    /// Without the body if hasBodyByReference().
+    void appendHeadToBuffer(Buffer *output) const;
+    /// After appendHeadToBuffer() has been sent, in the loop of @c conn.
+    void sendBody(const TcpConnectionPtr &conn) const;
+
+    /// For HttpResponseCache, which serializes a response once and sends
+    /// it in three parts: appendStatusLine(), appendConnectionHead() for
+    /// each answer, and appendSharedPart(). File bodies are left out.
+    void appendStatusLine(Buffer *output) const;
+    /// "Content-Length", the headers, the blank line and the body.
+    void appendSharedPart(Buffer *output) const;
+    /// "Connection" and "Date", what differs from answer to answer.
+    static void appendConnectionHead(Buffer *output, bool close, Timestamp date);
+
+    HttpStatusCode statusCode() const
+    {
+        return statusCode_;
+    }
+
+    /// In memory, ie. body() or bodyBlock().
+    StringPiece body() const
+    {
+        return bodyBlock_ ? StringPiece(*bodyBlock_) : bodyFd_ >= 0 ? StringPiece() : StringPiece(body_);
+    }
+
+    size_t bodySize() const
+    {
+        return bodyBlock_ ? bodyBlock_->size() : bodyFd_ >= 0 ? bodyFileSize_ : body_.size();
+    }
 
 private:
-    std::map<string, string> headers_; //header列表
+    static const size_t kMaxKeptBody = 64 * 1024;
+
+    size_t findHeader(const StringPiece &key) const;
+
     HttpStatusCode statusCode_;        //状态响应码
     // FIXME: add http version
-    string statusMessage_; //状态响应码对应的文本信息
+    string statusMessage_; //状态响应码对应的文本信息，空的话用预先生成的
     bool closeConnection_; //是否关闭连接
+    string headers_;       //header列表，"field: value\r\n"一行接一行
+    Timestamp date_;
     string body_;          //实体
+    std::shared_ptr<const string> bodyBlock_; //按引用发送的实体
+    std::shared_ptr<const void> bodyFile_;    //用sendfile发送的实体，保证bodyFd_打开着，可以为空
+    int bodyFd_;
+    off_t bodyFileOffset_;
+    size_t bodyFileSize_;
 };
 
 } // namespace net
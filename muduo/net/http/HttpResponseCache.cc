@@ -0,0 +1,219 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/http/HttpResponseCache.h"
+
+#include "muduo/net/Buffer.h"
+#include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponse.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// "no-store, max-age=60", case-insensitive
+bool hasDirective(const StringPiece &cacheControl, const char *directive)
+{
+    const size_t len = ::strlen(directive);
+    for (int i = 0; i + static_cast<int>(len) <= cacheControl.size(); ++i)
+    {
+        if (::strncasecmp(cacheControl.data() + i, directive, len) == 0 &&
+            (i == 0 || cacheControl[i - 1] == ' ' || cacheControl[i - 1] == ','))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// seconds to keep resp, 0 if it cannot be kept
+double ttlOf(const HttpResponse &resp, double ttlSeconds)
+{
+    HttpResponse::HttpStatusCode code = resp.statusCode();
+    if (code != HttpResponse::k200Ok && code != HttpResponse::k301MovedPermanently &&
+        code != HttpResponse::k404NotFound)
+    {
+        return 0;
+    }
+    if ((resp.hasBodyByReference() && !resp.bodyBlock()) || resp.header("Set-Cookie").data())
+    {
+        return 0; //文件有自己的缓存，cookie不能给别人
+    }
+    const StringPiece cacheControl = resp.header("Cache-Control");
+    if (hasDirective(cacheControl, "no-store") || hasDirective(cacheControl, "no-cache") ||
+        hasDirective(cacheControl, "private"))
+    {
+        return 0;
+    }
+    for (int i = 0; i + 8 <= cacheControl.size(); ++i)
+    {
+        if (::strncasecmp(cacheControl.data() + i, "max-age=", 8) == 0)
+        {
+            return ::atoi(cacheControl.data() + i + 8); //后面是"\r\n"，atoi会停下
+        }
+    }
+    return ttlSeconds;
+}
+
+size_t sizeOf(const string &key, const HttpResponseCache::Entry &entry)
+{
+    return key.size() + entry.statusLine.size() + (entry.rest ? entry.rest->size() : 0);
+}
+
+} // namespace
+
+const double HttpResponseCache::kUncacheableSeconds = 1.0;
+
+HttpResponseCache::HttpResponseCache(double ttlSeconds, size_t maxBytes)
+    : ttlSeconds_(ttlSeconds),
+      maxBytes_(maxBytes),
+      bytes_(0)
+{
+    keyHeaders_.push_back("Accept-Encoding");
+}
+
+HttpResponseCache::~HttpResponseCache() = default;
+
+HttpResponseCache::Result HttpResponseCache::lookup(const HttpRequest &req, Timestamp now,
+                                                    string *key, EntryPtr *entry)
+{
+    if (req.method() != HttpRequest::kGet || req.header("Range").data() ||
+        req.header("If-None-Match").data() || req.header("If-Modified-Since").data() ||
+        req.header("Authorization").data() || req.header("Cookie").data())
+    {
+        return kUncacheable;
+    }
+    key->assign(req.path()); //调用者的key可以复用内存
+    key->append(req.query());
+    for (const string &field : keyHeaders_)
+    {
+        const StringPiece value = req.header(field);
+        key->push_back('\n'); //header里不会有换行
+        key->append(value.data(), value.size());
+    }
+
+    MutexLockGuard lock(mutex_);
+    std::unordered_map<string, LruList::iterator>::iterator it = entries_.find(*key);
+    if (it != entries_.end())
+    {
+        if (now < it->second->second->expires)
+        {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            if (!it->second->second->rest)
+            {
+                return kUncacheable; //刚渲染过，不能缓存
+            }
+            *entry = it->second->second;
+            return kHit;
+        }
+        eraseLocked(it); //过期了
+    }
+    if (flights_.find(*key) != flights_.end())
+    {
+        return kBusy;
+    }
+    flights_[*key]; //由这个请求来渲染
+    return kMiss;
+}
+
+bool HttpResponseCache::wait(const string &key, const Waiter &waiter)
+{
+    MutexLockGuard lock(mutex_);
+    std::unordered_map<string, std::vector<Waiter>>::iterator it = flights_.find(key);
+    if (it == flights_.end())
+    {
+        return false;
+    }
+    it->second.push_back(waiter);
+    return true;
+}
+
+void HttpResponseCache::fill(const string &key, const HttpResponse &resp)
+{
+    const double ttl = ttlOf(resp, ttlSeconds_);
+    std::shared_ptr<Entry> entry(new Entry);
+    if (ttl > 0)
+    {
+        Buffer buf;
+        resp.appendStatusLine(&buf);
+        entry->statusLine = buf.retrieveAllAsString();
+        resp.appendSharedPart(&buf);
+        entry->rest.reset(new string(buf.peek(), buf.readableBytes()));
+        entry->expires = addTime(Timestamp::now(), ttl);
+    }
+    else
+    {
+        entry->expires = addTime(Timestamp::now(), kUncacheableSeconds); //只是标记
+    }
+    finish(key, entry);
+}
+
+void HttpResponseCache::abandon(const string &key)
+{
+    finish(key, EntryPtr());
+}
+
+void HttpResponseCache::finish(const string &key, const EntryPtr &entry)
+{
+    std::vector<Waiter> waiters;
+    {
+        MutexLockGuard lock(mutex_);
+        std::unordered_map<string, std::vector<Waiter>>::iterator flight = flights_.find(key);
+        if (flight != flights_.end())
+        {
+            waiters.swap(flight->second);
+            flights_.erase(flight);
+        }
+        if (entry)
+        {
+            std::unordered_map<string, LruList::iterator>::iterator it = entries_.find(key);
+            if (it != entries_.end())
+            {
+                eraseLocked(it);
+            }
+            lru_.push_front(std::make_pair(key, entry));
+            entries_[key] = lru_.begin();
+            bytes_ += sizeOf(key, *entry);
+            while (bytes_ > maxBytes_ && !lru_.empty())
+            {
+                eraseLocked(entries_.find(lru_.back().first));
+            }
+        }
+    }
+    const EntryPtr answer = entry && entry->rest ? entry : EntryPtr();
+    for (const Waiter &waiter : waiters)
+    {
+        waiter(answer); //不在锁里，等待者要切换到自己的io线程
+    }
+}
+
+void HttpResponseCache::eraseLocked(std::unordered_map<string, LruList::iterator>::iterator it)
+{
+    bytes_ -= sizeOf(it->first, *it->second->second);
+    lru_.erase(it->second);
+    entries_.erase(it);
+}
+
+size_t HttpResponseCache::bytes() const
+{
+    MutexLockGuard lock(mutex_);
+    return bytes_;
+}
+
+size_t HttpResponseCache::entries() const
+{
+    MutexLockGuard lock(mutex_);
+    return entries_.size();
+}
@@ -0,0 +1,118 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPRESPONSECACHE_H
+#define MUDUO_NET_HTTP_HTTPRESPONSECACHE_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/base/Timestamp.h"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpRequest;
+class HttpResponse;
+
+/// Rendered responses of GET requests, for HttpServer::setResponseCache().
+///
+/// Keyed by path, query and setKeyHeaders(). An entry is serialized once,
+/// hits send its bytes by reference, only "Connection:" and "Date:" are
+/// written per answer. Entries expire after the ttl, or the max-age of
+/// "Cache-Control", and the least recently used go first beyond maxBytes.
+/// While one request renders an entry, the same requests wait for it
+/// instead of calling the handler too.
+///
+/// 200, 301 and 404 answers are kept, unless they set cookies, say
+/// "Cache-Control: no-store", "no-cache" or "private", or are files.
+/// An answer that is not kept leaves a marker for kUncacheableSeconds,
+/// so the same requests meanwhile render on their own instead of
+/// waiting for each other. Conditional, range, authorized requests and
+/// those with cookies bypass the cache.
+///
+/// Thread safe, shared by all the io threads.
+class HttpResponseCache : noncopyable
+{ //渲染好的应答的缓存
+public:
+    static const size_t kDefaultMaxBytes = 64 * 1024 * 1024;
+    static const double kUncacheableSeconds;
+
+    struct Entry
+    {
+        string statusLine;                  //"HTTP/1.1 200 OK\r\n"
+        std::shared_ptr<const string> rest; //Content-Length，header列表，空行和实体，NULL表示不能缓存的标记
+        Timestamp expires;
+    };
+    typedef std::shared_ptr<const Entry> EntryPtr;
+    /// Called with the entry, or NULL if the answer could not be kept,
+    /// in the thread that rendered it.
+    typedef std::function<void(const EntryPtr &)> Waiter;
+
+    enum Result
+    {
+        kUncacheable,
+        kHit,         //*entry
+        kMiss,        //render, then fill()
+        kBusy,        //another request renders it, wait()
+    };
+
+    explicit HttpResponseCache(double ttlSeconds, size_t maxBytes = kDefaultMaxBytes);
+    ~HttpResponseCache();
+
+    /// Request headers that pick a different answer, "Accept-Encoding"
+    /// by default. Not thread safe, set before use.
+    void setKeyHeaders(const std::vector<string> &headers)
+    {
+        keyHeaders_ = headers;
+    }
+
+    /// @c key is for fill() or wait().
+    Result lookup(const HttpRequest &req, Timestamp now, string *key, EntryPtr *entry);
+
+    /// Returns false if the rendering is over by now, look up again.
+    bool wait(const string &key, const Waiter &waiter);
+
+    /// Ends a kMiss, keeps @c resp if it can be, and calls the waiters.
+    void fill(const string &key, const HttpResponse &resp);
+
+    /// Ends a kMiss without an answer, the waiters get NULL.
+    void abandon(const string &key);
+
+    /// Markers of uncacheable answers included.
+    size_t bytes() const;
+    size_t entries() const;
+
+private:
+    typedef std::list<std::pair<string, EntryPtr>> LruList;
+
+    void finish(const string &key, const EntryPtr &entry);
+    void eraseLocked(std::unordered_map<string, LruList::iterator>::iterator it);
+
+    const double ttlSeconds_;
+    const size_t maxBytes_;
+    std::vector<string> keyHeaders_;
+    mutable MutexLock mutex_;
+    LruList lru_ GUARDED_BY(mutex_); //最近用过的在前面
+    std::unordered_map<string, LruList::iterator> entries_ GUARDED_BY(mutex_);
+    std::unordered_map<string, std::vector<Waiter>> flights_ GUARDED_BY(mutex_); //正在渲染的
+    size_t bytes_ GUARDED_BY(mutex_);
+};
+
+} // namespace net
+} // namespace muduo
+
+#endif // MUDUO_NET_HTTP_HTTPRESPONSECACHE_H
@@ -0,0 +1,377 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/http/HttpRouter.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/http/HttpResponse.h"
+
+#include <assert.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// A radix tree node, the edge from its parent is labelled with static
+// characters, chains of single children are merged into one label.
+struct HttpRouter::Node
+{
+    Node() : handler(-1) {}
+
+    string label;                                //边上的静态字符
+    string indices;                              //各静态子节点label的首字符，和children一一对应
+    std::vector<std::unique_ptr<Node>> children;
+    std::unique_ptr<Node> param;                 //":name"，匹配一段路径
+    string paramName;
+    std::unique_ptr<Node> wildcard;              //"*name"，匹配剩下的路径
+    string wildcardName;
+    int handler;                                 //Table::handlers的下标，-1表示没有
+};
+
+// Built once, never changed after it is published.
+struct HttpRouter::Table
+{
+    Node roots[kMethods];
+    std::vector<Handler> handlers;
+};
+
+namespace
+{
+
+typedef HttpRouter::Params Params;
+
+const char *const kMethodNames[] = {"", "GET", "POST", "HEAD", "PUT", "DELETE"};
+
+// returns the node after s, splitting labels where needed
+HttpRouter::Node *insertStatic(HttpRouter::Node *node, StringPiece s)
+{
+    while (!s.empty())
+    {
+        size_t i = node->indices.find(s[0]);
+        if (i == string::npos)
+        {
+            node->indices.push_back(s[0]);
+            node->children.emplace_back(new HttpRouter::Node);
+            node->children.back()->label = s.as_string();
+            return node->children.back().get();
+        }
+        HttpRouter::Node *child = node->children[i].get();
+        size_t common = 0;
+        while (common < child->label.size() && common < static_cast<size_t>(s.size()) &&
+               child->label[common] == s[static_cast<int>(common)])
+        {
+            ++common;
+        }
+        if (common < child->label.size())
+        {
+            // "/users" and "/uploads" share "/u"
+            std::unique_ptr<HttpRouter::Node> middle(new HttpRouter::Node);
+            middle->label = child->label.substr(0, common);
+            child->label.erase(0, common);
+            middle->indices.push_back(child->label[0]);
+            middle->children.push_back(std::move(node->children[i]));
+            node->children[i] = std::move(middle);
+            child = node->children[i].get();
+        }
+        s.remove_prefix(static_cast<int>(common));
+        node = child;
+    }
+    return node;
+}
+
+// returns false for a bad pattern or clashing parameter names
+bool insert(HttpRouter::Node *root, const string &pattern, int handler)
+{
+    if (pattern.empty() || pattern[0] != '/')
+    {
+        return false;
+    }
+    HttpRouter::Node *node = root;
+    int params = 0;
+    size_t start = 0;
+    while (start < pattern.size())
+    {
+        size_t special = pattern.find_first_of(":*", start);
+        size_t end = special == string::npos ? pattern.size() : special;
+        node = insertStatic(node, StringPiece(pattern.data() + start, static_cast<int>(end - start)));
+        if (special == string::npos)
+        {
+            break;
+        }
+        if (pattern[special - 1] != '/' || ++params > HttpRouter::kMaxParams)
+        {
+            return false; //参数必须是完整的一段
+        }
+        size_t slash = pattern.find('/', special);
+        end = slash == string::npos ? pattern.size() : slash;
+        string name(pattern, special + 1, end - special - 1);
+        if (name.empty())
+        {
+            return false;
+        }
+        std::unique_ptr<HttpRouter::Node> &child = pattern[special] == ':' ? node->param : node->wildcard;
+        string &childName = pattern[special] == ':' ? node->paramName : node->wildcardName;
+        if (pattern[special] == '*' && end != pattern.size())
+        {
+            return false; //通配符只能在最后
+        }
+        if (!child)
+        {
+            child.reset(new HttpRouter::Node);
+            childName = name;
+        }
+        else if (childName != name)
+        {
+            return false;
+        }
+        node = child.get();
+        start = end;
+    }
+    node->handler = handler;
+    return true;
+}
+
+// static children first, then the parameter, then the wildcard
+const HttpRouter::Node *match(const HttpRouter::Node *node, StringPiece path, Params *params)
+{
+    if (path.empty() && node->handler >= 0)
+    {
+        return node;
+    }
+    if (!path.empty())
+    {
+        const char *index = static_cast<const char *>(
+            ::memchr(node->indices.data(), path[0], node->indices.size()));
+        if (index)
+        {
+            const HttpRouter::Node *child = node->children[index - node->indices.data()].get();
+            if (path.starts_with(child->label))
+            {
+                const HttpRouter::Node *found =
+                    match(child, StringPiece(path.data() + child->label.size(),
+                                             path.size() - static_cast<int>(child->label.size())),
+                          params);
+                if (found)
+                {
+                    return found;
+                }
+            }
+        }
+    }
+    if (node->param)
+    {
+        const char *slash = static_cast<const char *>(::memchr(path.data(), '/', path.size()));
+        int len = slash ? static_cast<int>(slash - path.data()) : path.size();
+        if (len > 0)
+        {
+            params->push(node->paramName, StringPiece(path.data(), len));
+            const HttpRouter::Node *found =
+                match(node->param.get(), StringPiece(path.data() + len, path.size() - len), params);
+            if (found)
+            {
+                return found;
+            }
+            params->pop();
+        }
+    }
+    if (node->wildcard && node->wildcard->handler >= 0)
+    {
+        params->push(node->wildcardName, path);
+        return node->wildcard.get();
+    }
+    return NULL;
+}
+
+} // namespace
+
+StringPiece HttpRouter::Params::get(const StringPiece &name) const
+{
+    for (int i = 0; i < size_; ++i)
+    {
+        if (names_[i] == name)
+        {
+            return values_[i];
+        }
+    }
+    return StringPiece();
+}
+
+HttpRouter::HttpRouter()
+    : table_(NULL),
+      batches_(0)
+{
+    MutexLockGuard lock(mutex_);
+    rebuildLocked();
+    publishLocked();
+}
+
+HttpRouter::~HttpRouter() = default;
+
+bool HttpRouter::add(HttpRequest::Method method, const string &pattern, const Handler &handler)
+{
+    MutexLockGuard lock(mutex_);
+    std::vector<Route> saved(routes_);
+    bool replaced = false;
+    for (Route &route : routes_)
+    {
+        if (route.method == method && route.pattern == pattern)
+        {
+            route.handler = handler;
+            replaced = true;
+        }
+    }
+    bool ok;
+    if (!replaced && building_)
+    {
+        routes_.push_back(Route{method, pattern, handler});
+        ok = insertLocked(routes_.back()); //批量修改中，只插入新的这条
+    }
+    else
+    {
+        if (!replaced)
+        {
+            routes_.push_back(Route{method, pattern, handler});
+        }
+        ok = rebuildLocked();
+    }
+    if (!ok)
+    {
+        LOG_ERROR << "HttpRouter::add bad or clashing pattern " << pattern;
+        routes_.swap(saved);
+        if (building_)
+        {
+            rebuildLocked(); //插入了一半的树不能再用
+        }
+        return false;
+    }
+    if (batches_ == 0)
+    {
+        publishLocked();
+    }
+    return true;
+}
+
+void HttpRouter::remove(HttpRequest::Method method, const string &pattern)
+{
+    MutexLockGuard lock(mutex_);
+    for (size_t i = 0; i < routes_.size(); ++i)
+    {
+        if (routes_[i].method == method && routes_[i].pattern == pattern)
+        {
+            routes_.erase(routes_.begin() + i);
+            rebuildLocked();
+            if (batches_ == 0)
+            {
+                publishLocked();
+            }
+            break;
+        }
+    }
+}
+
+void HttpRouter::beginBatch()
+{
+    MutexLockGuard lock(mutex_);
+    ++batches_;
+}
+
+void HttpRouter::endBatch()
+{
+    MutexLockGuard lock(mutex_);
+    assert(batches_ > 0);
+    if (--batches_ == 0 && building_)
+    {
+        publishLocked();
+    }
+}
+
+// builds the trees from scratch into building_, unchanged on failure
+bool HttpRouter::rebuildLocked()
+{
+    std::unique_ptr<Table> table(new Table);
+    table.swap(building_);
+    for (const Route &route : routes_)
+    {
+        if (!insertLocked(route))
+        {
+            building_.swap(table);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HttpRouter::insertLocked(const Route &route)
+{
+    building_->handlers.push_back(route.handler);
+    return insert(&building_->roots[route.method], route.pattern,
+                  static_cast<int>(building_->handlers.size() - 1));
+}
+
+// lookups may still be on the old table, it is kept with the router
+void HttpRouter::publishLocked()
+{
+    tables_.emplace_back(building_.release());
+    table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+const HttpRouter::Handler *HttpRouter::find(HttpRequest::Method method,
+                                            const StringPiece &path,
+                                            Params *params) const
+{
+    const Table *table = table_.load(std::memory_order_acquire);
+    params->table_ = table;
+    params->clear();
+    const Node *found = match(&table->roots[method], path, params);
+    if (!found && method != HttpRequest::kInvalid)
+    {
+        params->clear();
+        found = match(&table->roots[HttpRequest::kInvalid], path, params);
+    }
+    return found ? &table->handlers[found->handler] : NULL;
+}
+
+bool HttpRouter::route(const HttpRequest &req, HttpResponse *resp) const
+{
+    Params params;
+    const Handler *handler = find(req.method(), req.path(), &params);
+    if (handler)
+    {
+        (*handler)(req, params, resp);
+        return true;
+    }
+
+    // the path is there, but not for this method
+    const Table *table = params.table_;
+    string allow;
+    for (int method = HttpRequest::kGet; method < kMethods; ++method)
+    {
+        if (match(&table->roots[method], req.path(), &params))
+        {
+            if (!allow.empty())
+            {
+                allow += ", ";
+            }
+            allow += kMethodNames[method];
+        }
+        params.clear();
+    }
+    if (allow.empty())
+    {
+        resp->setStatusCode(HttpResponse::k404NotFound);
+        resp->setStatusMessage("Not Found");
+    }
+    else
+    {
+        resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
+        resp->setStatusMessage("Method Not Allowed");
+        resp->addHeader("Allow", allow);
+    }
+    return false;
+}
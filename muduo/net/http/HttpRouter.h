@@ -0,0 +1,164 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_HTTPROUTER_H
+#define MUDUO_NET_HTTP_HTTPROUTER_H
+
+#include "muduo/base/Mutex.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/net/http/HttpRequest.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpResponse;
+
+/// Dispatches requests by method and path, for HttpServer::setHttpCallback().
+///
+/// Patterns are like "/users/:id/posts" and "/static/*file", ":id" matches
+/// one segment, "*file" the rest of the path. Static segments win over
+/// parameters, which win over wildcards. Each method has its own radix
+/// tree, plus one for the routes of any method.
+///
+/// Lookups take no lock and allocate nothing, they read the current trees
+/// through an atomic pointer. Every add() or remove() outside a Batch
+/// builds new trees and publishes them, the replaced ones are kept until
+/// the router is destroyed, as a lookup may still be on them. Changes are
+/// meant to be rare, make many of them in a Batch.
+class HttpRouter : noncopyable
+{ //http请求的路由，按方法和路径分派
+public:
+    static const int kMaxParams = 8;
+
+    struct Node; // internal
+    struct Table;
+
+    /// Values point into the request path, names into the trees of the
+    /// router, valid as long as the router.
+    class Params
+    {
+    public:
+        Params() : size_(0), table_(NULL) {}
+
+        int size() const { return size_; }
+        const StringPiece &name(int i) const { return names_[i]; }
+        const StringPiece &value(int i) const { return values_[i]; }
+
+        /// data() is NULL if there is no such parameter.
+        StringPiece get(const StringPiece &name) const;
+
+        void push(const StringPiece &name, const StringPiece &value)
+        {
+            names_[size_] = name;
+            values_[size_] = value;
+            ++size_;
+        }
+
+        void pop() { --size_; }
+        void clear() { size_ = 0; }
+
+    private:
+        friend class HttpRouter;
+
+        StringPiece names_[kMaxParams];
+        StringPiece values_[kMaxParams];
+        int size_;
+        const Table *table_; //查找用的路由表，names_和handler都在里面
+    };
+
+    typedef std::function<void(const HttpRequest &,
+                               const Params &,
+                               HttpResponse *)> Handler;
+
+    /// Changes made while a Batch lives are published once, when the last
+    /// Batch ends, lookups see the routes from before until then. eg.
+    ///   { HttpRouter::Batch batch(&router); router.add(...); ... }
+    class Batch : noncopyable
+    {
+    public:
+        explicit Batch(HttpRouter *router)
+            : router_(router)
+        {
+            router_->beginBatch();
+        }
+
+        ~Batch() { router_->endBatch(); }
+
+    private:
+        HttpRouter *router_;
+    };
+
+    HttpRouter();
+    ~HttpRouter();
+
+    /// Thread safe. Replaces the handler of the same method and pattern.
+    /// Returns false for a bad pattern, or one whose parameter names
+    /// clash with an existing route.
+    bool add(HttpRequest::Method method, const string &pattern, const Handler &handler);
+
+    /// Thread safe. For any method without a route of its own.
+    bool add(const string &pattern, const Handler &handler)
+    {
+        return add(HttpRequest::kInvalid, pattern, handler);
+    }
+
+    /// Thread safe.
+    void remove(HttpRequest::Method method, const string &pattern);
+
+    void remove(const string &pattern)
+    {
+        remove(HttpRequest::kInvalid, pattern);
+    }
+
+    /// Thread safe. NULL if nothing matches, the handler stays valid
+    /// as long as the router.
+    const Handler *find(HttpRequest::Method method,
+                        const StringPiece &path,
+                        Params *params) const;
+
+    /// Calls the handler, or answers "404 Not Found" or
+    /// "405 Method Not Allowed". Returns false if no handler was called.
+    bool route(const HttpRequest &req, HttpResponse *resp) const;
+
+private:
+    struct Route
+    {
+        HttpRequest::Method method;
+        string pattern;
+        Handler handler;
+    };
+
+    static const int kMethods = HttpRequest::kDelete + 1; //kInvalid代表任意方法
+
+    void beginBatch();
+    void endBatch();
+    bool rebuildLocked();
+    bool insertLocked(const Route &route);
+    void publishLocked();
+
+    std::atomic<const Table *> table_; //当前的路由表，查找时不加锁，也不动引用计数
+    mutable MutexLock mutex_;
+    std::vector<std::unique_ptr<const Table>> tables_ GUARDED_BY(mutex_); //发布过的都留着，查找可能还在用
+    std::vector<Route> routes_ GUARDED_BY(mutex_);
+    std::unique_ptr<Table> building_ GUARDED_BY(mutex_); //还没发布的路由表
+    int batches_ GUARDED_BY(mutex_);
+};
+
+} // namespace net
+} // namespace muduo
+
+#endif // MUDUO_NET_HTTP_HTTPROUTER_H
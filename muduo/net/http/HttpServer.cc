@@ -10,10 +10,15 @@
 #include "muduo/net/http/HttpServer.h"
 
 #include "muduo/base/Logging.h"
+#include "muduo/base/ThreadLocalSingleton.h"
+#include "muduo/net/EventLoop.h"
 #include "muduo/net/http/HttpContext.h"
 #include "muduo/net/http/HttpRequest.h"
 #include "muduo/net/http/HttpResponse.h"
 
+#include <string.h>
+#include <strings.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -35,12 +40,60 @@ void defaultHttpCallback(const HttpRequest &, HttpResponse *resp) //如果没有
 } // namespace net
 } // namespace muduo
 
+namespace
+{
+
+bool equalsIgnoreCase(const StringPiece& s, const char* token)
+{
+  return static_cast<size_t>(s.size()) == ::strlen(token) &&
+         ::strncasecmp(s.data(), token, s.size()) == 0;
+}
+
+// HTTP/1.1 keeps the connection by default, HTTP/1.0 closes it
+bool closeAfter(const HttpRequest &req)
+{
+  const StringPiece connection = req.header("Connection");                               //把头部取出来，不拷贝
+  return equalsIgnoreCase(connection, "close") ||                                        //如果等于close
+         (req.getVersion() == HttpRequest::kHttp10 && !equalsIgnoreCase(connection, "Keep-Alive")); //或者是1.0且connection不等与keep-alive，http1.0不支持长连接
+}
+
+// Answers go out in request order, behind those not done yet.
+void answer(const TcpConnectionPtr& conn, HttpContext* context, Buffer* output,
+            const char* raw, bool close)
+{
+  if (context->hasPending())
+  {
+    HttpContext::PendingPtr pending(new HttpResponder::Pending(conn, close));
+    pending->output.append(raw);
+    pending->ready = true;
+    context->addPending(pending);
+  }
+  else
+  {
+    output->append(raw);
+  }
+}
+
+// Reused by every request answered in this thread, so a warm server
+// allocates nothing to build its responses.
+struct Scratch
+{
+  Scratch() : response(false) { }
+
+  Buffer output;
+  HttpResponse response;
+  string cacheKey;
+};
+
+}  // namespace
+
 HttpServer::HttpServer(EventLoop *loop,
                        const InetAddress &listenAddr,
                        const string &name,
                        TcpServer::Option option)
     : server_(loop, listenAddr, name, option),
-      httpCallback_(detail::defaultHttpCallback)
+      httpCallback_(detail::defaultHttpCallback),
+      maxBodySize_(HttpContext::kDefaultMaxBodySize)
 {
     server_.setConnectionCallback( //注册这两个回调函数
         std::bind(&HttpServer::onConnection, this, _1));
@@ -48,6 +101,8 @@ HttpServer::HttpServer(EventLoop *loop,
         std::bind(&HttpServer::onMessage, this, _1, _2, _3));
 }
 
+HttpServer::~HttpServer() = default;
+
 void HttpServer::start()
 {
     LOG_WARN << "HttpServer[" << server_.name()
@@ -59,7 +114,10 @@ void HttpServer::onConnection(const TcpConnectionPtr &conn)
 {
     if (conn->connected())
     {
-        conn->setContext(HttpContext()); //tcpconnection与一个httpcontext绑定
+        HttpContext context;
+        context.setMaxBodySize(maxBodySize_);
+        context.setBodyCallback(httpBodyCallback_);
+        conn->setContext(context); //tcpconnection与一个httpcontext绑定
     }
 }
 
@@ -68,32 +126,220 @@ void HttpServer::onMessage(const TcpConnectionPtr &conn,
                            Timestamp receiveTime)
 {
     HttpContext *context = std::any_cast<HttpContext>(conn->getMutableContext()); //获取的是可以改变的
+    // pipelined requests are answered in order, with one send for all
+    Buffer &output = ThreadLocalSingleton<Scratch>::instance().output;
+    bool close = false;
+    while (!close)
+    {
+        if (!context->parseRequest(buf, receiveTime)) //获取请求包，更好的做法是让parserequest作为httpcontext的成员函数
+        {
+            if (context->bodyTooLarge())
+            {
+                answer(conn, context, &output, "HTTP/1.1 413 Payload Too Large\r\n\r\n", true); //实体超过maxBodySize_
+            }
+            else
+            {
+                answer(conn, context, &output, "HTTP/1.1 400 Bad Request\r\n\r\n", true); //请求失败
+            }
+            close = true;
+        }
+        else if (context->gotAll()) //请求消息解析完毕
+        {
+            if (asyncHttpCallback_ || context->hasPending())
+            {
+                close = queueRequest(conn, context, context->request());
+            }
+            else
+            {
+                close = onRequest(conn, context->request(), &output); //请求对象传过来
+            }
+            context->reset();                               //本次请求处理完毕，重置httpcontext，适用于长连接
+        }
+        else
+        {
+            if (context->expectContinue()) //客户端等着100 Continue才发送实体
+            {
+                answer(conn, context, &output, "HTTP/1.1 100 Continue\r\n\r\n", false);
+                context->continueSent();
+            }
+            break; //等待更多数据
+        }
+    }
 
-    if (!context->parseRequest(buf, receiveTime)) //获取请求包，更好的做法是让parserequest作为httpcontext的成员函数
+    if (output.readableBytes() > 0)
     {
-        conn->send("HTTP/1.1 400 Bad Request\r\n\r\n"); //请求失败
-        conn->shutdown();
+        conn->send(&output); //将缓冲区发送个客户端
+        output.retrieveAll(); //连接断开时send不取走数据，output是下一个连接也要用的
     }
-    //请求消息解析完毕
-    if (context->gotAll())
+    if (close) //如果需要关闭，短连接
     {
-        onRequest(conn, context->request()); //连接和请求对象传过来
-        context->reset();                    //本次请求处理完毕，重置httpcontext，适用于长连接
+        if (!context->hasPending())
+        {
+            conn->shutdown(); //关闭，否则等排队的应答发完再关闭
+        }
+        buf->retrieveAll(); //之后的数据不再解析
     }
 }
 
-void HttpServer::onRequest(const TcpConnectionPtr &conn, const HttpRequest &req)
+// returns true if the connection should be closed
+bool HttpServer::onRequest(const TcpConnectionPtr &conn, const HttpRequest &req, Buffer *output)
 {
-    const string &connection = req.getHeader("Connection");                                //把头部取出来
-    bool close = connection == "close" ||                                                  //如果等于close
-                 (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive"); //或者是1.0且connection不等与keep-alive，http1.0不支持长连接
-    HttpResponse response(close);                                                          //处理完请求是否要关闭连接
+    bool close = closeAfter(req);
+    Scratch &scratch = ThreadLocalSingleton<Scratch>::instance();
+    HttpResponseCache::Result cached = HttpResponseCache::kUncacheable;
+    if (cache_)
+    {
+        HttpResponseCache::EntryPtr entry;
+        HttpContext *context = std::any_cast<HttpContext>(conn->getMutableContext());
+        cached = lookupCache(conn, context, req, &scratch.cacheKey, &entry);
+        if (cached == HttpResponseCache::kHit)
+        {
+            output->append(entry->statusLine); //序列化好的应答，只写Connection和Date
+            HttpResponse::appendConnectionHead(output, close, req.receiveTime());
+            conn->send(output);
+            output->retrieveAll();
+            conn->send(entry->rest);
+            return close;
+        }
+        if (cached == HttpResponseCache::kBusy)
+        {
+            return close; //排在正在渲染的请求后面
+        }
+    }
+
+    HttpResponse &response = scratch.response;
+    response.reset(close);                                                                 //处理完请求是否要关闭连接
+    response.setDate(req.receiveTime());                                                   //不必再取一次时间
     httpCallback_(req, &response);                                                         //回调用户的函数对http请求进行相应处理，一旦处理完了返回response对象，是一个输入输出参数
-    Buffer buf;
-    response.appendToBuffer(&buf);  //将对象转换为一个字符串转换到buf中
-    conn->send(&buf);               //将缓冲区发送个客户端
-    if (response.closeConnection()) //如果需要关闭，短连接
+    if (compressor_)
+    {
+        compressor_->compress(HttpCompressor::negotiate(req), &response); //在实体序列化之前压缩
+    }
+    if (cached == HttpResponseCache::kMiss)
+    {
+        cache_->fill(scratch.cacheKey, response);
+    }
+    if (response.hasBodyByReference())
+    {
+        response.appendHeadToBuffer(output); //实体按引用发送，不拷贝
+        conn->send(output);
+        output->retrieveAll();
+        response.sendBody(conn);
+    }
+    else
+    {
+        response.appendToBuffer(output); //将对象转换为一个字符串追加到output中
+    }
+    return response.closeConnection();
+}
+
+// returns true if the connection should be closed, maybe later
+bool HttpServer::queueRequest(const TcpConnectionPtr &conn, HttpContext *context, const HttpRequest &req)
+{
+    HttpContext::PendingPtr pending;
+    if (cache_)
+    {
+        string key;
+        HttpResponseCache::EntryPtr entry;
+        HttpResponseCache::Result cached = lookupCache(conn, context, req, &key, &entry);
+        if (cached == HttpResponseCache::kBusy)
+        {
+            return closeAfter(req);
+        }
+        pending = newPending(conn, req);
+        if (cached == HttpResponseCache::kHit)
+        {
+            pending->setEntry(entry, req.receiveTime());
+            pending->ready = true;
+            context->addPending(pending);
+            return pending->close;
+        }
+        if (cached == HttpResponseCache::kMiss)
+        {
+            pending->cache = cache_; //finish()时填进缓存
+            pending->cacheKey.swap(key);
+        }
+    }
+    else
+    {
+        pending = newPending(conn, req);
+    }
+    context->addPending(pending);
+    return render(req, pending);
+}
+
+HttpContext::PendingPtr HttpServer::newPending(const TcpConnectionPtr &conn, const HttpRequest &req)
+{
+    HttpContext::PendingPtr pending(new HttpResponder::Pending(conn, closeAfter(req)));
+    pending->response.setDate(req.receiveTime());
+    if (compressor_)
+    {
+        pending->compressor = compressor_;
+        pending->encoding = HttpCompressor::negotiate(req); //请求在done()时已经没了
+    }
+    return pending;
+}
+
+// returns true if the connection should be closed, maybe later
+bool HttpServer::render(const HttpRequest &req, const HttpContext::PendingPtr &pending)
+{
+    bool close = pending->close;
+    if (asyncHttpCallback_)
+    {
+        asyncHttpCallback_(req, HttpResponder(pending)); //用户稍后调用done()
+        return close;
+    }
+    else
+    {
+        httpCallback_(req, &pending->response); //前面还有没完成的应答，只能排队
+        pending->finish();
+        pending->ready = true;
+        return pending->close;
+    }
+}
+
+// On kBusy, an answer waiting for the entry is queued on the connection.
+HttpResponseCache::Result HttpServer::lookupCache(const TcpConnectionPtr &conn,
+                                                  HttpContext *context,
+                                                  const HttpRequest &req,
+                                                  string *key,
+                                                  HttpResponseCache::EntryPtr *entry)
+{
+    for (;;)
     {
-        conn->shutdown(); //关闭
+        HttpResponseCache::Result result = cache_->lookup(req, req.receiveTime(), key, entry);
+        if (result != HttpResponseCache::kBusy)
+        {
+            return result;
+        }
+        HttpContext::PendingPtr pending = newPending(conn, req);
+        HttpRequest copy(req); //等的时候请求已经没了
+        HttpResponseCache::Waiter waiter = [this, pending, copy](const HttpResponseCache::EntryPtr &rendered)
+            {
+                TcpConnectionPtr connection = pending->conn.lock();
+                if (!connection)
+                {
+                    return;
+                }
+                connection->getLoop()->queueInLoop([this, connection, pending, copy, rendered]
+                    {
+                        if (rendered)
+                        {
+                            pending->setEntry(rendered, copy.receiveTime());
+                            pending->ready = true;
+                        }
+                        else
+                        {
+                            render(copy, pending); //不能缓存的应答不能给别人，自己渲染
+                        }
+                        std::any_cast<HttpContext>(connection->getMutableContext())->sendReady(connection);
+                    });
+            };
+        if (cache_->wait(*key, waiter))
+        {
+            context->addPending(pending);
+            return result;
+        }
+        // rendered meanwhile, look again
     }
 }
@@ -11,60 +11,129 @@
 #ifndef MUDUO_NET_HTTP_HTTPSERVER_H
 #define MUDUO_NET_HTTP_HTTPSERVER_H
 
+#include "muduo/base/StringPiece.h"
 #include "muduo/net/TcpServer.h"
+#include "muduo/net/http/HttpCompressor.h"
+#include "muduo/net/http/HttpResponder.h"
+#include "muduo/net/http/HttpResponseCache.h"
 
 namespace muduo
 {
 namespace net
 {
 
+class HttpContext;
 class HttpRequest;
 class HttpResponse;
 
 /// A simple embeddable HTTP server designed for report status of a program.
 /// It is not a fully HTTP 1.1 compliant server, but provides minimum features
 /// that can communicate with HttpClient and Web browser.
-/// It is synchronous, just like Java Servlet.
+/// It is synchronous, just like Java Servlet, unless an AsyncHttpCallback
+/// is set.
 class HttpServer : noncopyable
-{
-    { //http服务器类的封装
-    public:
-        typedef std::function<void(const HttpRequest &,
-                                   HttpResponse *)> HttpCallback;
-        HttpServer(EventLoop * loop,
-                   const InetAddress &listenAddr,
-                   const string &name,
-                   TcpServer::Option option = TcpServer::kNoReusePort);
-
-        ~HttpServer(); // force out-line dtor, for scoped_ptr members.
-
-        EventLoop *getLoop() const { return server_.getLoop(); }
-
-        /// Not thread safe, callback be registered before calling start().
-        void setHttpCallback(const HttpCallback &cb)
-        {
-            httpCallback_ = cb;
-        }
-
-        void setThreadNum(int numThreads) //支持多线程
-        {
-            server_.setThreadNum(numThreads);
-        }
-
-        void start();
-
-    private:
-        void onConnection(const TcpConnectionPtr &conn);
-        void onMessage(const TcpConnectionPtr &conn,
-                       Buffer *buf,                                    //当服务器端收到了一个客户端发过来的http请求
-                       Timestamp receiveTime);                         //首先回调onmessage，在onmessage中调用了onrequest，
-        void onRequest(const TcpConnectionPtr &, const HttpRequest &); //在onRequest中调用了httpcallback_
-
-        TcpServer server_;
-        HttpCallback httpCallback_; //在处理http请求的时候(即调用onrequest)的过程中回调此函数，对请求进行具体的处理
-    };
+{ //http服务器类的封装
+public:
+    typedef std::function<void(const HttpRequest &,
+                               HttpResponse *)> HttpCallback;
+    /// A piece of the request body, straight from the input buffer,
+    /// valid only during the call.
+    typedef std::function<void(const HttpRequest &,
+                               const StringPiece &)> HttpBodyCallback;
+    /// The request is valid only during the call, copy what is needed later.
+    /// The answer is sent when the HttpResponder is done().
+    typedef std::function<void(const HttpRequest &,
+                               const HttpResponder &)> AsyncHttpCallback;
+    HttpServer(EventLoop * loop,
+               const InetAddress &listenAddr,
+               const string &name,
+               TcpServer::Option option = TcpServer::kNoReusePort);
+
+    ~HttpServer(); // force out-line dtor, for scoped_ptr members.
+
+    EventLoop *getLoop() const { return server_.getLoop(); }
+
+    /// Not thread safe, callback be registered before calling start().
+    void setHttpCallback(const HttpCallback &cb)
+    {
+        httpCallback_ = cb;
+    }
+
+    /// Not thread safe, callback be registered before calling start().
+    /// Used instead of the HttpCallback, so that slow requests can be
+    /// answered from other threads without blocking the io loop.
+    void setAsyncHttpCallback(const AsyncHttpCallback &cb)
+    {
+        asyncHttpCallback_ = cb;
+    }
+
+    /// Not thread safe, callback be registered before calling start().
+    /// Streams request bodies instead of keeping them in HttpRequest::body(),
+    /// HttpCallback is called after the last piece.
+    void setHttpBodyCallback(const HttpBodyCallback &cb)
+    {
+        httpBodyCallback_ = cb;
+    }
+
+    /// Larger request bodies get "413 Payload Too Large", 1 MiB by default.
+    /// Not thread safe, set before calling start().
+    void setMaxBodySize(size_t bytes)
+    {
+        maxBodySize_ = bytes;
+    }
+
+    /// Compresses response bodies as the Accept-Encoding of the request
+    /// allows, off by default. One compressor can be shared by servers.
+    /// Not thread safe, set before calling start().
+    void setCompressor(const std::shared_ptr<const HttpCompressor> &compressor)
+    {
+        compressor_ = compressor;
+    }
+
+    /// Answers GET requests from @c cache when it can, and renders each
+    /// missing answer once, see HttpResponseCache. Off by default.
+    /// Not thread safe, set before calling start().
+    void setResponseCache(const std::shared_ptr<HttpResponseCache> &cache)
+    {
+        cache_ = cache;
+    }
+
+    void setThreadNum(int numThreads) //支持多线程
+    {
+        server_.setThreadNum(numThreads);
+    }
+
+    void start();
+
+private:
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn,
+                   Buffer *buf,                                    //当服务器端收到了一个客户端发过来的http请求
+                   Timestamp receiveTime);                         //首先回调onmessage，在onmessage中调用了onrequest，
+    bool onRequest(const TcpConnectionPtr &conn,                   //在onRequest中调用了httpcallback_
+                   const HttpRequest &, Buffer *output);
+    bool queueRequest(const TcpConnectionPtr &conn,                //应答要排在未完成的应答之后
+                      HttpContext *context, const HttpRequest &);
+    std::shared_ptr<HttpResponder::Pending> newPending(const TcpConnectionPtr &conn,
+                                                       const HttpRequest &req);
+    bool render(const HttpRequest &req,
+                const std::shared_ptr<HttpResponder::Pending> &pending);
+    HttpResponseCache::Result lookupCache(const TcpConnectionPtr &conn,
+                                          HttpContext *context,
+                                          const HttpRequest &req,
+                                          string *key,
+                                          HttpResponseCache::EntryPtr *entry);
+
+    TcpServer server_;
+    HttpCallback httpCallback_; //在处理http请求的时候(即调用onrequest)的过程中回调此函数，对请求进行具体的处理
+    AsyncHttpCallback asyncHttpCallback_; //设置后代替httpCallback_，应答可以在其他线程中完成
+    HttpBodyCallback httpBodyCallback_; //实体到来时回调，不在内存中保存整个实体
+    size_t maxBodySize_;
+    std::shared_ptr<const HttpCompressor> compressor_; //空的话不压缩
+    std::shared_ptr<HttpResponseCache> cache_;          //空的话每次都调用回调
+};
 
 } // namespace net
-} // namespace net
+} // namespace muduo
 
 #endif // MUDUO_NET_HTTP_HTTPSERVER_H
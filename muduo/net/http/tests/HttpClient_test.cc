@@ -0,0 +1,69 @@
+#include "muduo/net/http/HttpClient.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/base/Logging.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// A load generator, keeps @c concurrency requests going until @c total are answered.
+int main(int argc, char* argv[])
+{
+  if (argc < 4)
+  {
+    printf("Usage: %s ip port path [total] [concurrency] [pipeline_depth]\n", argv[0]);
+    return 0;
+  }
+  Logger::setLogLevel(Logger::WARN);
+  const InetAddress server(argv[1], static_cast<uint16_t>(atoi(argv[2])));
+  const string path = argv[3];
+  const int total = argc > 4 ? atoi(argv[4]) : 10000;
+  const int concurrency = argc > 5 ? atoi(argv[5]) : 10;
+  const int depth = argc > 6 ? atoi(argv[6]) : 1;
+
+  EventLoop loop;
+  {
+    HttpClient client(&loop, "HttpClient");
+    client.setMaxConnectionsPerHost(concurrency);
+    client.setPipelineDepth(depth);
+    int sent = 0;
+    int answered = 0;
+    int failed = 0;
+    int64_t bytes = 0;
+    HttpClient::ResponseCallback onResponse = [&](const HttpClient::Response& resp)
+    {
+      ++answered;
+      if (resp.statusCode() == 0)
+      {
+        ++failed;
+      }
+      bytes += resp.body().size();
+      if (sent < total)
+      {
+        ++sent;
+        client.get(server, path, onResponse);
+      }
+      else if (answered == total)
+      {
+        loop.quit();
+      }
+    };
+
+    const Timestamp start = Timestamp::now();
+    for (; sent < total && sent < concurrency * depth; ++sent)
+    {
+      client.get(server, path, onResponse);
+    }
+    loop.loop();
+    const double seconds = timeDifference(Timestamp::now(), start);
+    printf("%d requests, %d failed, %.3f seconds, %.1f requests/s, %.3f MiB/s\n",
+           answered, failed, seconds, answered / seconds,
+           static_cast<double>(bytes) / seconds / 1024 / 1024);
+  }
+  // lets the connections of the client close
+  loop.wakeup();
+  loop.runAfter(0.1, [&loop] { loop.quit(); });
+  loop.loop();
+}
@@ -0,0 +1,214 @@
+#include "muduo/net/http/HttpClient.h"
+#include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/http/HttpServer.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpServer.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <string.h>
+
+//#define BOOST_TEST_MODULE HttpClientTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::Timestamp;
+using namespace muduo::net;
+
+namespace
+{
+
+const uint16_t kPort = 29893;
+const uint16_t kNoServerPort = 29894;
+
+// Answers each request by its path, counts the connections.
+class ScriptedServer
+{
+ public:
+  explicit ScriptedServer(EventLoop* loop)
+    : server_(loop, InetAddress(kPort, true), "ScriptedServer"),
+      connections_(0),
+      drops_(0)
+  {
+      server_.setConnectionCallback([this](const TcpConnectionPtr& conn)
+          {
+            if (conn->connected())
+            {
+              ++connections_;
+            }
+          });
+      server_.setMessageCallback(
+          [this](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+          { onMessage(conn, buf); });
+      server_.start();
+  }
+
+  int connections() const { return connections_; }
+
+ private:
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf)
+  {
+      const char* end;
+      while ((end = static_cast<const char*>(
+          memmem(buf->peek(), buf->readableBytes(), "\r\n\r\n", 4))) != NULL)
+      {
+        string path(buf->peek() + 4, std::find(buf->peek() + 4, end, ' '));
+        buf->retrieveUntil(end + 4);
+        if (path == "/chunked")
+        {
+          conn->send("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                     "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n");
+        }
+        else if (path == "/continue")
+        {
+          conn->send("HTTP/1.1 100 Continue\r\n\r\n"
+                     "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+        }
+        else if (path == "/close")
+        {
+          conn->send("HTTP/1.0 200 OK\r\n\r\nuntil close");
+          conn->shutdown();
+        }
+        else if (path == "/drop" && drops_++ == 0)
+        {
+          conn->shutdown(); // as if the kept-alive connection timed out
+        }
+        else
+        {
+          conn->send("HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(path.size()) +
+                     "\r\n\r\n" + path);
+        }
+      }
+  }
+
+  TcpServer server_;
+  int connections_;
+  int drops_;
+};
+
+// Lets the connections of a destroyed HttpClient close, the
+// destructor queued that outside of the loop.
+void drain(EventLoop* loop)
+{
+  loop->wakeup();
+  loop->runAfter(0.1, [loop] { loop->quit(); });
+  loop->loop();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testPipelining)
+{
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  server.setHttpCallback([](const HttpRequest& req, HttpResponse* resp)
+      {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->addHeader("X-Method", req.methodString());
+        if (req.method() != HttpRequest::kHead)
+        {
+          resp->setBody(req.path() + ":" + req.body());
+        }
+      });
+  server.start();
+
+  std::vector<string> answers;
+  const size_t kRequests = 7;
+  {
+    HttpClient client(&loop, "HttpClient");
+    client.setMaxConnectionsPerHost(1);
+    client.setPipelineDepth(4);
+    const InetAddress address(kPort, true);
+    HttpClient::ResponseCallback collect = [&](const HttpClient::Response& resp)
+        {
+          answers.push_back(std::to_string(resp.statusCode()) + " " +
+                            resp.header("X-Method").as_string() + " " + resp.body());
+          if (answers.size() == kRequests)
+          {
+            loop.quit();
+          }
+        };
+    for (int i = 0; i < 5; ++i)
+    {
+      client.get(address, "/" + std::to_string(i), collect);
+    }
+    HttpClient::Request post("POST", "/post");
+    post.body = "data";
+    client.request(address, post, collect);
+    client.request(address, HttpClient::Request("HEAD", "/head"), collect);
+    loop.runAfter(5.0, [&loop] { loop.quit(); });
+    loop.loop();
+  }
+  drain(&loop);
+
+  BOOST_REQUIRE_EQUAL(answers.size(), kRequests);
+  for (int i = 0; i < 5; ++i)
+  {
+    BOOST_CHECK_EQUAL(answers[i], "200 GET /" + std::to_string(i) + ":");
+  }
+  BOOST_CHECK_EQUAL(answers[5], "200 POST /post:data");
+  BOOST_CHECK_EQUAL(answers[6], "200 HEAD ");
+}
+
+BOOST_AUTO_TEST_CASE(testKeepAliveAndRetry)
+{
+  EventLoop loop;
+  ScriptedServer server(&loop);
+  std::vector<string> answers;
+  string pieces;
+  {
+    HttpClient client(&loop, "HttpClient");
+    const InetAddress address(kPort, true);
+
+    // one after another, from the callbacks
+    HttpClient::ResponseCallback next = [&](const HttpClient::Response& resp)
+        {
+          answers.push_back(std::to_string(resp.statusCode()) + " " + resp.body());
+          const char* paths[] = { "/continue", "/close", "/drop" };
+          if (answers.size() <= 3)
+          {
+            client.get(address, paths[answers.size() - 1], next);
+          }
+          else
+          {
+            loop.quit();
+          }
+        };
+    client.request(address, HttpClient::Request("GET", "/chunked"), next,
+        [&](const HttpClient::Response&, const muduo::StringPiece& piece)
+        { pieces += "[" + piece.as_string() + "]"; });
+    loop.runAfter(5.0, [&loop] { loop.quit(); });
+    loop.loop();
+  }
+  drain(&loop);
+
+  BOOST_REQUIRE_EQUAL(answers.size(), 4);
+  BOOST_CHECK_EQUAL(answers[0], "200 ");
+  BOOST_CHECK_EQUAL(pieces, "[hello][ world]");
+  BOOST_CHECK_EQUAL(answers[1], "200 ok");
+  BOOST_CHECK_EQUAL(answers[2], "200 until close");
+  BOOST_CHECK_EQUAL(answers[3], "200 /drop");
+  // the first is kept alive until "/close", "/drop" is sent again
+  BOOST_CHECK_EQUAL(server.connections(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(testConnectTimeout)
+{
+  EventLoop loop;
+  HttpClient client(&loop, "HttpClient");
+  client.setConnectTimeout(0.5);
+  int status = -1;
+  client.get(InetAddress(kNoServerPort, true), "/", [&](const HttpClient::Response& resp)
+      {
+        status = resp.statusCode();
+        loop.quit();
+      });
+  loop.runAfter(5.0, [&loop] { loop.quit(); });
+  loop.loop();
+  BOOST_CHECK_EQUAL(status, 0);
+}
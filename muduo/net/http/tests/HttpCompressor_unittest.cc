@@ -0,0 +1,219 @@
+#include "muduo/net/http/HttpCompressor.h"
+#include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/Buffer.h"
+
+#include <string.h>
+#include <zlib.h>
+
+//#define BOOST_TEST_MODULE HttpCompressorTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::StringPiece;
+using namespace muduo::net;
+
+namespace
+{
+
+HttpCompressor::Encoding negotiate(const string& acceptEncoding)
+{
+  HttpRequest req;
+  string line = "Accept-Encoding: " + acceptEncoding;
+  req.addHeader(line.data(), line.data() + 15, line.data() + line.size());
+  return HttpCompressor::negotiate(req);
+}
+
+// gzip or zlib format, told apart by inflate itself
+string inflate(const StringPiece& compressed)
+{
+  z_stream zs;
+  memset(&zs, 0, sizeof zs);
+  BOOST_REQUIRE_EQUAL(inflateInit2(&zs, MAX_WBITS + 32), Z_OK);
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  zs.avail_in = compressed.size();
+  string result;
+  char buf[4096];
+  int err = Z_OK;
+  while (err == Z_OK)
+  {
+    zs.next_out = reinterpret_cast<Bytef*>(buf);
+    zs.avail_out = sizeof buf;
+    err = ::inflate(&zs, Z_NO_FLUSH);
+    result.append(buf, sizeof buf - zs.avail_out);
+  }
+  BOOST_CHECK_EQUAL(err, Z_STREAM_END);
+  inflateEnd(&zs);
+  return result;
+}
+
+string json(int items)
+{
+  string body = "[";
+  for (int i = 0; i < items; ++i)
+  {
+    body += "{\"id\": " + std::to_string(i) + ", \"name\": \"item\"},";
+  }
+  body += "{}]";
+  return body;
+}
+
+size_t compressedSize(const std::shared_ptr<const string>& block)
+{
+  HttpCompressor compressor;
+  HttpResponse resp(false);
+  resp.setContentType("text/plain");
+  resp.setBody(block);
+  BOOST_REQUIRE(compressor.compress(HttpCompressor::kGzip, &resp));
+  return resp.bodySize();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testNegotiate)
+{
+  BOOST_CHECK_EQUAL(negotiate("gzip, deflate, br"), HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(negotiate("deflate"), HttpCompressor::kDeflate);
+  BOOST_CHECK_EQUAL(negotiate("gzip;q=0.5, deflate"), HttpCompressor::kDeflate);
+  BOOST_CHECK_EQUAL(negotiate("gzip;q=0, *"), HttpCompressor::kDeflate);
+  BOOST_CHECK_EQUAL(negotiate("*"), HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(negotiate("br, identity"), HttpCompressor::kIdentity);
+  BOOST_CHECK_EQUAL(negotiate(" GZIP ; q=1.0"), HttpCompressor::kGzip);
+  BOOST_CHECK_EQUAL(negotiate("*;q=0"), HttpCompressor::kIdentity);
+  BOOST_CHECK_EQUAL(HttpCompressor::negotiate(HttpRequest()), HttpCompressor::kIdentity);
+}
+
+BOOST_AUTO_TEST_CASE(testCompress)
+{
+  HttpCompressor compressor;
+  const string body = json(200);
+  HttpResponse resp(false);
+  for (int i = 0; i < 3; ++i) // the deflate states are reused
+  {
+    resp.reset(false);
+    resp.setStatusCode(HttpResponse::k200Ok);
+    resp.setContentType("application/json");
+    resp.addHeader("ETag", "\"v1\"");
+    resp.setBody(body);
+    BOOST_CHECK(compressor.compress(i == 1 ? HttpCompressor::kDeflate : HttpCompressor::kGzip, &resp));
+    BOOST_CHECK(resp.header("Content-Encoding") == (i == 1 ? "deflate" : "gzip"));
+    BOOST_CHECK(resp.header("Vary") == "Accept-Encoding");
+    BOOST_CHECK(resp.header("ETag") == "W/\"v1\"");
+    BOOST_CHECK_LT(resp.bodySize(), body.size() / 4);
+    BOOST_CHECK(inflate(resp.body()) == body);
+  }
+
+  // not for this client, but caches must know it could have been
+  resp.reset(false);
+  resp.setContentType("text/plain");
+  resp.setBody(body);
+  BOOST_CHECK(!compressor.compress(HttpCompressor::kIdentity, &resp));
+  BOOST_CHECK(resp.header("Vary") == "Accept-Encoding");
+  BOOST_CHECK(resp.header("Content-Encoding").data() == NULL);
+  BOOST_CHECK_EQUAL(resp.bodySize(), body.size());
+
+  // what the handler varies on stays
+  const char* varies[][2] = {
+    {"Cookie", "Cookie, Accept-Encoding"},
+    {"accept-encoding, Cookie", "accept-encoding, Cookie"},
+    {"*", "*"},
+  };
+  for (const auto& vary : varies)
+  {
+    resp.reset(false);
+    resp.setContentType("text/plain");
+    resp.addHeader("Vary", vary[0]);
+    resp.setBody(body);
+    BOOST_CHECK(compressor.compress(HttpCompressor::kGzip, &resp));
+    BOOST_CHECK_EQUAL(resp.header("Vary").as_string(), vary[1]);
+  }
+
+  // too small, or not text
+  resp.reset(false);
+  resp.setContentType("text/plain");
+  resp.setBody("small");
+  BOOST_CHECK(!compressor.compress(HttpCompressor::kGzip, &resp));
+  BOOST_CHECK(resp.header("Vary").data() == NULL);
+  resp.reset(false);
+  resp.setContentType("image/png");
+  resp.setBody(body);
+  BOOST_CHECK(!compressor.compress(HttpCompressor::kGzip, &resp));
+}
+
+BOOST_AUTO_TEST_CASE(testCachedBlocks)
+{
+  HttpCompressor compressor;
+  std::shared_ptr<const string> block(new string(json(100)));
+  std::shared_ptr<const string> first;
+  for (int i = 0; i < 2; ++i)
+  {
+    HttpResponse resp(false);
+    resp.setContentType("text/html");
+    resp.setBody(block);
+    BOOST_CHECK(compressor.compress(HttpCompressor::kGzip, &resp));
+    BOOST_REQUIRE(resp.bodyBlock());
+    if (i == 0)
+    {
+      first = resp.bodyBlock();
+    }
+    BOOST_CHECK(resp.bodyBlock() == first); // compressed once
+  }
+  BOOST_CHECK(inflate(*first) == *block);
+
+  // the other encoding has its own entry
+  HttpResponse resp(false);
+  resp.setContentType("text/html");
+  resp.setBody(block);
+  BOOST_CHECK(compressor.compress(HttpCompressor::kDeflate, &resp));
+  BOOST_CHECK(resp.bodyBlock() != first);
+  BOOST_CHECK(inflate(*resp.bodyBlock()) == *block);
+
+  // random bytes do not get smaller
+  string noise;
+  for (int i = 0; i < 4096; ++i)
+  {
+    noise.push_back(static_cast<char>(rand()));
+  }
+  std::shared_ptr<const string> random(new string(noise));
+  for (int i = 0; i < 2; ++i)
+  {
+    HttpResponse r(false);
+    r.setContentType("text/plain");
+    r.setBody(random);
+    BOOST_CHECK(!compressor.compress(HttpCompressor::kGzip, &r));
+    BOOST_CHECK(r.bodyBlock() == random);
+  }
+  BOOST_CHECK_EQUAL(random.use_count(), 1); // the cache only remembers it
+}
+
+BOOST_AUTO_TEST_CASE(testCacheBytes)
+{
+  std::shared_ptr<const string> blocks[2] = {
+    std::make_shared<const string>(json(100)),
+    std::make_shared<const string>(json(101)),
+  };
+  // room for one of them
+  HttpCompressor compressor;
+  compressor.setCacheBytes(compressedSize(blocks[0]) + 100);
+  std::shared_ptr<const string> compressed[2];
+  for (int i = 0; i < 2; ++i)
+  {
+    HttpResponse resp(false);
+    resp.setContentType("text/plain");
+    resp.setBody(blocks[i]);
+    BOOST_CHECK(compressor.compress(HttpCompressor::kGzip, &resp));
+    compressed[i] = resp.bodyBlock();
+  }
+  for (int i = 1; i >= 0; --i)
+  {
+    HttpResponse resp(false);
+    resp.setContentType("text/plain");
+    resp.setBody(blocks[i]);
+    BOOST_CHECK(compressor.compress(HttpCompressor::kGzip, &resp));
+    // the second is still there, the first was evicted and is compressed again
+    BOOST_CHECK_EQUAL(resp.bodyBlock() == compressed[i], i == 1);
+    BOOST_CHECK(inflate(*resp.bodyBlock()) == *blocks[i]);
+  }
+}
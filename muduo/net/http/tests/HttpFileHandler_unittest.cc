@@ -0,0 +1,221 @@
+#include "muduo/net/http/HttpFileHandler.h"
+#include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/http/HttpServer.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE HttpFileHandlerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::Timestamp;
+using namespace muduo::net;
+
+namespace
+{
+
+const uint16_t kPort = 29891;
+
+// a directory with "index.html", "small.txt" and "big.bin", removed at the end
+struct Root
+{
+  Root()
+  {
+    char dir[] = "/tmp/HttpFileHandler_unittestXXXXXX";
+    BOOST_REQUIRE(::mkdtemp(dir) != NULL);
+    path = dir;
+    small = "hello, world\n";
+    for (int i = 0; i < 300 * 1000; ++i)
+    {
+      big.push_back(static_cast<char>('a' + i % 26));
+    }
+    write("index.html", "<html></html>");
+    write("small.txt", small);
+    write("big.bin", big);
+  }
+
+  ~Root()
+  {
+    string command = "rm -rf " + path;
+    BOOST_CHECK_EQUAL(::system(command.c_str()), 0);
+  }
+
+  void write(const string& name, const string& content)
+  {
+    FILE* fp = ::fopen((path + "/" + name).c_str(), "w");
+    BOOST_REQUIRE(fp != NULL);
+    BOOST_REQUIRE_EQUAL(::fwrite(content.data(), 1, content.size(), fp), content.size());
+    ::fclose(fp);
+  }
+
+  string path;
+  string small;
+  string big;
+};
+
+// "GET path HTTP/1.1" with the headers, like "Range: bytes=0-9\r\n"
+string get(HttpFileHandler* handler, const string& path, const string& headers = "",
+           HttpRequest::Method method = HttpRequest::kGet)
+{
+  HttpRequest req;
+  const char* name = method == HttpRequest::kGet ? "GET" : "POST";
+  req.setMethod(name, name + strlen(name));
+  req.setPath(path.data(), path.data() + path.size());
+  size_t start = 0;
+  size_t crlf;
+  while ((crlf = headers.find("\r\n", start)) != string::npos)
+  {
+    const char* line = headers.data() + start;
+    req.addHeader(line, strchr(line, ':'), headers.data() + crlf);
+    start = crlf + 2;
+  }
+  HttpResponse resp(true);
+  handler->onRequest(req, &resp);
+  Buffer buf;
+  resp.appendToBuffer(&buf);
+  return buf.retrieveAllAsString();
+}
+
+string headerOf(const string& response, const string& field)
+{
+  size_t pos = response.find("\r\n" + field + ": ");
+  if (pos == string::npos)
+  {
+    return string();
+  }
+  pos += field.size() + 4;
+  return response.substr(pos, response.find("\r\n", pos) - pos);
+}
+
+string bodyOf(const string& response)
+{
+  return response.substr(response.find("\r\n\r\n") + 4);
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testGetAndConditional)
+{
+  Root root;
+  HttpFileHandler handler(root.path);
+
+  string response = get(&handler, "/small.txt");
+  BOOST_CHECK_EQUAL(response.substr(0, 17), "HTTP/1.1 200 OK\r\n");
+  BOOST_CHECK_EQUAL(headerOf(response, "Content-Type"), "text/plain; charset=utf-8");
+  BOOST_CHECK_EQUAL(headerOf(response, "Accept-Ranges"), "bytes");
+  BOOST_CHECK_EQUAL(bodyOf(response), root.small);
+  string etag = headerOf(response, "ETag");
+  string lastModified = headerOf(response, "Last-Modified");
+  BOOST_CHECK_EQUAL(etag[0], '"');
+  BOOST_CHECK_EQUAL(lastModified.size(), 29);
+
+  BOOST_CHECK_EQUAL(bodyOf(get(&handler, "/")), "<html></html>");
+  BOOST_CHECK_EQUAL(get(&handler, "/missing.txt").substr(0, 12), "HTTP/1.1 404");
+  BOOST_CHECK_EQUAL(get(&handler, "/../etc/passwd").substr(0, 12), "HTTP/1.1 403");
+  BOOST_CHECK_EQUAL(get(&handler, "/a/../../x").substr(0, 12), "HTTP/1.1 403");
+  BOOST_CHECK_EQUAL(get(&handler, "/small.txt", "", HttpRequest::kPost).substr(0, 12), "HTTP/1.1 405");
+
+  response = get(&handler, "/small.txt", "If-None-Match: " + etag + "\r\n");
+  BOOST_CHECK_EQUAL(response.substr(0, 12), "HTTP/1.1 304");
+  BOOST_CHECK_EQUAL(bodyOf(response), "");
+  BOOST_CHECK_EQUAL(headerOf(response, "ETag"), etag);
+  response = get(&handler, "/small.txt", "If-None-Match: \"x\", W/" + etag + "\r\n");
+  BOOST_CHECK_EQUAL(response.substr(0, 12), "HTTP/1.1 304");
+  response = get(&handler, "/small.txt", "If-None-Match: \"x\"\r\n");
+  BOOST_CHECK_EQUAL(response.substr(0, 12), "HTTP/1.1 200");
+  response = get(&handler, "/small.txt", "If-Modified-Since: " + lastModified + "\r\n");
+  BOOST_CHECK_EQUAL(response.substr(0, 12), "HTTP/1.1 304");
+
+  // a new file at the same path is seen within a second or so
+  ::sleep(1);
+  root.write("small.txt", "changed");
+  ::sleep(1);
+  response = get(&handler, "/small.txt", "If-None-Match: " + etag + "\r\n");
+  BOOST_CHECK_EQUAL(response.substr(0, 12), "HTTP/1.1 200");
+  BOOST_CHECK_EQUAL(bodyOf(response), "changed");
+}
+
+BOOST_AUTO_TEST_CASE(testRange)
+{
+  Root root;
+  HttpFileHandler handler(root.path);
+  handler.setMemoryCacheSize(1024);
+
+  string response = get(&handler, "/big.bin", "Range: bytes=10-19\r\n");
+  BOOST_CHECK_EQUAL(response.substr(0, 12), "HTTP/1.1 206");
+  BOOST_CHECK_EQUAL(headerOf(response, "Content-Range"), "bytes 10-19/300000");
+  BOOST_CHECK_EQUAL(bodyOf(response), root.big.substr(10, 10));
+
+  response = get(&handler, "/big.bin", "Range: bytes=299990-\r\n");
+  BOOST_CHECK_EQUAL(headerOf(response, "Content-Range"), "bytes 299990-299999/300000");
+  BOOST_CHECK_EQUAL(bodyOf(response), root.big.substr(299990));
+
+  response = get(&handler, "/small.txt", "Range: bytes=-6\r\n");
+  BOOST_CHECK_EQUAL(headerOf(response, "Content-Range"), "bytes 7-12/13");
+  BOOST_CHECK_EQUAL(bodyOf(response), "world\n");
+
+  response = get(&handler, "/small.txt", "Range: bytes=0-1000\r\n");
+  BOOST_CHECK_EQUAL(headerOf(response, "Content-Range"), "bytes 0-12/13");
+  BOOST_CHECK_EQUAL(bodyOf(response), root.small);
+
+  response = get(&handler, "/big.bin", "Range: bytes=300000-\r\n");
+  BOOST_CHECK_EQUAL(response.substr(0, 12), "HTTP/1.1 416");
+  BOOST_CHECK_EQUAL(headerOf(response, "Content-Range"), "bytes */300000");
+
+  // ignored, the whole file
+  response = get(&handler, "/small.txt", "Range: bytes=0-1,5-6\r\n");
+  BOOST_CHECK_EQUAL(response.substr(0, 12), "HTTP/1.1 200");
+  response = get(&handler, "/small.txt", "Range: bytes=0-1\r\nIf-Range: \"old\"\r\n");
+  BOOST_CHECK_EQUAL(response.substr(0, 12), "HTTP/1.1 200");
+  BOOST_CHECK_EQUAL(bodyOf(response), root.small);
+}
+
+BOOST_AUTO_TEST_CASE(testSendfile)
+{
+  Root root;
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  HttpFileHandler handler(root.path, 1);
+  server.setHttpCallback(
+      [&handler](const HttpRequest& req, HttpResponse* resp) { handler.onRequest(req, resp); });
+  server.start();
+
+  TcpClient client(&loop, InetAddress(kPort, true), "HttpClient");
+  string response;
+  client.setConnectionCallback([&](const TcpConnectionPtr& conn)
+      {
+        if (conn->connected())
+        {
+          conn->send("GET /big.bin HTTP/1.1\r\n\r\n"
+                     "GET /small.txt HTTP/1.1\r\nRange: bytes=0-4\r\n\r\n"
+                     "GET /big.bin HTTP/1.1\r\nConnection: close\r\n\r\n");
+        }
+        else
+        {
+          loop.runAfter(0.1, [&loop] { loop.quit(); });
+        }
+      });
+  client.setMessageCallback(
+      [&](const TcpConnectionPtr&, Buffer* buf, Timestamp)
+      { response += buf->retrieveAllAsString(); });
+  client.connect();
+  loop.runAfter(5.0, [&loop] { loop.quit(); });
+  loop.loop();
+
+  // keep-alive, a range of another file evicting the first, then close
+  size_t second = response.find("HTTP/1.1 206");
+  size_t third = response.find("HTTP/1.1 200", second);
+  BOOST_REQUIRE(second != string::npos && third != string::npos);
+  BOOST_CHECK_EQUAL(headerOf(response, "Content-Length"), "300000");
+  BOOST_CHECK(bodyOf(response.substr(0, second)) == root.big);
+  BOOST_CHECK_EQUAL(bodyOf(response.substr(second, third - second)), "hello");
+  BOOST_CHECK(bodyOf(response.substr(third)) == root.big);
+}
@@ -77,3 +77,208 @@ BOOST_AUTO_TEST_CASE(testParseRequestEmptyHeaderValue)
   BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string(""));
   BOOST_CHECK_EQUAL(request.getHeader("Accept-Encoding"), string(""));
 }
+
+BOOST_AUTO_TEST_CASE(testParseRequestContentLength)
+{
+  string all("POST /upload HTTP/1.1\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "content-length: 11\r\n"
+       "\r\n"
+       "hello world"
+       "GET / HTTP/1.1\r\n");
+
+  for (size_t sz1 = 0; sz1 < all.size(); ++sz1)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(all.c_str(), sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    input.append(all.c_str() + sz1, all.size() - sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.request().method(), HttpRequest::kPost);
+    BOOST_CHECK_EQUAL(context.request().body(), string("hello world"));
+    BOOST_CHECK_EQUAL(input.retrieveAllAsString(), string("GET / HTTP/1.1\r\n"));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestChunked)
+{
+  string all("PUT /file HTTP/1.1\r\n"
+       "Transfer-Encoding: chunked\r\n"
+       "\r\n"
+       "5\r\n"
+       "hello\r\n"
+       "1;name=value\r\n"
+       " \r\n"
+       "A\r\n"
+       "0123456789\r\n"
+       "0\r\n"
+       "Checksum: 42\r\n"
+       "\r\n");
+
+  // one byte at a time, the body comes out in pieces
+  HttpContext context;
+  string pieces;
+  int calls = 0;
+  context.setBodyCallback([&](const HttpRequest& request, const muduo::StringPiece& data)
+      {
+        BOOST_CHECK_EQUAL(request.method(), HttpRequest::kPut);
+        pieces.append(data.data(), data.size());
+        ++calls;
+      });
+  Buffer input;
+  for (char c : all)
+  {
+    BOOST_CHECK(!context.gotAll());
+    input.append(&c, 1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  }
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(pieces, string("hello 0123456789"));
+  BOOST_CHECK_EQUAL(calls, 16);
+  BOOST_CHECK_EQUAL(context.request().body(), string(""));
+  BOOST_CHECK_EQUAL(context.request().getHeader("Checksum"), string("42"));
+  BOOST_CHECK_EQUAL(input.readableBytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestBodyTooLarge)
+{
+  HttpContext context;
+  context.setMaxBodySize(10);
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\n"
+       "Content-Length: 11\r\n"
+       "\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.bodyTooLarge());
+
+  context.reset();
+  input.retrieveAll();
+  input.append("POST / HTTP/1.1\r\n"
+       "Transfer-Encoding: chunked\r\n"
+       "\r\n"
+       "6\r\n"
+       "123456\r\n"
+       "5\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.bodyTooLarge());
+
+  context.reset();
+  input.retrieveAll();
+  input.append("POST / HTTP/1.1\r\n"
+       "Content-Length: 1x\r\n"
+       "\r\n");
+  BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(!context.bodyTooLarge());
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestExpectContinue)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("POST / HTTP/1.1\r\n"
+       "Content-Length: 5\r\n"
+       "Expect: 100-continue\r\n"
+       "\r\n");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.expectContinue());
+  context.continueSent();
+  input.append("hello");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK(!context.expectContinue());
+  BOOST_CHECK_EQUAL(context.request().body(), string("hello"));
+}
+
+BOOST_AUTO_TEST_CASE(testHeaderLookup)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("GET /index.html?q=1 HTTP/1.0\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "X-Forwarded-For: 10.0.0.1\r\n"
+       "x-forwarded-for:  10.0.0.2 \r\n"
+       "Empty:\r\n"
+       "\r\n");
+
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  const HttpRequest& request = context.request();
+  BOOST_CHECK_EQUAL(request.path(), string("/index.html"));
+  BOOST_CHECK_EQUAL(request.query(), string("?q=1"));
+  BOOST_CHECK_EQUAL(request.getVersion(), HttpRequest::kHttp10);
+  BOOST_CHECK_EQUAL(request.header("HOST").as_string(), string("www.chenshuo.com"));
+  BOOST_CHECK_EQUAL(request.header("X-Forwarded-For").as_string(), string("10.0.0.2"));
+  BOOST_CHECK(request.header("Empty").data() != NULL);
+  BOOST_CHECK(request.header("Empty").empty());
+  BOOST_CHECK(request.header("Missing").data() == NULL);
+  BOOST_REQUIRE_EQUAL(request.headerCount(), 4);
+  BOOST_CHECK_EQUAL(request.headerField(1).as_string(), string("X-Forwarded-For"));
+  BOOST_CHECK_EQUAL(request.headerValue(1).as_string(), string("10.0.0.1"));
+  BOOST_CHECK_EQUAL(request.headers().size(), 4);
+  BOOST_CHECK_EQUAL(request.headers().at("Host"), string("www.chenshuo.com"));
+
+  // the next request on the connection reuses the memory
+  context.reset();
+  input.append("DELETE /x HTTP/1.1\r\n"
+       "Host: muduo\r\n"
+       "\r\n");
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().method(), HttpRequest::kDelete);
+  BOOST_CHECK_EQUAL(context.request().query(), string(""));
+  BOOST_CHECK_EQUAL(context.request().headerCount(), 1);
+  BOOST_CHECK_EQUAL(context.request().getHeader("host"), string("muduo"));
+  BOOST_CHECK_EQUAL(context.request().headers().size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testParseResponse)
+{
+  HttpContext context(HttpContext::kParseResponse);
+  Buffer input;
+  input.append("HTTP/1.1 100 Continue\r\n\r\n"
+       "HTTP/1.1 200 OK\r\n"
+       "Content-Length: 5\r\n"
+       "\r\n"
+       "hello"
+       "HTTP/1.1 404 \r\n"
+       "Transfer-Encoding: chunked\r\n"
+       "\r\n"
+       "3\r\nabc\r\n0\r\n\r\n");
+
+  BOOST_CHECK(context.parseResponse(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK(context.interim());
+  context.reset();
+  BOOST_CHECK(context.parseResponse(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.statusCode(), 200);
+  BOOST_CHECK_EQUAL(context.statusMessage(), string("OK"));
+  BOOST_CHECK_EQUAL(context.request().body(), string("hello"));
+  context.reset();
+  BOOST_CHECK(context.parseResponse(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.statusCode(), 404);
+  BOOST_CHECK_EQUAL(context.statusMessage(), string(""));
+  BOOST_CHECK_EQUAL(context.request().body(), string("abc"));
+
+  // the answer to HEAD, and no length at all
+  context.reset();
+  context.setNoBody();
+  input.append("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\n"
+       "HTTP/1.0 200 OK\r\n\r\nuntil close");
+  BOOST_CHECK(context.parseResponse(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  BOOST_CHECK_EQUAL(context.request().body(), string(""));
+  context.reset();
+  BOOST_CHECK(context.parseResponse(&input, Timestamp::now()));
+  BOOST_CHECK(!context.gotAll());
+  BOOST_CHECK(context.finishOnClose());
+  BOOST_CHECK_EQUAL(context.request().getVersion(), HttpRequest::kHttp10);
+  BOOST_CHECK_EQUAL(context.request().body(), string("until close"));
+
+  context.reset();
+  input.append("HTTP/1.1 2x0 OK\r\n\r\n");
+  BOOST_CHECK(!context.parseResponse(&input, Timestamp::now()));
+}
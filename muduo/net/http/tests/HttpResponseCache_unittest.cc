@@ -0,0 +1,268 @@
+#include "muduo/net/http/HttpResponseCache.h"
+#include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/http/HttpServer.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/http/tests/HttpTestUtil.h"
+
+#include "muduo/base/ThreadPool.h"
+
+#include <string.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE HttpResponseCacheTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::Timestamp;
+using namespace muduo::net;
+using muduo::net::test::roundTrip;
+
+namespace
+{
+
+const uint16_t kPort = 29892;
+
+HttpRequest get(const string& path, const string& header = "")
+{
+  HttpRequest req;
+  req.setMethod("GET", "GET" + 3);
+  req.setPath(path.data(), path.data() + path.size());
+  if (!header.empty())
+  {
+    req.addHeader(header.data(), strchr(header.data(), ':'), header.data() + header.size());
+  }
+  return req;
+}
+
+void render(HttpResponse* resp, const string& body, const char* header = NULL, const char* value = NULL)
+{
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setContentType("text/plain");
+  if (header)
+  {
+    resp->addHeader(header, value);
+  }
+  resp->setBody(body);
+}
+
+string hitOf(const HttpResponseCache::EntryPtr& entry)
+{
+  return entry->statusLine + *entry->rest;
+}
+
+size_t count(const string& s, const string& what)
+{
+  size_t n = 0;
+  for (size_t pos = s.find(what); pos != string::npos; pos = s.find(what, pos + 1))
+  {
+    ++n;
+  }
+  return n;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testHitMissExpire)
+{
+  HttpResponseCache cache(10.0);
+  Timestamp now = Timestamp::now();
+  string key;
+  HttpResponseCache::EntryPtr entry;
+
+  BOOST_CHECK_EQUAL(cache.lookup(get("/a"), now, &key, &entry), HttpResponseCache::kMiss);
+  HttpResponse resp(false);
+  render(&resp, "hello");
+  cache.fill(key, resp);
+  BOOST_CHECK_EQUAL(cache.entries(), 1);
+
+  BOOST_CHECK_EQUAL(cache.lookup(get("/a"), now, &key, &entry), HttpResponseCache::kHit);
+  BOOST_CHECK_EQUAL(hitOf(entry),
+      "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nContent-Type: text/plain\r\n\r\nhello");
+
+  // the query and the key headers are part of the key
+  BOOST_CHECK_EQUAL(cache.lookup(get("/a?x=1"), now, &key, &entry), HttpResponseCache::kMiss);
+  cache.abandon(key);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/a", "Accept-Encoding: gzip"), now, &key, &entry),
+                    HttpResponseCache::kMiss);
+  cache.abandon(key);
+
+  // not for the cache
+  BOOST_CHECK_EQUAL(cache.lookup(get("/a", "If-None-Match: \"x\""), now, &key, &entry),
+                    HttpResponseCache::kUncacheable);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/a", "Range: bytes=0-1"), now, &key, &entry),
+                    HttpResponseCache::kUncacheable);
+  // may be rendered for this user only
+  BOOST_CHECK_EQUAL(cache.lookup(get("/a", "Cookie: session=1"), now, &key, &entry),
+                    HttpResponseCache::kUncacheable);
+
+  BOOST_CHECK_EQUAL(cache.lookup(get("/a"), addTime(now, 11.0), &key, &entry),
+                    HttpResponseCache::kMiss);
+  BOOST_CHECK_EQUAL(cache.entries(), 0);
+  BOOST_CHECK_EQUAL(cache.bytes(), 0);
+  cache.abandon(key);
+}
+
+BOOST_AUTO_TEST_CASE(testWhatIsKept)
+{
+  HttpResponseCache cache(10.0);
+  Timestamp now = Timestamp::now();
+  string key;
+  HttpResponseCache::EntryPtr entry;
+  const char* headers[][2] = {
+    {"Set-Cookie", "id=1"},
+    {"Cache-Control", "no-store"},
+    {"Cache-Control", "private, max-age=60"},
+    {"Cache-Control", "max-age=0"},
+  };
+  int i = 0;
+  for (const auto& header : headers)
+  {
+    const string path = "/b" + std::to_string(i++);
+    BOOST_CHECK_EQUAL(cache.lookup(get(path), now, &key, &entry), HttpResponseCache::kMiss);
+    HttpResponse resp(false);
+    render(&resp, "secret", header[0], header[1]);
+    cache.fill(key, resp);
+    // only a marker, the next ones render without waiting for each other
+    BOOST_CHECK_EQUAL(cache.lookup(get(path), now, &key, &entry), HttpResponseCache::kUncacheable);
+  }
+  BOOST_CHECK_EQUAL(cache.lookup(get("/b"), now, &key, &entry), HttpResponseCache::kMiss);
+  HttpResponse error(false);
+  error.setStatusCode(HttpResponse::k500InternalServerError);
+  cache.fill(key, error);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/b"), now, &key, &entry), HttpResponseCache::kUncacheable);
+  BOOST_CHECK_EQUAL(cache.entries(), 5);
+  // the marker is short-lived, the answer may be cacheable by then
+  const Timestamp later = addTime(now, HttpResponseCache::kUncacheableSeconds + 1);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/b"), later, &key, &entry), HttpResponseCache::kMiss);
+  cache.abandon(key);
+
+  // max-age wins over the ttl
+  BOOST_CHECK_EQUAL(cache.lookup(get("/c"), now, &key, &entry), HttpResponseCache::kMiss);
+  HttpResponse resp(false);
+  render(&resp, "short", "Cache-Control", "public, max-age=1");
+  cache.fill(key, resp);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/c"), now, &key, &entry), HttpResponseCache::kHit);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/c"), addTime(now, 2.0), &key, &entry),
+                    HttpResponseCache::kMiss);
+}
+
+BOOST_AUTO_TEST_CASE(testEvictAndSingleFlight)
+{
+  HttpResponseCache cache(10.0, 1000);
+  Timestamp now = Timestamp::now();
+  string key;
+  HttpResponseCache::EntryPtr entry;
+  for (int i = 0; i < 10; ++i)
+  {
+    string path = "/" + std::to_string(i);
+    BOOST_CHECK_EQUAL(cache.lookup(get(path), now, &key, &entry), HttpResponseCache::kMiss);
+    HttpResponse resp(false);
+    render(&resp, string(200, 'x'));
+    cache.fill(key, resp);
+    BOOST_CHECK_LE(cache.bytes(), 1000);
+  }
+  BOOST_CHECK_LT(cache.entries(), 10);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/9"), now, &key, &entry), HttpResponseCache::kHit);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/0"), now, &key, &entry), HttpResponseCache::kMiss);
+  cache.abandon(key);
+
+  // the second lookup waits for the first to render
+  BOOST_CHECK_EQUAL(cache.lookup(get("/d"), now, &key, &entry), HttpResponseCache::kMiss);
+  string key2;
+  BOOST_CHECK_EQUAL(cache.lookup(get("/d"), now, &key2, &entry), HttpResponseCache::kBusy);
+  HttpResponseCache::EntryPtr waited;
+  int calls = 0;
+  BOOST_CHECK(cache.wait(key2, [&](const HttpResponseCache::EntryPtr& e) { waited = e; ++calls; }));
+  HttpResponse resp(false);
+  render(&resp, "rendered once");
+  cache.fill(key, resp);
+  BOOST_CHECK_EQUAL(calls, 1);
+  BOOST_REQUIRE(waited);
+  BOOST_CHECK(waited->rest->find("rendered once") != string::npos);
+  BOOST_CHECK(!cache.wait(key2, [&](const HttpResponseCache::EntryPtr&) { ++calls; }));
+
+  // an abandoned rendering wakes the waiters with nothing
+  BOOST_CHECK_EQUAL(cache.lookup(get("/e"), now, &key, &entry), HttpResponseCache::kMiss);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/e"), now, &key2, &entry), HttpResponseCache::kBusy);
+  BOOST_CHECK(cache.wait(key2, [&](const HttpResponseCache::EntryPtr& e) { waited = e; ++calls; }));
+  cache.abandon(key);
+  BOOST_CHECK_EQUAL(calls, 2);
+  BOOST_CHECK(!waited);
+
+  // so does one that could not be kept
+  BOOST_CHECK_EQUAL(cache.lookup(get("/f"), now, &key, &entry), HttpResponseCache::kMiss);
+  BOOST_CHECK_EQUAL(cache.lookup(get("/f"), now, &key2, &entry), HttpResponseCache::kBusy);
+  waited = entry;
+  BOOST_CHECK(cache.wait(key2, [&](const HttpResponseCache::EntryPtr& e) { waited = e; ++calls; }));
+  HttpResponse secret(false);
+  render(&secret, "secret", "Cache-Control", "no-store");
+  cache.fill(key, secret);
+  BOOST_CHECK_EQUAL(calls, 3);
+  BOOST_CHECK(!waited);
+}
+
+BOOST_AUTO_TEST_CASE(testServer)
+{
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  server.setResponseCache(std::make_shared<HttpResponseCache>(10.0));
+  int calls = 0;
+  server.setHttpCallback([&calls](const HttpRequest& req, HttpResponse* resp)
+      {
+        ++calls;
+        render(resp, req.path());
+      });
+  server.start();
+
+  string response = roundTrip(&loop, kPort,
+      "GET /a HTTP/1.1\r\n\r\n"
+      "GET /a HTTP/1.1\r\n\r\n"
+      "GET /b HTTP/1.1\r\n\r\n"
+      "GET /a HTTP/1.1\r\nConnection: close\r\n\r\n");
+  BOOST_CHECK_EQUAL(calls, 2);
+  BOOST_CHECK_EQUAL(count(response, "HTTP/1.1 200 OK\r\n"), 4);
+  BOOST_CHECK_EQUAL(count(response, "\r\n\r\n/a"), 3);
+  BOOST_CHECK_EQUAL(count(response, "Connection: Keep-Alive\r\n"), 3);
+  BOOST_CHECK_EQUAL(count(response, "Content-Length: 2\r\n"), 4);
+  BOOST_CHECK(response.find("Connection: close\r\n") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(testAsyncSingleFlight)
+{
+  muduo::ThreadPool pool("Workers");
+  pool.start(2);
+
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  server.setResponseCache(std::make_shared<HttpResponseCache>(10.0));
+  std::atomic<int> calls(0);
+  server.setAsyncHttpCallback([&](const HttpRequest& req, const HttpResponder& responder)
+      {
+        ++calls;
+        string path = req.path();
+        pool.run([responder, path]
+            {
+              ::usleep(100 * 1000);
+              render(responder.response(), path);
+              responder.done();
+            });
+      });
+  server.start();
+
+  // the second and third wait for the first, the fourth is a hit
+  string response = roundTrip(&loop, kPort,
+      "GET /slow HTTP/1.1\r\n\r\n"
+      "GET /slow HTTP/1.1\r\n\r\n"
+      "GET /slow HTTP/1.1\r\n\r\n"
+      "GET /other HTTP/1.1\r\n\r\n"
+      "GET /slow HTTP/1.1\r\nConnection: close\r\n\r\n");
+  BOOST_CHECK_EQUAL(calls, 2);
+  BOOST_CHECK_EQUAL(count(response, "\r\n\r\n/slow"), 4);
+  BOOST_CHECK_EQUAL(count(response, "\r\n\r\n/other"), 1);
+  BOOST_CHECK_LT(response.find("/other"), response.rfind("/slow"));
+  pool.stop();
+}
@@ -0,0 +1,104 @@
+#include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/Buffer.h"
+
+//#define BOOST_TEST_MODULE HttpResponseTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::HttpResponse;
+
+namespace
+{
+
+string serialize(const HttpResponse& resp)
+{
+  Buffer buf;
+  resp.appendToBuffer(&buf);
+  return buf.retrieveAllAsString();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testStatusLine)
+{
+  HttpResponse resp(false);
+  resp.setStatusCode(HttpResponse::k404NotFound);
+  BOOST_CHECK_EQUAL(serialize(resp),
+      "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: Keep-Alive\r\n\r\n");
+
+  resp.setStatusMessage("Not Found");
+  BOOST_CHECK_EQUAL(serialize(resp),
+      "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: Keep-Alive\r\n\r\n");
+
+  resp.setStatusMessage("Gone Fishing");
+  BOOST_CHECK_EQUAL(serialize(resp),
+      "HTTP/1.1 404 Gone Fishing\r\nContent-Length: 0\r\nConnection: Keep-Alive\r\n\r\n");
+
+  resp.setStatusCode(static_cast<HttpResponse::HttpStatusCode>(418));
+  resp.setStatusMessage("I'm a teapot");
+  resp.setCloseConnection(true);
+  BOOST_CHECK_EQUAL(serialize(resp),
+      "HTTP/1.1 418 I'm a teapot\r\nConnection: close\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(testHeaders)
+{
+  HttpResponse resp(false);
+  resp.setStatusCode(HttpResponse::k200Ok);
+  resp.setContentType("text/plain");
+  resp.addHeader("Server", "Muduo");
+  resp.addHeader("content-type", "text/html");
+  resp.setBody(string(1234567, 'x'));
+  string s = serialize(resp);
+  BOOST_CHECK_EQUAL(s.substr(0, s.find("\r\n\r\n") + 4),
+      "HTTP/1.1 200 OK\r\nContent-Length: 1234567\r\nConnection: Keep-Alive\r\n"
+      "Server: Muduo\r\ncontent-type: text/html\r\n\r\n");
+  BOOST_CHECK_EQUAL(s.size() - s.find("\r\n\r\n") - 4, 1234567);
+
+  resp.reset(true);
+  resp.setStatusCode(HttpResponse::k204NoContent);
+  BOOST_CHECK_EQUAL(serialize(resp),
+      "HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(testDate)
+{
+  HttpResponse resp(false);
+  resp.setStatusCode(HttpResponse::k200Ok);
+  resp.setDate(Timestamp(784111777LL * Timestamp::kMicroSecondsPerSecond));
+  resp.setBody("hello");
+  BOOST_CHECK_EQUAL(serialize(resp),
+      "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: Keep-Alive\r\n"
+      "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n\r\nhello");
+
+  resp.setDate(Timestamp(784111778LL * Timestamp::kMicroSecondsPerSecond + 500000));
+  BOOST_CHECK_EQUAL(serialize(resp),
+      "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: Keep-Alive\r\n"
+      "Date: Sun, 06 Nov 1994 08:49:38 GMT\r\n\r\nhello");
+}
+
+BOOST_AUTO_TEST_CASE(testBodyBlock)
+{
+  std::shared_ptr<const string> block(new string("{\"ok\":true}"));
+  HttpResponse resp(false);
+  resp.setStatusCode(HttpResponse::k200Ok);
+  resp.setBody(block);
+  BOOST_CHECK(resp.bodyBlock() == block);
+
+  Buffer head;
+  resp.appendHeadToBuffer(&head);
+  BOOST_CHECK_EQUAL(head.retrieveAllAsString(),
+      "HTTP/1.1 200 OK\r\nContent-Length: 11\r\nConnection: Keep-Alive\r\n\r\n");
+  BOOST_CHECK_EQUAL(serialize(resp),
+      "HTTP/1.1 200 OK\r\nContent-Length: 11\r\nConnection: Keep-Alive\r\n\r\n{\"ok\":true}");
+
+  string body("moved");
+  resp.setBody(std::move(body));
+  BOOST_CHECK(!resp.bodyBlock());
+  BOOST_CHECK_EQUAL(serialize(resp),
+      "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: Keep-Alive\r\n\r\nmoved");
+}
@@ -0,0 +1,169 @@
+#include "muduo/net/http/HttpRouter.h"
+#include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/Buffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//#define BOOST_TEST_MODULE HttpRouterTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::StringPiece;
+using namespace muduo::net;
+
+namespace
+{
+
+// the handler says who it is and what it got
+HttpRouter::Handler named(const string& name)
+{
+  return [name](const HttpRequest&, const HttpRouter::Params& params, HttpResponse* resp)
+      {
+        string body = name;
+        for (int i = 0; i < params.size(); ++i)
+        {
+          body += " " + params.name(i).as_string() + "=" + params.value(i).as_string();
+        }
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(body);
+      };
+}
+
+string route(const HttpRouter& router, HttpRequest::Method method, const string& path)
+{
+  HttpRequest req;
+  const char* name = method == HttpRequest::kGet ? "GET" :
+                     method == HttpRequest::kPost ? "POST" : "DELETE";
+  req.setMethod(name, name + strlen(name));
+  req.setPath(path.data(), path.data() + path.size());
+  HttpResponse resp(true);
+  router.route(req, &resp);
+  Buffer buf;
+  resp.appendToBuffer(&buf);
+  string s = buf.retrieveAllAsString();
+  // "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\nbody" -> "body"
+  size_t body = s.find("\r\n\r\n");
+  return s.substr(body + 4).empty() ? s.substr(9, 3) : s.substr(body + 4);
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testStaticParamWildcard)
+{
+  HttpRouter router;
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/", named("root")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users", named("users")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users/new", named("newUser")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users/:id", named("user")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users/:id/posts/:post", named("post")));
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/uploads/*file", named("upload")));
+  BOOST_CHECK(router.add(HttpRequest::kPost, "/users", named("createUser")));
+  BOOST_CHECK(router.add("/any/:x", named("any")));
+
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/"), "root");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/users"), "users");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/users/new"), "newUser");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/users/newer"), "user id=newer");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/users/42"), "user id=42");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/users/42/posts/7"), "post id=42 post=7");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/uploads/a/b.png"), "upload file=a/b.png");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kPost, "/users"), "createUser");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kDelete, "/any/1"), "any x=1");
+
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/users/"), "404");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/users/42/posts"), "404");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/nowhere"), "404");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kDelete, "/users"), "405");
+
+  HttpRouter::Params params;
+  BOOST_REQUIRE(router.find(HttpRequest::kGet, "/users/42/posts/7", &params) != NULL);
+  BOOST_CHECK(params.get("post") == "7");
+  BOOST_CHECK(params.get("nothing").data() == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(testBadPatterns)
+{
+  HttpRouter router;
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/users/:id", named("user")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/users/:name/posts", named("clash")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "users", named("relative")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/*rest/b", named("wildcardNotLast")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/x:y", named("halfSegment")));
+  BOOST_CHECK(!router.add(HttpRequest::kGet, "/a/:", named("noName")));
+  // the good route is still there
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/users/1"), "user id=1");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/users/1/posts"), "404");
+}
+
+BOOST_AUTO_TEST_CASE(testManyRoutes)
+{
+  HttpRouter router;
+  for (int i = 0; i < 400; ++i)
+  {
+    char pattern[64];
+    snprintf(pattern, sizeof pattern, "/api/v%d/service%d/:id", i % 3, i);
+    BOOST_REQUIRE(router.add(HttpRequest::kGet, pattern, named(pattern)));
+  }
+  for (int i = 0; i < 400; ++i)
+  {
+    char path[64], expected[96];
+    snprintf(path, sizeof path, "/api/v%d/service%d/abc", i % 3, i);
+    snprintf(expected, sizeof expected, "/api/v%d/service%d/:id id=abc", i % 3, i);
+    BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, path), expected);
+  }
+
+  router.remove(HttpRequest::kGet, "/api/v1/service1/:id");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/api/v1/service1/abc"), "404");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/api/v1/service10/abc"),
+                    "/api/v1/service10/:id id=abc");
+}
+
+BOOST_AUTO_TEST_CASE(testBatch)
+{
+  HttpRouter router;
+  BOOST_CHECK(router.add(HttpRequest::kGet, "/old", named("old")));
+  {
+    HttpRouter::Batch batch(&router);
+    for (int i = 0; i < 400; ++i)
+    {
+      BOOST_REQUIRE(router.add(HttpRequest::kGet, "/batch/" + std::to_string(i), named("batch")));
+    }
+    BOOST_CHECK(router.add(HttpRequest::kGet, "/batch/:id", named("param")));
+    BOOST_CHECK(!router.add(HttpRequest::kGet, "/batch/:clash/x", named("clash")));
+    router.remove(HttpRequest::kGet, "/old");
+    // not published yet
+    BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/old"), "old");
+    BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/batch/7"), "404");
+  }
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/old"), "404");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/batch/7"), "batch");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/batch/x"), "param id=x");
+  BOOST_CHECK_EQUAL(route(router, HttpRequest::kGet, "/batch/x/x"), "404");
+}
+
+BOOST_AUTO_TEST_CASE(testReplacedTables)
+{
+  std::shared_ptr<int> token(new int(0));
+  std::weak_ptr<int> weakToken(token);
+  {
+    HttpRouter router;
+    router.add(HttpRequest::kGet, "/token", [token](const HttpRequest&, const HttpRouter::Params&, HttpResponse*) {});
+    token.reset();
+
+    HttpRouter::Params params;
+    const HttpRouter::Handler* handler = router.find(HttpRequest::kGet, "/token", &params);
+    BOOST_REQUIRE(handler != NULL);
+    router.remove(HttpRequest::kGet, "/token");
+    for (int i = 0; i < 100; ++i)
+    {
+      router.add(HttpRequest::kGet, "/other", named("other"));
+    }
+    // a lookup may still be on the old table
+    BOOST_CHECK(router.find(HttpRequest::kGet, "/token", &params) == NULL);
+    BOOST_CHECK(!weakToken.expired());
+  }
+  BOOST_CHECK(weakToken.expired());
+}
@@ -0,0 +1,225 @@
+#include "muduo/net/http/HttpServer.h"
+#include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/http/tests/HttpTestUtil.h"
+
+#include "muduo/base/ThreadPool.h"
+
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE HttpServerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::Timestamp;
+using namespace muduo::net;
+using muduo::net::test::roundTrip;
+
+namespace
+{
+
+const uint16_t kPort = 29890;
+
+void onRequest(const HttpRequest& req, HttpResponse* resp)
+{
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setStatusMessage("OK");
+  resp->setBody(req.path() + ":" + req.body());
+}
+
+// The Date lines change every second, checks and removes them.
+string withoutDate(const string& response)
+{
+  string result;
+  size_t pos = 0;
+  size_t date;
+  while ((date = response.find("Date: ", pos)) != string::npos)
+  {
+    size_t end = response.find("\r\n", date);
+    BOOST_REQUIRE(end != string::npos);
+    // "Date: Sun, 06 Nov 1994 08:49:37 GMT"
+    BOOST_CHECK_EQUAL(end - date, 35);
+    BOOST_CHECK_EQUAL(response.substr(end - 4, 4), " GMT");
+    result.append(response, pos, date - pos);
+    pos = end + 2;
+  }
+  result.append(response, pos, string::npos);
+  return result;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testPipelinedRequests)
+{
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  server.setHttpCallback(onRequest);
+  server.start();
+
+  string response = roundTrip(&loop, kPort,
+      "GET /a HTTP/1.1\r\n\r\n"
+      "POST /b HTTP/1.1\r\nContent-Length: 3\r\n\r\nxyz"
+      "GET /c HTTP/1.1\r\nConnection: close\r\n\r\n"
+      "GET /d HTTP/1.1\r\n\r\n");
+  BOOST_CHECK(response.find("\r\nDate: ") != string::npos);
+  string expected =
+      "HTTP/1.1 200 OK\r\nContent-Length: 3\r\nConnection: Keep-Alive\r\n\r\n/a:"
+      "HTTP/1.1 200 OK\r\nContent-Length: 6\r\nConnection: Keep-Alive\r\n\r\n/b:xyz"
+      "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n/c:";
+  BOOST_CHECK_EQUAL(withoutDate(response), expected);
+}
+
+BOOST_AUTO_TEST_CASE(testPipelinedBadRequest)
+{
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  server.setHttpCallback(onRequest);
+  server.start();
+
+  string response = roundTrip(&loop, kPort,
+      "GET /a HTTP/1.1\r\n\r\n"
+      "BREW /pot HTTP/1.1\r\n\r\n");
+  string expected =
+      "HTTP/1.1 200 OK\r\nContent-Length: 3\r\nConnection: Keep-Alive\r\n\r\n/a:"
+      "HTTP/1.1 400 Bad Request\r\n\r\n";
+  BOOST_CHECK_EQUAL(withoutDate(response), expected);
+}
+
+BOOST_AUTO_TEST_CASE(testBodyBlock)
+{
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  std::shared_ptr<const string> block(new string(100 * 1000, 'x'));
+  server.setHttpCallback([block](const HttpRequest&, HttpResponse* resp)
+      {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(block);
+      });
+  server.start();
+
+  string response = roundTrip(&loop, kPort,
+      "GET /a HTTP/1.1\r\n\r\n"
+      "GET /b HTTP/1.0\r\n\r\n");
+  string expected =
+      "HTTP/1.1 200 OK\r\nContent-Length: 100000\r\nConnection: Keep-Alive\r\n\r\n"
+      + *block +
+      "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n"
+      + *block;
+  BOOST_CHECK(withoutDate(response) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(testBodyFileWithoutOwner)
+{
+  char path[] = "/tmp/HttpServer_unittest_XXXXXX";
+  int fd = ::mkstemp(path);
+  BOOST_REQUIRE(fd >= 0);
+  ::unlink(path);
+  // more than the socket takes at once, the rest waits in the output queue
+  const string content(8 * 1000 * 1000, 'f');
+  BOOST_REQUIRE_EQUAL(::write(fd, content.data(), content.size()),
+                      static_cast<ssize_t>(content.size()));
+
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  std::shared_ptr<const string> block(new string(1000, 'x'));
+  server.setHttpCallback([&](const HttpRequest& req, HttpResponse* resp)
+      {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        if (req.path() == "/file")
+        {
+          resp->setBodyFile(fd, 0, content.size(), nullptr); // we keep fd open
+        }
+        else
+        {
+          resp->setBody(block);
+        }
+      });
+  server.start();
+
+  string response = roundTrip(&loop, kPort,
+      "GET /file HTTP/1.1\r\n\r\n"
+      "GET /block HTTP/1.0\r\n\r\n");
+  ::close(fd);
+  string expected =
+      "HTTP/1.1 200 OK\r\nContent-Length: 8000000\r\nConnection: Keep-Alive\r\n\r\n"
+      + content +
+      "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n"
+      + *block;
+  BOOST_CHECK_EQUAL(response.size() - withoutDate(response).size(), 2 * 37);
+  BOOST_CHECK(withoutDate(response) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(testAsyncInOrder)
+{
+  muduo::ThreadPool pool("Workers");
+  pool.start(4);
+
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  server.setAsyncHttpCallback([&pool](const HttpRequest& req, const HttpResponder& responder)
+      {
+        if (req.path() == "/now")
+        {
+          responder.response()->setStatusCode(HttpResponse::k200Ok);
+          responder.response()->setBody("now");
+          responder.done();
+          return;
+        }
+        // later ones finish first
+        int delayMs = 100 - 10 * (req.path()[1] - 'a');
+        string path = req.path();
+        pool.run([responder, delayMs, path]
+            {
+              ::usleep(delayMs * 1000);
+              HttpResponse* resp = responder.response();
+              resp->setStatusCode(HttpResponse::k200Ok);
+              resp->setBody(path);
+              responder.done();
+            });
+      });
+  server.start();
+
+  string response = roundTrip(&loop, kPort,
+      "GET /a HTTP/1.1\r\n\r\n"
+      "GET /now HTTP/1.1\r\n\r\n"
+      "GET /b HTTP/1.1\r\n\r\n"
+      "BREW /pot HTTP/1.1\r\n\r\n"
+      "GET /c HTTP/1.1\r\n\r\n");
+  string expected =
+      "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: Keep-Alive\r\n\r\n/a"
+      "HTTP/1.1 200 OK\r\nContent-Length: 3\r\nConnection: Keep-Alive\r\n\r\nnow"
+      "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: Keep-Alive\r\n\r\n/b"
+      "HTTP/1.1 400 Bad Request\r\n\r\n";
+  BOOST_CHECK_EQUAL(withoutDate(response), expected);
+  pool.stop();
+}
+
+BOOST_AUTO_TEST_CASE(testCompression)
+{
+  EventLoop loop;
+  HttpServer server(&loop, InetAddress(kPort, true), "HttpServer");
+  server.setCompressor(std::make_shared<HttpCompressor>());
+  server.setHttpCallback([](const HttpRequest&, HttpResponse* resp)
+      {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->setBody(string(10000, 'x'));
+      });
+  server.start();
+
+  string response = roundTrip(&loop, kPort,
+      "GET /a HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n"
+      "GET /b HTTP/1.1\r\nConnection: close\r\n\r\n");
+  size_t second = response.find("HTTP/1.1 200 OK", 1);
+  BOOST_REQUIRE(second != string::npos);
+  string first = response.substr(0, second);
+  BOOST_CHECK(first.find("\r\nContent-Encoding: gzip\r\n") != string::npos);
+  BOOST_CHECK(first.find("\r\nVary: Accept-Encoding\r\n") != string::npos);
+  BOOST_CHECK_LT(first.size(), 1000);
+  BOOST_CHECK(response.find("Content-Encoding", second) == string::npos);
+  BOOST_CHECK(response.find(string(10000, 'x'), second) != string::npos);
+}
@@ -0,0 +1,47 @@
+// Helpers shared by the unit tests of muduo/net/http.
+
+#ifndef MUDUO_NET_HTTP_TESTS_HTTPTESTUTIL_H
+#define MUDUO_NET_HTTP_TESTS_HTTPTESTUTIL_H
+
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+
+namespace muduo
+{
+namespace net
+{
+namespace test
+{
+
+// Sends @c request in one piece to the server listening on @c port of
+// the loopback, collects what comes back until the server closes.
+inline string roundTrip(EventLoop* loop, uint16_t port, const string& request)
+{
+  TcpClient client(loop, InetAddress(port, true), "HttpClient");
+  string response;
+  client.setConnectionCallback([&](const TcpConnectionPtr& conn)
+      {
+        if (conn->connected())
+        {
+          conn->send(request);
+        }
+        else
+        {
+          // let the server see the close too
+          loop->runAfter(0.1, [loop] { loop->quit(); });
+        }
+      });
+  client.setMessageCallback(
+      [&](const TcpConnectionPtr&, Buffer* buf, Timestamp)
+      { response += buf->retrieveAllAsString(); });
+  client.connect();
+  loop->runAfter(5.0, [loop] { loop->quit(); });
+  loop->loop();
+  return response;
+}
+
+}  // namespace test
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_HTTP_TESTS_HTTPTESTUTIL_H
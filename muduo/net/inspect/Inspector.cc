@@ -18,11 +18,7 @@
 #include "muduo/net/inspect/PerformanceInspector.h"
 #include "muduo/net/inspect/SystemInspector.h"
 
-//#include <iostream>
-//#include <iterator>
-//#include <sstream>
-//#include <boost/algorithm/string/classification.hpp>
-//#include <boost/algorithm/string/split.hpp>
+#include <algorithm>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -31,27 +27,21 @@ namespace
 {
 Inspector* g_globalInspector = 0;
 
-// Looks buggy
-std::vector<string> split(const string& str)
+// "a/b//c" -> "a", "b", "c"
+std::vector<string> split(const StringPiece& str)
 {
   std::vector<string> result;
-  size_t start = 0;
-  size_t pos = str.find('/');
-  while (pos != string::npos)
+  const char* start = str.data();
+  const char* end = str.data() + str.size();
+  while (start < end)
   {
-    if (pos > start)
+    const char* slash = std::find(start, end, '/');
+    if (slash > start)
     {
-      result.push_back(str.substr(start, pos-start));
+      result.push_back(string(start, slash));
     }
-    start = pos+1;
-    pos = str.find('/', start);
+    start = slash + 1;
   }
-
-  if (start < str.length())
-  {
-    result.push_back(str.substr(start));
-  }
-
   return result;
 }
 
@@ -69,7 +59,15 @@ Inspector::Inspector(EventLoop* loop,
   assert(CurrentThread::isMainThread());
   assert(g_globalInspector == 0);
   g_globalInspector = this;
-  server_.setHttpCallback(std::bind(&Inspector::onRequest, this, _1, _2));
+  router_.add("/", std::bind(&Inspector::onHelp, this, _1, _2, _3));
+  router_.add("/favicon.ico", [](const HttpRequest&, const HttpRouter::Params&, HttpResponse* resp)
+      {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("image/png");
+        resp->setBody(string(favicon, sizeof favicon));
+      });
+  server_.setHttpCallback(std::bind(&HttpRouter::route, &router_, _1, _2));
   processInspector_->registerCommands(this);
   systemInspector_->registerCommands(this);
 #ifdef HAVE_TCMALLOC
@@ -90,19 +88,25 @@ void Inspector::add(const string& module,
                     const Callback& cb,
                     const string& help)
 {
+  // /module/command, and /module/command/arg1/arg2
+  const string path = "/" + module + "/" + command;
+  HttpRouter::Handler handler = std::bind(&Inspector::onCommand, cb, _1, _2, _3);
+  router_.add(path, handler);
+  router_.add(path + "/*args", handler);
   MutexLockGuard lock(mutex_);
-  modules_[module][command] = cb;
   helps_[module][command] = help;
 }
 
 void Inspector::remove(const string& module, const string& command)
 {
+  const string path = "/" + module + "/" + command;
+  router_.remove(path);
+  router_.remove(path + "/*args");
   MutexLockGuard lock(mutex_);
-  std::map<string, CommandList>::iterator it = modules_.find(module);
-  if (it != modules_.end())
+  std::map<string, HelpList>::iterator it = helps_.find(module);
+  if (it != helps_.end())
   {
     it->second.erase(command);
-    helps_[module].erase(command);
   }
 }
 
@@ -111,11 +115,10 @@ void Inspector::start()
   server_.start();
 }
 
-void Inspector::onRequest(const HttpRequest& req, HttpResponse* resp)
+void Inspector::onHelp(const HttpRequest&, const HttpRouter::Params&, HttpResponse* resp)
 {
-  if (req.path() == "/")
+  string result;
   {
-    string result;
     MutexLockGuard lock(mutex_);
     for (std::map<string, HelpList>::const_iterator helpListI = helps_.begin();
          helpListI != helps_.end();
@@ -134,72 +137,29 @@ void Inspector::onRequest(const HttpRequest& req, HttpResponse* resp)
         result += "\n";
       }
     }
+  }
+  resp->setStatusCode(HttpResponse::k200Ok);
+  resp->setStatusMessage("OK");
+  resp->setContentType("text/plain");
+  resp->setBody(std::move(result));
+}
+
+void Inspector::onCommand(const Callback& cb,
+                          const HttpRequest& req,
+                          const HttpRouter::Params& params,
+                          HttpResponse* resp)
+{
+  if (cb)
+  {
     resp->setStatusCode(HttpResponse::k200Ok);
     resp->setStatusMessage("OK");
     resp->setContentType("text/plain");
-    resp->setBody(result);
+    resp->setBody(cb(req.method(), split(params.get("args"))));
   }
   else
   {
-    std::vector<string> result = split(req.path());
-    // boost::split(result, req.path(), boost::is_any_of("/"));
-    //std::copy(result.begin(), result.end(), std::ostream_iterator<string>(std::cout, ", "));
-    //std::cout << "\n";
-    bool ok = false;
-    if (result.size() == 0)
-    {
-      LOG_DEBUG << req.path();
-    }
-    else if (result.size() == 1)
-    {
-      string module = result[0];
-      if (module == "favicon.ico")
-      {
-        resp->setStatusCode(HttpResponse::k200Ok);
-        resp->setStatusMessage("OK");
-        resp->setContentType("image/png");
-        resp->setBody(string(favicon, sizeof favicon));
-
-        ok = true;
-      }
-      else
-      {
-        LOG_ERROR << "Unimplemented " << module;
-      }
-    }
-    else
-    {
-      string module = result[0];
-      MutexLockGuard lock(mutex_);
-      std::map<string, CommandList>::const_iterator commListI = modules_.find(module);
-      if (commListI != modules_.end())
-      {
-        string command = result[1];
-        const CommandList& commList = commListI->second;
-        CommandList::const_iterator it = commList.find(command);
-        if (it != commList.end())
-        {
-          ArgList args(result.begin()+2, result.end());
-          if (it->second)
-          {
-            resp->setStatusCode(HttpResponse::k200Ok);
-            resp->setStatusMessage("OK");
-            resp->setContentType("text/plain");
-            const Callback& cb = it->second;
-            resp->setBody(cb(req.method(), args));
-            ok = true;
-          }
-        }
-      }
-
-    }
-
-    if (!ok)
-    {
-      resp->setStatusCode(HttpResponse::k404NotFound);
-      resp->setStatusMessage("Not Found");
-    }
-    //resp->setCloseConnection(true);
+    resp->setStatusCode(HttpResponse::k404NotFound);
+    resp->setStatusMessage("Not Found");
   }
 }
 
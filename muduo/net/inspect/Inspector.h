@@ -13,6 +13,7 @@
 
 #include "muduo/base/Mutex.h"
 #include "muduo/net/http/HttpRequest.h"
+#include "muduo/net/http/HttpRouter.h"
 #include "muduo/net/http/HttpServer.h"
 
 #include <map>
@@ -46,18 +47,19 @@ class Inspector : noncopyable
   void remove(const string& module, const string& command);
 
  private:
-  typedef std::map<string, Callback> CommandList;
   typedef std::map<string, string> HelpList;
 
   void start();
-  void onRequest(const HttpRequest& req, HttpResponse* resp);
+  void onHelp(const HttpRequest& req, const HttpRouter::Params&, HttpResponse* resp);
+  static void onCommand(const Callback& cb, const HttpRequest& req,
+                        const HttpRouter::Params& params, HttpResponse* resp);
 
   HttpServer server_;
   std::unique_ptr<ProcessInspector> processInspector_;
   std::unique_ptr<PerformanceInspector> performanceInspector_;
   std::unique_ptr<SystemInspector> systemInspector_;
+  HttpRouter router_;
   MutexLock mutex_;
-  std::map<string, CommandList> modules_ GUARDED_BY(mutex_);
   std::map<string, HelpList> helps_ GUARDED_BY(mutex_);
 };
 
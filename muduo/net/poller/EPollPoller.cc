@@ -39,7 +39,12 @@ const int kDeleted = 2;
 EPollPoller::EPollPoller(EventLoop* loop)
   : Poller(loop),
     epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
-    events_(kInitEventListSize)
+    events_(kInitEventListSize),
+#ifndef NO_EPOLL_PWAIT2
+    hasPwait2_(true)
+#else
+    hasPwait2_(false)
+#endif
 {
   if (epollfd_ < 0)
   {
@@ -59,6 +64,35 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
                                &*events_.begin(),
                                static_cast<int>(events_.size()),
                                timeoutMs);
+  return pollReturned(numEvents, activeChannels);
+}
+
+Timestamp EPollPoller::pollMicroSeconds(int64_t timeoutUs, ChannelList* activeChannels)
+{
+#ifndef NO_EPOLL_PWAIT2
+  if (hasPwait2_)
+  {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeoutUs / Timestamp::kMicroSecondsPerSecond);
+    ts.tv_nsec = static_cast<long>(timeoutUs % Timestamp::kMicroSecondsPerSecond * 1000);
+    int numEvents = ::epoll_pwait2(epollfd_,
+                                   &*events_.begin(),
+                                   static_cast<int>(events_.size()),
+                                   timeoutUs < 0 ? NULL : &ts,
+                                   NULL);
+    if (numEvents >= 0 || errno != ENOSYS)
+    {
+      return pollReturned(numEvents, activeChannels);
+    }
+    LOG_WARN << "epoll_pwait2 is not supported, fall back to epoll_wait";
+    hasPwait2_ = false;
+  }
+#endif
+  return Poller::pollMicroSeconds(timeoutUs, activeChannels);
+}
+
+Timestamp EPollPoller::pollReturned(int numEvents, ChannelList* activeChannels)
+{
   int savedErrno = errno;
   Timestamp now(Timestamp::now());
   if (numEvents > 0)
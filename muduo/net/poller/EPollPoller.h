@@ -32,6 +32,7 @@ class EPollPoller : public Poller
   ~EPollPoller() override;
 
   Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+  Timestamp pollMicroSeconds(int64_t timeoutUs, ChannelList* activeChannels) override;
   void updateChannel(Channel* channel) override;
   void removeChannel(Channel* channel) override;
 
@@ -40,6 +41,8 @@ class EPollPoller : public Poller
 
   static const char* operationToString(int op);
 
+  Timestamp pollReturned(int numEvents, ChannelList* activeChannels);
+
   void fillActiveChannels(int numEvents,
                           ChannelList* activeChannels) const;
   void update(int operation, Channel* channel);
@@ -48,6 +51,7 @@ class EPollPoller : public Poller
 
   int epollfd_;
   EventList events_;
+  bool hasPwait2_;  // epoll_pwait2(2) needs Linux 5.11
 };
 
 }  // namespace net
@@ -30,6 +30,21 @@ Timestamp PollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 {
   // XXX pollfds_ shouldn't change
   int numEvents = ::poll(&*pollfds_.begin(), pollfds_.size(), timeoutMs);
+  return pollReturned(numEvents, activeChannels);
+}
+
+Timestamp PollPoller::pollMicroSeconds(int64_t timeoutUs, ChannelList* activeChannels)
+{
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(timeoutUs / Timestamp::kMicroSecondsPerSecond);
+  ts.tv_nsec = static_cast<long>(timeoutUs % Timestamp::kMicroSecondsPerSecond * 1000);
+  int numEvents = ::ppoll(&*pollfds_.begin(), pollfds_.size(),
+                          timeoutUs < 0 ? NULL : &ts, NULL);
+  return pollReturned(numEvents, activeChannels);
+}
+
+Timestamp PollPoller::pollReturned(int numEvents, ChannelList* activeChannels)
+{
   int savedErrno = errno;
   Timestamp now(Timestamp::now());
   if (numEvents > 0)
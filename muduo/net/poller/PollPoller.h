@@ -33,12 +33,14 @@ class PollPoller : public Poller
   ~PollPoller() override;
 
   Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+  Timestamp pollMicroSeconds(int64_t timeoutUs, ChannelList* activeChannels) override;
   void updateChannel(Channel* channel) override;
   void removeChannel(Channel* channel) override;
 
  private:
   void fillActiveChannels(int numEvents,
                           ChannelList* activeChannels) const;
+  Timestamp pollReturned(int numEvents, ChannelList* activeChannels);
 
   typedef std::vector<struct pollfd> PollFdList;
   PollFdList pollfds_;
@@ -0,0 +1,346 @@
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/net/EventLoop.h"
+
+#include <algorithm>
+#include <memory>
+
+//#define BOOST_TEST_MODULE FlowLinkTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using namespace muduo::net;
+using std::placeholders::_1;
+using std::placeholders::_2;
+using std::placeholders::_3;
+
+namespace
+{
+
+const uint16_t kPort = 29878;
+const size_t kHighWaterMark = 1024 * 1024;
+const size_t kLowWaterMark = 256 * 1024;
+const size_t kChunk = 64 * 1024;
+
+// The client reads nothing for a while, the server sends as long as
+// its producer is not paused.
+class Producer
+{
+ public:
+  Producer(EventLoop* loop, size_t total)
+    : received(0),
+      maxOutput(0),
+      lowWaterMarks(0),
+      loop_(loop),
+      server_(loop, InetAddress(kPort, true), "Producer"),
+      client_(loop, InetAddress(kPort, true), "Reader"),
+      chunk_(kChunk, 'x'),
+      total_(total),
+      sent_(0),
+      paused_(false)
+  {
+    server_.setConnectionCallback(
+        std::bind(&Producer::onServerConnection, this, _1));
+    client_.setConnectionCallback(
+        std::bind(&Producer::onClientConnection, this, _1));
+    client_.setMessageCallback(
+        std::bind(&Producer::onClientMessage, this, _1, _2, _3));
+  }
+
+  void run()
+  {
+    server_.start();
+    client_.connect();
+    loop_->runAfter(10.0, [this] { loop_->quit(); });
+    loop_->loop();
+  }
+
+  size_t received;
+  size_t maxOutput;
+  int lowWaterMarks;
+  std::vector<bool> events;
+
+ private:
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setHighWaterMarkCallback(HighWaterMarkCallback(), kHighWaterMark);
+      conn->setLowWaterMarkCallback(
+          [this](const TcpConnectionPtr&, size_t len)
+          {
+            ++lowWaterMarks;
+            BOOST_CHECK_LE(len, kLowWaterMark);
+          },
+          kLowWaterMark);
+      conn_ = conn;
+      conn->linkFlowFrom([this](bool pause)
+          {
+            events.push_back(pause);
+            paused_ = pause;
+            if (!pause)
+            {
+              produce();
+            }
+          });
+      produce();
+    }
+  }
+
+  void produce()
+  {
+    TcpConnectionPtr conn = conn_.lock();
+    while (conn && !paused_ && sent_ < total_)
+    {
+      conn->send(chunk_);
+      sent_ += chunk_.size();
+      maxOutput = std::max(maxOutput, conn->outputBuffer()->readableBytes());
+    }
+  }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->stopRead();
+      loop_->runAfter(0.2, [conn] { conn->startRead(); });
+    }
+    else
+    {
+      loop_->quit();
+    }
+  }
+
+  void onClientMessage(const TcpConnectionPtr&, Buffer* buf, muduo::Timestamp)
+  {
+    received += buf->readableBytes();
+    buf->retrieveAll();
+    if (received >= total_)
+    {
+      client_.disconnect();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  TcpClient client_;
+  std::weak_ptr<TcpConnection> conn_;
+  const string chunk_;
+  const size_t total_;
+  size_t sent_;
+  bool paused_;
+};
+
+// writer -> server source -> server sink -> reader, the reader
+// reads nothing for a while, so the sink pauses the source.
+class Forwarder
+{
+ public:
+  Forwarder(EventLoop* loop, size_t total)
+    : received(0),
+      maxOutput(0),
+      loop_(loop),
+      server_(loop, InetAddress(kPort + 1, true), "Forwarder"),
+      writer_(loop, InetAddress(kPort + 1, true), "Writer"),
+      reader_(loop, InetAddress(kPort + 1, true), "Reader"),
+      message_(total, 'y'),
+      connectionsDown_(0)
+  {
+    server_.setConnectionCallback(
+        std::bind(&Forwarder::onServerConnection, this, _1));
+    server_.setMessageCallback(
+        std::bind(&Forwarder::onServerMessage, this, _1, _2, _3));
+    writer_.setConnectionCallback(
+        std::bind(&Forwarder::onWriterConnection, this, _1));
+    writer_.setWriteCompleteCallback(
+        [](const TcpConnectionPtr& conn) { conn->shutdown(); });
+    reader_.setConnectionCallback(
+        std::bind(&Forwarder::onReaderConnection, this, _1));
+    reader_.setMessageCallback(
+        [this](const TcpConnectionPtr&, Buffer* buf, muduo::Timestamp)
+        {
+          received += buf->readableBytes();
+          buf->retrieveAll();
+        });
+  }
+
+  void run()
+  {
+    server_.start();
+    reader_.connect();
+    loop_->runAfter(10.0, [this] { loop_->quit(); });
+    loop_->loop();
+  }
+
+  size_t received;
+  size_t maxOutput;
+
+ private:
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    TcpConnectionPtr sink = sink_.lock();
+    if (conn->connected())
+    {
+      if (!sink)
+      {
+        conn->setHighWaterMarkCallback(HighWaterMarkCallback(), kHighWaterMark);
+        conn->setLowWaterMarkCallback(LowWaterMarkCallback(), kLowWaterMark);
+        sink_ = conn;
+      }
+      else
+      {
+        sink->linkFlowFrom(conn);
+      }
+    }
+    else if (conn == sink)
+    {
+      connectionDown();
+    }
+    else if (sink)
+    {
+      sink->shutdown(); // the source is done
+    }
+  }
+
+  void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, muduo::Timestamp)
+  {
+    TcpConnectionPtr sink = sink_.lock();
+    if (sink && conn != sink)
+    {
+      sink->send(buf);
+      maxOutput = std::max(maxOutput, sink->outputBuffer()->readableBytes());
+    }
+  }
+
+  void onReaderConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->stopRead();
+      loop_->runAfter(0.2, [conn] { conn->startRead(); });
+      writer_.connect();
+    }
+    else
+    {
+      connectionDown();
+    }
+  }
+
+  void onWriterConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->send(message_);
+    }
+    else
+    {
+      connectionDown();
+    }
+  }
+
+  // the clients and the sink, which sees the reader close last
+  void connectionDown()
+  {
+    if (++connectionsDown_ == 3)
+    {
+      loop_->quit();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  TcpClient writer_;
+  TcpClient reader_;
+  std::weak_ptr<TcpConnection> sink_;
+  const string message_;
+  int connectionsDown_;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testFlowControlCallback)
+{
+  EventLoop loop;
+  Producer producer(&loop, 16 * 1024 * 1024);
+  producer.run();
+  BOOST_CHECK_EQUAL(producer.received, 16 * 1024 * 1024);
+  BOOST_CHECK_LT(producer.maxOutput, kHighWaterMark + kChunk);
+  BOOST_REQUIRE(!producer.events.empty());
+  BOOST_CHECK_EQUAL(producer.lowWaterMarks * 2, producer.events.size());
+  for (size_t i = 0; i < producer.events.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(producer.events[i], i % 2 == 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testFlowFromConnection)
+{
+  EventLoop loop;
+  Forwarder forwarder(&loop, 16 * 1024 * 1024);
+  forwarder.run();
+  BOOST_CHECK_EQUAL(forwarder.received, 16 * 1024 * 1024);
+  // a read of the source may add to the sink before it pauses
+  BOOST_CHECK_LT(forwarder.maxOutput, 4 * kHighWaterMark);
+}
+
+BOOST_AUTO_TEST_CASE(testUnlinkFlow)
+{
+  EventLoop loop;
+  TcpServer server(&loop, InetAddress(kPort, true), "Sink");
+  TcpClient client(&loop, InetAddress(kPort, true), "Reader");
+  std::vector<bool> kept;
+  std::vector<bool> unlinked;
+  int connectionsDown = 0;
+  auto quitWhenBothDown = [&] {
+    if (++connectionsDown == 2)
+    {
+      loop.quit();
+    }
+  };
+  server.setConnectionCallback([&](const TcpConnectionPtr& conn)
+      {
+        if (conn->connected())
+        {
+          conn->setHighWaterMarkCallback(HighWaterMarkCallback(), kHighWaterMark);
+          conn->setLowWaterMarkCallback(LowWaterMarkCallback(), kLowWaterMark);
+          conn->linkFlowFrom([&kept](bool pause) { kept.push_back(pause); });
+          int id = conn->linkFlowFrom(
+              [&unlinked](bool pause) { unlinked.push_back(pause); });
+          // more than the socket takes at once, both are paused
+          conn->send(string(32 * kHighWaterMark, 'z'));
+          conn->unlinkFlowFrom(id);
+          conn->unlinkFlowFrom(id);
+          conn->shutdown();
+        }
+        else
+        {
+          quitWhenBothDown();
+        }
+      });
+  client.setConnectionCallback([&](const TcpConnectionPtr& conn)
+      {
+        if (conn->connected())
+        {
+          conn->stopRead();
+          loop.runAfter(0.2, [conn] { conn->startRead(); });
+        }
+        else
+        {
+          quitWhenBothDown();
+        }
+      });
+  client.setMessageCallback(
+      [](const TcpConnectionPtr&, Buffer* buf, muduo::Timestamp)
+      { buf->retrieveAll(); });
+  server.start();
+  client.connect();
+  loop.runAfter(10.0, [&loop] { loop.quit(); });
+  loop.loop();
+  BOOST_CHECK_EQUAL(connectionsDown, 2);
+  // resumed when unlinked, the other one when drained
+  BOOST_CHECK(unlinked == std::vector<bool>({ true, false }));
+  BOOST_CHECK(kept == std::vector<bool>({ true, false }));
+}
@@ -0,0 +1,208 @@
+#include "muduo/net/Hub.h"
+
+#include "muduo/base/Mutex.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <atomic>
+#include <stdio.h>
+
+//#define BOOST_TEST_MODULE HubTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using namespace muduo::net;
+using std::placeholders::_1;
+
+namespace
+{
+
+const uint16_t kPort = 29880;
+const int kClients = 8;
+const int kMessages = 20;
+const size_t kMessageSize = 64 * 1024;
+
+string message(const char* topic, int seq)
+{
+  char head[32];
+  snprintf(head, sizeof head, "%s %d ", topic, seq);
+  string s(head);
+  s.resize(kMessageSize, static_cast<char>('a' + seq % 26));
+  return s;
+}
+
+// The server subscribes every connection to "all", and every other one to
+// "odd", then unsubscribes the first one and publishes from the main thread.
+class Quotes
+{
+ public:
+  explicit Quotes(EventLoop* loop)
+    : loop_(loop),
+      server_(loop, InetAddress(kPort, true), "Quotes"),
+      hub_("Quotes"),
+      accepted_(0),
+      subscribed_(0),
+      clientsDown_(0)
+  {
+    server_.setThreadNum(2);
+    server_.setConnectionCallback(
+        std::bind(&Quotes::onServerConnection, this, _1));
+    for (int i = 0; i < kClients; ++i)
+    {
+      char name[32];
+      snprintf(name, sizeof name, "Client%d", i);
+      clients_.emplace_back(new TcpClient(loop, InetAddress(kPort, true), name));
+      received.emplace_back();
+      clients_[i]->setConnectionCallback(
+          std::bind(&Quotes::onClientConnection, this, _1));
+      clients_[i]->setMessageCallback(
+          [this, i](const TcpConnectionPtr&, Buffer* buf, muduo::Timestamp)
+          {
+            received[i] += buf->retrieveAllAsString();
+            checkDone();
+          });
+    }
+  }
+
+  void run()
+  {
+    server_.start();
+    hub_.start(server_.threadPool()->getAllLoops());
+    for (auto& client : clients_)
+    {
+      client->connect();
+    }
+    loop_->runAfter(10.0, [this] { loop_->quit(); });
+    loop_->loop();
+  }
+
+  std::vector<string> received;
+
+ private:
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      int n;
+      {
+        muduo::MutexLockGuard lock(mutex_);
+        n = accepted_++;
+        if (n == 0)
+        {
+          first_ = conn;
+        }
+      }
+      hub_.subscribe("all", conn);
+      if (n % 2 == 1)
+      {
+        hub_.subscribe("odd", conn);
+      }
+      // subscribe() has run in this loop already
+      if (++subscribed_ == kClients)
+      {
+        loop_->runInLoop(std::bind(&Quotes::publish, this));
+      }
+    }
+  }
+
+  void publish()
+  {
+    TcpConnectionPtr first;
+    {
+      muduo::MutexLockGuard lock(mutex_);
+      first = first_.lock();
+    }
+    hub_.unsubscribe("all", first);
+    for (int i = 0; i < kMessages; ++i)
+    {
+      hub_.publish("all", message("all", i));
+      hub_.publish("odd", message("odd", i));
+      hub_.publish("none", message("none", i));
+    }
+  }
+
+  void checkDone()
+  {
+    size_t total = 0;
+    for (const string& r : received)
+    {
+      total += r.size();
+    }
+    // but the first one, which is even and unsubscribed
+    const size_t expected = ((kClients - 1) + kClients / 2) * kMessages * kMessageSize;
+    if (total == expected)
+    {
+      loop_->runAfter(0.1, [this]
+          {
+            for (auto& client : clients_)
+            {
+              client->disconnect();
+            }
+          });
+    }
+  }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->disconnected() && ++clientsDown_ == kClients)
+    {
+      loop_->quit();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  Hub hub_;
+  std::vector<std::unique_ptr<TcpClient>> clients_;
+  muduo::MutexLock mutex_;
+  int accepted_;
+  std::weak_ptr<TcpConnection> first_;
+  std::atomic<int> subscribed_;
+  int clientsDown_;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testHubPublish)
+{
+  string all, odd, both;
+  for (int i = 0; i < kMessages; ++i)
+  {
+    all += message("all", i);
+    odd += message("odd", i);
+    both += message("all", i) + message("odd", i);
+  }
+
+  EventLoop loop;
+  Quotes quotes(&loop);
+  quotes.run();
+
+  int none = 0, allOnly = 0, oddOnly = 0, allAndOdd = 0;
+  for (const string& r : quotes.received)
+  {
+    if (r.empty())
+    {
+      ++none;
+    }
+    else if (r == all)
+    {
+      ++allOnly;
+    }
+    else if (r == odd)
+    {
+      ++oddOnly;
+    }
+    else if (r == both)
+    {
+      ++allAndOdd;
+    }
+  }
+  BOOST_CHECK_EQUAL(none, 1);
+  BOOST_CHECK_EQUAL(allOnly, kClients / 2 - 1);
+  BOOST_CHECK_EQUAL(oddOnly, 0);
+  BOOST_CHECK_EQUAL(allAndOdd, kClients / 2);
+}
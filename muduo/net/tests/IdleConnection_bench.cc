@@ -0,0 +1,216 @@
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <malloc.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Opens many idle loopback connections to a TcpServer, then reports
+// the memory the server spends per connection.
+//
+// Needs ulimit -n above the number of connections, eg. as root:
+//   ./idleconnection_bench 1000000
+// sysctl fs.nr_open and net.ipv4.tcp_max_orphans may need raising too.
+
+const int kConnectionsPerSource = 20000;  // below ip_local_port_range
+
+size_t residentBytes()
+{
+  long pages = 0, resident = 0;
+  FILE* fp = ::fopen("/proc/self/statm", "r");
+  if (fp)
+  {
+    if (::fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+    {
+      resident = 0;
+    }
+    ::fclose(fp);
+  }
+  return static_cast<size_t>(resident) * ::sysconf(_SC_PAGESIZE);
+}
+
+size_t heapBytes()
+{
+  return mallinfo2().uordblks;
+}
+
+// returns how many connections the file limit leaves room for
+int raiseFileLimit(int connections)
+{
+  const rlim_t kReserved = 64;
+  struct rlimit rl;
+  rl.rlim_cur = rl.rlim_max = connections + kReserved;
+  if (::setrlimit(RLIMIT_NOFILE, &rl) < 0)
+  {
+    // not privileged, go up to the hard limit
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &rl);
+    if (rl.rlim_cur < connections + kReserved)
+    {
+      connections = rl.rlim_cur > kReserved ? static_cast<int>(rl.rlim_cur - kReserved) : 0;
+      printf("ulimit -n is %ld, only %d connections\n",
+             static_cast<long>(rl.rlim_cur), connections);
+    }
+  }
+  return connections;
+}
+
+// in the child, from 127.0.1.0, 127.0.1.1, ... to get past 64K ports
+void connectAll(uint16_t port, int connections)
+{
+  struct sockaddr_in server;
+  memset(&server, 0, sizeof server);
+  server.sin_family = AF_INET;
+  server.sin_port = htons(port);
+  server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  for (int i = 0; i < connections; ++i)
+  {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (sockfd < 0)
+    {
+      perror("socket");
+      _exit(1);
+    }
+    int on = 1;
+    ::setsockopt(sockfd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &on, sizeof on);
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof local);
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(0x7f000100 + i / kConnectionsPerSource);
+    if (::bind(sockfd, reinterpret_cast<struct sockaddr*>(&local), sizeof local) < 0
+        || ::connect(sockfd, reinterpret_cast<struct sockaddr*>(&server), sizeof server) < 0)
+    {
+      fprintf(stderr, "connection %d: %s\n", i, strerror(errno));
+      _exit(1);
+    }
+  }
+  ::pause();  // keep them open until killed
+  _exit(0);
+}
+
+class IdleServer
+{
+ public:
+  IdleServer(EventLoop* loop, uint16_t port, int connections)
+    : loop_(loop),
+      server_(loop, InetAddress(port, true), "IdleServer"),
+      connections_(connections),
+      connected_(0),
+      child_(0),
+      baseRss_(0),
+      baseHeap_(0),
+      start_(Timestamp::now())
+  {
+    server_.setConnectionCallback(
+        std::bind(&IdleServer::onConnection, this, std::placeholders::_1));
+  }
+
+  void start(uint16_t port)
+  {
+    server_.start();
+    baseRss_ = residentBytes();
+    baseHeap_ = heapBytes();
+    start_ = Timestamp::now();
+    child_ = ::fork();
+    if (child_ == 0)
+    {
+      connectAll(port, connections_);
+    }
+    loop_->runEvery(1.0, std::bind(&IdleServer::checkChild, this));
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected() && ++connected_ == connections_)
+    {
+      report();
+      stop();
+    }
+  }
+
+  void checkChild()
+  {
+    printf("%d connections, %.1f MiB resident\n", connected_,
+           static_cast<double>(residentBytes()) / (1024 * 1024));
+    int status = 0;
+    if (child_ > 0 && ::waitpid(child_, &status, WNOHANG) == child_)
+    {
+      child_ = 0;
+      printf("connecting failed after %d connections\n", connected_);
+      report();
+      loop_->quit();
+    }
+  }
+
+  void report()
+  {
+    if (connected_ == 0)
+    {
+      return;
+    }
+    size_t rss = residentBytes() - baseRss_;
+    size_t heap = heapBytes() - baseHeap_;
+    printf("%d connections in %.3fs\n", connected_,
+           timeDifference(Timestamp::now(), start_));
+    printf("resident %zu bytes, %zu per connection\n", rss, rss / connected_);
+    printf("heap %zu bytes, %zu per connection\n", heap, heap / connected_);
+  }
+
+  void stop()
+  {
+    if (child_ > 0)
+    {
+      ::kill(child_, SIGKILL);
+      ::waitpid(child_, NULL, 0);
+      child_ = 0;
+    }
+    loop_->quit();
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  const int connections_;
+  int connected_;
+  pid_t child_;
+  size_t baseRss_;
+  size_t baseHeap_;
+  Timestamp start_;
+};
+
+int main(int argc, char* argv[])
+{
+  int connections = argc > 1 ? atoi(argv[1]) : 1000 * 1000;
+  uint16_t port = static_cast<uint16_t>(argc > 2 ? atoi(argv[2]) : 29881);
+  if (connections > 0)
+  {
+    connections = raiseFileLimit(connections);
+  }
+  if (connections <= 0)
+  {
+    fprintf(stderr, "Usage: %s [connections] [port]\n", argv[0]);
+    return 1;
+  }
+  Logger::setLogLevel(Logger::WARN);
+
+  EventLoop loop;
+  IdleServer server(&loop, port, connections);
+  server.start(port);
+  loop.loop();
+  // the server closes what is left
+}
@@ -0,0 +1,334 @@
+#include "muduo/net/Resolver.h"
+
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE ResolverTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using muduo::net::EventLoop;
+using muduo::net::InetAddress;
+using muduo::net::Resolver;
+using muduo::net::TcpClient;
+using muduo::net::TcpConnectionPtr;
+using muduo::net::TcpServer;
+
+namespace
+{
+
+const uint16_t kPort = 29883;
+
+// Answers queries on loopback:
+//   www.example.com  - A 10.0.0.1 10.0.0.2, AAAA 2001:db8::1, TTL 1
+//   nx.example.com   - NXDOMAIN, SOA minimum 30
+//   lost.example.com - never answered
+//   two.example.com  - A 127.0.0.2 127.0.0.1, TTL 1
+class StubServer
+{
+ public:
+  StubServer()
+    : sockfd_(::socket(AF_INET, SOCK_DGRAM, 0)),
+      quit_(false)
+  {
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    BOOST_REQUIRE(::bind(sockfd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) == 0);
+    socklen_t len = sizeof addr;
+    ::getsockname(sockfd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    address_ = InetAddress(addr);
+    struct timeval tv = { 0, 50 * 1000 };
+    ::setsockopt(sockfd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    thread_ = std::thread([this] { serve(); });
+  }
+
+  ~StubServer()
+  {
+    quit_ = true;
+    thread_.join();
+    ::close(sockfd_);
+  }
+
+  const InetAddress& address() const { return address_; }
+
+  int queries(const string& name)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queries_[name];
+  }
+
+ private:
+  void serve()
+  {
+    char buf[1500];
+    while (!quit_)
+    {
+      struct sockaddr_in6 peer;
+      socklen_t len = sizeof peer;
+      ssize_t n = ::recvfrom(sockfd_, buf, sizeof buf, 0,
+                             reinterpret_cast<struct sockaddr*>(&peer), &len);
+      if (n < 12)
+      {
+        continue;
+      }
+      string query(buf, n);
+      string name;
+      size_t pos = 12;
+      while (pos < query.size() && query[pos] != 0)
+      {
+        int labelLen = query[pos];
+        if (!name.empty())
+          name += '.';
+        name.append(query, pos + 1, labelLen);
+        pos += labelLen + 1;
+      }
+      pos += 1;
+      uint16_t type = static_cast<uint16_t>((uint8_t(query[pos]) << 8) | uint8_t(query[pos + 1]));
+      pos += 4;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++queries_[name];
+      }
+      if (name == "lost.example.com")
+      {
+        continue;
+      }
+
+      string answer(query, 0, pos);  // header and question
+      answer[2] = static_cast<char>(answer[2] | 0x80);  // QR
+      answer[10] = answer[11] = 0;  // no additional records
+      int answers = 0;
+      if (name == "www.example.com" && type == 1)
+      {
+        appendRecord(&answer, 1, 1, string("\x0a\x00\x00\x01", 4));
+        appendRecord(&answer, 1, 1, string("\x0a\x00\x00\x02", 4));
+        answers = 2;
+      }
+      else if (name == "www.example.com" && type == 28)
+      {
+        struct in6_addr addr6;
+        ::inet_pton(AF_INET6, "2001:db8::1", &addr6);
+        appendRecord(&answer, 28, 1, string(reinterpret_cast<char*>(&addr6), 16));
+        answers = 1;
+      }
+      else if (name == "two.example.com" && type == 1)
+      {
+        appendRecord(&answer, 1, 1, string("\x7f\x00\x00\x02", 4));
+        appendRecord(&answer, 1, 1, string("\x7f\x00\x00\x01", 4));
+        answers = 2;
+      }
+      else
+      {
+        answer[3] = static_cast<char>(answer[3] | 3);  // NXDOMAIN
+        string soa("\0\0", 2);  // MNAME, RNAME
+        soa.append(16, '\0');   // SERIAL, REFRESH, RETRY, EXPIRE
+        soa.append("\0\0\0\x1e", 4);  // MINIMUM
+        appendRecord(&answer, 6, 3600, soa);
+        answer[9] = 1;  // NSCOUNT
+      }
+      answer[7] = static_cast<char>(answers);
+      ::sendto(sockfd_, answer.data(), answer.size(), 0,
+               reinterpret_cast<struct sockaddr*>(&peer), len);
+    }
+  }
+
+  static void appendRecord(string* answer, uint16_t type, uint32_t ttl, const string& rdata)
+  {
+    answer->append("\xc0\x0c", 2);  // pointer to the question name
+    answer->push_back(static_cast<char>(type >> 8));
+    answer->push_back(static_cast<char>(type));
+    answer->append("\x00\x01", 2);  // IN
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+      answer->push_back(static_cast<char>(ttl >> shift));
+    }
+    answer->push_back(static_cast<char>(rdata.size() >> 8));
+    answer->push_back(static_cast<char>(rdata.size()));
+    answer->append(rdata);
+  }
+
+  const int sockfd_;
+  InetAddress address_;
+  std::atomic<bool> quit_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::map<string, int> queries_;
+};
+
+std::vector<string> resolve(EventLoop* loop, Resolver* resolver, const char* hostname)
+{
+  std::vector<string> result;
+  bool done = false;
+  resolver->resolve(hostname, 80, [&](const std::vector<InetAddress>& addresses)
+  {
+    for (const InetAddress& addr : addresses)
+    {
+      result.push_back(addr.toIpPort());
+    }
+    done = true;
+    loop->quit();
+  });
+  if (!done)
+  {
+    loop->loop();
+  }
+  BOOST_CHECK(done);
+  return result;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testResolverCache)
+{
+  StubServer server;
+  EventLoop loop;
+  Resolver resolver(&loop, server.address());
+
+  std::vector<string> result = resolve(&loop, &resolver, "WWW.example.com.");
+  BOOST_REQUIRE_EQUAL(result.size(), 3u);
+  BOOST_CHECK_EQUAL(result[0], string("10.0.0.1:80"));
+  BOOST_CHECK_EQUAL(result[1], string("10.0.0.2:80"));
+  BOOST_CHECK_EQUAL(result[2], string("[2001:db8::1]:80"));
+  BOOST_CHECK_EQUAL(server.queries("www.example.com"), 2);
+  BOOST_CHECK_EQUAL(resolver.cacheSize(), 1u);
+
+  // answered from cache
+  result = resolve(&loop, &resolver, "www.example.com");
+  BOOST_CHECK_EQUAL(result.size(), 3u);
+  BOOST_CHECK_EQUAL(server.queries("www.example.com"), 2);
+
+  // TTL expired
+  ::usleep(1100 * 1000);
+  result = resolve(&loop, &resolver, "www.example.com");
+  BOOST_CHECK_EQUAL(result.size(), 3u);
+  BOOST_CHECK_EQUAL(server.queries("www.example.com"), 4);
+}
+
+BOOST_AUTO_TEST_CASE(testResolverShared)
+{
+  StubServer server;
+  EventLoop loop;
+  Resolver resolver(&loop, server.address(), Resolver::kIPv4Only);
+
+  int calls = 0;
+  auto cb = [&](const std::vector<InetAddress>& addresses)
+  {
+    BOOST_CHECK_EQUAL(addresses.size(), 2u);
+    if (++calls == 2)
+      loop.quit();
+  };
+  resolver.resolve("www.example.com", 80, cb);
+  resolver.resolve("www.example.com", 443, cb);
+  loop.loop();
+  BOOST_CHECK_EQUAL(calls, 2);
+  BOOST_CHECK_EQUAL(server.queries("www.example.com"), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testResolverNegative)
+{
+  StubServer server;
+  EventLoop loop;
+  Resolver resolver(&loop, server.address());
+
+  BOOST_CHECK(resolve(&loop, &resolver, "nx.example.com").empty());
+  BOOST_CHECK(resolve(&loop, &resolver, "nx.example.com").empty());
+  BOOST_CHECK_EQUAL(server.queries("nx.example.com"), 2);  // A and AAAA, then cached
+
+  resolver.setTimeout(0.1);
+  resolver.setRetries(1);
+  BOOST_CHECK(resolve(&loop, &resolver, "lost.example.com").empty());
+  BOOST_CHECK_EQUAL(server.queries("lost.example.com"), 4);  // resent once
+  BOOST_CHECK_EQUAL(resolver.cacheSize(), 1u);  // timeouts are not cached
+
+  BOOST_CHECK(resolve(&loop, &resolver, "bad..name").empty());
+}
+
+BOOST_AUTO_TEST_CASE(testResolverKnown)
+{
+  StubServer server;
+  EventLoop loop;
+  Resolver resolver(&loop, server.address());
+
+  std::vector<string> result = resolve(&loop, &resolver, "1.2.3.4");
+  BOOST_REQUIRE_EQUAL(result.size(), 1u);
+  BOOST_CHECK_EQUAL(result[0], string("1.2.3.4:80"));
+
+  result = resolve(&loop, &resolver, "::1");
+  BOOST_REQUIRE_EQUAL(result.size(), 1u);
+  BOOST_CHECK_EQUAL(result[0], string("[::1]:80"));
+
+  result = resolve(&loop, &resolver, "localhost");
+  BOOST_CHECK(!result.empty());
+  BOOST_CHECK_EQUAL(server.queries("localhost"), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testTcpClientNextAddress)
+{
+  StubServer server;
+  EventLoop loop;
+  Resolver resolver(&loop, server.address(), Resolver::kIPv4Only);
+  // listens on 127.0.0.1 only, 127.0.0.2 refuses
+  TcpServer tcpServer(&loop, InetAddress(kPort, true), "TcpServer");
+  tcpServer.start();
+
+  string peer;
+  {
+    TcpClient client(&loop, &resolver, "two.example.com", kPort, "TcpClient");
+    client.setConnectionCallback([&](const TcpConnectionPtr& conn)
+    {
+      if (conn->connected())
+      {
+        peer = conn->peerAddress().toIpPort();
+        loop.quit();
+      }
+    });
+    client.connect();
+    loop.runAfter(5.0, [&loop] { loop.quit(); });
+    loop.loop();
+  }
+  BOOST_CHECK_EQUAL(peer, "127.0.0.1:" + std::to_string(kPort));
+  // lets the connection close, the client queued that outside of the loop
+  loop.wakeup();
+  loop.runAfter(0.1, [&loop] { loop.quit(); });
+  loop.loop();
+}
+
+BOOST_AUTO_TEST_CASE(testTcpClientResolveAgain)
+{
+  StubServer server;
+  EventLoop loop;
+  Resolver resolver(&loop, server.address(), Resolver::kIPv4Only);
+  resolver.setTimeout(0.1);
+  resolver.setRetries(0);
+  {
+    TcpClient client(&loop, &resolver, "lost.example.com", kPort, "TcpClient");
+    client.connect();
+    // fails at 0.1s, resolves again at 0.6s, fails at 0.7s, then waits 1s
+    loop.runAfter(1.2, [&loop] { loop.quit(); });
+    loop.loop();
+    BOOST_CHECK_EQUAL(server.queries("lost.example.com"), 2);
+    client.stop();
+  }
+  // the answer comes after the client is gone
+  TcpClient* client = new TcpClient(&loop, &resolver, "lost.example.com", kPort, "TcpClient");
+  client->connect();
+  loop.runAfter(0.05, [client] { delete client; });
+  loop.runAfter(0.3, [&loop] { loop.quit(); });
+  loop.loop();
+  BOOST_CHECK_EQUAL(server.queries("lost.example.com"), 3);
+}
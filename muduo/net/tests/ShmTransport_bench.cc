@@ -0,0 +1,119 @@
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Echoes messages between two processes over a Unix domain socket,
+// first on the socket alone, then on the shared-memory rings, and
+// reports the messages per second of each.
+//
+//   ./shmtransport_bench [messages] [message_size] [in_flight]
+
+const size_t kRingSize = 256 * 1024;
+
+void runServer(const InetAddress& addr, bool shm)
+{
+  EventLoop loop;
+  TcpServer server(&loop, addr, "BenchServer");
+  if (shm)
+  {
+    server.setSharedMemoryRingSize(kRingSize);
+  }
+  server.setConnectionCallback([&loop](const TcpConnectionPtr& conn)
+      {
+        if (!conn->connected())
+        {
+          loop.quit();
+        }
+      });
+  server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+      { conn->send(buf); });
+  server.start();
+  loop.loop();
+}
+
+// returns seconds
+double runClient(const InetAddress& addr, bool shm, int messages, size_t size, int inFlight)
+{
+  EventLoop loop;
+  TcpClient client(&loop, addr, "BenchClient");
+  if (shm)
+  {
+    client.enableSharedMemory();
+  }
+  const string message(size, 'm');
+  int sent = 0;
+  int received = 0;
+  Timestamp start;
+  client.setConnectionCallback([&](const TcpConnectionPtr& conn)
+      {
+        if (conn->connected())
+        {
+          start = Timestamp::now();
+          for (; sent < inFlight && sent < messages; ++sent)
+          {
+            conn->send(message);
+          }
+        }
+        else
+        {
+          loop.quit();
+        }
+      });
+  client.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+      {
+        while (buf->readableBytes() >= size)
+        {
+          buf->retrieve(size);
+          if (++received == messages)
+          {
+            conn->shutdown();
+          }
+          else if (sent < messages)
+          {
+            ++sent;
+            conn->send(message);
+          }
+        }
+      });
+  client.connect(); // the Connector retries until the server listens
+  loop.loop();
+  return timeDifference(Timestamp::now(), start);
+}
+
+int main(int argc, char* argv[])
+{
+  const int messages = argc > 1 ? atoi(argv[1]) : 1000000;
+  const size_t size = argc > 2 ? atoi(argv[2]) : 64;
+  const int inFlight = argc > 3 ? atoi(argv[3]) : 1;
+  Logger::setLogLevel(Logger::WARN);
+
+  double seconds[2] = { 0, 0 };
+  for (int shm = 0; shm < 2; ++shm)
+  {
+    char name[64];
+    snprintf(name, sizeof name, "@muduo_shm_bench_%d_%d", ::getpid(), shm);
+    const InetAddress addr = InetAddress::fromUnixPath(name);
+    pid_t child = ::fork();
+    if (child == 0)
+    {
+      runServer(addr, shm);
+      ::_exit(0);
+    }
+    seconds[shm] = runClient(addr, shm, messages, size, inFlight);
+    ::waitpid(child, NULL, 0);
+    printf("%-6s %d messages of %zu bytes, %d in flight, %.3f seconds, %.0f messages/s\n",
+           shm ? "shm" : "socket", messages, size, inFlight,
+           seconds[shm], messages / seconds[shm]);
+  }
+  printf("shm is %.2fx as fast\n", seconds[0] / seconds[1]);
+}
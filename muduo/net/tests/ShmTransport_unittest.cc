@@ -0,0 +1,240 @@
+#include "muduo/net/ShmTransport.h"
+
+#include "muduo/net/Buffer.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+#include "muduo/net/tests/TestUtil.h"
+
+#include <atomic>
+
+#include <stdio.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE ShmTransportTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using namespace muduo::net;
+using muduo::net::test::pattern;
+using std::placeholders::_1;
+using std::placeholders::_2;
+using std::placeholders::_3;
+
+namespace
+{
+
+// The server echoes, the client sends a message much larger than a ring,
+// then disconnects when the echo is complete.
+class EchoPair
+{
+ public:
+  EchoPair(EventLoop* loop, const InetAddress& listenAddr, size_t messageSize,
+           size_t ringSize = 4096)
+    : loop_(loop),
+      server_(loop, listenAddr, "ShmServer"),
+      client_(loop, listenAddr, "ShmClient"),
+      message_(pattern(messageSize))
+  {
+    server_.setSharedMemoryRingSize(ringSize);
+    server_.setMessageCallback(
+        std::bind(&EchoPair::onServerMessage, this, _1, _2, _3));
+    client_.enableSharedMemory();
+    client_.setConnectionCallback(
+        std::bind(&EchoPair::onClientConnection, this, _1));
+    client_.setMessageCallback(
+        std::bind(&EchoPair::onClientMessage, this, _1, _2, _3));
+  }
+
+  void run()
+  {
+    if (serverBusy > 0)
+    {
+      server_.setThreadNum(1);
+    }
+    server_.start();
+    if (serverBusy > 0)
+    {
+      // the offer is made in the IO thread, after this
+      const useconds_t busy = static_cast<useconds_t>(serverBusy * 1000 * 1000);
+      server_.threadPool()->getAllLoops()[0]->runInLoop([busy] { ::usleep(busy); });
+    }
+    client_.connect();
+    loop_->runAfter(10.0, [this] { loop_->quit(); });
+    loop_->loop();
+  }
+
+  const string& message() const { return message_; }
+
+  double serverBusy = 0;  // seconds before the server makes its offer
+  double sendAfter = 0;   // seconds after the client connects
+  string received;
+  std::atomic<bool> serverShm{false};
+  bool clientShm = false;
+
+ private:
+  void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, muduo::Timestamp)
+  {
+    serverShm = conn->sharedMemory();
+    conn->send(buf);
+  }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected() && sendAfter > 0)
+    {
+      loop_->runAfter(sendAfter, [this, conn] { conn->send(message_); });
+    }
+    else if (conn->connected())
+    {
+      conn->send(message_);
+    }
+    else
+    {
+      loop_->quit();
+    }
+  }
+
+  void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, muduo::Timestamp)
+  {
+    clientShm = conn->sharedMemory();
+    received += buf->retrieveAllAsString();
+    if (received.size() >= message_.size())
+    {
+      client_.disconnect();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  TcpClient client_;
+  const string message_;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testShmRing)
+{
+  EventLoop loop;
+  std::unique_ptr<ShmTransport> creator(ShmTransport::create(&loop, 5000));
+  BOOST_REQUIRE(creator);
+  BOOST_CHECK_EQUAL(creator->ringSize(), 8192);
+
+  std::vector<int> fds;
+  for (int fd : creator->peerFds())
+  {
+    fds.push_back(::dup(fd));
+  }
+  std::unique_ptr<ShmTransport> other(ShmTransport::attach(&loop, fds));
+  BOOST_REQUIRE(other);
+  BOOST_CHECK_EQUAL(other->ringSize(), 8192);
+
+  const string data = pattern(20000);
+  BOOST_CHECK_EQUAL(creator->write(data.data(), 6000), 6000);
+  BOOST_CHECK_EQUAL(creator->write(data.data() + 6000, 14000), 2192);
+  BOOST_CHECK(!creator->waitForSpace());
+
+  Buffer buf;
+  BOOST_CHECK_EQUAL(other->read(&buf), 8192);
+  BOOST_CHECK(creator->waitForSpace());
+  // wraps around the end of the ring
+  BOOST_CHECK_EQUAL(creator->write(data.data() + 8192, 11808), 8192);
+  BOOST_CHECK_EQUAL(other->read(&buf), 8192);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), data.substr(0, 16384));
+
+  // the other direction
+  BOOST_CHECK_EQUAL(other->write("hello", 5), 5);
+  BOOST_CHECK_EQUAL(creator->read(&buf), 5);
+  BOOST_CHECK_EQUAL(other->read(&buf), 0);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string("hello"));
+}
+
+BOOST_AUTO_TEST_CASE(testShmAttachRejectsOthers)
+{
+  EventLoop loop;
+  int pipefd[2];
+  BOOST_REQUIRE(::pipe(pipefd) == 0);
+  std::vector<int> fds;
+  fds.push_back(pipefd[0]);
+  fds.push_back(pipefd[1]);
+  fds.push_back(::dup(pipefd[0]));
+  BOOST_CHECK(!ShmTransport::attach(&loop, fds));
+}
+
+BOOST_AUTO_TEST_CASE(testShmEcho)
+{
+  char name[64];
+  snprintf(name, sizeof name, "@muduo_shm_test_%d", ::getpid());
+
+  EventLoop loop;
+  EchoPair pair(&loop, InetAddress::fromUnixPath(name), 1000 * 1000);
+  pair.run();
+  BOOST_CHECK(pair.serverShm);
+  BOOST_CHECK(pair.clientShm);
+  BOOST_CHECK_EQUAL(pair.received.size(), pair.message().size());
+  BOOST_CHECK(pair.received == pair.message());
+}
+
+BOOST_AUTO_TEST_CASE(testShmDeclined)
+{
+  char name[64];
+  snprintf(name, sizeof name, "@muduo_shm_test_%d", ::getpid());
+
+  // rings larger than the address space, create() fails and the server says so
+  EventLoop loop;
+  EchoPair pair(&loop, InetAddress::fromUnixPath(name), 100 * 1000, size_t(1) << 50);
+  pair.run();
+  BOOST_CHECK(!pair.serverShm);
+  BOOST_CHECK(!pair.clientShm);
+  BOOST_CHECK(pair.received == pair.message());
+}
+
+BOOST_AUTO_TEST_CASE(testShmServerDisabled)
+{
+  char name[64];
+  snprintf(name, sizeof name, "@muduo_shm_test_%d", ::getpid());
+
+  // the server sends no marker at all, the client gives up waiting
+  EventLoop loop;
+  EchoPair pair(&loop, InetAddress::fromUnixPath(name), 100 * 1000, 0);
+  pair.run();
+  BOOST_CHECK(!pair.serverShm);
+  BOOST_CHECK(!pair.clientShm);
+  BOOST_CHECK(pair.received == pair.message());
+}
+
+BOOST_AUTO_TEST_CASE(testShmSlowServer)
+{
+  char name[64];
+  snprintf(name, sizeof name, "@muduo_shm_test_%d", ::getpid());
+
+  // the client gives up before the offer comes, and sends on the socket,
+  // the server sees that instead of an answer and stays there too
+  EventLoop loop;
+  EchoPair pair(&loop, InetAddress::fromUnixPath(name), 100 * 1000);
+  pair.serverBusy = 1.5;
+  pair.run();
+  BOOST_CHECK(!pair.serverShm);
+  BOOST_CHECK(!pair.clientShm);
+  BOOST_CHECK_EQUAL(pair.received.size(), pair.message().size());
+  BOOST_CHECK(pair.received == pair.message());
+}
+
+BOOST_AUTO_TEST_CASE(testShmSlowServerQuietClient)
+{
+  char name[64];
+  snprintf(name, sizeof name, "@muduo_shm_test_%d", ::getpid());
+
+  // with nothing to send, the client still takes a late offer
+  EventLoop loop;
+  EchoPair pair(&loop, InetAddress::fromUnixPath(name), 100 * 1000);
+  pair.serverBusy = 1.5;
+  pair.sendAfter = 2.0;
+  pair.run();
+  BOOST_CHECK(pair.serverShm);
+  BOOST_CHECK(pair.clientShm);
+  BOOST_CHECK(pair.received == pair.message());
+}
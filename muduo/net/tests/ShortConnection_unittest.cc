@@ -0,0 +1,122 @@
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/Mutex.h"
+#include "muduo/net/EventLoop.h"
+
+#include <atomic>
+#include <set>
+
+//#define BOOST_TEST_MODULE ShortConnectionTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using namespace muduo::net;
+using std::placeholders::_1;
+
+namespace
+{
+
+const uint16_t kPort = 29882;
+const int kConnections = 500;
+
+// Like HTTP/1.0, the server answers and closes, the client connects again.
+// Closed connections go back to the pools of the io loops, and are reused.
+class ShortLived
+{
+ public:
+  explicit ShortLived(EventLoop* loop)
+    : loop_(loop),
+      server_(loop, InetAddress(kPort, true), "ShortLived"),
+      client_(loop, InetAddress(kPort, true), "Client"),
+      serverDowns_(0),
+      clientDowns_(0)
+  {
+    server_.setThreadNum(2);
+    server_.setConnectionCallback(
+        std::bind(&ShortLived::onServerConnection, this, _1));
+    client_.setConnectionCallback(
+        std::bind(&ShortLived::onClientConnection, this, _1));
+    client_.setMessageCallback(
+        [this](const TcpConnectionPtr&, Buffer* buf, muduo::Timestamp)
+        { received += buf->retrieveAllAsString(); });
+    client_.enableRetry();
+  }
+
+  void run()
+  {
+    server_.start();
+    client_.connect();
+    loop_->runAfter(20.0, [this] { loop_->quit(); });
+    loop_->loop();
+  }
+
+  string received;
+  std::set<string> localAddrs;
+  std::set<string> names;
+
+ private:
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      {
+        muduo::MutexLockGuard lock(mutex_);
+        localAddrs.insert(conn->localAddress().toIpPort());
+        names.insert(conn->name());
+      }
+      conn->send("hello");
+      conn->shutdown();
+    }
+    else if (++serverDowns_ == kConnections)
+    {
+      loop_->queueInLoop(std::bind(&ShortLived::quitIfDone, this));
+    }
+  }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->disconnected() && ++clientDowns_ == kConnections)
+    {
+      client_.disconnect();  // no more retries
+      quitIfDone();
+    }
+  }
+
+  void quitIfDone()
+  {
+    if (serverDowns_ == kConnections && clientDowns_ == kConnections)
+    {
+      loop_->quit();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  TcpClient client_;
+  muduo::MutexLock mutex_;
+  std::atomic<int> serverDowns_;
+  int clientDowns_;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testShortConnections)
+{
+  EventLoop loop;
+  ShortLived server(&loop);
+  server.run();
+
+  string expected;
+  for (int i = 0; i < kConnections; ++i)
+  {
+    expected += "hello";
+  }
+  BOOST_CHECK_EQUAL(server.received.size(), expected.size());
+  BOOST_CHECK(server.received == expected);
+  BOOST_CHECK_EQUAL(server.names.size(), kConnections);
+  BOOST_REQUIRE_EQUAL(server.localAddrs.size(), 1);
+  BOOST_CHECK_EQUAL(*server.localAddrs.begin(), InetAddress(kPort, true).toIpPort());
+}
@@ -0,0 +1,102 @@
+// Echo requests through a TcpClientPool from every loop of a thread pool,
+// the echo server closes some connections to exercise reconnecting.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/TcpClientPool.h"
+#include "muduo/net/TcpServer.h"
+
+#include <atomic>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+TcpClientPool* g_pool;
+std::atomic<int> g_requests(0);
+std::atomic<int> g_responses(0);
+std::atomic<int> g_failures(0);
+std::atomic<int> g_wrongLoop(0);
+std::atomic<int> g_connections(0);
+
+void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  static int messages = 0;
+  conn->send(buf);
+  if (++messages % 50 == 0)
+  {
+    conn->shutdown();
+  }
+}
+
+void onClientConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    ++g_connections;
+  }
+}
+
+void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  if (conn->getLoop() != EventLoop::getEventLoopOfCurrentThread())
+  {
+    ++g_wrongLoop;
+  }
+  g_responses += static_cast<int>(buf->readableBytes() / 5);
+  buf->retrieveAll();
+  g_pool->release(conn);
+}
+
+void onAcquired(const TcpConnectionPtr& conn)
+{
+  if (conn)
+  {
+    ++g_requests;
+    conn->send("hello");
+  }
+  else
+  {
+    ++g_failures;
+  }
+}
+
+void request()
+{
+  g_pool->acquire(onAcquired);
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  InetAddress serverAddr("127.0.0.1", 2021);
+  EventLoop loop;
+  TcpServer server(&loop, serverAddr, "EchoServer");
+  server.setMessageCallback(onServerMessage);
+  server.start();
+
+  EventLoopThreadPool threads(&loop, "PoolThreads");
+  threads.setThreadNum(2);
+  threads.start();
+
+  TcpClientPool pool(serverAddr, "Pool");
+  g_pool = &pool;
+  pool.setConnectionsPerLoop(2);
+  pool.setMaxConnectionsPerLoop(4);
+  pool.setMaxIdle(0.5);
+  pool.setConnectionCallback(onClientConnection);
+  pool.setMessageCallback(onClientMessage);
+  pool.start(threads.getAllLoops());
+
+  for (EventLoop* ioLoop : threads.getAllLoops())
+  {
+    ioLoop->runEvery(0.001, request);
+  }
+  loop.runAfter(3.0, std::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  printf("requests %d responses %d failures %d wrong loop %d connections %d\n",
+         g_requests.load(), g_responses.load(), g_failures.load(),
+         g_wrongLoop.load(), g_connections.load());
+}
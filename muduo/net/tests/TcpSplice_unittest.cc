@@ -0,0 +1,313 @@
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+#include "muduo/net/tests/TestUtil.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+
+#include <memory>
+
+//#define BOOST_TEST_MODULE TcpSpliceTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using namespace muduo::net;
+using muduo::net::test::pattern;
+using std::placeholders::_1;
+using std::placeholders::_2;
+using std::placeholders::_3;
+
+namespace
+{
+
+const uint16_t kBackendPort = 29876;
+const uint16_t kRelayPort = 29877;
+const uint16_t kOneWayPort = 29879;
+
+// client -> relay -> echo backend, the relay splices both ways.
+// The backend pauses reading at first, so the relay has to stop reading.
+// Closing goes client -> relay -> upstream -> backend and back.
+class Relay
+{
+ public:
+  Relay(EventLoop* loop, size_t messageSize)
+    : loop_(loop),
+      backend_(loop, InetAddress(kBackendPort, true), "Backend"),
+      relay_(loop, InetAddress(kRelayPort, true), "Relay"),
+      client_(loop, InetAddress(kRelayPort, true), "Client"),
+      message_(pattern(messageSize))
+  {
+    backend_.setConnectionCallback(
+        std::bind(&Relay::onBackendConnection, this, _1));
+    backend_.setMessageCallback(
+        [](const TcpConnectionPtr& conn, Buffer* buf, muduo::Timestamp)
+        { conn->send(buf); });
+    relay_.setConnectionCallback(
+        std::bind(&Relay::onRelayConnection, this, _1));
+    relay_.setMessageCallback(
+        std::bind(&Relay::onRelayMessage, this, _1, _2, _3));
+    client_.setConnectionCallback(
+        std::bind(&Relay::onClientConnection, this, _1));
+    client_.setMessageCallback(
+        std::bind(&Relay::onClientMessage, this, _1, _2, _3));
+  }
+
+  void run()
+  {
+    backend_.start();
+    relay_.start();
+    client_.connect();
+    loop_->runAfter(10.0, [this] { loop_->quit(); });
+    loop_->loop();
+  }
+
+  const string& message() const { return message_; }
+
+  string received;
+  size_t bytesBeforeSplice = 0;
+  size_t bytesAfterSplice = 0;
+
+ private:
+  void onBackendConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->stopRead();
+      loop_->runAfter(0.2, [conn] { conn->startRead(); });
+    }
+  }
+
+  void onRelayConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      // what the client sends meanwhile waits in the input buffer
+      relayConn_ = conn;
+      upstream_.reset(new TcpClient(loop_, InetAddress(kBackendPort, true), "Upstream"));
+      upstream_->setConnectionCallback(
+          std::bind(&Relay::onUpstreamConnection, this, _1));
+      upstream_->connect();
+    }
+  }
+
+  void onUpstreamConnection(const TcpConnectionPtr& conn)
+  {
+    TcpConnectionPtr relayConn = relayConn_.lock();
+    if (conn->connected() && relayConn)
+    {
+      relayConn->spliceTo(conn);
+      conn->spliceTo(relayConn);
+      spliced_ = true;
+    }
+    else if (conn->disconnected())
+    {
+      quitWhenBothDown();
+    }
+  }
+
+  void quitWhenBothDown()
+  {
+    if (++disconnected_ == 2)
+    {
+      loop_->quit();
+    }
+  }
+
+  void onRelayMessage(const TcpConnectionPtr&, Buffer* buf, muduo::Timestamp)
+  {
+    if (spliced_)
+    {
+      bytesAfterSplice += buf->readableBytes();
+    }
+    else
+    {
+      bytesBeforeSplice = buf->readableBytes();
+    }
+  }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->send(message_);
+    }
+    else
+    {
+      quitWhenBothDown();
+    }
+  }
+
+  void onClientMessage(const TcpConnectionPtr& conn, Buffer* buf, muduo::Timestamp)
+  {
+    received += buf->retrieveAllAsString();
+    if (received.size() >= message_.size())
+    {
+      conn->shutdown();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpServer backend_;
+  TcpServer relay_;
+  TcpClient client_;
+  std::unique_ptr<TcpClient> upstream_;
+  std::weak_ptr<TcpConnection> relayConn_;
+  bool spliced_ = false;
+  int disconnected_ = 0;  // client and upstream
+  const string message_;
+};
+
+// writer -> server -> reader, the server splices one way only.
+// The reader does not read at first, so the writer's connection pauses.
+// The server sends filler to the reader before splicing.
+class OneWay
+{
+ public:
+  OneWay(EventLoop* loop, size_t messageSize)
+    : loop_(loop),
+      server_(loop, InetAddress(kOneWayPort, true), "OneWay"),
+      reader_(loop, InetAddress(kOneWayPort, true), "Reader"),
+      writer_(loop, InetAddress(kOneWayPort, true), "Writer"),
+      message_(pattern(messageSize))
+  {
+    server_.setConnectionCallback(
+        std::bind(&OneWay::onServerConnection, this, _1));
+    reader_.setConnectionCallback([this](const TcpConnectionPtr& conn)
+        {
+          if (conn->connected())
+          {
+            conn->stopRead();
+            onReader(conn);
+          }
+          else
+          {
+            readerClosed = true;
+            quitWhenAllDown();
+          }
+        });
+    reader_.setMessageCallback(
+        [this](const TcpConnectionPtr&, Buffer* buf, muduo::Timestamp)
+        { received += buf->retrieveAllAsString(); });
+    writer_.setConnectionCallback([this](const TcpConnectionPtr& conn)
+        {
+          if (conn->connected())
+          {
+            conn->send(message_);
+            conn->shutdown();
+          }
+          else
+          {
+            writerClosed = true;
+            quitWhenAllDown();
+          }
+        });
+  }
+
+  void run()
+  {
+    server_.start();
+    reader_.connect();
+    loop_->runAfter(10.0, [this] { loop_->quit(); });
+    loop_->loop();
+  }
+
+  TcpConnectionPtr sink() const { return sink_.lock(); }
+  const string& message() const { return message_; }
+
+  std::function<void (const TcpConnectionPtr&)> onReader;
+  string filler;
+  string received;
+  bool sinkClosed = false;
+  bool sourceClosed = false;
+  bool readerClosed = false;
+  bool writerClosed = false;
+
+ private:
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    TcpConnectionPtr sink = sink_.lock();
+    if (conn->connected() && !sink)
+    {
+      // the reader connects first, then the writer
+      sink_ = conn;
+      conn->send(filler);
+      writer_.connect();
+    }
+    else if (conn->connected())
+    {
+      source_ = conn;
+      conn->spliceTo(sink);
+    }
+    else
+    {
+      (conn == sink ? sinkClosed : sourceClosed) = true;
+      quitWhenAllDown();
+    }
+  }
+
+  void quitWhenAllDown()
+  {
+    if (readerClosed && writerClosed && sinkClosed && sourceClosed)
+    {
+      loop_->quit();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  TcpClient reader_;
+  TcpClient writer_;
+  std::weak_ptr<TcpConnection> sink_;
+  std::weak_ptr<TcpConnection> source_;
+  const string message_;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testSpliceRelay)
+{
+  EventLoop loop;
+  Relay relay(&loop, 8 * 1000 * 1000);
+  relay.run();
+  BOOST_CHECK_EQUAL(relay.bytesAfterSplice, 0);
+  BOOST_CHECK_EQUAL(relay.received.size(), relay.message().size());
+  BOOST_CHECK(relay.received == relay.message());
+  LOG_INFO << relay.bytesBeforeSplice << " bytes were read before splicing";
+}
+
+BOOST_AUTO_TEST_CASE(testSpliceSinkReset)
+{
+  EventLoop loop;
+  OneWay oneWay(&loop, 8 * 1000 * 1000);
+  oneWay.onReader = [&loop](const TcpConnectionPtr& conn)
+      {
+        // unread bytes make close(2) send a RST
+        loop.runAfter(0.5, [conn] { conn->forceClose(); });
+      };
+  oneWay.run();
+  BOOST_CHECK(oneWay.readerClosed);
+  BOOST_CHECK(oneWay.sourceClosed); // the paused source went on until the writer closed
+  BOOST_CHECK(oneWay.writerClosed);
+}
+
+BOOST_AUTO_TEST_CASE(testSpliceSendAfterPipe)
+{
+  EventLoop loop;
+  // the filler fills the socket buffers, the message then waits in the pipe
+  OneWay oneWay(&loop, 32 * 1000);
+  oneWay.filler = pattern(32 * 1000 * 1000);
+  const string tail = "sent by the server";
+  oneWay.onReader = [&](const TcpConnectionPtr& conn)
+      {
+        loop.runAfter(0.3, [&oneWay, &tail] { oneWay.sink()->send(tail); });
+        loop.runAfter(0.5, [conn] { conn->startRead(); });
+      };
+  oneWay.run();
+  BOOST_CHECK(oneWay.readerClosed);
+  BOOST_CHECK(oneWay.sourceClosed);
+  BOOST_CHECK_EQUAL(oneWay.received.size(),
+                    oneWay.filler.size() + oneWay.message().size() + tail.size());
+  BOOST_CHECK(oneWay.received == oneWay.filler + oneWay.message() + tail);
+}
@@ -0,0 +1,30 @@
+// Helpers shared by the unit tests of muduo/net.
+
+#ifndef MUDUO_NET_TESTS_TESTUTIL_H
+#define MUDUO_NET_TESTS_TESTUTIL_H
+
+#include "muduo/base/Types.h"
+
+namespace muduo
+{
+namespace net
+{
+namespace test
+{
+
+// "abc...zabc...", a corrupted or reordered copy does not compare equal
+inline string pattern(size_t len)
+{
+  string s(len, '\0');
+  for (size_t i = 0; i < len; ++i)
+  {
+    s[i] = static_cast<char>('a' + i % 26);
+  }
+  return s;
+}
+
+}  // namespace test
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TESTS_TESTUTIL_H
@@ -0,0 +1,91 @@
+#include "muduo/net/EventLoop.h"
+#include "muduo/base/Timestamp.h"
+
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+int g_fired = 0;
+
+void onTimeout()
+{
+  ++g_fired;
+}
+
+// one idle timeout per connection, refreshed on every message
+void benchRefresh(EventLoop::TimerQueueType type, const char* name,
+                  int connections, int messages)
+{
+  EventLoop loop(type);
+  std::vector<TimerId> timers(connections);
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < connections; ++i)
+  {
+    // in loop thread, runAfter() and cancel() are done synchronously
+    timers[i] = loop.runAfter(30.0 + i % 100, onTimeout);
+  }
+  Timestamp added(Timestamp::now());
+  for (int i = 0; i < messages; ++i)
+  {
+    int conn = rand() % connections;
+    loop.cancel(timers[conn]);
+    timers[conn] = loop.runAfter(30.0, onTimeout);
+  }
+  Timestamp refreshed(Timestamp::now());
+  for (int i = 0; i < messages; ++i)
+  {
+    int conn = rand() % connections;
+    loop.restart(timers[conn], addTime(refreshed, 30.0));
+  }
+  Timestamp restarted(Timestamp::now());
+  for (const TimerId& timer : timers)
+  {
+    loop.cancel(timer);
+  }
+  Timestamp end(Timestamp::now());
+
+  printf("%-6s add %.3fus/op refresh %.3fus/op restart %.3fus/op cancel %.3fus/op\n", name,
+         timeDifference(added, start) * 1e6 / connections,
+         timeDifference(refreshed, added) * 1e6 / messages,
+         timeDifference(restarted, refreshed) * 1e6 / messages,
+         timeDifference(end, restarted) * 1e6 / connections);
+}
+
+void quit(EventLoop* loop)
+{
+  loop->quit();
+}
+
+// short timers which do fire
+void benchExpire(EventLoop::TimerQueueType type, const char* name, int count)
+{
+  EventLoop loop(type);
+  g_fired = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < count; ++i)
+  {
+    loop.runAfter(0.001 * (i % 200), onTimeout);
+  }
+  loop.runAfter(0.5, std::bind(quit, &loop));
+  loop.loop();
+  printf("%-6s expire fired %d of %d in %.3fs\n", name, g_fired, count,
+         timeDifference(Timestamp::now(), start));
+}
+
+int main(int argc, char* argv[])
+{
+  int connections = argc > 1 ? atoi(argv[1]) : 100000;
+  int messages = argc > 2 ? atoi(argv[2]) : 1000000;
+  printf("connections %d messages %d\n", connections, messages);
+
+  benchRefresh(EventLoop::kSetTimerQueue, "set", connections, messages);
+  benchRefresh(EventLoop::kWheelTimerQueue, "wheel", connections, messages);
+  benchRefresh(EventLoop::kHeapTimerQueue, "heap", connections, messages);
+
+  benchExpire(EventLoop::kSetTimerQueue, "set", connections);
+  benchExpire(EventLoop::kWheelTimerQueue, "wheel", connections);
+  benchExpire(EventLoop::kHeapTimerQueue, "heap", connections);
+}
@@ -48,6 +48,9 @@ int main()
     TimerId t45 = loop.runAfter(4.5, std::bind(print, "once4.5"));
     loop.runAfter(4.2, std::bind(cancel, t45));
     loop.runAfter(4.8, std::bind(cancel, t45));
+    // windows overlap, both run at one wakeup
+    loop.runAfter(5, std::bind(print, "once5~6"), 1);
+    loop.runAfter(5.5, std::bind(print, "once5.5~6"), 0.5);
     loop.runEvery(2, std::bind(print, "every2"));
     TimerId t3 = loop.runEvery(3, std::bind(print, "every3"));
     loop.runAfter(9.001, std::bind(cancel, t3));
@@ -55,6 +58,27 @@ int main()
     loop.loop();
     print("main loop exits");
   }
+  {
+    EventLoop loop;
+    // both are due at one wakeup, the one run first cancels the other
+    int runs = 0;
+    TimerId timers[2];
+    for (int i = 0; i < 2; ++i)
+    {
+      timers[i] = loop.runAfter(0.5, [&loop, &runs, &timers, i]
+          {
+            ++runs;
+            loop.cancel(timers[1 - i]);
+          }, 0.2);
+    }
+    loop.runAfter(1, [&loop] { loop.quit(); });
+    loop.loop();
+    printf("%d of two timers cancelling each other ran\n", runs);
+    if (runs != 1)
+    {
+      return 1;
+    }
+  }
   sleep(1);
   {
     EventLoopThread loopThread;
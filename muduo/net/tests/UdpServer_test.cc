@@ -0,0 +1,90 @@
+// Echo datagrams through a UdpServer with one SO_REUSEPORT socket per loop,
+// from clients sending bursts of plain datagrams and UDP GSO buffers.
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/UdpServer.h"
+
+#include <atomic>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kClients = 4;
+const int kBurst = 32;
+const size_t kSegmentSize = 1000;
+
+std::atomic<int> g_served(0);
+int g_sent = 0;
+int g_echoed = 0;
+
+void onServerDatagram(UdpSocket* socket, const InetAddress& peer,
+                      const char* data, size_t len, Timestamp)
+{
+  ++g_served;
+  socket->sendTo(peer, data, len);
+}
+
+void onClientDatagram(UdpSocket*, const InetAddress&, const char*, size_t, Timestamp)
+{
+  ++g_echoed;
+}
+
+void sendBurst(UdpSocket* client, const InetAddress& serverAddr)
+{
+  char message[64];
+  for (int i = 0; i < kBurst; ++i)
+  {
+    int len = snprintf(message, sizeof message, "datagram %d", g_sent++);
+    client->sendTo(serverAddr, message, len);
+  }
+
+  // 8 datagrams in one UDP GSO send
+  string bulk(8 * kSegmentSize, 'x');
+  client->sendSegments(serverAddr, bulk.data(), bulk.size(), kSegmentSize);
+  g_sent += 8;
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  UdpServer server(&loop, InetAddress(0, true), "UdpEcho");
+  server.setThreadNum(argc > 1 ? atoi(argv[1]) : 2);
+  server.setDatagramCallback(onServerDatagram);
+  server.setSocketInitCallback([](UdpSocket* socket)
+  {
+    socket->setReceiveBufferSize(4 * 1024 * 1024);
+    if (!socket->enableGro())
+    {
+      printf("UDP GRO unavailable\n");
+    }
+  });
+  server.start();
+  const InetAddress serverAddr = server.listenAddress();
+
+  std::vector<std::unique_ptr<UdpSocket>> clients;
+  for (int i = 0; i < kClients; ++i)
+  {
+    clients.emplace_back(new UdpSocket(&loop, InetAddress(0, true)));
+    UdpSocket* client = clients.back().get();
+    client->setReceiveBufferSize(4 * 1024 * 1024);
+    client->setDatagramCallback(onClientDatagram);
+    client->start();
+    loop.runEvery(0.01, std::bind(sendBurst, client, serverAddr));
+  }
+  loop.runAfter(2.0, std::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  int64_t dropped = 0;
+  for (const auto& socket : server.sockets())
+  {
+    printf("server socket received %lld sent %lld\n",
+           static_cast<long long>(socket->receivedDatagrams()),
+           static_cast<long long>(socket->sentDatagrams()));
+    dropped += socket->droppedDatagrams();
+  }
+  printf("sent %d served %d echoed %d dropped %lld\n",
+         g_sent, g_served.load(), g_echoed, static_cast<long long>(dropped));
+}
@@ -0,0 +1,157 @@
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//#define BOOST_TEST_MODULE UnixSocketTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+using namespace muduo::net;
+using std::placeholders::_1;
+using std::placeholders::_2;
+using std::placeholders::_3;
+
+namespace
+{
+
+// The server echoes, and passes the read end of a pipe on connection.
+// The client reads the pipe and the echo, then disconnects,
+// the loop quits after the server has closed the connection too.
+class EchoPair
+{
+ public:
+  EchoPair(EventLoop* loop, const InetAddress& listenAddr)
+    : loop_(loop),
+      server_(loop, listenAddr, "UnixServer"),
+      client_(loop, listenAddr, "UnixClient")
+  {
+    server_.setConnectionCallback(
+        std::bind(&EchoPair::onServerConnection, this, _1));
+    server_.setMessageCallback(
+        std::bind(&EchoPair::onServerMessage, this, _1, _2, _3));
+    client_.setConnectionCallback(
+        std::bind(&EchoPair::onClientConnection, this, _1));
+    client_.setMessageCallback(
+        std::bind(&EchoPair::onClientMessage, this, _1, _2, _3));
+  }
+
+  void run()
+  {
+    server_.start();
+    client_.connect();
+    loop_->runAfter(5.0, [this] { loop_->quit(); });
+    loop_->loop();
+  }
+
+  string peerAddress;
+  string received;
+  string fromPipe;
+
+ private:
+  void onServerConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      int pipefd[2];
+      BOOST_REQUIRE(::pipe(pipefd) == 0);
+      BOOST_CHECK_EQUAL(::write(pipefd[1], "via pipe", 8), 8);
+      std::vector<int> fds;
+      fds.push_back(pipefd[0]);
+      conn->sendFds("F", fds);
+      ::close(pipefd[0]);
+      ::close(pipefd[1]);
+    }
+  }
+
+  void onServerMessage(const TcpConnectionPtr& conn, Buffer* buf, muduo::Timestamp)
+  {
+    conn->send(buf);
+  }
+
+  void onClientConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      peerAddress = conn->peerAddress().toIpPort();
+      conn->setFdsCallback(std::bind(&EchoPair::onClientFds, this, _1, _2));
+      conn->send("hello");
+    }
+    else
+    {
+      loop_->quit();
+    }
+  }
+
+  void onClientFds(const TcpConnectionPtr&, const std::vector<int>& fds)
+  {
+    for (int fd : fds)
+    {
+      char buf[64];
+      ssize_t n = ::read(fd, buf, sizeof buf);
+      if (n > 0)
+      {
+        fromPipe.append(buf, n);
+      }
+      ::close(fd);
+    }
+  }
+
+  void onClientMessage(const TcpConnectionPtr&, Buffer* buf, muduo::Timestamp)
+  {
+    received += buf->retrieveAllAsString();
+    if (received.size() >= 6)
+    {
+      client_.disconnect();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpServer server_;
+  TcpClient client_;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testAbstractSocket)
+{
+  char name[64];
+  snprintf(name, sizeof name, "@muduo_unix_test_%d", ::getpid());
+  InetAddress addr = InetAddress::fromUnixPath(name);
+  BOOST_CHECK_EQUAL(addr.family(), AF_UNIX);
+  BOOST_CHECK_EQUAL(addr.toIp(), string(name));
+
+  EventLoop loop;
+  EchoPair pair(&loop, addr);
+  pair.run();
+  BOOST_CHECK_EQUAL(pair.peerAddress, string("unix:") + name);
+  BOOST_CHECK_EQUAL(pair.received, string("Fhello"));
+  BOOST_CHECK_EQUAL(pair.fromPipe, string("via pipe"));
+}
+
+BOOST_AUTO_TEST_CASE(testPathSocket)
+{
+  char path[64];
+  snprintf(path, sizeof path, "/tmp/muduo_unix_test_%d.sock", ::getpid());
+  InetAddress addr = InetAddress::fromUnixPath(path);
+  BOOST_CHECK_EQUAL(addr.toIpPort(), string("unix:") + path);
+
+  struct stat st;
+  {
+    EventLoop loop;
+    EchoPair pair(&loop, addr);
+    pair.run();
+    BOOST_CHECK(::stat(path, &st) == 0 && S_ISSOCK(st.st_mode));
+    BOOST_CHECK_EQUAL(pair.received, string("Fhello"));
+    BOOST_CHECK_EQUAL(pair.fromPipe, string("via pipe"));
+  }
+  // removed by the Acceptor
+  BOOST_CHECK(::stat(path, &st) < 0);
+}
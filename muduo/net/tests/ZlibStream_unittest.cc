@@ -89,3 +89,23 @@ BOOST_AUTO_TEST_CASE(testZlibOutputStream5)
   printf("total %zd\n", output.readableBytes());
   BOOST_CHECK_EQUAL(stream.zlibErrorCode(), Z_STREAM_END);
 }
+
+BOOST_AUTO_TEST_CASE(testZlibOutputStreamReset)
+{
+  muduo::net::Buffer output;
+  muduo::net::ZlibOutputStream stream(&output, Z_DEFAULT_COMPRESSION, MAX_WBITS + 16);
+  BOOST_CHECK(stream.write("01234567890123456789012345678901234567890123456789"));
+  BOOST_CHECK(stream.end());
+  BOOST_CHECK_EQUAL(stream.zlibErrorCode(), Z_STREAM_END);
+  muduo::string first = output.retrieveAllAsString();
+  BOOST_CHECK_EQUAL(first.substr(0, 2), "\x1f\x8b"); // gzip
+
+  BOOST_CHECK(!stream.write("more"));
+  BOOST_CHECK(stream.reset());
+  BOOST_CHECK(stream.write("01234567890123456789012345678901234567890123456789"));
+  BOOST_CHECK(stream.end());
+  BOOST_CHECK(output.retrieveAllAsString() == first);
+
+  BOOST_CHECK(stream.finish() == false); // already ended
+  BOOST_CHECK(!stream.reset());
+}
@@ -0,0 +1,42 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/TimerQueue.h"
+#include "muduo/net/timer/HeapTimerQueue.h"
+#include "muduo/net/timer/SetTimerQueue.h"
+#include "muduo/net/timer/WheelTimerQueue.h"
+
+#include <stdlib.h>
+
+using namespace muduo::net;
+
+TimerQueue* TimerQueue::newTimerQueue(EventLoop* loop,
+                                      EventLoop::TimerQueueType type,
+                                      double tick)
+{
+  if (type == EventLoop::kDefaultTimerQueue)
+  {
+    if (::getenv("MUDUO_USE_TIMING_WHEEL"))
+    {
+      type = EventLoop::kWheelTimerQueue;
+    }
+    else if (::getenv("MUDUO_USE_TIMER_HEAP"))
+    {
+      type = EventLoop::kHeapTimerQueue;
+    }
+    else
+    {
+      type = EventLoop::kSetTimerQueue;
+    }
+  }
+
+  switch (type)
+  {
+    case EventLoop::kWheelTimerQueue:
+      return new WheelTimerQueue(loop, tick);
+    case EventLoop::kHeapTimerQueue:
+      return new HeapTimerQueue(loop);
+    default:
+      return new SetTimerQueue(loop);
+  }
+}
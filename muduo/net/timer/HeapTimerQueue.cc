@@ -0,0 +1,130 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/timer/HeapTimerQueue.h"
+
+#include "muduo/net/Timer.h"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+HeapTimerQueue::HeapTimerQueue(EventLoop* loop)
+  : TimerQueue(loop)
+{
+}
+
+HeapTimerQueue::~HeapTimerQueue() = default;
+
+bool HeapTimerQueue::insert(Timer* timer)
+{
+  loop_->assertInLoopThread();
+  assert(timer->index() == -1);
+  heap_.push_back(timer);
+  timer->set_index(static_cast<int>(heap_.size() - 1));
+  siftUp(heap_.size() - 1);
+  return heap_.front() == timer; //堆顶变了就是最早到期时间变了
+}
+
+void HeapTimerQueue::remove(Timer* timer)
+{
+  size_t pos = static_cast<size_t>(timer->index());
+  assert(pos < heap_.size() && heap_[pos] == timer);
+  Timer* last = heap_.back();
+  heap_.pop_back();
+  if (last != timer)
+  {
+    place(last, pos);
+    fix(pos);
+  }
+  timer->set_index(-1);
+}
+
+void HeapTimerQueue::reschedule(Timer* timer, Timestamp when)
+{
+  assert(heap_[timer->index()] == timer);
+  timer->set_expiration(when);
+  fix(static_cast<size_t>(timer->index()));
+}
+
+void HeapTimerQueue::getExpired(Timestamp now, TimerList* expired)
+{
+  while (!heap_.empty() && !(now < heap_.front()->expiration()))
+  {
+    Timer* timer = heap_.front();
+    remove(timer);
+    expired->push_back(timer);
+  }
+}
+
+Timestamp HeapTimerQueue::nextExpiration() const
+{
+  return heap_.empty() ? Timestamp::invalid() : heap_.front()->deadline();
+}
+
+void HeapTimerQueue::place(Timer* timer, size_t pos)
+{
+  heap_[pos] = timer;
+  timer->set_index(static_cast<int>(pos));
+}
+
+void HeapTimerQueue::siftUp(size_t pos)
+{
+  Timer* timer = heap_[pos];
+  while (pos > 0)
+  {
+    size_t parent = (pos - 1) / kArity;
+    if (!(timer->deadline() < heap_[parent]->deadline()))
+    {
+      break;
+    }
+    place(heap_[parent], pos);
+    pos = parent;
+  }
+  place(timer, pos);
+}
+
+void HeapTimerQueue::siftDown(size_t pos)
+{
+  Timer* timer = heap_[pos];
+  const size_t size = heap_.size();
+  while (true)
+  {
+    size_t first = pos * kArity + 1;
+    if (first >= size)
+    {
+      break;
+    }
+    size_t last = std::min(first + kArity, size);
+    size_t smallest = first;
+    for (size_t child = first + 1; child < last; ++child)
+    {
+      if (heap_[child]->deadline() < heap_[smallest]->deadline())
+      {
+        smallest = child;
+      }
+    }
+    if (!(heap_[smallest]->deadline() < timer->deadline()))
+    {
+      break;
+    }
+    place(heap_[smallest], pos);
+    pos = smallest;
+  }
+  place(timer, pos);
+}
+
+void HeapTimerQueue::fix(size_t pos)
+{
+  if (pos > 0 && heap_[pos]->deadline() < heap_[(pos - 1) / kArity]->deadline())
+  {
+    siftUp(pos);
+  }
+  else
+  {
+    siftDown(pos);
+  }
+}
@@ -0,0 +1,48 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMER_HEAPTIMERQUEUE_H
+#define MUDUO_NET_TIMER_HEAPTIMERQUEUE_H
+
+#include "muduo/net/TimerQueue.h"
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Timer queue with an indexed 4-ary min-heap, precise expirations.
+///
+/// O(log n) add and cancel without allocation, restart() sifts the timer
+/// in place. Timer::index() is the position in heap_.
+///
+class HeapTimerQueue : public TimerQueue
+{
+ public:
+  explicit HeapTimerQueue(EventLoop* loop);
+  ~HeapTimerQueue() override;
+
+ protected:
+  bool insert(Timer* timer) override;
+  void remove(Timer* timer) override;
+  void reschedule(Timer* timer, Timestamp when) override;
+  void getExpired(Timestamp now, TimerList* expired) override;
+  Timestamp nextExpiration() const override;
+
+ private:
+  static const size_t kArity = 4; //4叉堆比二叉堆层数少一半，子节点在同一个cache line
+
+  void siftUp(size_t pos);
+  void siftDown(size_t pos);
+  void fix(size_t pos);
+  void place(Timer* timer, size_t pos);
+
+  TimerList heap_;
+};
+
+}  // namespace net
+}  // namespace muduo
+#endif  // MUDUO_NET_TIMER_HEAPTIMERQUEUE_H
@@ -0,0 +1,84 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+
+#include "muduo/net/timer/SetTimerQueue.h"
+
+#include "muduo/net/Timer.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+SetTimerQueue::SetTimerQueue(EventLoop* loop)
+  : TimerQueue(loop)
+{
+}
+
+SetTimerQueue::~SetTimerQueue() = default;
+
+bool SetTimerQueue::insert(Timer* timer)
+{
+  loop_->assertInLoopThread();
+  //最早到器的时间是否改变
+  bool earliestChanged = false;
+  Timestamp when = timer->deadline();      //按最晚到期时间排序
+  EntrySet::iterator it = timers_.begin(); //第一个定时器，也就是时间最早的定时器
+
+  //如果timers_为空或者when小于timers_中的最早到期时间
+  if (it == timers_.end() || when < it->first)
+  {
+    earliestChanged = true; //需要更新变量
+  }
+  //插入到timers_中，按到期时间排序
+  std::pair<EntrySet::iterator, bool> result = timers_.insert(Entry(when, timer));
+  assert(result.second);
+  (void)result;
+  timer->set_index(0); // queued
+  return earliestChanged; //最早到期时间是否改变
+}
+
+void SetTimerQueue::remove(Timer* timer)
+{
+  size_t n = timers_.erase(Entry(timer->deadline(), timer));
+  assert(n == 1);
+  (void)n;
+  timer->set_index(-1);
+}
+
+void SetTimerQueue::getExpired(Timestamp now, TimerList* expired)
+{
+  Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
+  //返回第一个deadline未到的Timer的迭代器,二分
+  EntrySet::iterator end = timers_.lower_bound(sentry);
+  assert(end == timers_.end() || now < end->first); //断言找到了
+  // like hrtimer, also runs the following timers whose expiration passed,
+  // stops at the first one that is too early.
+  while (end != timers_.end() && !(now < end->second->expiration()))
+  {
+    ++end;
+  }
+  //将到期的定时器插入expired中
+  for (EntrySet::iterator it = timers_.begin(); it != end; ++it)
+  {
+    it->second->set_index(-1);
+    expired->push_back(it->second);
+  }
+  //从timers_中移除到期的定时器
+  timers_.erase(timers_.begin(), end);
+}
+
+Timestamp SetTimerQueue::nextExpiration() const
+{
+  return timers_.empty() ? Timestamp::invalid() : timers_.begin()->first;
+}
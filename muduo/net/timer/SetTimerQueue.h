@@ -0,0 +1,49 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMER_SETTIMERQUEUE_H
+#define MUDUO_NET_TIMER_SETTIMERQUEUE_H
+
+#include "muduo/net/TimerQueue.h"
+
+#include <set>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Timer queue with std::set, O(log n) add and cancel.
+///
+class SetTimerQueue : public TimerQueue
+{
+ public:
+  explicit SetTimerQueue(EventLoop* loop);
+  ~SetTimerQueue() override;
+
+ protected:
+  bool insert(Timer* timer) override;
+  void remove(Timer* timer) override;
+  void getExpired(Timestamp now, TimerList* expired) override;
+  Timestamp nextExpiration() const override;
+
+ private:
+  typedef std::pair<Timestamp, Timer*> Entry; //按照时间戳排序
+  typedef std::set<Entry> EntrySet;           //使用set不用map
+
+  // Timer list sorted by deadline
+  // Timer对象由TimerQueue的对象池管理，TimerId用序号校验，不再需要按地址排序的activeTimers_
+  EntrySet timers_; //timers_是按到期时间排序的
+};
+
+}  // namespace net
+}  // namespace muduo
+#endif  // MUDUO_NET_TIMER_SETTIMERQUEUE_H
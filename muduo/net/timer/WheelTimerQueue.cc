@@ -0,0 +1,196 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include "muduo/net/timer/WheelTimerQueue.h"
+
+#include "muduo/base/Clock.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/Timer.h"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// index of the first occupied slot at or after @c start, in wheel order
+int firstOccupied(uint64_t bitmap, int start)
+{
+  uint64_t rotated = (bitmap >> start) | (start ? bitmap << (64 - start) : 0);
+  return rotated ? __builtin_ctzll(rotated) : -1;
+}
+
+}  // namespace
+
+WheelTimerQueue::WheelTimerQueue(EventLoop* loop, double tick)
+  : TimerQueue(loop),
+    tickMicroSeconds_(std::max<int64_t>(1, static_cast<int64_t>(tick * Timestamp::kMicroSecondsPerSecond))),
+    currentTick_(Clock::monotonic().microSecondsSinceEpoch() / tickMicroSeconds_),
+    size_(0)
+{
+  memZero(occupied_, sizeof occupied_);
+  LOG_DEBUG << "WheelTimerQueue tick = " << tickMicroSeconds_ << "us";
+}
+
+WheelTimerQueue::~WheelTimerQueue() = default;
+
+bool WheelTimerQueue::insert(Timer* timer)
+{
+  loop_->assertInLoopThread();
+  Timestamp earliest = nextExpiration();
+  link(timer);
+  ++size_;
+  //最早唤醒时间可能是某一层的级联时刻，而不一定是这个定时器
+  return !earliest.valid() || nextExpiration() < earliest;
+}
+
+void WheelTimerQueue::remove(Timer* timer)
+{
+  unlink(timer);
+  --size_;
+}
+
+void WheelTimerQueue::getExpired(Timestamp now, TimerList* expired)
+{
+  const int64_t nowTick = now.microSecondsSinceEpoch() / tickMicroSeconds_;
+  while (currentTick_ <= nowTick)
+  {
+    int index = static_cast<int>(currentTick_ & kSlotMask);
+    if (index == 0)
+    {
+      //第0层转完一圈，把上层当前槽的定时器降级
+      for (int level = 1; level < kLevels; ++level)
+      {
+        cascade(level);
+        if (((currentTick_ >> (kLevelBits * level)) & kSlotMask) != 0)
+        {
+          break;
+        }
+      }
+    }
+
+    TimerList& slot = slots_[0][index];
+    for (Timer* timer : slot)
+    {
+      timer->set_index(-1);
+      timer->set_bucket(-1);
+      expired->push_back(timer);
+    }
+    size_ -= slot.size();
+    slot.clear();
+    occupied_[0] &= ~(1ULL << index);
+    ++currentTick_;
+
+    // skip empty slots till the next occupied one or the next cascade
+    int offset = static_cast<int>(currentTick_ & kSlotMask);
+    if (offset != 0)
+    {
+      uint64_t ahead = occupied_[0] >> offset;
+      int64_t next = ahead ? currentTick_ + __builtin_ctzll(ahead)
+                           : (currentTick_ | kSlotMask) + 1;
+      currentTick_ = std::min(next, nowTick + 1);
+    }
+  }
+}
+
+Timestamp WheelTimerQueue::nextExpiration() const
+{
+  if (size_ == 0)
+  {
+    return Timestamp::invalid();
+  }
+  int64_t earliest = INT64_MAX;
+  for (int level = 0; level < kLevels; ++level)
+  {
+    if (occupied_[level] == 0)
+    {
+      continue;
+    }
+    const int shift = kLevelBits * level;
+    const int64_t lowMask = (1LL << shift) - 1;
+    // current slot of upper levels is due only at the cascade boundary
+    int64_t start = (currentTick_ >> shift) + ((currentTick_ & lowMask) ? 1 : 0);
+    int distance = firstOccupied(occupied_[level], static_cast<int>(start & kSlotMask));
+    assert(distance >= 0);
+    earliest = std::min(earliest, (start + distance) << shift);
+  }
+  assert(earliest != INT64_MAX);
+  return Timestamp(earliest * tickMicroSeconds_);
+}
+
+int64_t WheelTimerQueue::tickOf(Timestamp when) const
+{
+  //向上取整，定时器不会提前触发
+  return (when.microSecondsSinceEpoch() + tickMicroSeconds_ - 1) / tickMicroSeconds_;
+}
+
+int64_t WheelTimerQueue::expiresOf(const Timer* timer) const
+{
+  const int64_t earliest = tickOf(timer->expiration());
+  int64_t expires = timer->deadline().microSecondsSinceEpoch() / tickMicroSeconds_;
+  //在[earliest, deadline]中找低位0最多的tick，窗口重叠的定时器落在同一个槽里
+  for (int64_t bit = 1; expires > earliest && (expires & ~bit) >= earliest; bit <<= 1)
+  {
+    expires &= ~bit;
+  }
+  return std::max(expires, earliest);
+}
+
+void WheelTimerQueue::link(Timer* timer)
+{
+  int64_t expires = std::max(expiresOf(timer), currentTick_);
+  int64_t delta = expires - currentTick_;
+  int level = 0;
+  while (level < kLevels - 1 && delta >= (1LL << (kLevelBits * (level + 1))))
+  {
+    ++level;
+  }
+  const int64_t range = 1LL << (kLevelBits * kLevels);
+  if (delta >= range)
+  {
+    // too far away, park it in the top level, it will be re-linked on cascade
+    expires = currentTick_ + range - 1;
+  }
+  int index = static_cast<int>((expires >> (kLevelBits * level)) & kSlotMask);
+  TimerList& slot = slots_[level][index];
+  timer->set_bucket(level * kSlotsPerLevel + index);
+  timer->set_index(static_cast<int>(slot.size()));
+  slot.push_back(timer);
+  occupied_[level] |= 1ULL << index;
+}
+
+void WheelTimerQueue::unlink(Timer* timer)
+{
+  const int level = timer->bucket() / kSlotsPerLevel;
+  const int index = timer->bucket() % kSlotsPerLevel;
+  TimerList& slot = slots_[level][index];
+  const int pos = timer->index();
+  assert(pos >= 0 && static_cast<size_t>(pos) < slot.size());
+  assert(slot[pos] == timer);
+  //和最后一个交换后删除，O(1)
+  slot[pos] = slot.back();
+  slot[pos]->set_index(pos);
+  slot.pop_back();
+  if (slot.empty())
+  {
+    occupied_[level] &= ~(1ULL << index);
+  }
+  timer->set_index(-1);
+  timer->set_bucket(-1);
+}
+
+void WheelTimerQueue::cascade(int level)
+{
+  int index = static_cast<int>((currentTick_ >> (kLevelBits * level)) & kSlotMask);
+  TimerList timers;
+  timers.swap(slots_[level][index]);
+  occupied_[level] &= ~(1ULL << index);
+  for (Timer* timer : timers)
+  {
+    link(timer);
+  }
+}
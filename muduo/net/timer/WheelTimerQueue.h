@@ -0,0 +1,61 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMER_WHEELTIMERQUEUE_H
+#define MUDUO_NET_TIMER_WHEELTIMERQUEUE_H
+
+#include "muduo/net/TimerQueue.h"
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Hierarchical timing wheel, O(1) add and cancel.
+///
+/// Expirations are rounded up to @c tick, so timers fire at most one tick late.
+/// A timer with slack is put at the tick which is a multiple of the largest
+/// power of two within its window, so overlapping windows share a slot.
+/// Each level has 64 slots, a slot of level n spans 64^n ticks,
+/// timers are cascaded to the lower level when their slot is reached.
+/// Suitable for lots of coarse timeouts which are mostly canceled,
+/// like idle timeouts of connections.
+///
+class WheelTimerQueue : public TimerQueue
+{
+ public:
+  WheelTimerQueue(EventLoop* loop, double tick);
+  ~WheelTimerQueue() override;
+
+ protected:
+  bool insert(Timer* timer) override;
+  void remove(Timer* timer) override;
+  void getExpired(Timestamp now, TimerList* expired) override;
+  Timestamp nextExpiration() const override;
+
+ private:
+  static const int kLevelBits = 6;
+  static const int kSlotsPerLevel = 1 << kLevelBits;
+  static const int kSlotMask = kSlotsPerLevel - 1;
+  static const int kLevels = 6;
+
+  int64_t tickOf(Timestamp when) const;
+  int64_t expiresOf(const Timer* timer) const;
+  void link(Timer* timer);
+  void unlink(Timer* timer);
+  void cascade(int level);
+
+  const int64_t tickMicroSeconds_;
+  int64_t currentTick_;  // next tick to be processed
+  //每个槽是一个vector，删除时和最后一个元素交换，Timer::index()是在槽中的下标
+  TimerList slots_[kLevels][kSlotsPerLevel];
+  uint64_t occupied_[kLevels];  // bitmap of non-empty slots
+  size_t size_;
+};
+
+}  // namespace net
+}  // namespace muduo
+#endif  // MUDUO_NET_TIMER_WHEELTIMERQUEUE_H